@@ -6,10 +6,15 @@
 //
 
 #include <time.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
 
 #include "model.h"
 #include "floorplan.h"
 #include "control.h"
+#include "bit.h"
 
 time_t g_start_time;
 #define TIME()		(time(0)-g_start_time)
@@ -18,6 +23,8 @@ time_t g_start_time;
 #define TIME_AND_MEM()	TIMESTAMP(); MEMUSAGE()
 
 #define AUTOTEST_TMP_DIR	"test.out"
+// With --jobs, diff steps are verified in chunks of this many steps.
+#define JOB_CHUNK		16
 
 struct test_state
 {
@@ -26,14 +33,52 @@ struct test_state
 	char cmdline_diff_exec[1024];
 	int dry_run;
 	int diff_to_null;
+	int cmdline_stats;
+	int cmdline_threads;
 
 	struct fpga_model* model;
 	// test filenames are: tmp_dir/autotest_<base_name>_<diff_counter>.???
 	char tmp_dir[256];
 	char base_name[256];
 	int next_diff_counter;
+
+	// Without a diff executable, every step is verified in-process
+	// by verify_step(). rt_model is built on first use and reset
+	// between steps. prior_fp and prior_b2f hold the floorplan and
+	// round-tripped floorplan text of the previous step.
+	struct fpga_model* rt_model;
+	struct fpga_bits rt_bits;
+	char* prior_fp;
+	size_t prior_fp_len;
+	char* prior_b2f;
+	size_t prior_b2f_len;
+
+	// With --jobs=<num> above 1, the test runs in num forked
+	// workers. Chunk c covers the output after diff step
+	// c*JOB_CHUNK up to and including step (c+1)*JOB_CHUNK and
+	// is written by worker c%num into
+	// tmp_dir/autotest_<base_name>_chunk<c>.log, output of other
+	// chunks goes to /dev/null. Each worker stores the last step
+	// it finished in last_step[job], shared with the parent that
+	// concatenates the chunks in order.
+	int cmdline_jobs;
+	int job;
+	int* last_step;
 };
 
+static void printf_stats(struct test_state* tstate)
+{
+	if (!tstate->cmdline_stats)
+		return;
+	printf("O Test model counters:\n");
+	fpga_print_stats(stdout, tstate->model);
+	if (tstate->rt_model) {
+		printf("O Round-trip model counters:\n");
+		fpga_print_stats(stdout, tstate->rt_model);
+	}
+	printf("\n");
+}
+
 static int dump_file(const char* path)
 {
 	char line[1024];
@@ -64,33 +109,278 @@ static int diff_start(struct test_state* tstate, const char* base_name)
 	return 0;
 }
 
+static void chunk_path(struct test_state* tstate, int chunk,
+	char* buf, int buf_len)
+{
+	snprintf(buf, buf_len, "%s/autotest_%s_chunk%06i.log",
+		tstate->tmp_dir, tstate->base_name, chunk);
+}
+
+static int job_owns_step(struct test_state* tstate, int step)
+{
+	return tstate->cmdline_jobs < 2
+		|| ((step-1)/JOB_CHUNK) % tstate->cmdline_jobs == tstate->job;
+}
+
+// Points stdout and stderr to the chunk's log if this worker owns
+// the chunk, and to /dev/null otherwise.
+static int job_start_chunk(struct test_state* tstate, int chunk)
+{
+	char path[1024];
+	int fd, rc;
+
+	fflush(stdout);
+	fflush(stderr);
+	if (job_owns_step(tstate, chunk*JOB_CHUNK+1)) {
+		chunk_path(tstate, chunk, path, sizeof(path));
+		fd = open(path, O_WRONLY|O_CREAT|O_TRUNC, 0644);
+	} else
+		fd = open("/dev/null", O_WRONLY);
+	if (fd == -1) FAIL(errno);
+	if (dup2(fd, STDOUT_FILENO) == -1
+	    || dup2(fd, STDERR_FILENO) == -1) FAIL(errno);
+	close(fd);
+	return 0;
+fail:
+	return rc;
+}
+
+static int diff_step_done(struct test_state* tstate)
+{
+	int step;
+
+	step = tstate->next_diff_counter++;
+	if (tstate->cmdline_jobs < 2)
+		return 0;
+	tstate->last_step[tstate->job] = step;
+	if (step % JOB_CHUNK)
+		return 0;
+	return job_start_chunk(tstate, step/JOB_CHUNK);
+}
+
+// Forks the workers, which return 0 and continue with the test. The
+// parent waits for them, prints the chunks in order and exits with
+// the workers' exit code. Every worker replays the whole test, so a
+// failure that all workers agree on was already logged by the owner
+// of the step, only disagreeing workers are reported.
+static int fork_jobs(struct test_state* tstate)
+{
+	char path[1024], buf[4096];
+	FILE* f;
+	pid_t* pids = 0;
+	int* statuses = 0;
+	int i, chunk, last_chunk, len, rc;
+
+	pids = calloc(tstate->cmdline_jobs, sizeof(*pids));
+	statuses = calloc(tstate->cmdline_jobs, sizeof(*statuses));
+	if (!pids || !statuses) FAIL(ENOMEM);
+	tstate->last_step = mmap(/*addr*/ 0,
+		tstate->cmdline_jobs*sizeof(*tstate->last_step),
+		PROT_READ|PROT_WRITE, MAP_SHARED|MAP_ANONYMOUS, -1, 0);
+	if (tstate->last_step == MAP_FAILED) FAIL(errno);
+
+	fflush(stdout);
+	for (i = 0; i < tstate->cmdline_jobs; i++) {
+		pids[i] = fork();
+		if (pids[i] == -1) FAIL(errno);
+		if (!pids[i]) {
+			free(pids);
+			free(statuses);
+			tstate->job = i;
+			return job_start_chunk(tstate, 0);
+		}
+	}
+
+	for (i = 0; i < tstate->cmdline_jobs; i++) {
+		if (waitpid(pids[i], &statuses[i], 0) == -1) FAIL(errno);
+	}
+	rc = WIFEXITED(statuses[0]) ? WEXITSTATUS(statuses[0]) : EINVAL;
+	last_chunk = tstate->last_step[0]/JOB_CHUNK;
+	for (chunk = 0; chunk <= last_chunk; chunk++) {
+		chunk_path(tstate, chunk, path, sizeof(path));
+		f = fopen(path, "r");
+		if (!f) {
+			printf("#E %s:%i missing %s\n", __FILE__, __LINE__, path);
+			rc = EINVAL;
+			continue;
+		}
+		while ((len = fread(buf, 1, sizeof(buf), f)) > 0)
+			fwrite(buf, 1, len, stdout);
+		fclose(f);
+		unlink(path);
+	}
+	for (i = 0; i < tstate->cmdline_jobs; i++) {
+		if (!WIFEXITED(statuses[i]) || statuses[i] != statuses[0]) {
+			printf("#E %s:%i worker %i failed with status 0x%x\n",
+				__FILE__, __LINE__, i, statuses[i]);
+			if (!rc) rc = EINVAL;
+		}
+		if (tstate->last_step[i] != tstate->last_step[0]) {
+			printf("#E %s:%i worker %i stopped at diff %i, "
+				"worker 0 at %i\n", __FILE__, __LINE__, i,
+				tstate->last_step[i], tstate->last_step[0]);
+			if (!rc) rc = EINVAL;
+		}
+	}
+	free(pids);
+	free(statuses);
+	exit(rc);
+fail:
+	free(pids);
+	free(statuses);
+	return rc;
+}
+
+// Appends what dump_config() prints about bits that extract_model()
+// did not consume, the last part of bit2fp output.
+static int printf_unknown_bits(FILE* dest_f, struct fpga_bits* bits)
+{
+	struct fpga_config cfg;
+
+	CLEAR(cfg);
+	cfg.idcode_reg = 0;
+	cfg.reg[0].int_v = XC6SLX9;
+	cfg.bits = *bits;
+	return dump_config(dest_f, &cfg, DUMP_BITS);
+}
+
+static int build_rt_model(struct test_state* tstate)
+{
+	int rc;
+
+	tstate->rt_model = malloc(sizeof(*tstate->rt_model));
+	if (!tstate->rt_model) FAIL(ENOMEM);
+	rc = fpga_build_model(tstate->rt_model, XC6SLX9, FTG256);
+	if (rc) FAIL(rc);
+	tstate->rt_bits.len = BITS_LEN;
+	tstate->rt_bits.d = malloc(tstate->rt_bits.len);
+	if (!tstate->rt_bits.d) FAIL(ENOMEM);
+	return 0;
+fail:
+	return rc;
+}
+
+// Same as autotest_diff.sh, without running fp2bit and bit2fp:
+// the floorplan is read into rt_model, written into rt_bits and
+// extracted again. The .diff file gets the floorplan diff and the
+// diff of the round-tripped floorplan, both against the prior step.
+// Without path_base, no file is written and only the prior is updated.
+static int verify_step(struct test_state* tstate, const char* path_base,
+	const char* fp, size_t fp_len, int diff_to_null)
+{
+	char path[1024];
+	char* b2f = 0;
+	size_t b2f_len;
+	FILE *f = 0;
+	int rc;
+
+	if (!tstate->rt_model) {
+		rc = build_rt_model(tstate);
+		if (rc) FAIL(rc);
+	}
+
+	// fp2bit
+	rc = fpga_reset_model(tstate->rt_model);
+	if (rc) FAIL(rc);
+	f = fmemopen((void*) fp, fp_len, "r");
+	if (!f) FAIL(errno);
+	rc = read_floorplan(tstate->rt_model, f);
+	if (rc) FAIL(rc);
+	fclose(f);
+	f = 0;
+	memset(tstate->rt_bits.d, 0, tstate->rt_bits.len);
+	rc = write_model(&tstate->rt_bits, tstate->rt_model);
+	if (rc) FAIL(rc);
+
+	// bit2fp --no-json
+	rc = fpga_reset_model(tstate->rt_model);
+	if (rc) FAIL(rc);
+	rc = extract_model(tstate->rt_model, &tstate->rt_bits);
+	if (rc) FAIL(rc);
+	f = open_memstream(&b2f, &b2f_len);
+	if (!f) FAIL(errno);
+	rc = write_floorplan(f, tstate->rt_model, FP_NO_JSON);
+	if (rc) FAIL(rc);
+	rc = printf_unknown_bits(f, &tstate->rt_bits);
+	if (rc) FAIL(rc);
+	fclose(f);
+	f = 0;
+
+	if (path_base) {
+		snprintf(path, sizeof(path), "%s.diff", path_base);
+		f = fopen(path, "w");
+		if (!f) FAIL(errno);
+		fprintf(f, "fp:\n");
+		rc = diff_to_null ? printf_line_diff(f, "", 0, fp, fp_len)
+			: printf_line_diff(f, tstate->prior_fp,
+				tstate->prior_fp_len, fp, fp_len);
+		if (rc) FAIL(rc);
+		fprintf(f, "bit:\n");
+		rc = diff_to_null ? printf_line_diff(f, "", 0, b2f, b2f_len)
+			: printf_line_diff(f, tstate->prior_b2f,
+				tstate->prior_b2f_len, b2f, b2f_len);
+		if (rc) FAIL(rc);
+		fclose(f);
+		f = 0;
+	}
+
+	free(tstate->prior_b2f);
+	tstate->prior_b2f = b2f;
+	tstate->prior_b2f_len = b2f_len;
+	return 0;
+fail:
+	if (f) fclose(f);
+	free(b2f);
+	// a failed round trip leaves the model unusable
+	if (tstate->rt_model && tstate->rt_model->rc) {
+		fpga_free_model(tstate->rt_model);
+		free(tstate->rt_model);
+		tstate->rt_model = 0;
+	}
+	return rc;
+}
+
 static int diff_printf(struct test_state* tstate)
 {
 	char path[1024], tmp[1024], prior_fp[1024];
-	int path_base;
+	char* fp = 0;
+	size_t fp_len;
+	int path_base, prime;
 	FILE* dest_f = 0;
 	int rc;
 
 	if (tstate->cmdline_count != -1
 	    && tstate->next_diff_counter > tstate->cmdline_skip + tstate->cmdline_count) {
 		printf("\nO Finished %i tests.\n", tstate->cmdline_count);
+		printf_stats(tstate);
 		exit(0);
 	}
 	if (tstate->dry_run) {
-		printf("O Dry run, skipping diff %i.\n", tstate->next_diff_counter++);
-		return 0;
+		printf("O Dry run, skipping diff %i.\n", tstate->next_diff_counter);
+		return diff_step_done(tstate);
 	}
 	if (tstate->next_diff_counter <= tstate->cmdline_skip) {
-		tstate->next_diff_counter++;
+		rc = diff_step_done(tstate);
 		if (tstate->next_diff_counter == tstate->cmdline_skip)
 			printf("O Skipping diffs 1-%i.\n", tstate->next_diff_counter);
-		return 0;
+		return rc;
+	}
+	// A worker skips steps of chunks it does not own, except for
+	// the last step before its own chunk, which is only kept in
+	// memory so that the next step has a prior. Its files belong
+	// to the worker owning that step.
+	prime = 0;
+	if (!job_owns_step(tstate, tstate->next_diff_counter)) {
+		if (tstate->next_diff_counter % JOB_CHUNK
+		    || !job_owns_step(tstate, tstate->next_diff_counter+1))
+			return diff_step_done(tstate);
+		prime = 1;
 	}
 
 	snprintf(path, sizeof(path), "%s/autotest_%s_%06i", tstate->tmp_dir,
 		tstate->base_name, tstate->next_diff_counter);
 	path_base = strlen(path);
-	if (tstate->diff_to_null
+	if (tstate->diff_to_null || prime || !tstate->prior_fp
 	    || tstate->next_diff_counter == tstate->cmdline_skip + 1)
 		strcpy(prior_fp, "/dev/null");
 	else {
@@ -99,37 +389,66 @@ static int diff_printf(struct test_state* tstate)
 			tstate->next_diff_counter-1);
 	}
 
-	strcpy(&path[path_base], ".fp");
-	dest_f = fopen(path, "w");
+	dest_f = open_memstream(&fp, &fp_len);
 	if (!dest_f) FAIL(errno);
-
 	rc = printf_devices(dest_f, tstate->model, /*config_only*/ 1, /*no_json*/ 1);
 	if (rc) FAIL(rc);
 	rc = printf_nets(dest_f, tstate->model, /*no_json*/ 1);
 	if (rc) FAIL(rc);
+	fclose(dest_f);
+	dest_f = 0;
 
+	if (prime) {
+		// --jobs is only supported with in-process verification
+		rc = verify_step(tstate, /*path_base*/ 0, fp, fp_len,
+			/*diff_to_null*/ 1);
+		if (rc)
+			printf("#E %s:%i in-process verification failed "
+				"with code %i\n", __FILE__, __LINE__, rc);
+		free(tstate->prior_fp);
+		tstate->prior_fp = fp;
+		tstate->prior_fp_len = fp_len;
+		return diff_step_done(tstate);
+	}
+
+	strcpy(&path[path_base], ".fp");
+	dest_f = fopen(path, "w");
+	if (!dest_f) FAIL(errno);
+	if (fwrite(fp, 1, fp_len, dest_f) != fp_len) FAIL(errno);
 	fclose(dest_f);
 	dest_f = 0;
 	path[path_base] = 0;
-	snprintf(tmp, sizeof(tmp), "%s %s %s.fp >%s.log 2>&1",
-		tstate->cmdline_diff_exec, prior_fp, path, path);
-	rc = system(tmp);
-	if (rc) {
-		printf("#E %s:%i system call '%s' failed with code %i, "
-			"check %s.log\n", __FILE__, __LINE__, tmp, rc, path);
-		// ENOENT comes back when pressing ctrl-c
-		if (rc == ENOENT) EXIT(rc);
+
+	if (!tstate->cmdline_diff_exec[0]) {
+		rc = verify_step(tstate, path, fp, fp_len,
+			/*diff_to_null*/ !strcmp(prior_fp, "/dev/null"));
+		if (rc)
+			printf("#E %s:%i in-process verification failed with "
+				"code %i\n", __FILE__, __LINE__, rc);
+	} else {
+		snprintf(tmp, sizeof(tmp), "%s %s %s.fp >%s.log 2>&1",
+			tstate->cmdline_diff_exec, prior_fp, path, path);
+		rc = system(tmp);
+		if (rc) {
+			printf("#E %s:%i system call '%s' failed with code %i, "
+				"check %s.log\n", __FILE__, __LINE__, tmp, rc, path);
+			// ENOENT comes back when pressing ctrl-c
+			if (rc == ENOENT) EXIT(rc);
 // todo: report the error up so we can avoid adding a switch to the block list etc.
+		}
 	}
+	free(tstate->prior_fp);
+	tstate->prior_fp = fp;
+	tstate->prior_fp_len = fp_len;
+	fp = 0;
 
 	strcpy(&path[path_base], ".diff");
 	rc = dump_file(path);
 	if (rc) FAIL(rc);
-
-	tstate->next_diff_counter++;
-	return 0;
+	return diff_step_done(tstate);
 fail:
 	if (dest_f) fclose(dest_f);
+	free(fp);
 	return rc;
 }
 
@@ -895,7 +1214,7 @@ static int test_iob_config(struct test_state* tstate)
 	if (!dev) FAIL(EINVAL);
 
 	if ((rc = diff_printf(tstate))) FAIL(rc);
-	dev->u.iob.I_mux = IMUX_I_B;
+	dev->u->iob.I_mux = IMUX_I_B;
 	if ((rc = diff_printf(tstate))) FAIL(rc);
 
 	fdev_delete(tstate->model, iob_y, iob_x, DEV_IOB, iob_type_idx);
@@ -917,37 +1236,37 @@ static int test_iob_config(struct test_state* tstate)
 	if (!dev) FAIL(EINVAL);
 
 	// least amount of bits:
-	dev->u.iob.slew = SLEW_SLOW;
-	dev->u.iob.drive_strength = 8;
-	dev->u.iob.suspend = SUSP_3STATE;
+	dev->u->iob.slew = SLEW_SLOW;
+	dev->u->iob.drive_strength = 8;
+	dev->u->iob.suspend = SUSP_3STATE;
 
-	dev->u.iob.suspend = SUSP_3STATE;
+	dev->u->iob.suspend = SUSP_3STATE;
 	rc = diff_printf(tstate); if (rc) FAIL(rc);
-	dev->u.iob.suspend = SUSP_3STATE_OCT_ON;
+	dev->u->iob.suspend = SUSP_3STATE_OCT_ON;
 	rc = diff_printf(tstate); if (rc) FAIL(rc);
-	dev->u.iob.suspend = SUSP_3STATE_KEEPER;
+	dev->u->iob.suspend = SUSP_3STATE_KEEPER;
 	rc = diff_printf(tstate); if (rc) FAIL(rc);
-	dev->u.iob.suspend = SUSP_3STATE_PULLUP;
+	dev->u->iob.suspend = SUSP_3STATE_PULLUP;
 	rc = diff_printf(tstate); if (rc) FAIL(rc);
-	dev->u.iob.suspend = SUSP_3STATE_PULLDOWN;
+	dev->u->iob.suspend = SUSP_3STATE_PULLDOWN;
 	rc = diff_printf(tstate); if (rc) FAIL(rc);
-	dev->u.iob.suspend = SUSP_LAST_VAL;
+	dev->u->iob.suspend = SUSP_LAST_VAL;
 	rc = diff_printf(tstate); if (rc) FAIL(rc);
-	dev->u.iob.suspend = SUSP_3STATE;
+	dev->u->iob.suspend = SUSP_3STATE;
 
 	for (i = 0; i < sizeof(drive_strengths)/sizeof(*drive_strengths); i++) {
-		dev->u.iob.drive_strength = drive_strengths[i];
+		dev->u->iob.drive_strength = drive_strengths[i];
 		rc = diff_printf(tstate); if (rc) FAIL(rc);
 	}
-	dev->u.iob.drive_strength = 8;
+	dev->u->iob.drive_strength = 8;
 
-	dev->u.iob.slew = SLEW_SLOW;
+	dev->u->iob.slew = SLEW_SLOW;
 	rc = diff_printf(tstate); if (rc) FAIL(rc);
-	dev->u.iob.slew = SLEW_FAST;
+	dev->u->iob.slew = SLEW_FAST;
 	rc = diff_printf(tstate); if (rc) FAIL(rc);
-	dev->u.iob.slew = SLEW_QUIETIO;
+	dev->u->iob.slew = SLEW_QUIETIO;
 	rc = diff_printf(tstate); if (rc) FAIL(rc);
-	dev->u.iob.slew = SLEW_SLOW;
+	dev->u->iob.slew = SLEW_SLOW;
 
 	fdev_delete(tstate->model, iob_y, iob_x, DEV_IOB, iob_type_idx);
 
@@ -960,9 +1279,9 @@ static int test_iob_config(struct test_state* tstate)
 	if (!dev) FAIL(EINVAL);
 
 	// least bits
-	dev->u.iob.slew = SLEW_SLOW;
-	dev->u.iob.drive_strength = 8;
-	dev->u.iob.suspend = SUSP_3STATE;
+	dev->u->iob.slew = SLEW_SLOW;
+	dev->u->iob.drive_strength = 8;
+	dev->u->iob.suspend = SUSP_3STATE;
 
 	// new net
 	rc = fnet_new(tstate->model, &net_idx);
@@ -1019,7 +1338,7 @@ static int test_iob_config(struct test_state* tstate)
 				     || !strcmp(io_std[i], IO_LVCMOS12_JEDEC))
 				    && (drive_strengths[j] == 16 || drive_strengths[j] == 24))
 					continue;
-				dev->u.iob.drive_strength = drive_strengths[j];
+				dev->u->iob.drive_strength = drive_strengths[j];
 				rc = diff_printf(tstate); if (rc) FAIL(rc);
 			}
 		}
@@ -2183,7 +2502,297 @@ fail:
 	return rc;
 }
 
-#define DEFAULT_DIFF_EXEC "./autotest_diff.sh"
+//
+// The threads test converts the hello_world design in cmdline_threads
+// threads at once, each with its own model, and compares the results
+// with the same conversion run alone beforehand. It keeps the
+// per-thread string buffers and caches of the libraries honest.
+//
+
+struct conversion
+{
+	pthread_t thread;
+	int rc;
+	char* fp; // placed design
+	size_t fp_len;
+	char* b2f; // design after write_model() and extract_model()
+	size_t b2f_len;
+	struct fpga_bits bits; // bits left over by extract_model()
+};
+
+static int place_hello_world(struct fpga_model* model)
+{
+	int iob_a_y, iob_a_x, iob_a_idx, iob_b_y, iob_b_x, iob_b_idx;
+	int iob_y_y, iob_y_x, iob_y_idx, logic_y, logic_x, rc;
+	struct fpgadev_logic logic_cfg;
+	net_idx_t net;
+
+	RC_CHECK(model);
+	fpga_find_iob(model, "P45", &iob_a_y, &iob_a_x, &iob_a_idx);
+	fdev_iob_input(model, iob_a_y, iob_a_x, iob_a_idx, IO_LVCMOS33);
+	fpga_find_iob(model, "P46", &iob_b_y, &iob_b_x, &iob_b_idx);
+	fdev_iob_input(model, iob_b_y, iob_b_x, iob_b_idx, IO_LVCMOS33);
+	fpga_find_iob(model, "P48", &iob_y_y, &iob_y_x, &iob_y_idx);
+	fdev_iob_output(model, iob_y_y, iob_y_x, iob_y_idx, IO_LVCMOS33);
+
+	logic_y = 68;
+	logic_x = 13;
+	CLEAR(logic_cfg);
+	logic_cfg.a2d[LUT_D].flags |= OUT_USED | LUT6VAL_SET;
+	if ((rc = bool_str2u64("A3*A5", &logic_cfg.a2d[LUT_D].lut6_val)))
+		RC_FAIL(model, rc);
+	fdev_logic_setconf(model, logic_y, logic_x, DEV_LOG_X, &logic_cfg);
+
+	fnet_new(model, &net);
+	fnet_add_port(model, net, iob_a_y, iob_a_x, DEV_IOB, iob_a_idx,
+		IOB_OUT_I);
+	fnet_add_port(model, net, logic_y, logic_x, DEV_LOGIC, DEV_LOG_X,
+		LI_D3);
+	fnet_route(model, net);
+
+	fnet_new(model, &net);
+	fnet_add_port(model, net, iob_b_y, iob_b_x, DEV_IOB, iob_b_idx,
+		IOB_OUT_I);
+	fnet_add_port(model, net, logic_y, logic_x, DEV_LOGIC, DEV_LOG_X,
+		LI_D5);
+	fnet_route(model, net);
+
+	fnet_new(model, &net);
+	fnet_add_port(model, net, logic_y, logic_x, DEV_LOGIC, DEV_LOG_X,
+		LO_D);
+	fnet_add_port(model, net, iob_y_y, iob_y_x, DEV_IOB, iob_y_idx,
+		IOB_IN_O);
+	fnet_route(model, net);
+	RC_RETURN(model);
+}
+
+static int convert_design(struct conversion* conv)
+{
+	struct fpga_model* model;
+	FILE* f = 0;
+	int rc;
+
+	// the hello_world pins are TQG144 pins
+	model = malloc(sizeof(*model));
+	if (!model) FAIL(ENOMEM);
+	rc = fpga_build_model(model, XC6SLX9, TQG144);
+	if (rc) FAIL(rc);
+	rc = place_hello_world(model);
+	if (rc) FAIL(rc);
+	f = open_memstream(&conv->fp, &conv->fp_len);
+	if (!f) FAIL(errno);
+	rc = write_floorplan(f, model, FP_NO_JSON);
+	if (rc) FAIL(rc);
+	fclose(f);
+	f = 0;
+
+	conv->bits.len = BITS_LEN;
+	conv->bits.d = calloc(conv->bits.len, 1);
+	if (!conv->bits.d) FAIL(ENOMEM);
+	rc = write_model(&conv->bits, model);
+	if (rc) FAIL(rc);
+	rc = fpga_reset_model(model);
+	if (rc) FAIL(rc);
+	rc = extract_model(model, &conv->bits);
+	if (rc) FAIL(rc);
+	f = open_memstream(&conv->b2f, &conv->b2f_len);
+	if (!f) FAIL(errno);
+	rc = write_floorplan(f, model, FP_NO_JSON);
+	if (rc) FAIL(rc);
+	fclose(f);
+	f = 0;
+	rc = 0;
+fail:
+	if (f) fclose(f);
+	if (model) {
+		fpga_free_model(model);
+		free(model);
+	}
+	return rc;
+}
+
+static void* convert_thread(void* arg)
+{
+	struct conversion* conv = arg;
+
+	conv->rc = convert_design(conv);
+	return 0;
+}
+
+static void free_conversion(struct conversion* conv)
+{
+	free(conv->fp);
+	free(conv->b2f);
+	free(conv->bits.d);
+}
+
+static int test_threads(struct test_state* tstate)
+{
+	struct conversion ref, *convs;
+	int num_threads, num_started, i, rc;
+
+	num_threads = tstate->cmdline_threads;
+	CLEAR(ref);
+	rc = convert_design(&ref);
+	if (rc) FAIL(rc);
+	printf("O Single-threaded: %zu bytes floorplan, %zu bytes after"
+		" round trip.\n", ref.fp_len, ref.b2f_len);
+
+	convs = calloc(num_threads, sizeof(*convs));
+	if (!convs) FAIL(ENOMEM);
+	for (num_started = 0; num_started < num_threads; num_started++) {
+		rc = pthread_create(&convs[num_started].thread, /*attr*/ 0,
+			convert_thread, &convs[num_started]);
+		if (rc) {
+			printf("#E %s:%i cannot start thread %i: %s\n",
+				__FILE__, __LINE__, num_started, strerror(rc));
+			break;
+		}
+	}
+	for (i = 0; i < num_started; i++) {
+		pthread_join(convs[i].thread, /*retval*/ 0);
+		if (convs[i].rc) {
+			printf("#E Thread %i failed with code %i.\n",
+				i, convs[i].rc);
+			rc = EINVAL;
+		} else if (convs[i].fp_len != ref.fp_len
+		    || memcmp(convs[i].fp, ref.fp, ref.fp_len)) {
+			printf("#E Thread %i: floorplan differs.\n", i);
+			rc = EINVAL;
+		} else if (convs[i].b2f_len != ref.b2f_len
+		    || memcmp(convs[i].b2f, ref.b2f, ref.b2f_len)) {
+			printf("#E Thread %i: round-tripped floorplan "
+				"differs.\n", i);
+			rc = EINVAL;
+		} else if (memcmp(convs[i].bits.d, ref.bits.d, BITS_LEN)) {
+			printf("#E Thread %i: leftover bits differ.\n", i);
+			rc = EINVAL;
+		} else
+			printf("O Thread %i matches.\n", i);
+		free_conversion(&convs[i]);
+	}
+	free(convs);
+	free_conversion(&ref);
+	if (num_started < num_threads && !rc)
+		rc = EAGAIN;
+	return rc;
+fail:
+	free_conversion(&ref);
+	return rc;
+}
+
+//
+// The build_exact test builds a second model with
+// fpga_build_model_exact() and compares its tiles, devices, ports,
+// connections and switches with the model built the default way,
+// one row of tiles at a time.
+//
+
+enum { SECT_TILES = 0, SECT_DEVICES, SECT_PORTS, SECT_CONNS,
+	SECT_SWITCHES, NUM_SECTIONS };
+
+static const char* s_section_names[NUM_SECTIONS] =
+	{ "tiles", "devices", "ports", "conns", "switches" };
+
+static int printf_section(FILE* f, struct fpga_model* model, int section,
+	const struct fp_range* range)
+{
+	switch (section) {
+		case SECT_TILES: return printf_tiles_range(f, model, range);
+		case SECT_DEVICES: return printf_devices_range(f, model,
+			/*config_only*/ 0, /*no_json*/ 1, range);
+		case SECT_PORTS: return printf_ports_range(f, model, range);
+		case SECT_CONNS: return printf_conns_range(f, model, range);
+		case SECT_SWITCHES: return printf_switches_range(f, model,
+			range);
+	}
+	return EINVAL;
+}
+
+static int dump_section(struct fpga_model* model, int section,
+	const struct fp_range* range, char** buf, size_t* len)
+{
+	FILE* f;
+	int rc;
+
+	*buf = 0;
+	*len = 0;
+	f = open_memstream(buf, len);
+	if (!f) return errno;
+	rc = printf_section(f, model, section, range);
+	fclose(f);
+	return rc;
+}
+
+// 1-based line number of the first difference between a and b
+static int first_diff_line(const char* a, size_t a_len,
+	const char* b, size_t b_len)
+{
+	size_t i;
+	int line;
+
+	line = 1;
+	for (i = 0; i < a_len && i < b_len && a[i] == b[i]; i++) {
+		if (a[i] == '\n')
+			line++;
+	}
+	return line;
+}
+
+static int test_build_exact(struct test_state* tstate)
+{
+	struct fpga_model* exact;
+	struct fp_range range;
+	char* def_buf, *exact_buf;
+	size_t def_len, exact_len, total_len;
+	int i, rc;
+
+	def_buf = exact_buf = 0;
+	exact = calloc(1, sizeof(*exact));
+	if (!exact) FAIL(ENOMEM);
+	rc = fpga_build_model_exact(exact, XC6SLX9, FTG256);
+	if (rc) FAIL(rc);
+	TIME_AND_MEM();
+
+	range.x_beg = 0;
+	range.x_end = -1;
+	for (i = 0; i < NUM_SECTIONS; i++) {
+		total_len = 0;
+		for (range.y_beg = 0; range.y_beg < tstate->model->y_height;
+		     range.y_beg++) {
+			range.y_end = range.y_beg;
+			rc = dump_section(tstate->model, i, &range,
+				&def_buf, &def_len);
+			if (rc) FAIL(rc);
+			rc = dump_section(exact, i, &range,
+				&exact_buf, &exact_len);
+			if (rc) FAIL(rc);
+			if (def_len != exact_len
+			    || memcmp(def_buf, exact_buf, def_len)) {
+				printf("#E Exact build: %s differ in y%i at "
+					"line %i.\n", s_section_names[i],
+					range.y_beg, first_diff_line(def_buf,
+					def_len, exact_buf, exact_len));
+				FAIL(EINVAL);
+			}
+			total_len += def_len;
+			free(def_buf);
+			free(exact_buf);
+			def_buf = exact_buf = 0;
+		}
+		printf("O Exact build: %s match, %zu bytes.\n",
+			s_section_names[i], total_len);
+	}
+	rc = 0;
+fail:
+	free(def_buf);
+	free(exact_buf);
+	if (exact) {
+		fpga_free_model(exact);
+		free(exact);
+	}
+	return rc;
+}
 
 static void printf_help(const char* argv_0, const char** available_tests)
 {
@@ -2192,8 +2801,19 @@ static void printf_help(const char* argv_0, const char** available_tests)
 		"\n"
 		"Usage: %s [--test=<name>] [--skip=<num>] [--count=<num>]\n"
 		"       %*s [--dry-run] [--diff=<diff executable>]\n"
-		"Default diff executable: " DEFAULT_DIFF_EXEC "\n"
-		"Output dir: " AUTOTEST_TMP_DIR "\n", argv_0, (int) strlen(argv_0), "");
+		"       %*s [--jobs=<num>] [--threads=<num>] [--stats]\n"
+		"Without --diff, every step is verified in-process the same\n"
+		"way as by autotest_diff.sh.\n"
+		"--jobs splits the diffs over num worker processes, the\n"
+		"output is the same as without --jobs. Not together with\n"
+		"--diff.\n"
+		"--threads is the number of threads in the threads test,\n"
+		"default 4.\n"
+		"--stats prints the hot-path counters of the test and\n"
+		"round-trip models at the end (make STATS=1), not together\n"
+		"with --jobs.\n"
+		"Output dir: " AUTOTEST_TMP_DIR "\n", argv_0, (int) strlen(argv_0), "",
+		(int) strlen(argv_0), "");
 
 	if (available_tests) {
 		int i = 0;
@@ -2212,11 +2832,12 @@ int main(int argc, char** argv)
 	struct fpga_model model;
 	struct test_state tstate;
 	char param[1024], cmdline_test[1024];
-	int i, param_skip, param_count, rc;
+	int i, param_skip, param_count, param_jobs, param_threads, rc;
 	const char* available_tests[] =
 		{ "logic_cfg", "routing_sw", "io_sw", "iob_cfg",
 		  "lut_encoding", "bufg_cfg", "bufio_cfg", "pll_cfg",
-		  "dcm_cfg", "bscan_cfg", "clock_routing", "dist_mem", 0 };
+		  "dcm_cfg", "bscan_cfg", "clock_routing", "dist_mem",
+		  "threads", "build_exact", 0 };
 
 	// flush after every line is better for the autotest
 	// output, tee, etc.
@@ -2274,14 +2895,36 @@ int main(int argc, char** argv)
 			tstate.cmdline_count = param_count;
 			continue;
 		}
+		if (sscanf(argv[i], "--jobs=%i", &param_jobs) == 1) {
+			if (tstate.cmdline_jobs || param_jobs < 1) {
+				printf_help(argv[0], available_tests);
+				return EINVAL;
+			}
+			tstate.cmdline_jobs = param_jobs;
+			continue;
+		}
 		if (!strcmp(argv[i], "--dry-run")) {
 			tstate.dry_run = 1;
 			continue;
 		}
+		if (sscanf(argv[i], "--threads=%i", &param_threads) == 1) {
+			if (tstate.cmdline_threads || param_threads < 1) {
+				printf_help(argv[0], available_tests);
+				return EINVAL;
+			}
+			tstate.cmdline_threads = param_threads;
+			continue;
+		}
+		if (!strcmp(argv[i], "--stats")) {
+			tstate.cmdline_stats = 1;
+			continue;
+		}
 		printf_help(argv[0], available_tests);
 		return EINVAL;
 	}
-	if (!cmdline_test[0]) {
+	if (!cmdline_test[0]
+	    || (tstate.cmdline_stats && tstate.cmdline_jobs > 1)
+	    || (tstate.cmdline_diff_exec[0] && tstate.cmdline_jobs > 1)) {
 		printf_help(argv[0], available_tests);
 		return EINVAL;
 	}
@@ -2295,12 +2938,12 @@ int main(int argc, char** argv)
 		printf_help(argv[0], available_tests);
 		return EINVAL;
 	}
-	if (!tstate.cmdline_diff_exec[0])
-		strcpy(tstate.cmdline_diff_exec, DEFAULT_DIFF_EXEC);
 	if (tstate.cmdline_skip == -1)
 		tstate.cmdline_skip = 0;
 	if (tstate.dry_run == -1)
 		tstate.dry_run = 0;
+	if (!tstate.cmdline_threads)
+		tstate.cmdline_threads = 4;
 
 	//
 	// test
@@ -2311,7 +2954,8 @@ int main(int argc, char** argv)
 			"our guest. namo namaha.\n");
 	printf("\n");
 	printf("O Test: %s\n", cmdline_test);
-	printf("O Diff: %s\n", tstate.cmdline_diff_exec);
+	printf("O Diff: %s\n", tstate.cmdline_diff_exec[0]
+		? tstate.cmdline_diff_exec : "in-process");
 	printf("O Skip: %i\n", tstate.cmdline_skip);
 	printf("O Count: %i\n", tstate.cmdline_count);
 	printf("O Dry run: %i\n", tstate.dry_run);
@@ -2333,6 +2977,15 @@ int main(int argc, char** argv)
 	mkdir(tstate.tmp_dir, S_IRWXU|S_IRWXG|S_IROTH|S_IXOTH);
 	rc = diff_start(&tstate, cmdline_test);
 	if (rc) FAIL(rc);
+	if (tstate.cmdline_jobs > 1) {
+		// workers share the round-trip model
+		if (!tstate.dry_run) {
+			rc = build_rt_model(&tstate);
+			if (rc) FAIL(rc);
+		}
+		rc = fork_jobs(&tstate);
+		if (rc) FAIL(rc);
+	}
 
 	if (!strcmp(cmdline_test, "logic_cfg")) {
 		rc = test_logic_config(&tstate);
@@ -2382,11 +3035,20 @@ int main(int argc, char** argv)
 		rc = test_dist_mem(&tstate);
 		if (rc) FAIL(rc);
 	}
+	if (!strcmp(cmdline_test, "threads")) {
+		rc = test_threads(&tstate);
+		if (rc) FAIL(rc);
+	}
+	if (!strcmp(cmdline_test, "build_exact")) {
+		rc = test_build_exact(&tstate);
+		if (rc) FAIL(rc);
+	}
 
 	printf("\n");
 	printf("O Test completed.\n");
 	TIME_AND_MEM();
 	printf("\n");
+	printf_stats(&tstate);
 	return EXIT_SUCCESS;
 fail:
 	return rc;
@@ -2,7 +2,7 @@
 diff -U 0 $1 $2 > ${2%.*}.fp_diff
 
 ./fp2bit $2 ${2%.*}.f2b || exit $?
-./bit2fp --no-fp-header ${2%.*}.f2b > ${2%.*}.b2f || exit $?
+./bit2fp --no-json ${2%.*}.f2b > ${2%.*}.b2f || exit $?
 if [ "$1" == "/dev/null" ]
 then
 	diff -U 0 /dev/null ${2%.*}.b2f > ${2%.*}.b2f_diff
@@ -0,0 +1,758 @@
+//
+// This is free and unencumbered software released into the public domain.
+// For details see the UNLICENSE file at the root of the source tree.
+//
+
+#include <time.h>
+#include <sys/resource.h>
+
+#include "model.h"
+#include "floorplan.h"
+#include "control.h"
+#include "bit.h"
+
+//
+// Micro-benchmarks for the hot paths of the fpgatools libraries.
+// Every benchmark runs a number of warmup and measured repetitions,
+// the results are printed to stdout as JSON.
+//
+
+#ifdef __GLIBC__
+// All heap allocations, including those inside the libraries, are
+// counted by replacing malloc(), calloc() and realloc().
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t nmemb, size_t size);
+extern void* __libc_realloc(void* ptr, size_t size);
+
+static long s_mallocs, s_malloc_bytes;
+
+void* malloc(size_t size)
+{
+	s_mallocs++;
+	s_malloc_bytes += size;
+	return __libc_malloc(size);
+}
+
+void* calloc(size_t nmemb, size_t size)
+{
+	s_mallocs++;
+	s_malloc_bytes += nmemb*size;
+	return __libc_calloc(nmemb, size);
+}
+
+void* realloc(void* ptr, size_t size)
+{
+	s_mallocs++;
+	s_malloc_bytes += size;
+	return __libc_realloc(ptr, size);
+}
+#endif
+
+struct bench_state
+{
+	int idcode, package;
+	// fully built model shared by all benchmarks after the
+	// model builds
+	struct fpga_model model;
+
+	// strings and connection points to look up
+	int num_strs;
+	const char** strs;
+	int num_connpts;
+	struct bench_connpt { int y, x; str16_t name_i; }* connpts;
+	// tile for switch enumeration
+	int sw_y, sw_x;
+
+	// results of write_bitfile() and write_floorplan()
+	struct fpga_bits bits;
+	char* bitfile;
+	size_t bitfile_len;
+	char* fp;
+	size_t fp_len;
+	struct fpga_config cfg;
+	int cfg_valid;
+};
+
+// Each run returns the number of operations done in it,
+// or a negative error. Chained benchmarks work on the state
+// left by the one before, which runs once untimed if it is
+// filtered out. The optional prepare runs once before the
+// warmup, untimed.
+struct bench
+{
+	const char* name;
+	int warmup, reps, chained;
+	long (*run)(struct bench_state* bs);
+	int (*prepare)(struct bench_state* bs);
+};
+
+static double now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec*1e9 + ts.tv_nsec;
+}
+
+static long peak_rss_kb(void)
+{
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage)) return 0;
+	return usage.ru_maxrss;
+}
+
+//
+// model build
+//
+
+static long bench_build_model(struct bench_state* bs)
+{
+	struct fpga_model model;
+	int rc;
+
+	rc = fpga_build_model(&model, bs->idcode, bs->package);
+	fpga_free_model(&model);
+	return rc ? -rc : 1;
+}
+
+static long bench_build_model_lazy(struct bench_state* bs)
+{
+	struct fpga_model model;
+	int rc;
+
+	rc = fpga_build_model_lazy(&model, bs->idcode, bs->package);
+	fpga_free_model(&model);
+	return rc ? -rc : 1;
+}
+
+//
+// strings
+//
+
+static long bench_strarray_find(struct bench_state* bs)
+{
+	int i;
+
+	for (i = 0; i < bs->num_strs; i++) {
+		if (strarray_find(&bs->model.str, bs->strs[i]) == STRIDX_NO_ENTRY)
+			return -EINVAL;
+	}
+	return bs->num_strs;
+}
+
+static long bench_strarray_add_existing(struct bench_state* bs)
+{
+	int i, idx, rc;
+
+	for (i = 0; i < bs->num_strs; i++) {
+		rc = strarray_add(&bs->model.str, bs->strs[i], &idx);
+		if (rc) return -rc;
+	}
+	return bs->num_strs;
+}
+
+#define NUM_NEW_STRS 50000
+
+static long bench_strarray_add_new(struct bench_state* bs)
+{
+	struct hashed_strarray str;
+	char name[64];
+	int i, idx, rc;
+
+	rc = strarray_init(&str, STRIDX_64K);
+	if (rc) return -rc;
+	for (i = 0; i < NUM_NEW_STRS; i++) {
+		snprintf(name, sizeof(name), "BENCH_WIRE%i_%i", i%97, i);
+		rc = strarray_add(&str, name, &idx);
+		if (rc) break;
+	}
+	strarray_free(&str);
+	return rc ? -rc : NUM_NEW_STRS;
+}
+
+//
+// connection points and switches
+//
+
+static long bench_connpt_find(struct bench_state* bs)
+{
+	struct bench_connpt* pt;
+	int i, dests_o, num_dests;
+
+	for (i = 0; i < bs->num_connpts; i++) {
+		pt = &bs->connpts[i];
+		if (fpga_connpt_find(&bs->model, pt->y, pt->x, pt->name_i,
+			&dests_o, &num_dests) == NO_CONN)
+			return -EINVAL;
+	}
+	return bs->num_connpts;
+}
+
+static long bench_switch_first_next(struct bench_state* bs)
+{
+	struct fpga_tile* tile;
+	swidx_t sw;
+	long ops;
+	int i;
+
+	tile = YX_TILE(&bs->model, bs->sw_y, bs->sw_x);
+	ops = 0;
+	for (i = 0; i < tile->num_conn_point_names; i++) {
+		sw = fpga_switch_first(&bs->model, bs->sw_y, bs->sw_x,
+			CONNPT_STR16(tile, i), SW_FROM);
+		while (sw != NO_SWITCH) {
+			ops++;
+			sw = fpga_switch_next(&bs->model, bs->sw_y,
+				bs->sw_x, sw, SW_FROM);
+		}
+	}
+	return ops;
+}
+
+// chains from only the first connection points keep one run short
+#define SW_CHAIN_CONNPTS 100
+
+static long bench_switch_chain(struct bench_state* bs)
+{
+	struct fpga_tile* tile;
+	struct sw_chain chain;
+	long ops;
+	int i;
+
+	tile = YX_TILE(&bs->model, bs->sw_y, bs->sw_x);
+	ops = 0;
+	for (i = 0; i < tile->num_conn_point_names && i < SW_CHAIN_CONNPTS; i++) {
+		if (construct_sw_chain(&chain, &bs->model, bs->sw_y, bs->sw_x,
+			CONNPT_STR16(tile, i), SW_FROM, /*max_depth*/ -1,
+			NO_NET, /*block_list*/ 0, /*block_list_len*/ 0))
+			return -EINVAL;
+		while (fpga_switch_chain(&chain) != NO_SWITCH)
+			ops++;
+		destruct_sw_chain(&chain);
+	}
+	return ops;
+}
+
+//
+// routing of the design examples
+//
+
+// same as hello_world.c
+static int design_hello_world(struct fpga_model* model)
+{
+	int iob_inA_y, iob_inA_x, iob_inA_type_idx;
+	int iob_inB_y, iob_inB_x, iob_inB_type_idx;
+	int iob_out_y, iob_out_x, iob_out_type_idx;
+	int logic_y, logic_x, logic_type_idx, rc;
+	struct fpgadev_logic logic_cfg;
+	net_idx_t inA_net, inB_net, out_net;
+
+	fpga_find_iob(model, "P45", &iob_inA_y, &iob_inA_x,
+		&iob_inA_type_idx);
+	fdev_iob_input(model, iob_inA_y, iob_inA_x,
+		iob_inA_type_idx, IO_LVCMOS33);
+	fpga_find_iob(model, "P46", &iob_inB_y, &iob_inB_x,
+		&iob_inB_type_idx);
+	fdev_iob_input(model, iob_inB_y, iob_inB_x,
+		iob_inB_type_idx, IO_LVCMOS33);
+	fpga_find_iob(model, "P48", &iob_out_y, &iob_out_x,
+		&iob_out_type_idx);
+	fdev_iob_output(model, iob_out_y, iob_out_x,
+		iob_out_type_idx, IO_LVCMOS33);
+
+	logic_y = 68;
+	logic_x = 13;
+	logic_type_idx = DEV_LOG_X;
+	CLEAR(logic_cfg);
+	logic_cfg.a2d[LUT_D].flags |= OUT_USED | LUT6VAL_SET;
+	if ((rc = bool_str2u64("A3*A5", &logic_cfg.a2d[LUT_D].lut6_val)))
+		RC_FAIL(model, rc);
+	fdev_logic_setconf(model, logic_y, logic_x, logic_type_idx, &logic_cfg);
+
+	fnet_new(model, &inA_net);
+	fnet_add_port(model, inA_net, iob_inA_y, iob_inA_x,
+		DEV_IOB, iob_inA_type_idx, IOB_OUT_I);
+	fnet_add_port(model, inA_net, logic_y, logic_x, DEV_LOGIC,
+		logic_type_idx, LI_D3);
+	fnet_route(model, inA_net);
+
+	fnet_new(model, &inB_net);
+	fnet_add_port(model, inB_net, iob_inB_y, iob_inB_x,
+		DEV_IOB, iob_inB_type_idx, IOB_OUT_I);
+	fnet_add_port(model, inB_net, logic_y, logic_x, DEV_LOGIC,
+		logic_type_idx, LI_D5);
+	fnet_route(model, inB_net);
+
+	fnet_new(model, &out_net);
+	fnet_add_port(model, out_net, logic_y, logic_x, DEV_LOGIC,
+		logic_type_idx, LO_D);
+	fnet_add_port(model, out_net, iob_out_y, iob_out_x,
+		DEV_IOB, iob_out_type_idx, IOB_IN_O);
+	fnet_route(model, out_net);
+	RC_RETURN(model);
+}
+
+// Same as blinking_led.c with its default parameters, without the
+// vcc net for the lut5 outputs.
+static int design_blinking_led(struct fpga_model* model)
+{
+	static const int out_pin[] = {LO_AQ, LO_BQ, LO_CQ, LO_DQ};
+	static const int in_pin[] = {LI_A5, LI_B5, LI_C5, LI_D5};
+	const int highest_bit = 14;
+	int iob_clk_y, iob_clk_x, iob_clk_type_idx;
+	int iob_led_y, iob_led_x, iob_led_type_idx;
+	int logic_x, logic_type_idx, cur_bit;
+	int cur_y, next_y, i, rc;
+	struct fpgadev_logic logic_cfg;
+	net_idx_t clock_net, net;
+
+	fpga_find_iob(model, fpga_find_pkg_pin(model, "IO_L30N_GCLK0_USERCCLK_2"),
+		&iob_clk_y, &iob_clk_x, &iob_clk_type_idx);
+	fdev_iob_input(model, iob_clk_y, iob_clk_x, iob_clk_type_idx,
+		IO_LVCMOS33);
+	fpga_find_iob(model, fpga_find_pkg_pin(model, "IO_L48P_D7_2"),
+		&iob_led_y, &iob_led_x, &iob_led_type_idx);
+	fdev_iob_output(model, iob_led_y, iob_led_x, iob_led_type_idx,
+		IO_LVCMOS25);
+	fdev_iob_slew(model, iob_led_y, iob_led_x, iob_led_type_idx,
+		SLEW_QUIETIO);
+	fdev_iob_drive(model, iob_led_y, iob_led_x, iob_led_type_idx, 8);
+
+	cur_y = 58;
+	logic_x = 13;
+	logic_type_idx = DEV_LOG_M_OR_L;
+
+	fnet_new(model, &clock_net);
+	fnet_add_port(model, clock_net, iob_clk_y, iob_clk_x, DEV_IOB,
+		iob_clk_type_idx, IOB_OUT_I);
+
+	for (cur_bit = 0; cur_bit <= highest_bit; cur_bit++) {
+		RC_ASSERT(model, cur_y != -1);
+		if (!(cur_bit % 4)) {
+			CLEAR(logic_cfg);
+			logic_cfg.clk_inv = CLKINV_CLK;
+			logic_cfg.sync_attr = SYNCATTR_ASYNC;
+		}
+		if (!cur_bit) {
+			logic_cfg.precyinit = PRECYINIT_0;
+			logic_cfg.a2d[LUT_A].flags |= LUT5VAL_SET | LUT6VAL_SET;
+			if ((rc = bool_str2lut_pair("(A6+~A6)*(~A5)", "1",
+				&logic_cfg.a2d[LUT_A].lut6_val,
+				&logic_cfg.a2d[LUT_A].lut5_val))) RC_FAIL(model, rc);
+			logic_cfg.a2d[LUT_A].cy0 = CY0_O5;
+		} else if (cur_bit == highest_bit) {
+			logic_cfg.a2d[cur_bit%4].flags |= LUT6VAL_SET;
+			if ((rc = bool_str2u64("A5", &logic_cfg.a2d[cur_bit%4].lut6_val)))
+				RC_FAIL(model, rc);
+		} else {
+			logic_cfg.a2d[cur_bit%4].flags |= LUT5VAL_SET | LUT6VAL_SET;
+			if ((rc = bool_str2lut_pair("(A6+~A6)*(A5)", "0",
+				&logic_cfg.a2d[cur_bit%4].lut6_val,
+				&logic_cfg.a2d[cur_bit%4].lut5_val))) RC_FAIL(model, rc);
+			logic_cfg.a2d[cur_bit%4].cy0 = CY0_O5;
+		}
+		logic_cfg.a2d[cur_bit%4].ff = FF_FF;
+		logic_cfg.a2d[cur_bit%4].ff_mux = MUX_XOR;
+		logic_cfg.a2d[cur_bit%4].ff_srinit = FF_SRINIT0;
+
+		if (cur_bit%4 != 3 && cur_bit != highest_bit)
+			continue;
+		next_y = regular_row_up(cur_y, model);
+		if (cur_bit < highest_bit) {
+			RC_ASSERT(model, next_y != -1);
+			logic_cfg.cout_used = 1;
+			fnet_new(model, &net);
+			fnet_add_port(model, net, cur_y, logic_x, DEV_LOGIC, logic_type_idx, LO_COUT);
+			fnet_add_port(model, net, next_y, logic_x, DEV_LOGIC, logic_type_idx, LI_CIN);
+			fnet_route(model, net);
+		}
+		fdev_logic_setconf(model, cur_y, logic_x, logic_type_idx, &logic_cfg);
+		fnet_add_port(model, clock_net, cur_y, logic_x, DEV_LOGIC, logic_type_idx, LI_CLK);
+		for (i = 0; i <= cur_bit%4; i++) {
+			fnet_new(model, &net);
+			fnet_add_port(model, net, cur_y, logic_x, DEV_LOGIC, logic_type_idx, out_pin[i]);
+			fnet_add_port(model, net, cur_y, logic_x, DEV_LOGIC, logic_type_idx, in_pin[i]);
+			if (cur_bit - cur_bit%4 + i == highest_bit)
+				fnet_add_port(model, net, iob_led_y, iob_led_x, DEV_IOB,
+					iob_led_type_idx, IOB_IN_O);
+			fnet_route(model, net);
+		}
+		cur_y = next_y;
+	}
+	fnet_route(model, clock_net);
+	RC_RETURN(model);
+}
+
+static long bench_route_hello_world(struct bench_state* bs)
+{
+	int rc;
+
+	rc = fpga_reset_model(&bs->model);
+	if (!rc) rc = design_hello_world(&bs->model);
+	return rc ? -rc : 1;
+}
+
+static long bench_route_blinking_led(struct bench_state* bs)
+{
+	int rc;
+
+	rc = fpga_reset_model(&bs->model);
+	if (!rc) rc = design_blinking_led(&bs->model);
+	return rc ? -rc : 1;
+}
+
+//
+// binary configuration and floorplan, all on the blinking_led
+// design left in the model by the previous benchmark
+//
+
+static long bench_write_model(struct bench_state* bs)
+{
+	int rc;
+
+	memset(bs->bits.d, 0, bs->bits.len);
+	rc = write_model(&bs->bits, &bs->model);
+	return rc ? -rc : 1;
+}
+
+static long bench_write_bitfile(struct bench_state* bs)
+{
+	FILE* f;
+	int rc;
+
+	free(bs->bitfile);
+	bs->bitfile = 0;
+	f = open_memstream(&bs->bitfile, &bs->bitfile_len);
+	if (!f) return -errno;
+	rc = write_bitfile(f, &bs->model);
+	fclose(f);
+	return rc ? -rc : 1;
+}
+
+static long bench_read_bitfile(struct bench_state* bs)
+{
+	FILE* f;
+	int rc;
+
+	if (bs->cfg_valid) {
+		free_config(&bs->cfg);
+		bs->cfg_valid = 0;
+	}
+	f = fmemopen(bs->bitfile, bs->bitfile_len, "r");
+	if (!f) return -errno;
+	rc = read_bitfile(&bs->cfg, f, /*verbose*/ 0);
+	fclose(f);
+	if (rc) return -rc;
+	bs->cfg_valid = 1;
+	return 1;
+}
+
+// extract_model() clears the bits it consumes, each run
+// works on a copy
+static long bench_extract_model(struct bench_state* bs)
+{
+	int rc;
+
+	if (!bs->cfg_valid || bs->cfg.bits.len != bs->bits.len)
+		return -EINVAL;
+	memcpy(bs->bits.d, bs->cfg.bits.d, bs->bits.len);
+	rc = fpga_reset_model(&bs->model);
+	if (!rc) rc = extract_model(&bs->model, &bs->bits);
+	return rc ? -rc : 1;
+}
+
+static long bench_write_floorplan(struct bench_state* bs)
+{
+	FILE* f;
+	int rc;
+
+	free(bs->fp);
+	bs->fp = 0;
+	f = open_memstream(&bs->fp, &bs->fp_len);
+	if (!f) return -errno;
+	rc = write_floorplan(f, &bs->model, FP_DEFAULT);
+	fclose(f);
+	return rc ? -rc : 1;
+}
+
+// read_floorplan() only parses dev and net lines, which
+// write_floorplan() does not write in this tree. The nets of the
+// design are written in the net line format instead, devices are
+// not read back.
+static int prepare_read_floorplan(struct bench_state* bs)
+{
+	struct fpga_model* model = &bs->model;
+	struct fpga_device* dev;
+	struct fpga_net* net;
+	struct net_el* el;
+	net_idx_t net_i;
+	FILE* f;
+	int i, pinw_i;
+
+	free(bs->fp);
+	bs->fp = 0;
+	f = open_memstream(&bs->fp, &bs->fp_len);
+	if (!f) return errno;
+	net_i = NO_NET;
+	while (!fnet_enum(model, net_i, &net_i) && net_i != NO_NET) {
+		net = fnet_get(model, net_i);
+		if (!net) continue;
+		for (i = 0; i < net->len; i++) {
+			el = &net->el[i];
+			if (!(el->idx & NET_IDX_IS_PINW)) {
+				fprintf(f, "net %i sw y%i x%i %s\n", net_i,
+					el->y, el->x, fpga_switch_print(model,
+					el->y, el->x, el->idx));
+				continue;
+			}
+			dev = FPGA_DEV(model, el->y, el->x, el->dev_idx);
+			pinw_i = el->idx & NET_IDX_MASK;
+			fprintf(f, "net %i %s y%i x%i %s %i pin %s\n", net_i,
+				pinw_i < dev->num_pinw_in ? "in" : "out",
+				el->y, el->x, fdev_type2str(dev->type),
+				fdev_typeidx(model, el->y, el->x, el->dev_idx),
+				fdev_pinw_idx2str(dev->type, pinw_i));
+		}
+	}
+	fclose(f);
+	return model->rc;
+}
+
+static long bench_read_floorplan(struct bench_state* bs)
+{
+	FILE* f;
+	int rc;
+
+	rc = fpga_reset_model(&bs->model);
+	if (rc) return -rc;
+	f = fmemopen(bs->fp, bs->fp_len, "r");
+	if (!f) return -errno;
+	rc = read_floorplan(&bs->model, f);
+	fclose(f);
+	if (!rc) rc = bs->model.rc;
+	return rc ? -rc : 1;
+}
+
+static const struct bench s_benches[] = {
+	{ "fpga_build_model", 1, 3, 0, bench_build_model },
+	{ "fpga_build_model_lazy", 1, 3, 0, bench_build_model_lazy },
+	{ "strarray_find", 2, 10, 0, bench_strarray_find },
+	{ "strarray_add_existing", 2, 10, 0, bench_strarray_add_existing },
+	{ "strarray_add_new", 2, 10, 0, bench_strarray_add_new },
+	{ "fpga_connpt_find", 2, 10, 0, bench_connpt_find },
+	{ "fpga_switch_first_next", 2, 10, 0, bench_switch_first_next },
+	{ "fpga_switch_chain", 1, 5, 0, bench_switch_chain },
+	{ "fnet_route_hello_world", 2, 10, 0, bench_route_hello_world },
+	{ "fnet_route_blinking_led", 2, 10, 0, bench_route_blinking_led },
+	{ "write_model", 2, 10, 1, bench_write_model },
+	{ "write_bitfile", 2, 10, 1, bench_write_bitfile },
+	{ "read_bitfile", 2, 10, 1, bench_read_bitfile },
+	{ "extract_model", 2, 10, 1, bench_extract_model },
+	{ "write_floorplan", 2, 10, 1, bench_write_floorplan },
+	{ "read_floorplan", 2, 10, 1, bench_read_floorplan,
+		prepare_read_floorplan },
+	{ 0 }
+};
+
+// The model build benchmarks run before the shared model is built.
+#define NUM_BUILD_BENCHES 2
+
+static int init_state(struct bench_state* bs)
+{
+	struct fpga_tile* tile;
+	const char* s;
+	int y, x, i, rc;
+
+	rc = fpga_build_model(&bs->model, bs->idcode, bs->package);
+	if (rc) FAIL(rc);
+
+	bs->strs = malloc(bs->model.str.highest_index*sizeof(*bs->strs));
+	if (!bs->strs) FAIL(ENOMEM);
+	for (i = 1; i < bs->model.str.highest_index; i++) {
+		if ((s = strarray_lookup(&bs->model.str, i)))
+			bs->strs[bs->num_strs++] = s;
+	}
+
+	// every 7th connection point of every tile, and the
+	// routing tile with the most switches
+	bs->sw_y = bs->sw_x = -1;
+	for (y = 0; y < bs->model.y_height; y++) {
+		for (x = 0; x < bs->model.x_width; x++) {
+			tile = YX_TILE(&bs->model, y, x);
+			for (i = 0; i < tile->num_conn_point_names; i += 7) {
+				if (!(bs->num_connpts % 1024)) {
+					void* new_ptr = realloc(bs->connpts,
+						(bs->num_connpts+1024)*sizeof(*bs->connpts));
+					if (!new_ptr) FAIL(ENOMEM);
+					bs->connpts = new_ptr;
+				}
+				bs->connpts[bs->num_connpts].y = y;
+				bs->connpts[bs->num_connpts].x = x;
+				bs->connpts[bs->num_connpts].name_i = CONNPT_STR16(tile, i);
+				bs->num_connpts++;
+			}
+			if (tile->type == ROUTING
+			    && (bs->sw_y == -1 || tile->num_switches
+				> YX_TILE(&bs->model, bs->sw_y, bs->sw_x)->num_switches)) {
+				bs->sw_y = y;
+				bs->sw_x = x;
+			}
+		}
+	}
+	if (bs->sw_y == -1) FAIL(EINVAL);
+
+	bs->bits.len = IOB_DATA_START + IOB_DATA_LEN;
+	bs->bits.d = malloc(bs->bits.len);
+	if (!bs->bits.d) FAIL(ENOMEM);
+	return 0;
+fail:
+	return rc;
+}
+
+static void free_state(struct bench_state* bs)
+{
+	if (bs->cfg_valid)
+		free_config(&bs->cfg);
+	free(bs->fp);
+	free(bs->bitfile);
+	free(bs->bits.d);
+	free(bs->connpts);
+	free(bs->strs);
+	fpga_free_model(&bs->model);
+}
+
+static int run_bench(struct bench_state* bs, const struct bench* b,
+	int warmup, int reps, int first)
+{
+	struct alloc_counters start_cnt, end_cnt;
+	long ops, total_ops, start_mallocs, start_malloc_bytes;
+	double start_ns, ns, total_ns, min_ns, max_ns;
+	int i, rc;
+
+	if (b->prepare) {
+		rc = (*b->prepare)(bs);
+		if (rc) FAIL(rc);
+	}
+	for (i = 0; i < warmup; i++) {
+		ops = (*b->run)(bs);
+		if (ops < 0) FAIL(-ops);
+	}
+	total_ops = 0;
+	total_ns = 0;
+	min_ns = max_ns = -1;
+	get_alloc_counters(&start_cnt);
+#ifdef __GLIBC__
+	start_mallocs = s_mallocs;
+	start_malloc_bytes = s_malloc_bytes;
+#else
+	start_mallocs = start_malloc_bytes = 0;
+#endif
+	for (i = 0; i < reps; i++) {
+		start_ns = now_ns();
+		ops = (*b->run)(bs);
+		ns = now_ns() - start_ns;
+		if (ops < 0) FAIL(-ops);
+		if (!ops) FAIL(EINVAL);
+		total_ops += ops;
+		total_ns += ns;
+		if (min_ns == -1 || ns/ops < min_ns)
+			min_ns = ns/ops;
+		if (ns/ops > max_ns)
+			max_ns = ns/ops;
+	}
+	get_alloc_counters(&end_cnt);
+
+	printf("%s    { \"name\" : \"%s\", \"warmup\" : %i, \"reps\" : %i,"
+		" \"ops\" : %li,\n", first ? "" : ",\n", b->name, warmup,
+		reps, total_ops);
+	printf("      \"ns_per_op\" : %.1f, \"ns_per_op_min\" : %.1f,"
+		" \"ns_per_op_max\" : %.1f,\n",
+		total_ns/total_ops, min_ns, max_ns);
+#ifdef __GLIBC__
+	printf("      \"mallocs_per_op\" : %.2f, \"malloc_bytes_per_op\" : %.1f,\n",
+		(double) (s_mallocs-start_mallocs)/total_ops,
+		(double) (s_malloc_bytes-start_malloc_bytes)/total_ops);
+#endif
+	printf("      \"arena_bytes_per_op\" : %.1f, \"str_adds_per_op\" : %.2f,\n",
+		(double) (end_cnt.alloc_bytes-start_cnt.alloc_bytes)/total_ops,
+		(double) (end_cnt.str_adds-start_cnt.str_adds)/total_ops);
+	printf("      \"peak_rss_kb\" : %li }", peak_rss_kb());
+	fflush(stdout);
+	return 0;
+fail:
+	fprintf(stderr, "#E %s failed with %i\n", b->name, rc);
+	return rc;
+}
+
+int main(int argc, char** argv)
+{
+	struct bench_state bs;
+	const char* param_filter;
+	int param_reps, param_warmup, warmup, reps, first, i, rc;
+	int num_benches, last_needed, needed[32];
+
+	if (cmdline_help(argc, argv)) {
+		printf( "       %*s [-Dfilter=<substring of benchmark name>]\n"
+			"       %*s [-Dreps=<num>] [-Dwarmup=<num>]\n"
+			"\n", (int) strlen(*argv), "", (int) strlen(*argv), "");
+		printf("Benchmarks:\n");
+		for (i = 0; s_benches[i].name; i++)
+			printf("  %s\n", s_benches[i].name);
+		return 0;
+	}
+	param_filter = cmdline_strvar(argc, argv, "filter");
+	param_reps = cmdline_intvar(argc, argv, "reps");
+	param_warmup = cmdline_intvar(argc, argv, "warmup");
+
+	memset(&bs, 0, sizeof(bs));
+	bs.idcode = cmdline_part(argc, argv);
+	// the hello_world design uses tqg144 pin names
+	bs.package = TQG144;
+	for (i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "--package=ftg256"))
+			bs.package = FTG256;
+	}
+
+	printf("{\n  \"bench_version\" : 1,\n");
+	printf("  \"part\" : \"%s\", \"package\" : \"%s\",\n",
+		bs.idcode == XC6SLX9 ? "xc6slx9" : "unknown",
+		bs.package == TQG144 ? "tqg144" : "ftg256");
+	// needed[i] is 1 for selected benchmarks and 2 for those
+	// that only run because a selected one is chained to them
+	for (num_benches = 0; s_benches[num_benches].name; num_benches++);
+	last_needed = -1;
+	for (i = num_benches-1; i >= 0; i--) {
+		needed[i] = !param_filter
+			|| strstr(s_benches[i].name, param_filter);
+		if (!needed[i] && i+1 < num_benches
+		    && s_benches[i+1].chained && needed[i+1])
+			needed[i] = 2;
+		if (needed[i] && last_needed == -1)
+			last_needed = i;
+	}
+
+	printf("  \"benchmarks\" : [\n");
+	first = 1;
+	for (i = 0; i <= last_needed; i++) {
+		if (i == NUM_BUILD_BENCHES) {
+			rc = init_state(&bs);
+			if (rc) FAIL(rc);
+		}
+		if (!needed[i])
+			continue;
+		if (needed[i] == 2) {
+			if ((*s_benches[i].run)(&bs) < 0) FAIL(EINVAL);
+			continue;
+		}
+		warmup = param_warmup ? param_warmup : s_benches[i].warmup;
+		reps = param_reps ? param_reps : s_benches[i].reps;
+		rc = run_bench(&bs, &s_benches[i], warmup, reps, first);
+		if (rc) FAIL(rc);
+		first = 0;
+	}
+	printf("\n  ]\n}\n");
+	free_state(&bs);
+	return EXIT_SUCCESS;
+fail:
+	free_state(&bs);
+	return rc;
+}
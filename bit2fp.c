@@ -15,7 +15,9 @@ static void help_exit(int argc, char **argv)
 		"\n"
 		"%s - bitstream to floorplan\n"
 		"Usage: %s [--help] [--verbose] [--bit-header] [--bit-regs] [--bit-crc]\n"
-		"       %*s [--no-model] [--no-json] <bitstream_file>\n"
+		"       %*s [--no-model] [--no-json] [--stats] <bitstream_file>\n"
+		"\n"
+		"--stats  print hot-path counters to stderr (make STATS=1)\n"
 		"\n", argv[0], argv[0], (int) strlen(argv[0]), "");
 	exit(EXIT_SUCCESS);
 }
@@ -23,7 +25,7 @@ static void help_exit(int argc, char **argv)
 int main(int argc, char** argv)
 {
 	struct fpga_model model;
-	int bit_header, bit_regs, bit_crc, json, pull_model, file_arg;
+	int bit_header, bit_regs, bit_crc, json, pull_model, stats, file_arg;
 	int verbose, flags, rc = -1;
 	struct fpga_config config;
 
@@ -35,6 +37,7 @@ int main(int argc, char** argv)
 	bit_crc = 0;
 	pull_model = 1;
 	json = 1;
+	stats = 0;
 	file_arg = 1;
 	while (file_arg < argc && !strncmp(argv[file_arg], "--", 2)) {
 		if (!strcmp(argv[file_arg], "--help"))
@@ -52,6 +55,8 @@ int main(int argc, char** argv)
 			pull_model = 0;
 		else if (!strcmp(argv[file_arg], "--no-json"))
 			json = 0;
+		else if (!strcmp(argv[file_arg], "--stats"))
+			stats = 1;
 		else break;
 		file_arg++;
 	}
@@ -91,7 +96,11 @@ int main(int argc, char** argv)
 	if (bit_header) flags |= DUMP_HEADER_STR;
 	if (bit_regs) flags |= DUMP_REGS;
 	if (bit_crc) flags |= DUMP_CRC;
-	if ((rc = dump_config(&config, flags))) FAIL(rc);
+	if ((rc = dump_config(stdout, &config, flags))) FAIL(rc);
+	if (stats) {
+		fflush(stdout);
+		fpga_print_stats(stderr, &model);
+	}
 	return EXIT_SUCCESS;
 fail:
 	return rc;
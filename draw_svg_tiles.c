@@ -5,117 +5,319 @@
 // For details see the UNLICENSE file at the root of the source tree.
 //
 
-#include <stdio.h>
-#include <string.h>
-#include <stdlib.h>
-#include <stdint.h>
-#include <assert.h>
-#include <sys/stat.h>
-
-#include <libxml/tree.h>
-#include <libxml/parser.h>
-#include <libxml/xpath.h>
-#include <libxml/xpathInternals.h>
-
 #include "model.h"
+#include "floorplan.h"
+#include "control.h"
+#include "bit.h"
+
+//
+// The svg is written straight to a large stdio buffer, one element per
+// line, without building a document tree first.
+//
 
 #define VERT_TILE_SPACING	 45
 #define HORIZ_TILE_SPACING	160
+#define OUT_BUF_SIZE		(1024*1024)
 
-int main(int argc, char** argv)
+#define TILE_X(x)	(HORIZ_TILE_SPACING + (x)*HORIZ_TILE_SPACING)
+#define TILE_Y(y)	(20 + VERT_TILE_SPACING + (y)*VERT_TILE_SPACING)
+
+struct draw_opts
+{
+	int devs, switches, nets, heatmap;
+};
+
+static int num_used_switches(struct fpga_model* model, int y, int x)
+{
+	int i, num_used;
+
+	num_used = 0;
+	for (i = 0; i < YX_TILE(model, y, x)->num_switches; i++) {
+		if (fpga_switch_is_used(model, y, x, i))
+			num_used++;
+	}
+	return num_used;
+}
+
+// White for unused tiles, then from yellow to red for the tile with
+// the most used switches.
+static void heat_color(char* buf, int used, int max_used)
+{
+	int green;
+
+	if (!used) {
+		strcpy(buf, "#ffffff");
+		return;
+	}
+	green = 255 - (255 * used) / max_used;
+	sprintf(buf, "#ff%02x00", green);
+}
+
+static void draw_heatmap(FILE* f, struct fpga_model* model, const int* used,
+	int max_used)
+{
+	char color[16];
+	int y, x;
+
+	fprintf(f, "<g id=\"heatmap\">\n");
+	for (y = 0; y < model->y_height; y++) {
+		for (x = 0; x < model->x_width; x++) {
+			if (!used[y*model->x_width + x])
+				continue;
+			heat_color(color, used[y*model->x_width + x], max_used);
+			fprintf(f, "<rect x=\"%i\" y=\"%i\" width=\"%i\" height=\"%i\" "
+				"fill=\"%s\"><title>y%i x%i: %i used switches</title></rect>\n",
+				TILE_X(x) - HORIZ_TILE_SPACING + 4,
+				TILE_Y(y) - 12, HORIZ_TILE_SPACING - 8,
+				VERT_TILE_SPACING - 4, color, y, x,
+				used[y*model->x_width + x]);
+		}
+	}
+	fprintf(f, "</g>\n");
+}
+
+// Device types in the tile, e.g. "2 LOGIC, 1 BUFIO", in bold if
+// any of them is configured.
+static void draw_devs(FILE* f, struct fpga_model* model, int y, int x)
+{
+	struct fpga_tile* tile;
+	char str[256];
+	int i, j, num, instantiated, len;
+
+	tile = YX_TILE(model, y, x);
+	len = 0;
+	str[0] = 0;
+	instantiated = 0;
+	for (i = 0; i < tile->num_devs; i++) {
+		if (tile->devs[i].instantiated)
+			instantiated = 1;
+		for (j = 0; j < i; j++) {
+			if (tile->devs[j].type == tile->devs[i].type)
+				break;
+		}
+		if (j < i)
+			continue;
+		num = 1;
+		for (j = i+1; j < tile->num_devs; j++) {
+			if (tile->devs[j].type == tile->devs[i].type)
+				num++;
+		}
+		len += snprintf(&str[len], sizeof(str)-len, "%s%i %s",
+			len ? ", " : "", num, fdev_type2str(tile->devs[i].type));
+		if (len >= (int) sizeof(str)) break;
+	}
+	if (!str[0])
+		return;
+	fprintf(f, "<text x=\"%i\" y=\"%i\" class=\"%s\">%s</text>\n",
+		TILE_X(x), TILE_Y(y) + 28, instantiated ? "devs used" : "devs",
+		str);
+}
+
+static void draw_switches(FILE* f, struct fpga_model* model, int y, int x,
+	int used)
+{
+	int i;
+
+	fprintf(f, "<text x=\"%i\" y=\"%i\" class=\"sw\">%i sw<title>",
+		TILE_X(x) - HORIZ_TILE_SPACING + 8, TILE_Y(y), used);
+	for (i = 0; i < YX_TILE(model, y, x)->num_switches; i++) {
+		if (!fpga_switch_is_used(model, y, x, i))
+			continue;
+		fprintf(f, "%s\n", fpga_switch_print(model, y, x, i));
+	}
+	fprintf(f, "</title></text>\n");
+}
+
+// Nets are drawn as a line through the tiles of their elements, nets
+// that stay in one tile are only visible in the switch count.
+static void draw_nets(FILE* f, struct fpga_model* model)
+{
+	struct fpga_net* net;
+	net_idx_t net_i;
+	int i, last_y, last_x;
+
+	fprintf(f, "<g id=\"nets\">\n");
+	net_i = NO_NET;
+	while (!fnet_enum(model, net_i, &net_i) && net_i != NO_NET) {
+		net = fnet_get(model, net_i);
+		if (!net) continue;
+		for (i = 1; i < net->len; i++) {
+			if (net->el[i].y != net->el[0].y
+			    || net->el[i].x != net->el[0].x)
+				break;
+		}
+		if (i >= net->len)
+			continue;
+		fprintf(f, "<polyline class=\"net\" points=\"");
+		last_y = last_x = -1;
+		for (i = 0; i < net->len; i++) {
+			if (net->el[i].y == last_y && net->el[i].x == last_x)
+				continue;
+			fprintf(f, "%s%i,%i", i ? " " : "",
+				TILE_X(net->el[i].x) - HORIZ_TILE_SPACING/2,
+				TILE_Y(net->el[i].y) + VERT_TILE_SPACING/4);
+			last_y = net->el[i].y;
+			last_x = net->el[i].x;
+		}
+		fprintf(f, "\"><title>net %i</title></polyline>\n", net_i);
+	}
+	fprintf(f, "</g>\n");
+}
+
+static int draw_svg(FILE* f, struct fpga_model* model,
+	const struct draw_opts* opts)
 {
-	static const xmlChar* empty_svg = (const xmlChar*)
-		"<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+	int* used = 0;
+	int y, x, max_used, rc;
+
+	RC_CHECK(model);
+	used = calloc(model->y_height * model->x_width, sizeof(*used));
+	if (!used) FAIL(ENOMEM);
+	max_used = 0;
+	if (opts->switches || opts->heatmap) {
+		for (y = 0; y < model->y_height; y++) {
+			for (x = 0; x < model->x_width; x++) {
+				used[y*model->x_width + x] =
+					num_used_switches(model, y, x);
+				if (used[y*model->x_width + x] > max_used)
+					max_used = used[y*model->x_width + x];
+			}
+		}
+	}
+
+	fprintf(f, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
 		"<svg version=\"2.0\"\n"
 		"   xmlns=\"http://www.w3.org/2000/svg\"\n"
 		"   xmlns:xlink=\"http://www.w3.org/1999/xlink\"\n"
 		"   xmlns:fpga=\"http://qi-hw.com/fpga\"\n"
-		"   id=\"root\">\n"
-		"<style type=\"text/css\"><![CDATA[text{font-size:8pt;font-family:sans-serif;text-anchor:end;}]]></style>\n"
-		"</svg>\n";
-
-	xmlDocPtr doc = 0;
-	xmlXPathContextPtr xpathCtx = 0;
-	xmlXPathObjectPtr xpathObj = 0;
-	xmlNodePtr new_node;
-	struct fpga_model model = {0};
-	char str[128];
-	int i, j;
+		"   id=\"root\" width=\"%i\" height=\"%i\">\n"
+		"<style type=\"text/css\"><![CDATA["
+		"text{font-size:8pt;font-family:sans-serif;text-anchor:end;}"
+		" .devs{font-size:6pt;fill:#606060;}"
+		" .used{font-weight:bold;fill:#000000;}"
+		" .sw{font-size:6pt;text-anchor:start;fill:#c00000;}"
+		" .net{fill:none;stroke:#0000c0;stroke-opacity:0.5;}"
+		"]]></style>\n",
+		model->x_width * HORIZ_TILE_SPACING + HORIZ_TILE_SPACING/2,
+		20 + VERT_TILE_SPACING + model->y_height * VERT_TILE_SPACING + 20);
 
-// can't get indent formatting to work - use 'xmllint --pretty 1 -'
-// on the output for now
+	if (opts->heatmap)
+		draw_heatmap(f, model, used, max_used);
+	for (y = 0; y < model->y_height; y++) {
+		for (x = 0; x < model->x_width; x++) {
+			fprintf(f, "<text x=\"%i\" y=\"%i\">y%i x%i:</text>\n",
+				TILE_X(x), TILE_Y(y), y, x);
+			fprintf(f, "<text x=\"%i\" y=\"%i\" fpga:tile_y=\"%i\" "
+				"fpga:tile_x=\"%i\">%s</text>\n",
+				TILE_X(x), TILE_Y(y) + 14, y, x,
+				fpga_tiletype_str(YX_TILE(model, y, x)->type));
+			if (opts->devs)
+				draw_devs(f, model, y, x);
+			if (opts->switches && used[y*model->x_width + x])
+				draw_switches(f, model, y, x,
+					used[y*model->x_width + x]);
+		}
+	}
+	if (opts->nets)
+		draw_nets(f, model);
+	fprintf(f, "</svg>\n");
+	free(used);
+	if (ferror(f)) return EIO;
+	return 0;
+fail:
+	free(used);
+	return rc;
+}
 
-	xmlInitParser();
-	if (fpga_build_model(&model, XC6SLX9, TQG144))
-		goto fail;
+static int load_design(struct fpga_model* model, const char* path,
+	int argc, char** argv)
+{
+	struct fpga_config config;
+	FILE* f;
+	int len, rc;
 
-	doc = xmlParseDoc(empty_svg);
-	if (!doc) {
-		fprintf(stderr, "Internal error %i.\n", __LINE__);
-		goto fail;
-	}
-	xpathCtx = xmlXPathNewContext(doc);
-	if (!xpathCtx) {
-		fprintf(stderr, "Cannot create XPath context.\n");
-		goto fail;
-	}
-	xmlXPathRegisterNs(xpathCtx, BAD_CAST "svg", BAD_CAST "http://www.w3.org/2000/svg");
-	xpathObj = xmlXPathEvalExpression(BAD_CAST "//svg:*[@id='root']", xpathCtx);
-	if (!xpathObj) {
-		fprintf(stderr, "Cannot evaluate root expression.\n");
-		goto fail;
-	}
-	if (!xpathObj->nodesetval) {
-		fprintf(stderr, "Cannot find root node.\n");
-		goto fail;
+	if (!(f = fopen(path, "r"))) {
+		fprintf(stderr, "#E Cannot open %s\n", path);
+		return errno;
 	}
-	if (xpathObj->nodesetval->nodeNr != 1) {
-		fprintf(stderr, "Found %i root nodes.\n", xpathObj->nodesetval->nodeNr);
-		goto fail;
+	len = strlen(path);
+	if (len > 4 && !strcmp(&path[len-4], ".bit")) {
+		rc = read_bitfile(&config, f, /*verbose*/ 0);
+		fclose(f);
+		if (rc) FAIL(rc);
+		if (config.idcode_reg == -1) FAIL(EINVAL);
+		rc = fpga_build_model(model, config.reg[config.idcode_reg].int_v,
+			cmdline_package(argc, argv));
+		if (rc) FAIL(rc);
+		rc = extract_model(model, &config.bits);
+		if (rc) FAIL(rc);
+		return 0;
 	}
+	rc = fpga_build_model(model, cmdline_part(argc, argv),
+		cmdline_package(argc, argv));
+	if (rc) { fclose(f); FAIL(rc); }
+	rc = read_floorplan(model, f);
+	fclose(f);
+	if (rc) FAIL(rc);
+	return 0;
+fail:
+	return rc;
+}
+
+int main(int argc, char** argv)
+{
+	static char out_buf[OUT_BUF_SIZE];
+	struct fpga_model model = {0};
+	struct draw_opts opts;
+	const char* design;
+	int i, rc;
 
-	for (i = 0; i < model.y_height; i++) {
-		for (j = 0; j < model.x_width; j++) {
-			sprintf(str, "y%i x%i:", i, j);
-			new_node = xmlNewChild(xpathObj->nodesetval->nodeTab[0],
-			   0 /* xmlNsPtr */, BAD_CAST "text", BAD_CAST str);
-			xmlSetProp(new_node, BAD_CAST "x",
-				xmlXPathCastNumberToString(HORIZ_TILE_SPACING + j*HORIZ_TILE_SPACING));
-			xmlSetProp(new_node, BAD_CAST "y",
-				xmlXPathCastNumberToString(20
-			  + VERT_TILE_SPACING + i*VERT_TILE_SPACING));
-
-			strcpy(str, fpga_tiletype_str(
-				model.tiles[i*model.x_width+j].type));
-			new_node = xmlNewChild(xpathObj->nodesetval->nodeTab[0],
-			   0 /* xmlNsPtr */, BAD_CAST "text", BAD_CAST str);
-			xmlSetProp(new_node, BAD_CAST "x",
-				xmlXPathCastNumberToString(HORIZ_TILE_SPACING + j*HORIZ_TILE_SPACING));
-			xmlSetProp(new_node, BAD_CAST "y",
-				xmlXPathCastNumberToString(20 + VERT_TILE_SPACING + i*VERT_TILE_SPACING + 14));
-			xmlSetProp(new_node, BAD_CAST "fpga:tile_y", BAD_CAST xmlXPathCastNumberToString(i));
-			xmlSetProp(new_node, BAD_CAST "fpga:tile_x", BAD_CAST xmlXPathCastNumberToString(j));
+	memset(&opts, 0, sizeof(opts));
+	design = 0;
+	for (i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "--devs"))
+			opts.devs = 1;
+		else if (!strcmp(argv[i], "--switches"))
+			opts.switches = 1;
+		else if (!strcmp(argv[i], "--nets"))
+			opts.nets = 1;
+		else if (!strcmp(argv[i], "--heatmap"))
+			opts.heatmap = 1;
+		else if (!strncmp(argv[i], "--part=", 7)
+			 || !strncmp(argv[i], "--package=", 10))
+			continue;
+		else if (argv[i][0] != '-' && !design)
+			design = argv[i];
+		else {
+			printf( "\n"
+				"%s - draws the tiles as svg to stdout\n"
+				"Usage: %s [--part=xc6slx9] [--package=tqg144|ftg256]\n"
+				"       %*s [--devs] [--switches] [--nets] [--heatmap]\n"
+				"       %*s [<design.fp|design.bit>]\n"
+				"\n"
+				"--devs      device sites, in bold if configured\n"
+				"--switches  number of used switches per tile\n"
+				"--nets      nets as lines through their tiles\n"
+				"--heatmap   tile background by number of used switches\n"
+				"\n", *argv, *argv, (int) strlen(*argv), "",
+				(int) strlen(*argv), "");
+			return EXIT_FAILURE;
 		}
 	}
-	xmlSetProp(xpathObj->nodesetval->nodeTab[0], BAD_CAST "width",
-		BAD_CAST xmlXPathCastNumberToString(model.x_width * HORIZ_TILE_SPACING + HORIZ_TILE_SPACING/2));
-	xmlSetProp(xpathObj->nodesetval->nodeTab[0], BAD_CAST "height",
-		BAD_CAST xmlXPathCastNumberToString(20 + VERT_TILE_SPACING
-		+ model.y_height * VERT_TILE_SPACING + 20));
-
-	xmlDocFormatDump(stdout, doc, 1 /* format */);
-	xmlXPathFreeObject(xpathObj);
-	xmlXPathFreeContext(xpathCtx); 
-	xmlFreeDoc(doc); 
- 	xmlCleanupParser();
+	setvbuf(stdout, out_buf, _IOFBF, sizeof(out_buf));
+
+	if (design)
+		rc = load_design(&model, design, argc, argv);
+	else
+		rc = fpga_build_model(&model, cmdline_part(argc, argv),
+			cmdline_package(argc, argv));
+	if (rc) FAIL(rc);
+	rc = draw_svg(stdout, &model, &opts);
+	if (rc) FAIL(rc);
+	if (fflush(stdout)) FAIL(errno);
 	fpga_free_model(&model);
 	return EXIT_SUCCESS;
-
 fail:
-	if (xpathObj) xmlXPathFreeObject(xpathObj);
-	if (xpathCtx) xmlXPathFreeContext(xpathCtx); 
-	if (doc) xmlFreeDoc(doc); 
- 	xmlCleanupParser();
 	fpga_free_model(&model);
 	return EXIT_FAILURE;
 }
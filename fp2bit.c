@@ -13,13 +13,21 @@ int main(int argc, char** argv)
 {
 	struct fpga_model model;
 	FILE *fbits = 0, *fp = 0;
-	int rc = -1;
+	int stats, rc = -1;
 
+	stats = argc > 1 && !strcmp(argv[1], "--stats");
+	if (stats) {
+		argv[1] = argv[0];
+		argc--;
+		argv++;
+	}
 	if (argc != 2 && argc != 3) {
 		fprintf(stderr,
 			"\n"
 			"%s - floorplan to bitstream\n"
-			"Usage: %s <floorplan_file|- for stdin> [<bits_file>]\n"
+			"Usage: %s [--stats] <floorplan_file|- for stdin> [<bits_file>]\n"
+			"\n"
+			"--stats  print hot-path counters to stderr (make STATS=1)\n"
 			"\n", argv[0], argv[0]);
 		goto fail;
 	}
@@ -60,6 +68,8 @@ int main(int argc, char** argv)
 
 	if ((rc = read_floorplan(&model, fp))) goto fail;
 	if ((rc = write_bitfile(fbits, &model))) goto fail;
+	if (stats)
+		fpga_print_stats(stderr, &model);
 	fclose(fp);
 	fclose(fbits);
 	return EXIT_SUCCESS;
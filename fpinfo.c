@@ -5,47 +5,727 @@
 // For details see the UNLICENSE file at the root of the source tree.
 //
 
+#include <sys/wait.h>
+
 #include "model.h"
 #include "floorplan.h"
+#include "control.h"
 
-int main(int argc, char** argv)
+//
+// Compare mode: --compare=<category> walks the model directly and
+// prints one record per line, sorted. With --gold=<file>, the sorted
+// records are instead merged against a gold file that was written the
+// same way, and only the matching/missing/extra summary is printed.
+//
+// Records are kept as small integer tuples. String fields hold an
+// index (string index, tile type, device type) and are sorted by the
+// rank of their string, so the output order is the same as a field-wise
+// comparison of the printed lines.
+//
+
+#define CMP_MAX_FIELDS	6
+#define CMP_LINE_LEN	1024
+
+enum { CMP_INT = 0, CMP_Y, CMP_X, CMP_NAME };
+
+struct cmp_field
 {
-	struct fpga_model model;
-	int no_conns, rc;
+	int kind;
+	// only for CMP_NAME
+	const char* (*name)(int val);
+};
 
-	if ((rc = fpga_build_model(&model, XC6SLX9, TQG144)))
-		goto fail;
+struct cmp_rec
+{
+	uint16_t f[CMP_MAX_FIELDS];
+};
 
-	no_conns = 0;
-	if (argc > 1 && !strcmp(argv[1], "--no-conns"))
-		no_conns = 1;
+struct cmp_state;
 
-	printf("{\n");
-	printf_version(stdout);
-	printf(",\n");
+struct cmp_category
+{
+	const char* name;
+	int num_fields;
+	struct cmp_field fields[CMP_MAX_FIELDS];
+	int (*collect)(struct cmp_state* cs);
+};
 
-	rc = printf_tiles(stdout, &model);
-	if (rc) goto fail;
+struct cmp_state
+{
+	struct fpga_model* model;
+	const struct cmp_category* cat;
+	struct cmp_rec* recs;
+	int num_recs, recs_size;
+	// rank of every value of a CMP_NAME field, 0 for other fields
+	int* rank[CMP_MAX_FIELDS];
+	int rank_len[CMP_MAX_FIELDS];
+};
 
-	printf(",\n");
-	rc = printf_devices(stdout, &model, /*config_only*/ 0, /*no_json*/ 0);
-	if (rc) goto fail;
+// qsort() has no context argument
+static struct fpga_model* s_cmp_model;
+static struct cmp_state* s_cmp_state;
+static const char* (*s_cmp_name)(int val);
+
+static const char* str_name(int val)
+{
+	const char* s = strarray_lookup(&s_cmp_model->str, val);
+	return s ? s : "";
+}
 
-	printf(",\n");
-	rc = printf_ports(stdout, &model);
-	if (rc) goto fail;
+static const char* tiletype_name(int val)
+{
+	return fpga_tiletype_str(val);
+}
 
-	if (!no_conns) {
-		printf(",\n");
-		rc = printf_conns(stdout, &model);
-		if (rc) goto fail;
+static const char* devtype_name(int val)
+{
+	const char* s = fdev_type2str(val);
+	return s ? s : "";
+}
+
+static const char* swdir_name(int val)
+{
+	return val ? "<->" : "->";
+}
+
+static int add_rec(struct cmp_state* cs, const int* f)
+{
+	int i;
+
+	if (cs->num_recs >= cs->recs_size) {
+		void* new_ptr = realloc(cs->recs,
+			(cs->recs_size + 64*1024) * sizeof(*cs->recs));
+		if (!new_ptr) return ENOMEM;
+		cs->recs = new_ptr;
+		cs->recs_size += 64*1024;
+	}
+	for (i = 0; i < cs->cat->num_fields; i++) {
+		if (f[i] < 0 || f[i] > UINT16_MAX) {
+			HERE();
+			return EINVAL;
+		}
+		cs->recs[cs->num_recs].f[i] = f[i];
+	}
+	cs->num_recs++;
+	return 0;
+}
+
+static int collect_tiles(struct cmp_state* cs)
+{
+	struct fpga_model* model = cs->model;
+	int y, x, f[CMP_MAX_FIELDS], rc;
+
+	for (y = 0; y < model->y_height; y++) {
+		for (x = 0; x < model->x_width; x++) {
+			if (YX_TILE(model, y, x)->type == NA)
+				continue;
+			f[0] = y;
+			f[1] = x;
+			f[2] = YX_TILE(model, y, x)->type;
+			if ((rc = add_rec(cs, f))) FAIL(rc);
+		}
+	}
+	return 0;
+fail:
+	return rc;
+}
+
+static int collect_devs(struct cmp_state* cs)
+{
+	struct fpga_model* model = cs->model;
+	struct fpga_tile* tile;
+	int y, x, i, f[CMP_MAX_FIELDS], rc;
+
+	for (y = 0; y < model->y_height; y++) {
+		for (x = 0; x < model->x_width; x++) {
+			tile = YX_TILE(model, y, x);
+			for (i = 0; i < tile->num_devs; i++) {
+				f[0] = y;
+				f[1] = x;
+				f[2] = tile->devs[i].type;
+				f[3] = fdev_typeidx(model, y, x, i);
+				f[4] = tile->devs[i].subtype;
+				if ((rc = add_rec(cs, f))) FAIL(rc);
+			}
+		}
+	}
+	return 0;
+fail:
+	return rc;
+}
+
+// Ports are connection points without connections, conns are all
+// the others with one record per destination.
+static int collect_connpts(struct cmp_state* cs, int ports)
+{
+	struct fpga_model* model = cs->model;
+	struct fpga_tile* tile;
+	int y, x, i, j, dests_o, num_dests, f[CMP_MAX_FIELDS], rc;
+
+	rc = fpga_materialize_all(model);
+	if (rc) FAIL(rc);
+	for (y = 0; y < model->y_height; y++) {
+		for (x = 0; x < model->x_width; x++) {
+			tile = YX_TILE(model, y, x);
+			for (i = 0; i < tile->num_conn_point_names; i++) {
+				dests_o = tile->conn_point_names[i*2];
+				if (i < tile->num_conn_point_names-1)
+					num_dests = tile->conn_point_names[(i+1)*2] - dests_o;
+				else
+					num_dests = tile->num_conn_point_dests - dests_o;
+				f[0] = y;
+				f[1] = x;
+				f[2] = tile->conn_point_names[i*2+1];
+				if (ports) {
+					if (num_dests)
+						continue;
+					if ((rc = add_rec(cs, f))) FAIL(rc);
+					continue;
+				}
+				for (j = 0; j < num_dests; j++) {
+					f[3] = tile->conn_point_dests[(dests_o+j)*3+1];
+					f[4] = tile->conn_point_dests[(dests_o+j)*3];
+					f[5] = tile->conn_point_dests[(dests_o+j)*3+2];
+					if ((rc = add_rec(cs, f))) FAIL(rc);
+				}
+			}
+		}
+	}
+	return 0;
+fail:
+	return rc;
+}
+
+static int collect_ports(struct cmp_state* cs)
+{
+	return collect_connpts(cs, /*ports*/ 1);
+}
+
+static int collect_conns(struct cmp_state* cs)
+{
+	return collect_connpts(cs, /*ports*/ 0);
+}
+
+static int collect_sw(struct cmp_state* cs)
+{
+	struct fpga_model* model = cs->model;
+	int y, x, i, f[CMP_MAX_FIELDS], rc;
+
+	rc = fpga_materialize_all(model);
+	if (rc) FAIL(rc);
+	for (y = 0; y < model->y_height; y++) {
+		for (x = 0; x < model->x_width; x++) {
+			for (i = 0; i < YX_TILE(model, y, x)->num_switches; i++) {
+				f[0] = y;
+				f[1] = x;
+				f[2] = fpga_switch_str_i(model, y, x, i, SW_FROM);
+				f[3] = fpga_switch_is_bidir(model, y, x, i);
+				f[4] = fpga_switch_str_i(model, y, x, i, SW_TO);
+				if ((rc = add_rec(cs, f))) FAIL(rc);
+			}
+		}
+	}
+	return 0;
+fail:
+	return rc;
+}
+
+static const struct cmp_category s_cmp_categories[] = {
+	{ "tiles", 3, {{ CMP_Y }, { CMP_X }, { CMP_NAME, tiletype_name }},
+		collect_tiles },
+	{ "devs", 5, {{ CMP_Y }, { CMP_X }, { CMP_NAME, devtype_name },
+		{ CMP_INT }, { CMP_INT }}, collect_devs },
+	{ "ports", 3, {{ CMP_Y }, { CMP_X }, { CMP_NAME, str_name }},
+		collect_ports },
+	{ "conns", 6, {{ CMP_Y }, { CMP_X }, { CMP_NAME, str_name },
+		{ CMP_Y }, { CMP_X }, { CMP_NAME, str_name }}, collect_conns },
+	{ "sw", 5, {{ CMP_Y }, { CMP_X }, { CMP_NAME, str_name },
+		{ CMP_NAME, swdir_name }, { CMP_NAME, str_name }}, collect_sw },
+};
+
+static int name_val_cmp(const void* a, const void* b)
+{
+	return strcmp(s_cmp_name(*(const int*) a), s_cmp_name(*(const int*) b));
+}
+
+static int build_ranks(struct cmp_state* cs)
+{
+	int field, i, max_val, *vals = 0, rc;
+
+	for (field = 0; field < cs->cat->num_fields; field++) {
+		if (cs->cat->fields[field].kind != CMP_NAME)
+			continue;
+		max_val = 0;
+		for (i = 0; i < cs->num_recs; i++) {
+			if (cs->recs[i].f[field] > max_val)
+				max_val = cs->recs[i].f[field];
+		}
+		vals = malloc((max_val+1) * sizeof(*vals));
+		cs->rank[field] = malloc((max_val+1) * sizeof(*cs->rank[field]));
+		if (!vals || !cs->rank[field]) FAIL(ENOMEM);
+		cs->rank_len[field] = max_val+1;
+		for (i = 0; i <= max_val; i++)
+			vals[i] = i;
+		s_cmp_name = cs->cat->fields[field].name;
+		qsort(vals, max_val+1, sizeof(*vals), name_val_cmp);
+		// equal strings get equal ranks
+		for (i = 0; i <= max_val; i++) {
+			if (i && !strcmp(s_cmp_name(vals[i]), s_cmp_name(vals[i-1])))
+				cs->rank[field][vals[i]] = cs->rank[field][vals[i-1]];
+			else
+				cs->rank[field][vals[i]] = i;
+		}
+		free(vals);
+		vals = 0;
 	}
+	return 0;
+fail:
+	free(vals);
+	return rc;
+}
+
+static int rec_cmp(const void* a, const void* b)
+{
+	const struct cmp_rec* rec_a = a, *rec_b = b;
+	int i, val_a, val_b;
+
+	for (i = 0; i < s_cmp_state->cat->num_fields; i++) {
+		val_a = rec_a->f[i];
+		val_b = rec_b->f[i];
+		if (s_cmp_state->rank[i]) {
+			val_a = s_cmp_state->rank[i][val_a];
+			val_b = s_cmp_state->rank[i][val_b];
+		}
+		if (val_a != val_b)
+			return val_a < val_b ? -1 : 1;
+	}
+	return 0;
+}
+
+static void rec_tokens(struct cmp_state* cs, const struct cmp_rec* rec,
+	char tok_buf[CMP_MAX_FIELDS][CMP_LINE_LEN/CMP_MAX_FIELDS],
+	const char** tok)
+{
+	const struct cmp_field* field;
+	int i;
 
-	printf(",\n");
-	rc = printf_switches(stdout, &model);
-	if (rc) goto fail;
+	for (i = 0; i < cs->cat->num_fields; i++) {
+		field = &cs->cat->fields[i];
+		if (field->kind == CMP_NAME) {
+			tok[i] = field->name(rec->f[i]);
+			continue;
+		}
+		snprintf(tok_buf[i], sizeof(tok_buf[i]), "%s%i",
+			field->kind == CMP_Y ? "y"
+			: (field->kind == CMP_X ? "x" : ""), rec->f[i]);
+		tok[i] = tok_buf[i];
+	}
+}
 
-	printf("\n}\n");
+static void printf_rec(FILE* f, struct cmp_state* cs, const struct cmp_rec* rec)
+{
+	char tok_buf[CMP_MAX_FIELDS][CMP_LINE_LEN/CMP_MAX_FIELDS];
+	const char* tok[CMP_MAX_FIELDS];
+	int i;
+
+	rec_tokens(cs, rec, tok_buf, tok);
+	for (i = 0; i < cs->cat->num_fields; i++)
+		fprintf(f, "%s%s", i ? " " : "", tok[i]);
+	fprintf(f, "\n");
+}
+
+// Compares two lines split into tokens, in the same order as rec_cmp().
+static int tok_cmp(struct cmp_state* cs, const char** a, int num_a,
+	const char** b, int num_b)
+{
+	int i, kind, val_a, val_b, rc;
+
+	for (i = 0; i < num_a && i < num_b; i++) {
+		kind = i < cs->cat->num_fields
+			? cs->cat->fields[i].kind : CMP_NAME;
+		if (kind == CMP_NAME) {
+			if ((rc = strcmp(a[i], b[i])))
+				return rc < 0 ? -1 : 1;
+			continue;
+		}
+		val_a = atoi(kind == CMP_INT ? a[i] : a[i]+1);
+		val_b = atoi(kind == CMP_INT ? b[i] : b[i]+1);
+		if (val_a != val_b)
+			return val_a < val_b ? -1 : 1;
+	}
+	if (num_a != num_b)
+		return num_a < num_b ? -1 : 1;
+	return 0;
+}
+
+// Reads the next gold line into line and splits it into tok.
+// Returns the number of tokens, or -1 at the end of the file.
+static int read_gold(FILE* f, char* line, const char** tok)
+{
+	int num_tok, i;
+
+	if (!fgets(line, CMP_LINE_LEN, f))
+		return -1;
+	num_tok = 0;
+	i = 0;
+	while (line[i] && line[i] != '\n') {
+		while (line[i] == ' ')
+			line[i++] = 0;
+		if (!line[i] || line[i] == '\n')
+			break;
+		if (num_tok < CMP_MAX_FIELDS+1)
+			tok[num_tok++] = &line[i];
+		while (line[i] && line[i] != ' ' && line[i] != '\n')
+			i++;
+	}
+	line[i] = 0;
+	return num_tok;
+}
+
+static int compare_gold(struct cmp_state* cs, const char* gold_path)
+{
+	char tok_buf[CMP_MAX_FIELDS][CMP_LINE_LEN/CMP_MAX_FIELDS];
+	char line[2][CMP_LINE_LEN];
+	const char* gold_tok[2][CMP_MAX_FIELDS+1], *rec_tok[CMP_MAX_FIELDS];
+	int cur, num_gold_tok[2], gold_line, rec_i, num_match, num_missing;
+	int* extra = 0, num_extra, i, rc;
+	FILE* f;
+
+	if (!(f = fopen(gold_path, "r"))) {
+		fprintf(stderr, "#E Cannot open gold %s\n", gold_path);
+		return errno;
+	}
+	extra = malloc((cs->num_recs ? cs->num_recs : 1) * sizeof(*extra));
+	if (!extra) FAIL(ENOMEM);
+
+	num_match = num_missing = num_extra = 0;
+	cur = 0;
+	num_gold_tok[cur] = read_gold(f, line[cur], gold_tok[cur]);
+	gold_line = 1;
+	rec_i = 0;
+	while (rec_i < cs->num_recs || num_gold_tok[cur] != -1) {
+		if (num_gold_tok[cur] == -1)
+			i = -1;
+		else if (rec_i >= cs->num_recs)
+			i = 1;
+		else {
+			rec_tokens(cs, &cs->recs[rec_i], tok_buf, rec_tok);
+			i = tok_cmp(cs, rec_tok, cs->cat->num_fields,
+				gold_tok[cur], num_gold_tok[cur]);
+		}
+		if (i <= 0) {
+			if (i)
+				extra[num_extra++] = rec_i;
+			else
+				num_match++;
+			rec_i++;
+		}
+		if (i >= 0) {
+			if (i)
+				num_missing++;
+			num_gold_tok[!cur] = read_gold(f, line[!cur], gold_tok[!cur]);
+			gold_line++;
+			if (num_gold_tok[!cur] != -1
+			    && tok_cmp(cs, gold_tok[cur], num_gold_tok[cur],
+					gold_tok[!cur], num_gold_tok[!cur]) > 0) {
+				fprintf(stderr, "#E %s:%i not sorted\n",
+					gold_path, gold_line);
+				FAIL(EINVAL);
+			}
+			cur = !cur;
+		}
+	}
+	printf("Matching lines\n%i\n", num_match);
+	printf("Missing lines\n%i\n", num_missing);
+	if (num_extra) {
+		printf("Extra lines:\n");
+		for (i = 0; i < num_extra; i++)
+			printf_rec(stdout, cs, &cs->recs[extra[i]]);
+	}
+	free(extra);
+	fclose(f);
+	return 0;
+fail:
+	free(extra);
+	fclose(f);
+	return rc;
+}
+
+static int compare_model(struct fpga_model* model, const char* category,
+	const char* gold_path)
+{
+	struct cmp_state cs;
+	int i, rc;
+
+	memset(&cs, 0, sizeof(cs));
+	cs.model = model;
+	for (i = 0; i < sizeof(s_cmp_categories)/sizeof(*s_cmp_categories); i++) {
+		if (!strcmp(s_cmp_categories[i].name, category)) {
+			cs.cat = &s_cmp_categories[i];
+			break;
+		}
+	}
+	if (!cs.cat) {
+		fprintf(stderr, "#E Unknown compare category %s, expected "
+			"tiles, devs, ports, conns or sw\n", category);
+		return EINVAL;
+	}
+	s_cmp_model = model;
+	s_cmp_state = &cs;
+
+	rc = cs.cat->collect(&cs);
+	if (rc) FAIL(rc);
+	rc = build_ranks(&cs);
+	if (rc) FAIL(rc);
+	qsort(cs.recs, cs.num_recs, sizeof(*cs.recs), rec_cmp);
+
+	if (gold_path) {
+		rc = compare_gold(&cs, gold_path);
+		if (rc) FAIL(rc);
+	} else {
+		for (i = 0; i < cs.num_recs; i++)
+			printf_rec(stdout, &cs, &cs.recs[i]);
+	}
+	rc = 0;
+fail:
+	for (i = 0; i < CMP_MAX_FIELDS; i++)
+		free(cs.rank[i]);
+	free(cs.recs);
+	return rc;
+}
+
+enum { SEC_TILES = 0, SEC_DEVS, SEC_PORTS, SEC_CONNS, SEC_SW, NUM_SECTIONS };
+static const char* s_sections[NUM_SECTIONS] =
+	{ "tiles", "devs", "ports", "conns", "sw" };
+
+static int printf_section(FILE* f, struct fpga_model* model, int section,
+	const struct fp_range* range)
+{
+	switch (section) {
+		case SEC_TILES: return printf_tiles_range(f, model, range);
+		case SEC_DEVS: return printf_devices_range(f, model,
+			/*config_only*/ 0, /*no_json*/ 0, range);
+		case SEC_PORTS: return printf_ports_range(f, model, range);
+		case SEC_CONNS: return printf_conns_range(f, model, range);
+		case SEC_SW: return printf_switches_range(f, model, range);
+	}
+	HERE();
+	return EINVAL;
+}
+
+// Parses a comma-separated list of section names into a bit mask,
+// returns -1 for unknown names.
+static int parse_sections(const char* s)
+{
+	int mask, i, len;
+
+	mask = 0;
+	while (*s) {
+		len = strcspn(s, ",");
+		for (i = 0; i < NUM_SECTIONS; i++) {
+			if (strlen(s_sections[i]) == len
+			    && !strncmp(s_sections[i], s, len))
+				break;
+		}
+		if (i >= NUM_SECTIONS) {
+			fprintf(stderr, "#E Unknown section %.*s\n", len, s);
+			return -1;
+		}
+		mask |= 1 << i;
+		s += len;
+		if (*s) s++;
+	}
+	return mask;
+}
+
+// Parses y<beg>[-[y]<end>] and x<beg>[-[x]<end>], comma-separated.
+static int parse_range(const char* s, struct fp_range* range)
+{
+	int* beg, *end, n;
+	char c;
+
+	range->y_beg = range->x_beg = 0;
+	range->y_end = range->x_end = -1;
+	while (*s) {
+		c = *s++;
+		if (c == 'y') {
+			beg = &range->y_beg;
+			end = &range->y_end;
+		} else if (c == 'x') {
+			beg = &range->x_beg;
+			end = &range->x_end;
+		} else
+			goto fail;
+		if (sscanf(s, "%i%n", beg, &n) != 1 || *beg < 0)
+			goto fail;
+		s += n;
+		*end = *beg;
+		if (*s == '-') {
+			s++;
+			if (*s == c) s++;
+			if (sscanf(s, "%i%n", end, &n) != 1 || *end < *beg)
+				goto fail;
+			s += n;
+		}
+		if (*s == ',') s++;
+		else if (*s) goto fail;
+	}
+	return 0;
+fail:
+	fprintf(stderr, "#E Invalid tile range, expected e.g. y0-y20,x3-x7\n");
+	return -1;
+}
+
+static void printf_sections(FILE* f, struct fpga_model* model, int sections,
+	const struct fp_range* range)
+{
+	int i;
+
+	fprintf(f, "{\n");
+	printf_version(f);
+	for (i = 0; i < NUM_SECTIONS; i++) {
+		if (!(sections & (1 << i)))
+			continue;
+		fprintf(f, ",\n");
+		fflush(f);
+		printf_section(f, model, i, range);
+	}
+	fprintf(f, "\n}\n");
+}
+
+// Writes every section into <prefix>_<section>.json, each from its
+// own process.
+static int printf_split(struct fpga_model* model, int sections,
+	const struct fp_range* range, const char* prefix)
+{
+	char path[1024];
+	pid_t pid[NUM_SECTIONS];
+	FILE* f;
+	int i, status, rc;
+
+	// build everything once before forking
+	rc = fpga_materialize_all(model);
+	if (rc) FAIL(rc);
+	fflush(stdout);
+	for (i = 0; i < NUM_SECTIONS; i++) {
+		pid[i] = 0;
+		if (!(sections & (1 << i)))
+			continue;
+		pid[i] = fork();
+		if (pid[i] == -1) FAIL(errno);
+		if (pid[i])
+			continue;
+		snprintf(path, sizeof(path), "%s_%s.json", prefix, s_sections[i]);
+		if (!(f = fopen(path, "w"))) {
+			fprintf(stderr, "#E Cannot write %s\n", path);
+			_exit(EXIT_FAILURE);
+		}
+		printf_sections(f, model, 1 << i, range);
+		rc = ferror(f) | fclose(f) | model->rc;
+		_exit(rc ? EXIT_FAILURE : EXIT_SUCCESS);
+	}
+	rc = 0;
+	for (i = 0; i < NUM_SECTIONS; i++) {
+		if (!pid[i])
+			continue;
+		if (waitpid(pid[i], &status, 0) == -1
+		    || !WIFEXITED(status) || WEXITSTATUS(status)) {
+			fprintf(stderr, "#E Writing section %s failed\n",
+				s_sections[i]);
+			rc = EIO;
+		}
+	}
+	return rc;
+fail:
+	return rc;
+}
+
+int main(int argc, char** argv)
+{
+	struct fpga_model model;
+	struct fp_range range, *range_p;
+	const char* compare, *gold, *split, *graph;
+	int sections, i, rc;
+
+	sections = (1 << NUM_SECTIONS) - 1;
+	compare = gold = split = graph = 0;
+	range_p = 0;
+	for (i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "--no-conns"))
+			sections &= ~(1 << SEC_CONNS);
+		else if (!strncmp(argv[i], "--sections=", 11)) {
+			if ((sections = parse_sections(&argv[i][11])) == -1)
+				return EXIT_FAILURE;
+		} else if (!strncmp(argv[i], "--tiles=", 8)) {
+			if (parse_range(&argv[i][8], &range))
+				return EXIT_FAILURE;
+			range_p = &range;
+		} else if (!strncmp(argv[i], "--split=", 8))
+			split = &argv[i][8];
+		else if (!strncmp(argv[i], "--graph=", 8))
+			graph = &argv[i][8];
+		else if (!strncmp(argv[i], "--compare=", 10))
+			compare = &argv[i][10];
+		else if (!strncmp(argv[i], "--gold=", 7))
+			gold = &argv[i][7];
+		else {
+			printf( "\n"
+				"%s - prints the fpga model\n"
+				"Usage: %s [--no-conns] [--sections=tiles,devs,ports,conns,sw]\n"
+				"       %*s [--tiles=y<beg>-y<end>,x<beg>-x<end>]\n"
+				"       %*s [--split=<prefix>]\n"
+				"       %*s [--graph=<file>]\n"
+				"       %*s [--compare=tiles|devs|ports|conns|sw [--gold=<file>]]\n"
+				"\n"
+				"--split writes every section into <prefix>_<section>.json,\n"
+				"all sections in parallel.\n"
+				"--graph writes the routing graph in binary form, see\n"
+				"write_graph() and map_graph() in floorplan.h.\n"
+				"--compare prints the sorted records of one category,\n"
+				"with --gold they are compared against a gold file\n"
+				"written the same way.\n"
+				"\n", *argv, *argv, (int) strlen(*argv), "",
+				(int) strlen(*argv), "", (int) strlen(*argv), "",
+				(int) strlen(*argv), "");
+			return EXIT_FAILURE;
+		}
+	}
+	if (gold && !compare) {
+		fprintf(stderr, "#E --gold requires --compare\n");
+		return EXIT_FAILURE;
+	}
+
+	if ((rc = fpga_build_model(&model, XC6SLX9, TQG144)))
+		goto fail;
+
+	if (compare) {
+		rc = compare_model(&model, compare, gold);
+		if (rc) goto fail;
+		return EXIT_SUCCESS;
+	}
+	if (graph) {
+		FILE* f = fopen(graph, "w");
+		if (!f) {
+			fprintf(stderr, "#E Cannot write %s\n", graph);
+			rc = errno;
+			goto fail;
+		}
+		rc = write_graph(f, &model);
+		if (fclose(f) && !rc)
+			rc = errno;
+		if (rc) goto fail;
+		return EXIT_SUCCESS;
+	}
+	if (split) {
+		rc = printf_split(&model, sections, range_p, split);
+		if (rc) goto fail;
+		return EXIT_SUCCESS;
+	}
+	printf_sections(stdout, &model, sections, range_p);
+	if (model.rc) {
+		rc = model.rc;
+		goto fail;
+	}
 	return EXIT_SUCCESS;
 fail:
 	return rc;
@@ -33,7 +33,7 @@ int main(int argc, char** argv)
 	struct fpgadev_logic logic_cfg;
 	net_idx_t inA_net, inB_net, out_net;
 
-	fpga_build_model(&model, XC6SLX9, TQG144);
+	fpga_build_model_lazy(&model, XC6SLX9, TQG144);
 
 	fpga_find_iob(&model, "P45", &iob_inA_y, &iob_inA_x,
 		&iob_inA_type_idx);
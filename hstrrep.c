@@ -9,20 +9,440 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdint.h>
-#include <assert.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 
 #include "helper.h"
 
+#define CHUNK_SIZE	(4*1024*1024)
+#define READ_CHUNK	(1024*1024)
+#define MAX_THREADS	64
+#define NO_TOKEN	0xFFFFFFFF
+
+struct input_file
+{
+	const char* data;
+	uint64_t len;
+	int mapped;
+};
+
+// The search and replace strings point into the token file.
+struct token
+{
+	uint32_t hash;
+	uint32_t search_len;
+	const char* search;
+	uint32_t replace_len;
+	const char* replace;
+};
+
+// Open addressing with linear probing, NO_TOKEN means free.
+// num_slots is always a power of 2 and at least twice the
+// number of tokens.
+struct token_table
+{
+	struct token* tokens;
+	uint32_t num_tokens;
+	uint32_t* slots;
+	uint32_t num_slots;
+};
+
+struct chunk
+{
+	uint64_t start, end;
+	char* out;
+	size_t out_len, out_alloc;
+	int done;
+};
+
+// Workers pick chunks in order and the main thread writes them
+// in order. At most max_inflight chunks are processed or waiting
+// to be written at any time, which bounds memory use.
+struct replace_work
+{
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	const struct input_file* data;
+	const struct token_table* table;
+	struct chunk* chunks;
+	int num_chunks, next_chunk, num_written, max_inflight;
+	int failed;
+};
+
+static uint32_t hash_token(const char* s, uint32_t len)
+{
+	uint32_t hash = 5381;
+	uint32_t i;
+
+	for (i = 0; i < len; i++)
+		hash = ((hash << 5) + hash) + (unsigned char) s[i];
+	return hash;
+}
+
+// Maps the whole file, or reads it in large chunks if
+// it cannot be mapped.
+static int read_input(const char* path, struct input_file* in)
+{
+	struct stat st;
+	FILE* fp;
+	char* buf, *new_buf;
+	uint64_t buf_len, buf_alloc;
+	size_t read_len;
+	void* map;
+
+	CLEAR(*in);
+	fp = fopen(path, "r");
+	if (!fp) {
+		fprintf(stderr, "Error opening %s.\n", path);
+		return -1;
+	}
+	if (!fstat(fileno(fp), &st) && S_ISREG(st.st_mode)) {
+		if (!st.st_size) {
+			fclose(fp);
+			in->data = "";
+			return 0;
+		}
+		map = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fileno(fp), 0);
+		if (map != MAP_FAILED) {
+			madvise(map, st.st_size, MADV_SEQUENTIAL);
+			fclose(fp);
+			in->data = map;
+			in->len = st.st_size;
+			in->mapped = 1;
+			return 0;
+		}
+	}
+	buf = 0;
+	buf_len = 0;
+	buf_alloc = 0;
+	do {
+		if (buf_len + READ_CHUNK > buf_alloc) {
+			buf_alloc = buf_alloc ? buf_alloc*2 : 16*READ_CHUNK;
+			new_buf = realloc(buf, buf_alloc);
+			if (!new_buf) {
+				fprintf(stderr, "Out of memory in %s:%i\n",
+					__FILE__, __LINE__);
+				free(buf);
+				fclose(fp);
+				return -1;
+			}
+			buf = new_buf;
+		}
+		read_len = fread(&buf[buf_len], 1, READ_CHUNK, fp);
+		buf_len += read_len;
+	} while (read_len == READ_CHUNK);
+	fclose(fp);
+	in->data = buf;
+	in->len = buf_len;
+	return 0;
+}
+
+static void free_input(struct input_file* in)
+{
+	if (in->mapped)
+		munmap((void*) in->data, in->len);
+	else if (in->len)
+		free((void*) in->data);
+	CLEAR(*in);
+}
+
+static const struct token* find_token(const struct token_table* table,
+	const char* s, uint32_t len)
+{
+	const struct token* tok;
+	uint32_t hash, slot;
+
+	hash = hash_token(s, len);
+	slot = hash & (table->num_slots-1);
+	while (table->slots[slot] != NO_TOKEN) {
+		tok = &table->tokens[table->slots[slot]];
+		if (tok->hash == hash && tok->search_len == len
+		    && !memcmp(tok->search, s, len))
+			return tok;
+		slot = (slot+1) & (table->num_slots-1);
+	}
+	return 0;
+}
+
+static int is_space(char c)
+{
+	return c == ' ' || c == '\t' || c == '\n' || c == '\r'
+		|| c == '\v' || c == '\f';
+}
+
+// Each token line is a search word up to the first space,
+// followed by whitespace and the replacement up to the end
+// of the line. A later line for the same word wins.
+static int read_tokens(const struct input_file* in, struct token_table* table)
+{
+	const char* d = in->data;
+	uint64_t pos, line_end, search_start, search_end;
+	uint32_t num_alloc, slot, i;
+	struct token* tok;
+	void* new_ptr;
+
+	CLEAR(*table);
+	num_alloc = 0;
+	for (pos = 0; pos < in->len; pos = line_end+1) {
+		for (line_end = pos; line_end < in->len && d[line_end] != '\n'; line_end++);
+		while (pos < line_end && is_space(d[pos])) pos++;
+		search_start = pos;
+		while (pos < line_end && d[pos] != ' ') pos++;
+		search_end = pos;
+		while (pos < line_end && is_space(d[pos])) pos++;
+		if (search_end >= line_end || pos >= line_end)
+			continue;
+
+		if (table->num_tokens >= num_alloc) {
+			num_alloc = num_alloc ? num_alloc*2 : 1024;
+			new_ptr = realloc(table->tokens, num_alloc*sizeof(*table->tokens));
+			if (!new_ptr) {
+				fprintf(stderr, "Out of memory in %s:%i\n",
+					__FILE__, __LINE__);
+				return -1;
+			}
+			table->tokens = new_ptr;
+		}
+		tok = &table->tokens[table->num_tokens++];
+		tok->search = &d[search_start];
+		tok->search_len = search_end - search_start;
+		tok->hash = hash_token(tok->search, tok->search_len);
+		tok->replace = &d[pos];
+		tok->replace_len = line_end - pos;
+	}
+
+	for (table->num_slots = 1024; table->num_slots < table->num_tokens*2;
+	     table->num_slots *= 2);
+	table->slots = malloc(table->num_slots*sizeof(*table->slots));
+	if (!table->slots) {
+		fprintf(stderr, "Out of memory in %s:%i\n", __FILE__, __LINE__);
+		return -1;
+	}
+	memset(table->slots, 0xFF, table->num_slots*sizeof(*table->slots));
+	for (i = 0; i < table->num_tokens; i++) {
+		tok = &table->tokens[i];
+		slot = tok->hash & (table->num_slots-1);
+		while (table->slots[slot] != NO_TOKEN) {
+			if (table->tokens[table->slots[slot]].search_len == tok->search_len
+			    && !memcmp(table->tokens[table->slots[slot]].search,
+					tok->search, tok->search_len))
+				break;
+			slot = (slot+1) & (table->num_slots-1);
+		}
+		table->slots[slot] = i;
+	}
+	return 0;
+}
+
+static int chunk_append(struct chunk* c, const char* s, size_t len)
+{
+	size_t new_alloc;
+	char* new_out;
+
+	if (c->out_len + len > c->out_alloc) {
+		new_alloc = c->out_alloc ? c->out_alloc : CHUNK_SIZE + CHUNK_SIZE/4;
+		while (new_alloc < c->out_len + len)
+			new_alloc *= 2;
+		new_out = realloc(c->out, new_alloc);
+		if (!new_out) {
+			fprintf(stderr, "Out of memory in %s:%i\n", __FILE__, __LINE__);
+			return -1;
+		}
+		c->out = new_out;
+		c->out_alloc = new_alloc;
+	}
+	memcpy(&c->out[c->out_len], s, len);
+	c->out_len += len;
+	return 0;
+}
+
+// Words are separated by spaces and newlines. Every line with at
+// least one word is written with single spaces between the words,
+// lines without words are dropped.
+static int replace_chunk(const struct input_file* in,
+	const struct token_table* table, struct chunk* c)
+{
+	const char* d = in->data;
+	const struct token* tok;
+	uint64_t pos, word_start;
+	int words_in_line;
+
+	words_in_line = 0;
+	for (pos = c->start; pos < c->end; ) {
+		if (d[pos] == ' ' || d[pos] == '\n') {
+			if (d[pos] == '\n' && words_in_line) {
+				if (chunk_append(c, "\n", 1)) return -1;
+				words_in_line = 0;
+			}
+			pos++;
+			continue;
+		}
+		word_start = pos;
+		while (pos < c->end && d[pos] != ' ' && d[pos] != '\n')
+			pos++;
+		if (words_in_line++ && chunk_append(c, " ", 1))
+			return -1;
+		tok = find_token(table, &d[word_start], pos - word_start);
+		if (tok) {
+			if (chunk_append(c, tok->replace, tok->replace_len))
+				return -1;
+		} else if (chunk_append(c, &d[word_start], pos - word_start))
+			return -1;
+	}
+	// last line of the file without newline
+	if (words_in_line && chunk_append(c, "\n", 1))
+		return -1;
+	return 0;
+}
+
+static void* replace_thread(void* arg)
+{
+	struct replace_work* work = arg;
+	int i, rc;
+
+	while (1) {
+		pthread_mutex_lock(&work->lock);
+		while (!work->failed && work->next_chunk < work->num_chunks
+		       && work->next_chunk >= work->num_written + work->max_inflight)
+			pthread_cond_wait(&work->cond, &work->lock);
+		if (work->failed || work->next_chunk >= work->num_chunks) {
+			pthread_mutex_unlock(&work->lock);
+			break;
+		}
+		i = work->next_chunk++;
+		pthread_mutex_unlock(&work->lock);
+
+		rc = replace_chunk(work->data, work->table, &work->chunks[i]);
+
+		pthread_mutex_lock(&work->lock);
+		if (rc) work->failed = 1;
+		work->chunks[i].done = 1;
+		pthread_cond_broadcast(&work->cond);
+		pthread_mutex_unlock(&work->lock);
+	}
+	return 0;
+}
+
+// Splits the data into chunks that end after a newline.
+static int split_chunks(const struct input_file* in, struct chunk** chunks,
+	int* num_chunks)
+{
+	uint64_t pos, end;
+	int num_alloc;
+	void* new_ptr;
+
+	*chunks = 0;
+	*num_chunks = 0;
+	num_alloc = 0;
+	for (pos = 0; pos < in->len; pos = end) {
+		end = pos + CHUNK_SIZE;
+		if (end >= in->len)
+			end = in->len;
+		else {
+			while (end < in->len && in->data[end-1] != '\n')
+				end++;
+		}
+		if (*num_chunks >= num_alloc) {
+			num_alloc = num_alloc ? num_alloc*2 : 64;
+			new_ptr = realloc(*chunks, num_alloc*sizeof(**chunks));
+			if (!new_ptr) {
+				fprintf(stderr, "Out of memory in %s:%i\n",
+					__FILE__, __LINE__);
+				return -1;
+			}
+			*chunks = new_ptr;
+		}
+		memset(&(*chunks)[*num_chunks], 0, sizeof(**chunks));
+		(*chunks)[*num_chunks].start = pos;
+		(*chunks)[*num_chunks].end = end;
+		(*num_chunks)++;
+	}
+	return 0;
+}
+
+static int replace_all(const struct input_file* data,
+	const struct token_table* table)
+{
+	struct replace_work work;
+	pthread_t threads[MAX_THREADS];
+	long num_threads;
+	int i, num_started, rc;
+
+	CLEAR(work);
+	if (split_chunks(data, &work.chunks, &work.num_chunks))
+		return -1;
+	work.data = data;
+	work.table = table;
+
+	num_threads = sysconf(_SC_NPROCESSORS_ONLN);
+	if (num_threads < 1) num_threads = 1;
+	if (num_threads > MAX_THREADS) num_threads = MAX_THREADS;
+	work.max_inflight = 2*num_threads;
+	pthread_mutex_init(&work.lock, 0);
+	pthread_cond_init(&work.cond, 0);
+	for (num_started = 0; num_started < num_threads; num_started++) {
+		rc = pthread_create(&threads[num_started], 0, replace_thread, &work);
+		if (rc) {
+			fprintf(stderr, "Cannot create thread: %s\n", strerror(rc));
+			break;
+		}
+	}
+	rc = 0;
+	if (!num_started) {
+		// replace in the main thread
+		work.max_inflight = work.num_chunks;
+		replace_thread(&work);
+	}
+	for (i = 0; i < work.num_chunks; i++) {
+		pthread_mutex_lock(&work.lock);
+		while (!work.chunks[i].done && !work.failed)
+			pthread_cond_wait(&work.cond, &work.lock);
+		pthread_mutex_unlock(&work.lock);
+		if (work.failed) {
+			rc = -1;
+			break;
+		}
+		if (work.chunks[i].out_len
+		    && fwrite(work.chunks[i].out, 1, work.chunks[i].out_len,
+				stdout) != work.chunks[i].out_len) {
+			fprintf(stderr, "Error writing output: %s\n",
+				strerror(errno));
+			pthread_mutex_lock(&work.lock);
+			work.failed = 1;
+			pthread_cond_broadcast(&work.cond);
+			pthread_mutex_unlock(&work.lock);
+			rc = -1;
+			break;
+		}
+		free(work.chunks[i].out);
+		work.chunks[i].out = 0;
+		pthread_mutex_lock(&work.lock);
+		work.num_written++;
+		pthread_cond_broadcast(&work.cond);
+		pthread_mutex_unlock(&work.lock);
+	}
+	for (i = 0; i < num_started; i++)
+		pthread_join(threads[i], 0);
+	for (i = 0; i < work.num_chunks; i++)
+		free(work.chunks[i].out);
+	free(work.chunks);
+	pthread_cond_destroy(&work.cond);
+	pthread_mutex_destroy(&work.lock);
+	return rc;
+}
+
 int main(int argc, char** argv)
 {
-	char line[1024], search_str[1024], replace_str[1024];
-	char* next_wrd, *lasts;
-	const char* replace_ptr;
-	struct hashed_strarray search_arr, replace_arr;
-	FILE* fp = 0;
-	int i, rc, search_idx;
+	static char out_buf[READ_CHUNK];
+	struct input_file token_file, data_file;
+	struct token_table table;
 
+	CLEAR(token_file);
+	CLEAR(data_file);
+	CLEAR(table);
 	if (argc < 3) {
 		fprintf(stderr,
 			"\n"
@@ -33,79 +453,37 @@ int main(int argc, char** argv)
 		goto xout;
 	}
 
-	if (strarray_init(&search_arr, STRIDX_1M)) {
-		fprintf(stderr, "Out of memory in %s:%i\n", __FILE__, __LINE__);
-		goto xout;
-	}
-	if (strarray_init(&replace_arr, STRIDX_1M)) {
-		fprintf(stderr, "Out of memory in %s:%i\n", __FILE__, __LINE__);
-		goto xout;
-	}
-
 	//
-	// Read search and replace tokens into hashed strarray
+	// Read search and replace tokens into hash table
 	//
 
-	fp = fopen(argv[2], "r");
-	if (!fp) {
-		fprintf(stderr, "Error opening %s.\n", argv[2]);
+	if (read_input(argv[2], &token_file))
+		goto xout;
+	if (read_tokens(&token_file, &table))
 		goto xout;
-	}
-	while (fgets(line, sizeof(line), fp)) {
-		memset(replace_str, 0, sizeof(replace_str));
-		i = sscanf(line, " %[^ ] %1023c", search_str, replace_str);
-		if (i == 2) {
-			i = strlen(replace_str);
-			if (i && replace_str[i-1] == '\n')
-				replace_str[i-1] = 0;
-			rc = strarray_add(&search_arr, search_str, &search_idx);
-			if (rc) {
-				fprintf(stderr, "Out of memory in %s:%i\n", __FILE__, __LINE__);
-				goto xout;
-			}
-			rc = strarray_stash(&replace_arr, replace_str, search_idx);
-			if (rc) {
-				fprintf(stderr, "Out of memory in %s:%i\n", __FILE__, __LINE__);
-				goto xout;
-			}
-		}
-	}
-	fclose(fp);
 
 	//
 	// Go through data file and search and replace
 	//
 
-	fp = fopen(argv[1], "r");
-	if (!fp) {
-		fprintf(stderr, "Error opening %s.\n", argv[1]);
+	if (read_input(argv[1], &data_file))
+		goto xout;
+	setvbuf(stdout, out_buf, _IOFBF, sizeof(out_buf));
+	if (replace_all(&data_file, &table))
+		goto xout;
+	if (fflush(stdout)) {
+		fprintf(stderr, "Error writing output: %s\n", strerror(errno));
 		goto xout;
 	}
-	while (fgets(line, sizeof(line), fp)) {
-		next_wrd = strtok_r(line, " \n", &lasts);
-		if (next_wrd) {
-			do {
-				search_idx = strarray_find(&search_arr, next_wrd);
-				if (search_idx == STRIDX_NO_ENTRY)
-					fputs(next_wrd, stdout);
-				else {
-					replace_ptr = strarray_lookup(&replace_arr, search_idx);
-					if (!replace_ptr) {
-						fprintf(stderr, "Internal error in %s:%i\n", __FILE__, __LINE__);
-						goto xout;
-					}
-					fputs(replace_ptr, stdout);
-				}
-				next_wrd = strtok_r(0, " \n", &lasts);
-				if (next_wrd)
-					putchar(' ');
-			} while ( next_wrd );
-			putchar('\n');
-		}
-	}
-	fclose(fp);
+	free_input(&data_file);
+	free(table.tokens);
+	free(table.slots);
+	free_input(&token_file);
 	return EXIT_SUCCESS;
 xout:
-	if (fp) fclose(fp);
+	free_input(&data_file);
+	free(table.tokens);
+	free(table.slots);
+	free_input(&token_file);
 	return EXIT_FAILURE;
 }
@@ -43,12 +43,12 @@ int main(int argc, char** argv)
 	fpga_build_model(&model, cmdline_part(argc, argv),
 		cmdline_package(argc, argv));
 
-	fpga_find_iob(&model, xc6_find_pkg_pin(model.pkg, param_clock_pin),
+	fpga_find_iob(&model, fpga_find_pkg_pin(&model, param_clock_pin),
 		&iob_clk_y, &iob_clk_x, &iob_clk_type_idx);
 	fdev_iob_input(&model, iob_clk_y, iob_clk_x, iob_clk_type_idx,
 		IO_LVCMOS33);
 
-	fpga_find_iob(&model, xc6_find_pkg_pin(model.pkg, param_led_pin),
+	fpga_find_iob(&model, fpga_find_pkg_pin(&model, param_led_pin),
 		&iob_led_y, &iob_led_x, &iob_led_type_idx);
 	fdev_iob_output(&model, iob_led_y, iob_led_x, iob_led_type_idx,
 		IO_LVCMOS25);
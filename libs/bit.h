@@ -94,7 +94,7 @@ int read_bitfile(struct fpga_config* cfg, FILE* f, int verbose_read);
 #define DUMP_REGS		0x0002
 #define DUMP_BITS		0x0004
 #define DUMP_CRC		0x0008
-int dump_config(struct fpga_config* cfg, int flags);
+int dump_config(FILE* f, struct fpga_config* cfg, int flags);
 
 void free_config(struct fpga_config* cfg);
 
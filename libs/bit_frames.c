@@ -24,9 +24,14 @@ static uint8_t* get_first_minor(struct fpga_bits* bits, int row, int major)
 	return &bits->d[(row*FRAMES_PER_ROW + num_frames)*FRAME_SIZE];
 }
 
+// get_bit() and set_bit() have no model, they count per thread and
+// extract_model() and write_model() add the difference to model->stats.
+static __thread long s_bit_gets, s_bit_sets;
+
 static int get_bit(struct fpga_bits* bits,
 	int row, int major, int minor, int bit_i)
 {
+	STAT_INC(s_bit_gets);
 	return frame_get_bit(get_first_minor(bits, row, major)
 		+ minor*FRAME_SIZE, bit_i);
 }
@@ -34,6 +39,7 @@ static int get_bit(struct fpga_bits* bits,
 static void set_bit(struct fpga_bits* bits,
 	int row, int major, int minor, int bit_i)
 {
+	STAT_INC(s_bit_sets);
 	return frame_set_bit(get_first_minor(bits, row, major)
 		+ minor*FRAME_SIZE, bit_i);
 }
@@ -41,6 +47,7 @@ static void set_bit(struct fpga_bits* bits,
 static void clear_bit(struct fpga_bits* bits,
 	int row, int major, int minor, int bit_i)
 {
+	STAT_INC(s_bit_sets);
 	return frame_clear_bit(get_first_minor(bits, row, major)
 		+ minor*FRAME_SIZE, bit_i);
 }
@@ -137,49 +144,49 @@ static int write_type2(struct fpga_bits* bits, struct fpga_model* model)
 				/*minor*/ 22, 64*15+XC6_HCLK_BITS+4);
 		}
 
-		if (dev->u.iob.istandard[0]) {
-			if (!dev->u.iob.I_mux
-			    || !dev->u.iob.bypass_mux
-			    || dev->u.iob.ostandard[0])
+		if (dev->u->iob.istandard[0]) {
+			if (!dev->u->iob.I_mux
+			    || !dev->u->iob.bypass_mux
+			    || dev->u->iob.ostandard[0])
 				HERE();
 
 			u64 = XC6_IOB_INPUT | XC6_IOB_INSTANTIATED;
 
-			if (dev->u.iob.I_mux == IMUX_I_B)
+			if (dev->u->iob.I_mux == IMUX_I_B)
 				u64 |= XC6_IOB_IMUX_I_B;
 
-			if (!strcmp(dev->u.iob.istandard, IO_LVCMOS33)
-			    || !strcmp(dev->u.iob.istandard, IO_LVCMOS25)
-			    || !strcmp(dev->u.iob.istandard, IO_LVTTL))
+			if (!strcmp(dev->u->iob.istandard, IO_LVCMOS33)
+			    || !strcmp(dev->u->iob.istandard, IO_LVCMOS25)
+			    || !strcmp(dev->u->iob.istandard, IO_LVTTL))
 				u64 |= XC6_IOB_INPUT_LVCMOS33_25_LVTTL;
-			else if (!strcmp(dev->u.iob.istandard, IO_LVCMOS18)
-			    || !strcmp(dev->u.iob.istandard, IO_LVCMOS15)
-			    || !strcmp(dev->u.iob.istandard, IO_LVCMOS12))
+			else if (!strcmp(dev->u->iob.istandard, IO_LVCMOS18)
+			    || !strcmp(dev->u->iob.istandard, IO_LVCMOS15)
+			    || !strcmp(dev->u->iob.istandard, IO_LVCMOS12))
 				u64 |= XC6_IOB_INPUT_LVCMOS18_15_12;
-			else if (!strcmp(dev->u.iob.istandard, IO_LVCMOS18_JEDEC)
-			    || !strcmp(dev->u.iob.istandard, IO_LVCMOS15_JEDEC)
-			    || !strcmp(dev->u.iob.istandard, IO_LVCMOS12_JEDEC))
+			else if (!strcmp(dev->u->iob.istandard, IO_LVCMOS18_JEDEC)
+			    || !strcmp(dev->u->iob.istandard, IO_LVCMOS15_JEDEC)
+			    || !strcmp(dev->u->iob.istandard, IO_LVCMOS12_JEDEC))
 				u64 |= XC6_IOB_INPUT_LVCMOS18_15_12_JEDEC;
-			else if (!strcmp(dev->u.iob.istandard, IO_SSTL2_I))
+			else if (!strcmp(dev->u->iob.istandard, IO_SSTL2_I))
 				u64 |= XC6_IOB_INPUT_SSTL2_I;
 			else
 				HERE();
 
 			frame_set_u64(&bits->d[IOB_DATA_START
 				+ t2_idx*IOB_ENTRY_LEN], u64);
-		} else if (dev->u.iob.ostandard[0]) {
-			if (!dev->u.iob.drive_strength
-			    || !dev->u.iob.slew
-			    || !dev->u.iob.suspend
-			    || dev->u.iob.istandard[0])
+		} else if (dev->u->iob.ostandard[0]) {
+			if (!dev->u->iob.drive_strength
+			    || !dev->u->iob.slew
+			    || !dev->u->iob.suspend
+			    || dev->u->iob.istandard[0])
 				HERE();
 
 			u64 = XC6_IOB_INSTANTIATED;
 			// for now we always turn on O_PINW even if no net
 			// is connected to the pinw
 			u64 |= XC6_IOB_O_PINW;
-			if (!strcmp(dev->u.iob.ostandard, IO_LVTTL)) {
-				switch (dev->u.iob.drive_strength) {
+			if (!strcmp(dev->u->iob.ostandard, IO_LVTTL)) {
+				switch (dev->u->iob.drive_strength) {
 					case 2: u64 |= XC6_IOB_OUTPUT_LVTTL_DRIVE_2; break;
 					case 4: u64 |= XC6_IOB_OUTPUT_LVTTL_DRIVE_4; break;
 					case 6: u64 |= XC6_IOB_OUTPUT_LVTTL_DRIVE_6; break;
@@ -189,8 +196,8 @@ static int write_type2(struct fpga_bits* bits, struct fpga_model* model)
 					case 24: u64 |= XC6_IOB_OUTPUT_LVTTL_DRIVE_24; break;
 					default: FAIL(EINVAL);
 				}
-			} else if (!strcmp(dev->u.iob.ostandard, IO_LVCMOS33)) {
-				switch (dev->u.iob.drive_strength) {
+			} else if (!strcmp(dev->u->iob.ostandard, IO_LVCMOS33)) {
+				switch (dev->u->iob.drive_strength) {
 					case 2: u64 |= XC6_IOB_OUTPUT_LVCMOS33_25_DRIVE_2; break;
 					case 4: u64 |= XC6_IOB_OUTPUT_LVCMOS33_DRIVE_4; break;
 					case 6: u64 |= XC6_IOB_OUTPUT_LVCMOS33_DRIVE_6; break;
@@ -200,8 +207,8 @@ static int write_type2(struct fpga_bits* bits, struct fpga_model* model)
 					case 24: u64 |= XC6_IOB_OUTPUT_LVCMOS33_DRIVE_24; break;
 					default: FAIL(EINVAL);
 				}
-			} else if (!strcmp(dev->u.iob.ostandard, IO_LVCMOS25)) {
-				switch (dev->u.iob.drive_strength) {
+			} else if (!strcmp(dev->u->iob.ostandard, IO_LVCMOS25)) {
+				switch (dev->u->iob.drive_strength) {
 					case 2: u64 |= XC6_IOB_OUTPUT_LVCMOS33_25_DRIVE_2; break;
 					case 4: u64 |= XC6_IOB_OUTPUT_LVCMOS25_DRIVE_4; break;
 					case 6: u64 |= XC6_IOB_OUTPUT_LVCMOS25_DRIVE_6; break;
@@ -211,9 +218,9 @@ static int write_type2(struct fpga_bits* bits, struct fpga_model* model)
 					case 24: u64 |= XC6_IOB_OUTPUT_LVCMOS25_DRIVE_24; break;
 					default: FAIL(EINVAL);
 				}
-			} else if (!strcmp(dev->u.iob.ostandard, IO_LVCMOS18)
-				   || !strcmp(dev->u.iob.ostandard, IO_LVCMOS18_JEDEC)) {
-				switch (dev->u.iob.drive_strength) {
+			} else if (!strcmp(dev->u->iob.ostandard, IO_LVCMOS18)
+				   || !strcmp(dev->u->iob.ostandard, IO_LVCMOS18_JEDEC)) {
+				switch (dev->u->iob.drive_strength) {
 					case 2: u64 |= XC6_IOB_OUTPUT_LVCMOS18_DRIVE_2; break;
 					case 4: u64 |= XC6_IOB_OUTPUT_LVCMOS18_DRIVE_4; break;
 					case 6: u64 |= XC6_IOB_OUTPUT_LVCMOS18_DRIVE_6; break;
@@ -223,9 +230,9 @@ static int write_type2(struct fpga_bits* bits, struct fpga_model* model)
 					case 24: u64 |= XC6_IOB_OUTPUT_LVCMOS18_DRIVE_24; break;
 					default: FAIL(EINVAL);
 				}
-			} else if (!strcmp(dev->u.iob.ostandard, IO_LVCMOS15)
-				   || !strcmp(dev->u.iob.ostandard, IO_LVCMOS15_JEDEC)) {
-				switch (dev->u.iob.drive_strength) {
+			} else if (!strcmp(dev->u->iob.ostandard, IO_LVCMOS15)
+				   || !strcmp(dev->u->iob.ostandard, IO_LVCMOS15_JEDEC)) {
+				switch (dev->u->iob.drive_strength) {
 					case 2: u64 |= XC6_IOB_OUTPUT_LVCMOS15_DRIVE_2; break;
 					case 4: u64 |= XC6_IOB_OUTPUT_LVCMOS15_DRIVE_4; break;
 					case 6: u64 |= XC6_IOB_OUTPUT_LVCMOS15_DRIVE_6; break;
@@ -234,9 +241,9 @@ static int write_type2(struct fpga_bits* bits, struct fpga_model* model)
 					case 16: u64 |= XC6_IOB_OUTPUT_LVCMOS15_DRIVE_16; break;
 					default: FAIL(EINVAL);
 				}
-			} else if (!strcmp(dev->u.iob.ostandard, IO_LVCMOS12)
-				   || !strcmp(dev->u.iob.ostandard, IO_LVCMOS12_JEDEC)) {
-				switch (dev->u.iob.drive_strength) {
+			} else if (!strcmp(dev->u->iob.ostandard, IO_LVCMOS12)
+				   || !strcmp(dev->u->iob.ostandard, IO_LVCMOS12_JEDEC)) {
+				switch (dev->u->iob.drive_strength) {
 					case 2: u64 |= XC6_IOB_OUTPUT_LVCMOS12_DRIVE_2; break;
 					case 4: u64 |= XC6_IOB_OUTPUT_LVCMOS12_DRIVE_4; break;
 					case 6: u64 |= XC6_IOB_OUTPUT_LVCMOS12_DRIVE_6; break;
@@ -245,13 +252,13 @@ static int write_type2(struct fpga_bits* bits, struct fpga_model* model)
 					default: FAIL(EINVAL);
 				}
 			} else FAIL(EINVAL);
-			switch (dev->u.iob.slew) {
+			switch (dev->u->iob.slew) {
 				case SLEW_SLOW: u64 |= XC6_IOB_SLEW_SLOW; break;
 				case SLEW_FAST: u64 |= XC6_IOB_SLEW_FAST; break;
 				case SLEW_QUIETIO: u64 |= XC6_IOB_SLEW_QUIETIO; break;
 				default: FAIL(EINVAL);
 			}
-			switch (dev->u.iob.suspend) {
+			switch (dev->u->iob.suspend) {
 				case SUSP_LAST_VAL: u64 |= XC6_IOB_SUSP_LAST_VAL; break;
 				case SUSP_3STATE: u64 |= XC6_IOB_SUSP_3STATE; break;
 				case SUSP_3STATE_PULLUP: u64 |= XC6_IOB_SUSP_3STATE_PULLUP; break;
@@ -559,8 +566,9 @@ static int extract_iobs(struct extract_state* es)
 			frame_set_u64(&es->bits->d[IOB_DATA_START
 				+ i*IOB_ENTRY_LEN], 0);
 			if (dev->instantiated) HERE();
+			if (!fdev_cfg(es->model, dev)) RC_FAIL(es->model, ENOMEM);
 			dev->instantiated = 1;
-			dev->u.iob = cfg;
+			dev->u->iob = cfg;
 		} else HERE();
 	}
 	return 0;
@@ -1714,7 +1722,7 @@ static int extract_routing_switches(struct extract_state* es, int y, int x)
 		if (tile->switches[sw_idx] & SWITCH_BIDIRECTIONAL)
 			fprintf(stderr, "#E %s:%i BIDIR not supported yet\n",
 				__FILE__, __LINE__);
-		if (tile->switches[sw_idx] & SWITCH_USED)
+		if (SWITCH_IS_USED(tile, sw_idx))
 			fprintf(stderr, "#E %s:%i switch already in use\n",
 				__FILE__, __LINE__);
 		if (es->num_yx_pos >= MAX_YX_SWITCHES)
@@ -2022,7 +2030,7 @@ static int write_center_sw(struct fpga_bits *bits,
 
 	tile = YX_TILE(model, y, x);
 	for (i = 0; i < tile->num_switches; i++) {
-		if (!(tile->switches[i] & SWITCH_USED))
+		if (!(SWITCH_IS_USED(tile, i)))
 			continue;
 
 		from_str = fpga_switch_str(model, y, x, i, SW_FROM);
@@ -2119,7 +2127,7 @@ static int write_gclk_center_vert_sw(struct fpga_bits *bits,
 	tile = YX_TILE(model, y, x);
 
 	for (i = 0; i < tile->num_switches; i++) {
-		if (!(tile->switches[i] & SWITCH_USED))
+		if (!(SWITCH_IS_USED(tile, i)))
 			continue;
 
 		from_str = fpga_switch_str(model, y, x, i, SW_FROM);
@@ -2243,7 +2251,7 @@ static int write_hclk_sw(struct fpga_bits *bits, struct fpga_model *model,
 
 	tile = YX_TILE(model, y, x);
 	for (i = 0; i < tile->num_switches; i++) {
-		if (!(tile->switches[i] & SWITCH_USED))
+		if (!(SWITCH_IS_USED(tile, i)))
 			continue;
 		from_str = fpga_switch_str(model, y, x, i, SW_FROM);
 		to_str = fpga_switch_str(model, y, x, i, SW_TO);
@@ -2384,7 +2392,7 @@ static int write_bscan(struct fpga_bits *bits, struct fpga_model *model)
 		pinword = frame_get_pinword(u8_p + XC6_BSCAN_MINOR*FRAME_SIZE + XC6_BSCAN_WORD*XC6_WORD_BYTES);
 
 		if (bscan_y == TOP_IO_TILES && !bscan_type_idx
-		    && dev->u.bscan.jtag_test == BSCAN_JTAG_TEST_Y)
+		    && dev->u->bscan.jtag_test == BSCAN_JTAG_TEST_Y)
 			pinword |= 1 << XC6_BSCAN_TEST_PIN;
 		pinword |= 1 << ((bscan_y - TOP_IO_TILES)*2 + bscan_type_idx);
 
@@ -2614,7 +2622,7 @@ typedef struct _bram_init // only first half of array used for bram8
 void bram_extract_init(bram_init_t *init, const uint8_t *bits);
 	for (row = 3; row >= 0; row--) {
 		for (i = XC6_BRAM16_DEVS_PER_ROW-1; i >= 0; i--) {
-			printf_ramb_data(&cfg->bits.d[BRAM_DATA_START
+			printf_ramb_data(stdout, &cfg->bits.d[BRAM_DATA_START
 				+ (row*XC6_BRAM16_DEVS_PER_ROW+i)
 				  *XC6_BRAM_DATA_FRAMES_PER_DEV*FRAME_SIZE],
 				row, i);
@@ -2636,8 +2644,14 @@ int extract_model(struct fpga_model* model, struct fpga_bits* bits)
 {
 	struct extract_state es;
 	net_idx_t net_idx;
+	long bit_gets, bit_sets;
 	int i, rc;
 
+	RC_CHECK(model);
+	bit_gets = s_bit_gets;
+	bit_sets = s_bit_sets;
+	// the extractor walks the switches of all tiles
+	fpga_materialize_all(model);
 	RC_CHECK(model);
 	rc = construct_extract_state(&es, model);
 	if (rc) RC_FAIL(model, rc);
@@ -2673,6 +2687,8 @@ int extract_model(struct fpga_model* model, struct fpga_bits* bits)
 	}
 out:
 	destruct_extract_state(&es);
+	model->stats.bit_gets += s_bit_gets - bit_gets;
+	model->stats.bit_sets += s_bit_sets - bit_sets;
 	RC_RETURN(model);
 }
 
@@ -2706,14 +2722,13 @@ int printf_swbits(struct fpga_model* model)
 static int find_bitpos(struct fpga_model* model, int y, int x, swidx_t sw)
 {
 	enum extra_wires from_w, to_w;
-	const char* from_str, *to_str;
 	int i;
 
 	RC_CHECK(model);
-	from_str = fpga_switch_str(model, y, x, sw, SW_FROM);
-	to_str = fpga_switch_str(model, y, x, sw, SW_TO);
-	from_w = fpga_str2wire(from_str);
-	to_w = fpga_str2wire(to_str);
+	from_w = fpga_str2wire_i(model,
+		fpga_switch_str_i(model, y, x, sw, SW_FROM));
+	to_w = fpga_str2wire_i(model,
+		fpga_switch_str_i(model, y, x, sw, SW_TO));
 
 	if (from_w == NO_WIRE || to_w == NO_WIRE) {
 		HERE();
@@ -2732,7 +2747,8 @@ static int find_bitpos(struct fpga_model* model, int y, int x, swidx_t sw)
 		}
 	}
 	fprintf(stderr, "#E switch %s (%i) to %s (%i) not in model\n",
-		from_str, from_w, to_str, to_w);
+		fpga_switch_str(model, y, x, sw, SW_FROM), from_w,
+		fpga_switch_str(model, y, x, sw, SW_TO), to_w);
 	return -1;
 }
 
@@ -2746,7 +2762,7 @@ static int write_routing_sw(struct fpga_bits* bits, struct fpga_model* model, in
 	// and set bits
 	tile = YX_TILE(model, y, x);
 	for (i = 0; i < tile->num_switches; i++) {
-		if (!(tile->switches[i] & SWITCH_USED))
+		if (!(SWITCH_IS_USED(tile, i)))
 			continue;
 		bit_pos = find_bitpos(model, y, x, i);
 		if (bit_pos == -1) {
@@ -2778,7 +2794,7 @@ static int get_used_switches(struct fpga_model* model, int y, int x,
 	tile = YX_TILE(model, y, x);
 	num_used = 0;
 	for (i = 0; i < tile->num_switches; i++) {
-		if (tile->switches[i] & SWITCH_USED)
+		if (SWITCH_IS_USED(tile, i))
 			num_used++;
 	}
 	if (!num_used) {
@@ -2790,7 +2806,7 @@ static int get_used_switches(struct fpga_model* model, int y, int x,
 	if (!(*str_sw)) FAIL(ENOMEM);
 	*num_sw = 0;
 	for (i = 0; i < tile->num_switches; i++) {
-		if (!(tile->switches[i] & SWITCH_USED))
+		if (!(SWITCH_IS_USED(tile, i)))
 			continue;
 		(*str_sw)[*num_sw].from =
 			fpga_switch_str_i(model, y, x, i, SW_FROM);
@@ -2902,7 +2918,7 @@ static int write_inner_term_sw(struct fpga_bits *bits,
 
 	tile = YX_TILE(model, y, x);
 	for (i = 0; i < tile->num_switches; i++) {
-		if (!(tile->switches[i] & SWITCH_USED))
+		if (!(SWITCH_IS_USED(tile, i)))
 			continue;
 
 		from_str = fpga_switch_str(model, y, x, i, SW_FROM);
@@ -2987,7 +3003,7 @@ static int write_logic_sw(struct fpga_bits *bits,
 
 	tile = YX_TILE(model, y, x);
 	for (i = 0; i < tile->num_switches; i++) {
-		if (!(tile->switches[i] & SWITCH_USED))
+		if (!(SWITCH_IS_USED(tile, i)))
 			continue;
 		from_str = fpga_switch_str(model, y, x, i, SW_FROM);
 		to_str = fpga_switch_str(model, y, x, i, SW_TO);
@@ -3077,7 +3093,7 @@ static int write_switches(struct fpga_bits* bits, struct fpga_model* model)
 			}
 			// print unsupported switches
 			for (i = 0; i < tile->num_switches; i++) {
-				if (!(tile->switches[i] & SWITCH_USED))
+				if (!(SWITCH_IS_USED(tile, i)))
 					continue;
 				fprintf(stderr, "#E %s:%i unsupported switch "
 					"y%i x%i %s\n", __FILE__, __LINE__,
@@ -3095,9 +3111,9 @@ static int is_latch(struct fpga_device *dev)
 	// todo: there are a lot more checks we can do to determine whether
 	//       the entire device is properly configured as a latch or not...
 	for (i = LUT_A; i <= LUT_D; i++) {
-		if (dev->u.logic.a2d[i].ff == FF_LATCH
-		    || dev->u.logic.a2d[i].ff == FF_OR2L
-		    || dev->u.logic.a2d[i].ff == FF_AND2L)
+		if (dev->u->logic.a2d[i].ff == FF_LATCH
+		    || dev->u->logic.a2d[i].ff == FF_OR2L
+		    || dev->u->logic.a2d[i].ff == FF_AND2L)
 			return 1;
 	}
 	return 0;
@@ -3199,32 +3215,32 @@ static int write_logic(struct fpga_bits* bits, struct fpga_model* model)
 
 			// X device
 			if (dev_x->instantiated) {
-				if (dev_x->u.logic.a2d[LUT_A].ff5_srinit == FF_SRINIT1)
+				if (dev_x->u->logic.a2d[LUT_A].ff5_srinit == FF_SRINIT1)
 					mi20 |= 1ULL << XC6_X_A5_FFSRINIT_1;
-				if (dev_x->u.logic.a2d[LUT_B].ff5_srinit == FF_SRINIT1)
+				if (dev_x->u->logic.a2d[LUT_B].ff5_srinit == FF_SRINIT1)
 					mi20 |= 1ULL << XC6_X_B5_FFSRINIT_1;
-				if (dev_x->u.logic.a2d[LUT_C].ff5_srinit == FF_SRINIT1)
+				if (dev_x->u->logic.a2d[LUT_C].ff5_srinit == FF_SRINIT1)
 					mi20 |= 1ULL << XC6_X_C5_FFSRINIT_1;
-				if (dev_x->u.logic.a2d[LUT_D].ff5_srinit == FF_SRINIT1)
+				if (dev_x->u->logic.a2d[LUT_D].ff5_srinit == FF_SRINIT1)
 					mi20 |= 1ULL << XC6_X_D5_FFSRINIT_1;
 
-				if (dev_x->u.logic.a2d[LUT_C].ff_srinit == FF_SRINIT1)
+				if (dev_x->u->logic.a2d[LUT_C].ff_srinit == FF_SRINIT1)
 					mi20 |= 1ULL << XC6_X_C_FFSRINIT_1;
 			}
 
 			// M or L device
 			if (dev_ml->instantiated) {
-				if (dev_ml->u.logic.a2d[LUT_A].ff5_srinit == FF_SRINIT1)
+				if (dev_ml->u->logic.a2d[LUT_A].ff5_srinit == FF_SRINIT1)
 					mi20 |= 1ULL << XC6_ML_A5_FFSRINIT_1;
-				if (dev_ml->u.logic.a2d[LUT_B].ff5_srinit == FF_SRINIT1)
+				if (dev_ml->u->logic.a2d[LUT_B].ff5_srinit == FF_SRINIT1)
 					mi20 |= 1ULL << XC6_ML_B5_FFSRINIT_1;
-				if (dev_ml->u.logic.a2d[LUT_C].ff5_srinit == FF_SRINIT1)
+				if (dev_ml->u->logic.a2d[LUT_C].ff5_srinit == FF_SRINIT1)
 					mi20 |= 1ULL << XC6_ML_C5_FFSRINIT_1;
-				if (dev_ml->u.logic.a2d[LUT_D].ff5_srinit == FF_SRINIT1)
+				if (dev_ml->u->logic.a2d[LUT_D].ff5_srinit == FF_SRINIT1)
 					mi20 |= 1ULL << XC6_ML_D5_FFSRINIT_1;
 
 				if (xm_col // M-device only
-				    && dev_ml->u.logic.a2d[LUT_A].ff_srinit == FF_SRINIT1)
+				    && dev_ml->u->logic.a2d[LUT_A].ff_srinit == FF_SRINIT1)
 					mi20 |= 1ULL << XC6_M_A_FFSRINIT_1;
 			}
 
@@ -3234,58 +3250,58 @@ static int write_logic(struct fpga_bits* bits, struct fpga_model* model)
 
 			// X device
 			if (dev_x->instantiated) {
-				if (dev_x->u.logic.a2d[LUT_D].out_mux != MUX_5Q)
+				if (dev_x->u->logic.a2d[LUT_D].out_mux != MUX_5Q)
 					mi2526 |= 1ULL << XC6_X_D_OUTMUX_O5; // default-set
-				if (dev_x->u.logic.a2d[LUT_C].out_mux != MUX_5Q)
+				if (dev_x->u->logic.a2d[LUT_C].out_mux != MUX_5Q)
 					mi2526 |= 1ULL << XC6_X_C_OUTMUX_O5; // default-set
-				if (dev_x->u.logic.a2d[LUT_D].ff_srinit == FF_SRINIT1)
+				if (dev_x->u->logic.a2d[LUT_D].ff_srinit == FF_SRINIT1)
 					mi2526 |= 1ULL << XC6_X_D_FFSRINIT_1;
-				if (dev_x->u.logic.a2d[LUT_B].out_mux != MUX_5Q)
+				if (dev_x->u->logic.a2d[LUT_B].out_mux != MUX_5Q)
 					mi2526 |= 1ULL << XC6_X_B_OUTMUX_O5; // default-set
-				if (dev_x->u.logic.clk_inv == CLKINV_B)
+				if (dev_x->u->logic.clk_inv == CLKINV_B)
 					mi2526 |= 1ULL << XC6_X_CLK_B;
-				if (dev_x->u.logic.a2d[LUT_D].ff_mux != MUX_O6)
+				if (dev_x->u->logic.a2d[LUT_D].ff_mux != MUX_O6)
 					mi2526 |= 1ULL << XC6_X_D_FFMUX_X; // default-set
-				if (dev_x->u.logic.a2d[LUT_C].ff_mux != MUX_O6)
+				if (dev_x->u->logic.a2d[LUT_C].ff_mux != MUX_O6)
 					mi2526 |= 1ULL << XC6_X_C_FFMUX_X; // default-set
-				if (dev_x->u.logic.ce_used)
+				if (dev_x->u->logic.ce_used)
 					mi2526 |= 1ULL << XC6_X_CE_USED;
-				if (dev_x->u.logic.a2d[LUT_B].ff_mux != MUX_O6)
+				if (dev_x->u->logic.a2d[LUT_B].ff_mux != MUX_O6)
 					mi2526 |= 1ULL << XC6_X_B_FFMUX_X; // default-set
-				if (dev_x->u.logic.a2d[LUT_A].ff_mux != MUX_O6)
+				if (dev_x->u->logic.a2d[LUT_A].ff_mux != MUX_O6)
 					mi2526 |= 1ULL << XC6_X_A_FFMUX_X; // default-set
-				if (dev_x->u.logic.a2d[LUT_B].ff_srinit == FF_SRINIT1)
+				if (dev_x->u->logic.a2d[LUT_B].ff_srinit == FF_SRINIT1)
 					mi2526 |= 1ULL << XC6_X_B_FFSRINIT_1;
-				if (dev_x->u.logic.a2d[LUT_A].out_mux != MUX_5Q)
+				if (dev_x->u->logic.a2d[LUT_A].out_mux != MUX_5Q)
 					mi2526 |= 1ULL << XC6_X_A_OUTMUX_O5; // default-set
-				if (dev_x->u.logic.sr_used)
+				if (dev_x->u->logic.sr_used)
 					mi2526 |= 1ULL << XC6_X_SR_USED;
-				if (dev_x->u.logic.sync_attr == SYNCATTR_SYNC)
+				if (dev_x->u->logic.sync_attr == SYNCATTR_SYNC)
 					mi2526 |= 1ULL << XC6_X_SYNC;
 				if (is_latch(dev_x))
 					mi2526 |= 1ULL << XC6_X_ALL_LATCH;
-				if (dev_x->u.logic.a2d[LUT_A].ff_srinit == FF_SRINIT1)
+				if (dev_x->u->logic.a2d[LUT_A].ff_srinit == FF_SRINIT1)
 					mi2526 |= 1ULL << XC6_X_A_FFSRINIT_1;
 			}
 
 			// M or L device
 			if (dev_ml->instantiated) {
-				if (dev_ml->u.logic.a2d[LUT_D].cy0 == CY0_O5)
+				if (dev_ml->u->logic.a2d[LUT_D].cy0 == CY0_O5)
 					mi2526 |= 1ULL << XC6_ML_D_CY0_O5;
-				if (dev_ml->u.logic.a2d[LUT_D].ff_srinit == FF_SRINIT1)
+				if (dev_ml->u->logic.a2d[LUT_D].ff_srinit == FF_SRINIT1)
 					mi2526 |= 1ULL << XC6_ML_D_FFSRINIT_1;
-				if (dev_ml->u.logic.a2d[LUT_C].ff_srinit == FF_SRINIT1)
+				if (dev_ml->u->logic.a2d[LUT_C].ff_srinit == FF_SRINIT1)
 					mi2526 |= 1ULL << XC6_ML_C_FFSRINIT_1;
-				if (dev_ml->u.logic.a2d[LUT_C].cy0 == CY0_O5)
+				if (dev_ml->u->logic.a2d[LUT_C].cy0 == CY0_O5)
 					mi2526 |= 1ULL << XC6_ML_C_CY0_O5;
-				switch (dev_ml->u.logic.a2d[LUT_D].out_mux) {
+				switch (dev_ml->u->logic.a2d[LUT_D].out_mux) {
 					case MUX_O6: mi2526 |= XC6_ML_D_OUTMUX_O6 << XC6_ML_D_OUTMUX_O; break;
 					case MUX_XOR: mi2526 |= XC6_ML_D_OUTMUX_XOR << XC6_ML_D_OUTMUX_O; break;
 					case MUX_O5: mi2526 |= XC6_ML_D_OUTMUX_O5 << XC6_ML_D_OUTMUX_O; break;
 					case MUX_CY: mi2526 |= XC6_ML_D_OUTMUX_CY << XC6_ML_D_OUTMUX_O; break;
 					case MUX_5Q: mi2526 |= XC6_ML_D_OUTMUX_5Q << XC6_ML_D_OUTMUX_O; break;
 				}
-				switch (dev_ml->u.logic.a2d[LUT_D].ff_mux) {
+				switch (dev_ml->u->logic.a2d[LUT_D].ff_mux) {
 					// XC6_ML_D_FFMUX_O6 is 0
 					case MUX_O5: mi2526 |= XC6_ML_D_FFMUX_O5 << XC6_ML_D_FFMUX_O; break;
 					case MUX_X: mi2526 |= XC6_ML_D_FFMUX_X << XC6_ML_D_FFMUX_O; break;
@@ -3294,13 +3310,13 @@ static int write_logic(struct fpga_bits* bits, struct fpga_model* model)
 				}
 				if (is_latch(dev_ml))
 					mi2526 |= 1ULL << XC6_ML_ALL_LATCH;
-				if (dev_ml->u.logic.sr_used)
+				if (dev_ml->u->logic.sr_used)
 					mi2526 |= 1ULL << XC6_ML_SR_USED;
-				if (dev_ml->u.logic.sync_attr == SYNCATTR_SYNC)
+				if (dev_ml->u->logic.sync_attr == SYNCATTR_SYNC)
 					mi2526 |= 1ULL << XC6_ML_SYNC;
-				if (dev_ml->u.logic.ce_used)
+				if (dev_ml->u->logic.ce_used)
 					mi2526 |= 1ULL << XC6_ML_CE_USED;
-				switch (dev_ml->u.logic.a2d[LUT_C].out_mux) {
+				switch (dev_ml->u->logic.a2d[LUT_C].out_mux) {
 					case MUX_XOR: mi2526 |= XC6_ML_C_OUTMUX_XOR << XC6_ML_C_OUTMUX_O; break;
 					case MUX_O6: mi2526 |= XC6_ML_C_OUTMUX_O6 << XC6_ML_C_OUTMUX_O; break;
 					case MUX_5Q: mi2526 |= XC6_ML_C_OUTMUX_5Q << XC6_ML_C_OUTMUX_O; break;
@@ -3308,7 +3324,7 @@ static int write_logic(struct fpga_bits* bits, struct fpga_model* model)
 					case MUX_O5: mi2526 |= XC6_ML_C_OUTMUX_O5 << XC6_ML_C_OUTMUX_O; break;
 					case MUX_F7: mi2526 |= XC6_ML_C_OUTMUX_F7 << XC6_ML_C_OUTMUX_O; break;
 				}
-				switch (dev_ml->u.logic.a2d[LUT_C].ff_mux) {
+				switch (dev_ml->u->logic.a2d[LUT_C].ff_mux) {
 					// XC6_ML_C_FFMUX_O6 is 0
 					case MUX_O5: mi2526 |= XC6_ML_C_FFMUX_O5 << XC6_ML_C_FFMUX_O; break;
 					case MUX_X: mi2526 |= XC6_ML_C_FFMUX_X << XC6_ML_C_FFMUX_O; break;
@@ -3316,7 +3332,7 @@ static int write_logic(struct fpga_bits* bits, struct fpga_model* model)
 					case MUX_XOR: mi2526 |= XC6_ML_C_FFMUX_XOR << XC6_ML_C_FFMUX_O; break;
 					case MUX_CY: mi2526 |= XC6_ML_C_FFMUX_CY << XC6_ML_C_FFMUX_O; break;
 				}
-				switch (dev_ml->u.logic.a2d[LUT_B].out_mux) {
+				switch (dev_ml->u->logic.a2d[LUT_B].out_mux) {
 					case MUX_5Q: mi2526 |= XC6_ML_B_OUTMUX_5Q << XC6_ML_B_OUTMUX_O; break;
 					case MUX_F8: mi2526 |= XC6_ML_B_OUTMUX_F8 << XC6_ML_B_OUTMUX_O; break;
 					case MUX_XOR: mi2526 |= XC6_ML_B_OUTMUX_XOR << XC6_ML_B_OUTMUX_O; break;
@@ -3324,9 +3340,9 @@ static int write_logic(struct fpga_bits* bits, struct fpga_model* model)
 					case MUX_O6: mi2526 |= XC6_ML_B_OUTMUX_O6 << XC6_ML_B_OUTMUX_O; break;
 					case MUX_O5: mi2526 |= XC6_ML_B_OUTMUX_O5 << XC6_ML_B_OUTMUX_O; break;
 				}
-				if (dev_ml->u.logic.clk_inv == CLKINV_B)
+				if (dev_ml->u->logic.clk_inv == CLKINV_B)
 					mi2526 |= 1ULL << XC6_ML_CLK_B;
-				switch (dev_ml->u.logic.a2d[LUT_B].ff_mux) {
+				switch (dev_ml->u->logic.a2d[LUT_B].ff_mux) {
 					// XC6_ML_B_FFMUX_O6 is 0
 					case MUX_XOR: mi2526 |= XC6_ML_B_FFMUX_XOR << XC6_ML_B_FFMUX_O; break;
 					case MUX_O5: mi2526 |= XC6_ML_B_FFMUX_O5 << XC6_ML_B_FFMUX_O; break;
@@ -3334,7 +3350,7 @@ static int write_logic(struct fpga_bits* bits, struct fpga_model* model)
 					case MUX_X: mi2526 |= XC6_ML_B_FFMUX_X << XC6_ML_B_FFMUX_O; break;
 					case MUX_F8: mi2526 |= XC6_ML_B_FFMUX_F8 << XC6_ML_B_FFMUX_O; break;
 				}
-				switch (dev_ml->u.logic.a2d[LUT_A].ff_mux) {
+				switch (dev_ml->u->logic.a2d[LUT_A].ff_mux) {
 					// XC6_ML_A_FFMUX_O6 is 0
 					case MUX_XOR: mi2526 |= XC6_ML_A_FFMUX_XOR << XC6_ML_A_FFMUX_O; break;
 					case MUX_X: mi2526 |= XC6_ML_A_FFMUX_X << XC6_ML_A_FFMUX_O; break;
@@ -3342,7 +3358,7 @@ static int write_logic(struct fpga_bits* bits, struct fpga_model* model)
 					case MUX_CY: mi2526 |= XC6_ML_A_FFMUX_CY << XC6_ML_A_FFMUX_O; break;
 					case MUX_F7: mi2526 |= XC6_ML_A_FFMUX_F7 << XC6_ML_A_FFMUX_O; break;
 				}
-				switch (dev_ml->u.logic.a2d[LUT_A].out_mux) {
+				switch (dev_ml->u->logic.a2d[LUT_A].out_mux) {
 					case MUX_5Q: mi2526 |= XC6_ML_A_OUTMUX_5Q << XC6_ML_A_OUTMUX_O; break;
 					case MUX_F7: mi2526 |= XC6_ML_A_OUTMUX_F7 << XC6_ML_A_OUTMUX_O; break;
 					case MUX_XOR: mi2526 |= XC6_ML_A_OUTMUX_XOR << XC6_ML_A_OUTMUX_O; break;
@@ -3350,17 +3366,17 @@ static int write_logic(struct fpga_bits* bits, struct fpga_model* model)
 					case MUX_O6: mi2526 |= XC6_ML_A_OUTMUX_O6 << XC6_ML_A_OUTMUX_O; break;
 					case MUX_O5: mi2526 |= XC6_ML_A_OUTMUX_O5 << XC6_ML_A_OUTMUX_O; break;
 				}
-				if (dev_ml->u.logic.a2d[LUT_B].cy0 == CY0_O5)
+				if (dev_ml->u->logic.a2d[LUT_B].cy0 == CY0_O5)
 					mi2526 |= 1ULL << XC6_ML_B_CY0_O5;
-				if (dev_ml->u.logic.precyinit == PRECYINIT_AX)
+				if (dev_ml->u->logic.precyinit == PRECYINIT_AX)
 					mi2526 |= 1ULL << XC6_ML_PRECYINIT_AX;
-				else if (dev_ml->u.logic.precyinit == PRECYINIT_1)
+				else if (dev_ml->u->logic.precyinit == PRECYINIT_1)
 					mi2526 |= 1ULL << XC6_ML_PRECYINIT_1;
-				if (dev_ml->u.logic.a2d[LUT_B].ff_srinit == FF_SRINIT1)
+				if (dev_ml->u->logic.a2d[LUT_B].ff_srinit == FF_SRINIT1)
 					mi2526 |= 1ULL << XC6_ML_B_FFSRINIT_1;
-				if (dev_ml->u.logic.a2d[LUT_A].cy0 == CY0_O5)
+				if (dev_ml->u->logic.a2d[LUT_A].cy0 == CY0_O5)
 					mi2526 |= 1ULL << XC6_ML_A_CY0_O5;
-				if (!xm_col && dev_ml->u.logic.a2d[LUT_A].ff_srinit == FF_SRINIT1)
+				if (!xm_col && dev_ml->u->logic.a2d[LUT_A].ff_srinit == FF_SRINIT1)
 					mi2526 |= 1ULL << XC6_L_A_FFSRINIT_1;
 			}
 
@@ -3423,9 +3439,12 @@ static int write_logic(struct fpga_bits* bits, struct fpga_model* model)
 
 int write_model(struct fpga_bits *bits, struct fpga_model *model)
 {
+	long bit_gets, bit_sets;
 	int i;
 
 	RC_CHECK(model);
+	bit_gets = s_bit_gets;
+	bit_sets = s_bit_sets;
 
 	for (i = 0; i < sizeof(s_default_bits)/sizeof(s_default_bits[0]); i++)
 		set_bitp(bits, &s_default_bits[i]);
@@ -3435,5 +3454,7 @@ int write_model(struct fpga_bits *bits, struct fpga_model *model)
 	write_bscan(bits, model);
 	write_bram(bits, model);
 
+	model->stats.bit_gets += s_bit_gets - bit_gets;
+	model->stats.bit_sets += s_bit_sets - bit_sets;
 	RC_RETURN(model);
 }
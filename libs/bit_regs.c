@@ -76,17 +76,17 @@ fail:
 	return rc;
 }
 
-static void dump_header(struct fpga_config* cfg)
+static void dump_header(FILE* f, struct fpga_config* cfg)
 {
 	int i;
 	for (i = 0; i < sizeof(cfg->header_str)
 			/sizeof(cfg->header_str[0]); i++) {
-		printf("header_str_%c %s\n", 'a'+i,
+		fprintf(f, "header_str_%c %s\n", 'a'+i,
 			cfg->header_str[i]);
 	}
 }
 
-static int dump_regs(struct fpga_config* cfg, int start, int end, int dump_crc)
+static int dump_regs(FILE* f, struct fpga_config* cfg, int start, int end, int dump_crc)
 {
 	uint16_t u16;
 	int i, rc;
@@ -98,28 +98,28 @@ static int dump_regs(struct fpga_config* cfg, int start, int end, int dump_crc)
 					== REG_NOOP)
 				times++;
 			if (times > 1)
-				printf("noop times %i\n", times);
+				fprintf(f, "noop times %i\n", times);
 			else
-				printf("noop\n");
+				fprintf(f, "noop\n");
 			i += times-1;
 			continue;
 		}
 		if (cfg->reg[i].reg == IDCODE) {
 			switch (cfg->reg[i].int_v & IDCODE_MASK) {
-				case XC6SLX4:    printf("T1 IDCODE XC6SLX4\n"); break;
-				case XC6SLX9:    printf("T1 IDCODE XC6SLX9\n"); break;
-				case XC6SLX16:   printf("T1 IDCODE XC6SLX16\n"); break;
-				case XC6SLX25:   printf("T1 IDCODE XC6SLX25\n"); break;
-				case XC6SLX25T:  printf("T1 IDCODE XC6SLX25T\n"); break;
-				case XC6SLX45:   printf("T1 IDCODE XC6SLX45\n"); break;
-				case XC6SLX45T:  printf("T1 IDCODE XC6SLX45T\n"); break;
-				case XC6SLX75:   printf("T1 IDCODE XC6SLX75\n"); break;
-				case XC6SLX75T:  printf("T1 IDCODE XC6SLX75T\n"); break;
-				case XC6SLX100:  printf("T1 IDCODE XC6SLX100\n"); break;
-				case XC6SLX100T: printf("T1 IDCODE XC6SLX100T\n"); break;
-				case XC6SLX150:  printf("T1 IDCODE XC6SLX150\n"); break;
+				case XC6SLX4:    fprintf(f, "T1 IDCODE XC6SLX4\n"); break;
+				case XC6SLX9:    fprintf(f, "T1 IDCODE XC6SLX9\n"); break;
+				case XC6SLX16:   fprintf(f, "T1 IDCODE XC6SLX16\n"); break;
+				case XC6SLX25:   fprintf(f, "T1 IDCODE XC6SLX25\n"); break;
+				case XC6SLX25T:  fprintf(f, "T1 IDCODE XC6SLX25T\n"); break;
+				case XC6SLX45:   fprintf(f, "T1 IDCODE XC6SLX45\n"); break;
+				case XC6SLX45T:  fprintf(f, "T1 IDCODE XC6SLX45T\n"); break;
+				case XC6SLX75:   fprintf(f, "T1 IDCODE XC6SLX75\n"); break;
+				case XC6SLX75T:  fprintf(f, "T1 IDCODE XC6SLX75T\n"); break;
+				case XC6SLX100:  fprintf(f, "T1 IDCODE XC6SLX100\n"); break;
+				case XC6SLX100T: fprintf(f, "T1 IDCODE XC6SLX100T\n"); break;
+				case XC6SLX150:  fprintf(f, "T1 IDCODE XC6SLX150\n"); break;
 				default:
-					printf("#W Unknown IDCODE 0x%X.\n", cfg->reg[i].int_v);
+					fprintf(f, "#W Unknown IDCODE 0x%X.\n", cfg->reg[i].int_v);
 					break;
 			}
 			continue;
@@ -142,65 +142,65 @@ static int dump_regs(struct fpga_config* cfg, int start, int end, int dump_crc)
 			};
 			if (cfg->reg[i].int_v >= sizeof(cmds)/sizeof(cmds[0])
 			    || cmds[cfg->reg[i].int_v] == 0)
-				printf("#W Unknown CMD 0x%X.\n", cfg->reg[i].int_v);
+				fprintf(f, "#W Unknown CMD 0x%X.\n", cfg->reg[i].int_v);
 			else
-				printf("T1 CMD %s\n", cmds[cfg->reg[i].int_v]);
+				fprintf(f, "T1 CMD %s\n", cmds[cfg->reg[i].int_v]);
 			continue;
 		}
 		if (cfg->reg[i].reg == FDRI) {
-			printf("T2 FDRI %i\n", cfg->reg[i].int_v);
+			fprintf(f, "T2 FDRI %i\n", cfg->reg[i].int_v);
 			continue;
 		}
 		if (cfg->reg[i].reg == FLR) {
-			printf("T1 FLR %i\n", cfg->reg[i].int_v);
+			fprintf(f, "T1 FLR %i\n", cfg->reg[i].int_v);
 			continue;
 		}
 		if (cfg->reg[i].reg == CRC) {
 			if (dump_crc)
-				printf("T1 CRC 0x%X\n", cfg->reg[i].int_v);
+				fprintf(f, "T1 CRC 0x%X\n", cfg->reg[i].int_v);
 			else
-				printf("T1 CRC\n");
+				fprintf(f, "T1 CRC\n");
 			continue;
 		}
 		if (cfg->reg[i].reg == COR1) {
 			int unexpected_clk11 = 0;
 
 			u16 = cfg->reg[i].int_v;
-			printf("T1 COR1");
+			fprintf(f, "T1 COR1");
 			if (u16 & 0x8000) {
-				printf(" DRIVE_AWAKE");
+				fprintf(f, " DRIVE_AWAKE");
 				u16 &= ~0x8000;
 			}
 			if (u16 & 0x0010) {
-				printf(" CRC_BYPASS");
+				fprintf(f, " CRC_BYPASS");
 				u16 &= ~0x0010;
 			}
 			if (u16 & 0x0008) {
-				printf(" DONE_PIPE");
+				fprintf(f, " DONE_PIPE");
 				u16 &= ~0x0008;
 			}
 			if (u16 & 0x0004) {
-				printf(" DRIVE_DONE");
+				fprintf(f, " DRIVE_DONE");
 				u16 &= ~0x0004;
 			}
 			if (u16 & 0x0003) {
 				if (u16 & 0x0002) {
 					if (u16 & 0x0001)
 						unexpected_clk11 = 1;
-					printf(" SSCLKSRC=TCK");
+					fprintf(f, " SSCLKSRC=TCK");
 				} else
-					printf(" SSCLKSRC=UserClk");
+					fprintf(f, " SSCLKSRC=UserClk");
 				u16 &= ~0x0003;
 			}
 			if (u16)
-				printf(" 0x%x", u16);
-			printf("\n");
+				fprintf(f, " 0x%x", u16);
+			fprintf(f, "\n");
 			if (unexpected_clk11)
-				printf("#W Unexpected SSCLKSRC 11.\n");
+				fprintf(f, "#W Unexpected SSCLKSRC 11.\n");
 			// Reserved bits 14:5 should be 0110111000
 			// according to documentation.
 			if (u16 != 0x3700)
-				printf("#W Expected reserved 0x%x, got 0x%x.\n", 0x3700, u16);
+				fprintf(f, "#W Expected reserved 0x%x, got 0x%x.\n", 0x3700, u16);
 
 			continue;
 		}
@@ -210,48 +210,48 @@ static int dump_regs(struct fpga_config* cfg, int start, int end, int dump_crc)
 			unsigned cycle;
 
 			u16 = cfg->reg[i].int_v;
-			printf("T1 COR2");
+			fprintf(f, "T1 COR2");
 			if (u16 & 0x8000) {
-				printf(" RESET_ON_ERROR");
+				fprintf(f, " RESET_ON_ERROR");
 				u16 &= ~0x8000;
 			}
 
 			// DONE_CYCLE
 			cycle = (u16 & 0x0E00) >> 9;
-			printf(" DONE_CYCLE=%s", bitstr(cycle, 3));
+			fprintf(f, " DONE_CYCLE=%s", bitstr(cycle, 3));
 			if (!cycle || cycle == 7)
 				unexpected_done_cycle = 1;
 			u16 &= ~0x0E00;
 
 			// LCK_CYCLE
 			cycle = (u16 & 0x01C0) >> 6;
-			printf(" LCK_CYCLE=%s", bitstr(cycle, 3));
+			fprintf(f, " LCK_CYCLE=%s", bitstr(cycle, 3));
 			if (!cycle)
 				unexpected_lck_cycle = 1;
 			u16 &= ~0x01C0;
 
 			// GTS_CYCLE
 			cycle = (u16 & 0x0038) >> 3;
-			printf(" GTS_CYCLE=%s", bitstr(cycle, 3));
+			fprintf(f, " GTS_CYCLE=%s", bitstr(cycle, 3));
 			u16 &= ~0x0038;
 
 			// GWE_CYCLE
 			cycle = u16 & 0x0007;
-			printf(" GWE_CYCLE=%s", bitstr(cycle, 3));
+			fprintf(f, " GWE_CYCLE=%s", bitstr(cycle, 3));
 			u16 &= ~0x0007;
 
 			if (u16)
-				printf(" 0x%x", u16);
-			printf("\n");
+				fprintf(f, " 0x%x", u16);
+			fprintf(f, "\n");
 			if (unexpected_done_cycle)
-				printf("#W Unexpected DONE_CYCLE %s.\n",
+				fprintf(f, "#W Unexpected DONE_CYCLE %s.\n",
 					bitstr((u16 & 0x01C0) >> 6, 3));
 			if (unexpected_lck_cycle)
-				printf("#W Unexpected LCK_CYCLE 0b000.\n");
+				fprintf(f, "#W Unexpected LCK_CYCLE 0b000.\n");
 			// Reserved bits 14:12 should be 000
 			// according to documentation.
 			if (u16)
-				printf("#W Expected reserved 0, got 0x%x.\n", u16);
+				fprintf(f, "#W Expected reserved 0, got 0x%x.\n", u16);
 			continue;
 		}
 		if (cfg->reg[i].reg == FAR_MAJ) {
@@ -260,170 +260,170 @@ static int dump_regs(struct fpga_config* cfg, int start, int end, int dump_crc)
 
 			maj = cfg->reg[i].far[FAR_MAJ_O];
 			min = cfg->reg[i].far[FAR_MIN_O];
-			printf("T1 FAR_MAJ");
+			fprintf(f, "T1 FAR_MAJ");
 
 			// BLK
 			u16 = (maj & 0xF000) >> 12;
-			printf(" BLK=%u", u16);
+			fprintf(f, " BLK=%u", u16);
 			if (u16 > 7)
 				unexpected_blk_bit4 = 1;
 			// ROW
 			u16 = (maj & 0x0F00) >> 8;
-			printf(" ROW=%u", u16);
+			fprintf(f, " ROW=%u", u16);
 			// MAJOR
 			u16 = maj & 0x00FF;
-			printf(" MAJOR=%u", u16);
+			fprintf(f, " MAJOR=%u", u16);
 			// Block RAM
 			u16 = (min & 0xC000) >> 14;
-			printf(" BRAM=%u", u16);
+			fprintf(f, " BRAM=%u", u16);
 			// MINOR
 			u16 = min & 0x03FF;
-			printf(" MINOR=%u", u16);
+			fprintf(f, " MINOR=%u", u16);
 
 			if (min & 0x3C00)
-				printf(" 0x%x", min & 0x3C00);
-			printf("\n");
+				fprintf(f, " 0x%x", min & 0x3C00);
+			fprintf(f, "\n");
 
 			if (unexpected_blk_bit4)
-				printf("#W Unexpected BLK bit 4 set.\n");
+				fprintf(f, "#W Unexpected BLK bit 4 set.\n");
 			// Reserved min bits 13:10 should be 000.
 			if (min & 0x3C00)
-				printf("#W Expected reserved 0, got 0x%x.\n", (min & 0x3C00) > 10);
+				fprintf(f, "#W Expected reserved 0, got 0x%x.\n", (min & 0x3C00) > 10);
 			continue;
 		}
 		if (cfg->reg[i].reg == MFWR) {
-			printf("T1 MFWR\n");
+			fprintf(f, "T1 MFWR\n");
 			continue;
 		}
 		if (cfg->reg[i].reg == CTL) {
 			u16 = cfg->reg[i].int_v;
-			printf("T1 CTL");
+			fprintf(f, "T1 CTL");
 			if (u16 & 0x0040) {
-				printf(" DECRYPT");
+				fprintf(f, " DECRYPT");
 				u16 &= ~0x0040;
 			}
 			if (u16 & 0x0020) {
 				if (u16 & 0x0010)
-					printf(" SBITS=NO_RW");
+					fprintf(f, " SBITS=NO_RW");
 				else
-					printf(" SBITS=NO_READ");
+					fprintf(f, " SBITS=NO_READ");
 				u16 &= ~0x0030;
 			} else if (u16 & 0x0010) {
-				printf(" SBITS=ICAP_READ");
+				fprintf(f, " SBITS=ICAP_READ");
 				u16 &= ~0x0010;
 			}
 			if (u16 & 0x0008) {
-				printf(" PERSIST");
+				fprintf(f, " PERSIST");
 				u16 &= ~0x0008;
 			}
 			if (u16 & 0x0004) {
-				printf(" USE_EFUSE_KEY");
+				fprintf(f, " USE_EFUSE_KEY");
 				u16 &= ~0x0004;
 			}
 			if (u16 & 0x0002) {
-				printf(" CRC_EXTSTAT_DISABLE");
+				fprintf(f, " CRC_EXTSTAT_DISABLE");
 				u16 &= ~0x0002;
 			}
 			if (u16)
-				printf(" 0x%x", u16);
-			printf("\n");
+				fprintf(f, " 0x%x", u16);
+			fprintf(f, "\n");
 			// bit0 is reserved as 1, and we have seen
 			// bit7 on as well.
 			if (u16 != 0x81)
-				printf("#W Expected reserved 0x%x, got 0x%x.\n", 0x0081, u16);
+				fprintf(f, "#W Expected reserved 0x%x, got 0x%x.\n", 0x0081, u16);
 			continue;
 		}
 		if (cfg->reg[i].reg == MASK) {
 			u16 = cfg->reg[i].int_v;
-			printf("T1 MASK");
+			fprintf(f, "T1 MASK");
 			if (u16 & 0x0040) {
-				printf(" DECRYPT");
+				fprintf(f, " DECRYPT");
 				u16 &= ~0x0040;
 			}
 			if ((u16 & MASK_SECURITY) == MASK_SECURITY) {
-				printf(" SECURITY");
+				fprintf(f, " SECURITY");
 				u16 &= ~MASK_SECURITY;
 			}
 			if (u16 & 0x0008) {
-				printf(" PERSIST");
+				fprintf(f, " PERSIST");
 				u16 &= ~0x0008;
 			}
 			if (u16 & 0x0004) {
-				printf(" USE_EFUSE_KEY");
+				fprintf(f, " USE_EFUSE_KEY");
 				u16 &= ~0x0004;
 			}
 			if (u16 & 0x0002) {
-				printf(" CRC_EXTSTAT_DISABLE");
+				fprintf(f, " CRC_EXTSTAT_DISABLE");
 				u16 &= ~0x0002;
 			}
 			if (u16)
-				printf(" 0x%x", u16);
-			printf("\n");
+				fprintf(f, " 0x%x", u16);
+			fprintf(f, "\n");
 			// It seems bit7 and bit0 are always masked in.
 			if (u16 != 0x81)
-				printf("#W Expected reserved 0x%x, got 0x%x.\n", 0x0081, u16);
+				fprintf(f, "#W Expected reserved 0x%x, got 0x%x.\n", 0x0081, u16);
 			continue;
 		}
 		if (cfg->reg[i].reg == PWRDN_REG) {
 			u16 = cfg->reg[i].int_v;
-			printf("T1 PWRDN_REG");
+			fprintf(f, "T1 PWRDN_REG");
 			if (u16 & 0x4000) {
-				printf(" EN_EYES");
+				fprintf(f, " EN_EYES");
 				u16 &= ~0x4000;
 			}
 			if (u16 & 0x0020) {
-				printf(" FILTER_B");
+				fprintf(f, " FILTER_B");
 				u16 &= ~0x0020;
 			}
 			if (u16 & 0x0010) {
-				printf(" EN_PGSR");
+				fprintf(f, " EN_PGSR");
 				u16 &= ~0x0010;
 			}
 			if (u16 & 0x0004) {
-				printf(" EN_PWRDN");
+				fprintf(f, " EN_PWRDN");
 				u16 &= ~0x0004;
 			}
 			if (u16 & 0x0001) {
-				printf(" KEEP_SCLK");
+				fprintf(f, " KEEP_SCLK");
 				u16 &= ~0x0001;
 			}
 			if (u16)
-				printf(" 0x%x", u16);
-			printf("\n");
+				fprintf(f, " 0x%x", u16);
+			fprintf(f, "\n");
 			// Reserved bits 13:6 should be 00100010
 			// according to documentation.
 			if (u16 != 0x0880)
-				printf("#W Expected reserved 0x%x, got 0x%x.\n", 0x0880, u16);
+				fprintf(f, "#W Expected reserved 0x%x, got 0x%x.\n", 0x0880, u16);
 			continue;
 		}
 		if (cfg->reg[i].reg == HC_OPT_REG) {
 			u16 = cfg->reg[i].int_v;
-			printf("T1 HC_OPT_REG");
+			fprintf(f, "T1 HC_OPT_REG");
 			if (u16 & 0x0040) {
-				printf(" INIT_SKIP");
+				fprintf(f, " INIT_SKIP");
 				u16 &= ~0x0040;
 			}
 			if (u16)
-				printf(" 0x%x", u16);
-			printf("\n");
+				fprintf(f, " 0x%x", u16);
+			fprintf(f, "\n");
 			// Reserved bits 5:0 should be 011111
 			// according to documentation.
 			if (u16 != 0x001F)
-				printf("#W Expected reserved 0x%x, got 0x%x.\n", 0x001F, u16);
+				fprintf(f, "#W Expected reserved 0x%x, got 0x%x.\n", 0x001F, u16);
 			continue;
 		}
 		if (cfg->reg[i].reg == PU_GWE) {
-			printf("T1 PU_GWE 0x%03X\n", cfg->reg[i].int_v);
+			fprintf(f, "T1 PU_GWE 0x%03X\n", cfg->reg[i].int_v);
 			continue;
 		}
 		if (cfg->reg[i].reg == PU_GTS) {
-			printf("T1 PU_GTS 0x%03X\n", cfg->reg[i].int_v);
+			fprintf(f, "T1 PU_GTS 0x%03X\n", cfg->reg[i].int_v);
 			continue;
 		}
 		if (cfg->reg[i].reg == CWDT) {
-			printf("T1 CWDT 0x%X\n", cfg->reg[i].int_v);
+			fprintf(f, "T1 CWDT 0x%X\n", cfg->reg[i].int_v);
 			if (cfg->reg[i].int_v < 0x0201)
-				printf("#W Watchdog timer clock below"
+				fprintf(f, "#W Watchdog timer clock below"
 				  " minimum value of 0x0201.\n");
 			continue;
 		}
@@ -431,83 +431,83 @@ static int dump_regs(struct fpga_config* cfg, int start, int end, int dump_crc)
 			int unexpected_buswidth = 0;
 
 			u16 = cfg->reg[i].int_v;
-			printf("T1 MODE_REG");
+			fprintf(f, "T1 MODE_REG");
 			if (u16 & (1<<13)) {
-				printf(" NEW_MODE=BITSTREAM");
+				fprintf(f, " NEW_MODE=BITSTREAM");
 				u16 &= ~(1<<13);
 			}
 			if ((u16 & (1<<12))
 			   && (u16 & (1<<11)))
 				unexpected_buswidth = 1;
 			else if (u16 & (1<<12)) {
-				printf(" BUSWIDTH=4");
+				fprintf(f, " BUSWIDTH=4");
 				u16 &= ~(1<<12);
 			} else if (u16 & (1<<11)) {
-				printf(" BUSWIDTH=2");
+				fprintf(f, " BUSWIDTH=2");
 				u16 &= ~(1<<11);
 			}
 			// BUSWIDTH=1 is the default and not displayed
 
 			if (u16 & (1<<9)) {
-				printf(" BOOTMODE_1");
+				fprintf(f, " BOOTMODE_1");
 				u16 &= ~(1<<9);
 			}
 			if (u16 & (1<<8)) {
-				printf(" BOOTMODE_0");
+				fprintf(f, " BOOTMODE_0");
 				u16 &= ~(1<<8);
 			}
 
 			if (unexpected_buswidth)
-				printf("#W Unexpected bus width 0b11.\n");
+				fprintf(f, "#W Unexpected bus width 0b11.\n");
 			if (u16)
-				printf(" 0x%x", u16);
-			printf("\n");
+				fprintf(f, " 0x%x", u16);
+			fprintf(f, "\n");
 			if (u16)
-				printf("#W Expected reserved 0, got 0x%x.\n", u16);
+				fprintf(f, "#W Expected reserved 0, got 0x%x.\n", u16);
 			continue;
 		}
 		if (cfg->reg[i].reg == CCLK_FREQ) {
 			u16 = cfg->reg[i].int_v;
-			printf("T1 CCLK_FREQ");
+			fprintf(f, "T1 CCLK_FREQ");
 			if (u16 & (1<<14)) {
-				printf(" EXT_MCLK");
+				fprintf(f, " EXT_MCLK");
 				u16 &= ~(1<<14);
 			}
-			printf(" MCLK_FREQ=0x%03X", u16 & 0x03FF);
+			fprintf(f, " MCLK_FREQ=0x%03X", u16 & 0x03FF);
 			u16 &= ~(0x03FF);
 			if (u16)
-				printf(" 0x%x", u16);
-			printf("\n");
+				fprintf(f, " 0x%x", u16);
+			fprintf(f, "\n");
 			if (u16)
-				printf("#W Expected reserved 0, got 0x%x.\n", u16);
+				fprintf(f, "#W Expected reserved 0, got 0x%x.\n", u16);
 			continue;
 		}
 		if (cfg->reg[i].reg == EYE_MASK) {
-			printf("T1 EYE_MASK 0x%X\n", cfg->reg[i].int_v);
+			fprintf(f, "T1 EYE_MASK 0x%X\n", cfg->reg[i].int_v);
 			continue;
 		}
 		if (cfg->reg[i].reg == GENERAL1) {
-			printf("T1 GENERAL1 0x%X\n", cfg->reg[i].int_v);
+			fprintf(f, "T1 GENERAL1 0x%X\n", cfg->reg[i].int_v);
 			continue;
 		}
 		if (cfg->reg[i].reg == GENERAL2) {
-			printf("T1 GENERAL2 0x%X\n", cfg->reg[i].int_v);
+			fprintf(f, "T1 GENERAL2 0x%X\n", cfg->reg[i].int_v);
 			continue;
 		}
 		if (cfg->reg[i].reg == GENERAL3) {
-			printf("T1 GENERAL3 0x%X\n", cfg->reg[i].int_v);
+			fprintf(f, "T1 GENERAL3 0x%X\n", cfg->reg[i].int_v);
 			continue;
 		}
 		if (cfg->reg[i].reg == GENERAL4) {
-			printf("T1 GENERAL4 0x%X\n", cfg->reg[i].int_v);
+			fprintf(f, "T1 GENERAL4 0x%X\n", cfg->reg[i].int_v);
 			continue;
 		}
 		if (cfg->reg[i].reg == GENERAL5) {
-			printf("T1 GENERAL5 0x%X\n", cfg->reg[i].int_v);
+			fprintf(f, "T1 GENERAL5 0x%X\n", cfg->reg[i].int_v);
 			continue;
 		}
 		if (cfg->reg[i].reg == EXP_SIGN) {
-			printf("T1 EXP_SIGN 0x%X\n", cfg->reg[i].int_v);
+			fprintf(f, "T1 EXP_SIGN 0x%X\n", cfg->reg[i].int_v);
 			continue;
 		}
 		if (cfg->reg[i].reg == SEU_OPT) {
@@ -515,25 +515,25 @@ static int dump_regs(struct fpga_config* cfg, int start, int end, int dump_crc)
 
 			u16 = cfg->reg[i].int_v;
 			seu_freq = (u16 & 0x3FF0) >> 4;
-			printf("T1 SEU_OPT SEU_FREQ=0x%X", seu_freq);
+			fprintf(f, "T1 SEU_OPT SEU_FREQ=0x%X", seu_freq);
 			u16 &= ~(0x3FF0);
 			if (u16 & (1<<3)) {
-				printf(" SEU_RUN_ON_ERR");
+				fprintf(f, " SEU_RUN_ON_ERR");
 				u16 &= ~(1<<3);
 			}
 			if (u16 & (1<<1)) {
-				printf(" GLUT_MASK");
+				fprintf(f, " GLUT_MASK");
 				u16 &= ~(1<<1);
 			}
 			if (u16 & (1<<0)) {
-				printf(" SEU_ENABLE");
+				fprintf(f, " SEU_ENABLE");
 				u16 &= ~(1<<0);
 			}
 			if (u16)
-				printf(" 0x%x", u16);
-			printf("\n");
+				fprintf(f, " 0x%x", u16);
+			fprintf(f, "\n");
 			if (u16)
-				printf("#W Expected reserved 0, got 0x%x.\n", u16);
+				fprintf(f, "#W Expected reserved 0, got 0x%x.\n", u16);
 			continue;
 		}
 		FAIL(EINVAL);
@@ -543,56 +543,56 @@ fail:
 	return rc;
 }
 
-static int dump_maj_zero(const uint8_t* bits, int row, int major)
+static int dump_maj_zero(FILE* f, const uint8_t* bits, int row, int major)
 {
 	int minor;
 
 	for (minor = 0; minor < get_major_minors(XC6SLX9, major); minor++)
-		printf_clock(&bits[minor*FRAME_SIZE], row, major, minor);
+		printf_clock(f, &bits[minor*FRAME_SIZE], row, major, minor);
 	for (minor = 0; minor < get_major_minors(XC6SLX9, major); minor++)
-		printf_frames(&bits[minor*FRAME_SIZE], /*max_frames*/ 1,
+		printf_frames(f, &bits[minor*FRAME_SIZE], /*max_frames*/ 1,
 			row, major, minor, /*print_empty*/ 0, /*no_clock*/ 1);
 	return 0;
 }
 
-static int dump_maj_left(const uint8_t* bits, int row, int major)
+static int dump_maj_left(FILE* f, const uint8_t* bits, int row, int major)
 {
 	int minor;
 
 	for (minor = 0; minor < get_major_minors(XC6SLX9, major); minor++)
-		printf_clock(&bits[minor*FRAME_SIZE], row, major, minor);
+		printf_clock(f, &bits[minor*FRAME_SIZE], row, major, minor);
 	for (minor = 0; minor < get_major_minors(XC6SLX9, major); minor++)
-		printf_frames(&bits[minor*FRAME_SIZE], /*max_frames*/ 1,
+		printf_frames(f, &bits[minor*FRAME_SIZE], /*max_frames*/ 1,
 			row, major, minor, /*print_empty*/ 0, /*no_clock*/ 1);
 	return 0;
 }
 
-static int dump_maj_right(const uint8_t* bits, int row, int major)
+static int dump_maj_right(FILE* f, const uint8_t* bits, int row, int major)
 {
 	int minor;
 
 	for (minor = 0; minor < get_major_minors(XC6SLX9, major); minor++)
-		printf_clock(&bits[minor*FRAME_SIZE], row, major, minor);
+		printf_clock(f, &bits[minor*FRAME_SIZE], row, major, minor);
 	for (minor = 0; minor < get_major_minors(XC6SLX9, major); minor++)
-		printf_frames(&bits[minor*FRAME_SIZE], /*max_frames*/ 1,
+		printf_frames(f, &bits[minor*FRAME_SIZE], /*max_frames*/ 1,
 			row, major, minor, /*print_empty*/ 0, /*no_clock*/ 1);
 	return 0;
 }
 
-static int dump_maj_logic(const uint8_t* bits, int row, int major)
+static int dump_maj_logic(FILE* f, const uint8_t* bits, int row, int major)
 {
 	const struct xc_die* xci = xc_die_info(XC6SLX9);
 	int minor, i, logdev_start, logdev_end;
 
 	for (minor = 0; minor < xci->majors[major].minors; minor++)
-		printf_clock(&bits[minor*FRAME_SIZE], row, major, minor);
+		printf_clock(f, &bits[minor*FRAME_SIZE], row, major, minor);
 
 	// 0:19 routing minor pairs
 	for (i = 0; i < 10; i++)
-		printf_routing_2minors(&bits[i*2*FRAME_SIZE], row, major, i*2);
+		printf_routing_2minors(f, &bits[i*2*FRAME_SIZE], row, major, i*2);
 
 	// mi20 as 64-char 0/1 string
-	printf_v64_mi20(&bits[20*FRAME_SIZE], row, major);
+	printf_v64_mi20(f, &bits[20*FRAME_SIZE], row, major);
 
 	logdev_start = 0;
 	logdev_end = 15;
@@ -608,68 +608,68 @@ static int dump_maj_logic(const uint8_t* bits, int row, int major)
 
 		// M devices
 		if (logdev_start)
-			printf_extrabits(bits, 21, 2, 0, logdev_start*64, row, major);
+			printf_extrabits(f, bits, 21, 2, 0, logdev_start*64, row, major);
 		for (i = logdev_start; i <= logdev_end; i++) {
-			printf_lut_words(bits, row, major, 21, i*4);
-			printf_lut_words(bits, row, major, 21, i*4+2);
+			printf_lut_words(f, bits, row, major, 21, i*4);
+			printf_lut_words(f, bits, row, major, 21, i*4+2);
 		}
 		if (logdev_end < 15)
-			printf_extrabits(bits, 21, 2, i*64 + XC6_HCLK_BITS, (15-logdev_end)*64, row, major);
-		printf_frames(&bits[23*FRAME_SIZE], /*max_frames*/ 1,
+			printf_extrabits(f, bits, 21, 2, i*64 + XC6_HCLK_BITS, (15-logdev_end)*64, row, major);
+		printf_frames(f, &bits[23*FRAME_SIZE], /*max_frames*/ 1,
 			row, major, 23, /*print_empty*/ 0, /*no_clock*/ 1);
 		if (logdev_start)
-			printf_extrabits(bits, 24, 2, 0, logdev_start*64, row, major);
+			printf_extrabits(f, bits, 24, 2, 0, logdev_start*64, row, major);
 		for (i = logdev_start; i <= logdev_end; i++) {
-			printf_lut_words(bits, row, major, 24, i*4);
-			printf_lut_words(bits, row, major, 24, i*4+2);
+			printf_lut_words(f, bits, row, major, 24, i*4);
+			printf_lut_words(f, bits, row, major, 24, i*4+2);
 		}
 		if (logdev_end < 15)
-			printf_extrabits(bits, 24, 2, i*64 + XC6_HCLK_BITS, (15-logdev_end)*64, row, major);
+			printf_extrabits(f, bits, 24, 2, i*64 + XC6_HCLK_BITS, (15-logdev_end)*64, row, major);
 
 		// X devices
-		printf_frames(&bits[26*FRAME_SIZE], /*max_frames*/ 1,
+		printf_frames(f, &bits[26*FRAME_SIZE], /*max_frames*/ 1,
 			row, major, 26, /*print_empty*/ 0, /*no_clock*/ 1);
 		if (logdev_start)
-			printf_extrabits(bits, 27, 4, 0, logdev_start*64, row, major);
+			printf_extrabits(f, bits, 27, 4, 0, logdev_start*64, row, major);
 		for (i = logdev_start; i <= logdev_end; i++) {
-			printf_lut_words(bits, row, major, 27, i*4);
-			printf_lut_words(bits, row, major, 29, i*4);
-			printf_lut_words(bits, row, major, 27, i*4+2);
-			printf_lut_words(bits, row, major, 29, i*4+2);
+			printf_lut_words(f, bits, row, major, 27, i*4);
+			printf_lut_words(f, bits, row, major, 29, i*4);
+			printf_lut_words(f, bits, row, major, 27, i*4+2);
+			printf_lut_words(f, bits, row, major, 29, i*4+2);
 		}
 		if (logdev_end < 15)
-			printf_extrabits(bits, 27, 4, i*64 + XC6_HCLK_BITS, (15-logdev_end)*64, row, major);
+			printf_extrabits(f, bits, 27, 4, i*64 + XC6_HCLK_BITS, (15-logdev_end)*64, row, major);
 	} else if (xci->majors[major].flags & (XC_MAJ_XL|XC_MAJ_CENTER)) {
 
 		// L devices
 		if (logdev_start)
-			printf_extrabits(bits, 21, 4, 0, logdev_start*64, row, major);
+			printf_extrabits(f, bits, 21, 4, 0, logdev_start*64, row, major);
 		for (i = logdev_start; i <= logdev_end; i++) {
-			printf_lut_words(bits, row, major, 21, i*4);
-			printf_lut_words(bits, row, major, 23, i*4);
-			printf_lut_words(bits, row, major, 21, i*4+2);
-			printf_lut_words(bits, row, major, 23, i*4+2);
+			printf_lut_words(f, bits, row, major, 21, i*4);
+			printf_lut_words(f, bits, row, major, 23, i*4);
+			printf_lut_words(f, bits, row, major, 21, i*4+2);
+			printf_lut_words(f, bits, row, major, 23, i*4+2);
 		}
 		if (logdev_end < 15)
-			printf_extrabits(bits, 21, 4, i*64 + XC6_HCLK_BITS, (15-logdev_end)*64, row, major);
-		printf_frames(&bits[25*FRAME_SIZE], /*max_frames*/ 1,
+			printf_extrabits(f, bits, 21, 4, i*64 + XC6_HCLK_BITS, (15-logdev_end)*64, row, major);
+		printf_frames(f, &bits[25*FRAME_SIZE], /*max_frames*/ 1,
 			row, major, 25, /*print_empty*/ 0, /*no_clock*/ 1);
 		// X devices
 		if (logdev_start)
-			printf_extrabits(bits, 26, 4, 0, logdev_start*64, row, major);
+			printf_extrabits(f, bits, 26, 4, 0, logdev_start*64, row, major);
 		for (i = logdev_start; i <= logdev_end; i++) {
-			printf_lut_words(bits, row, major, 26, i*4);
-			printf_lut_words(bits, row, major, 28, i*4);
-			printf_lut_words(bits, row, major, 26, i*4+2);
-			printf_lut_words(bits, row, major, 28, i*4+2);
+			printf_lut_words(f, bits, row, major, 26, i*4);
+			printf_lut_words(f, bits, row, major, 28, i*4);
+			printf_lut_words(f, bits, row, major, 26, i*4+2);
+			printf_lut_words(f, bits, row, major, 28, i*4+2);
 		}
 		if (logdev_end < 15)
-			printf_extrabits(bits, 26, 4, i*64 + XC6_HCLK_BITS, (15-logdev_end)*64, row, major);
+			printf_extrabits(f, bits, 26, 4, i*64 + XC6_HCLK_BITS, (15-logdev_end)*64, row, major);
 
 		// one extra minor in the center major
 		if (xci->majors[major].flags & XC_MAJ_CENTER) {
 			if (xci->majors[major].minors != 31) HERE();
-			printf_frames(&bits[30*FRAME_SIZE], /*max_frames*/ 1,
+			printf_frames(f, &bits[30*FRAME_SIZE], /*max_frames*/ 1,
 				row, major, 30, /*print_empty*/ 0, /*no_clock*/ 1);
 		} else { // XL
 			if (xci->majors[major].minors != 30) HERE();
@@ -680,7 +680,7 @@ static int dump_maj_logic(const uint8_t* bits, int row, int major)
 	return 0;
 }
 
-static void printf_minor_diff(int row, int major, int minor,
+static void printf_minor_diff(FILE* f, int row, int major, int minor,
 	const uint8_t *old_minor_bits, const uint8_t *new_minor_bits)
 {
 	int word_i, w_old, w_new;
@@ -696,12 +696,12 @@ static void printf_minor_diff(int row, int major, int minor,
 		w_old = frame_get_cpuword(&old_minor_bits[word_i*XC6_WORD_BYTES]);
 		w_new = frame_get_cpuword(&new_minor_bits[word_i*XC6_WORD_BYTES]);
 		if (w_old == w_new) continue;
-		printf("#I <r%i ma%i %s mi%i %s", row, major, v16_str, minor, fmt_word(w_old));
-		printf("#I >r%i ma%i %s mi%i %s", row, major, v16_str, minor, fmt_word(w_new));
+		fprintf(f, "#I <r%i ma%i %s mi%i %s", row, major, v16_str, minor, fmt_word(w_old));
+		fprintf(f, "#I >r%i ma%i %s mi%i %s", row, major, v16_str, minor, fmt_word(w_new));
 	}
 }
 
-static void printf_minors(int row, int major, int minor, int num_minors,
+static void printf_minors(FILE* f, int row, int major, int minor, int num_minors,
 	const uint8_t *major_bits)
 {
 	int word_i, minor_i, w;
@@ -718,50 +718,50 @@ static void printf_minors(int row, int major, int minor, int num_minors,
 			w = frame_get_cpuword(&major_bits[minor_i*FRAME_SIZE
 				+ word_i*XC6_WORD_BYTES]);
 			if (!w) continue;
-			printf("r%i ma%i %s mi%i %s", row, major, v16_str, minor_i, fmt_word(w));
+			fprintf(f, "r%i ma%i %s mi%i %s", row, major, v16_str, minor_i, fmt_word(w));
 		}
 	}
 }
 
-static int dump_maj_bram(const uint8_t *bits, int row, int major)
+static int dump_maj_bram(FILE* f, const uint8_t *bits, int row, int major)
 {
 	int minor, i;
 
 	for (minor = 0; minor < get_major_minors(XC6SLX9, major); minor++)
-		printf_clock(&bits[minor*FRAME_SIZE], row, major, minor);
+		printf_clock(f, &bits[minor*FRAME_SIZE], row, major, minor);
 
 	// 0:19 routing minor pairs
 	for (i = 0; i < 10; i++)
-		printf_routing_2minors(&bits[i*2*FRAME_SIZE], row, major, i*2);
+		printf_routing_2minors(f, &bits[i*2*FRAME_SIZE], row, major, i*2);
 
 	// mi20 as 64-char 0/1 string
-	printf_v64_mi20(&bits[20*FRAME_SIZE], row, major);
+	printf_v64_mi20(f, &bits[20*FRAME_SIZE], row, major);
 
-	printf_minors(row, major, /*minor*/ 21, /*num_minors*/ 4, bits);
+	printf_minors(f, row, major, /*minor*/ 21, /*num_minors*/ 4, bits);
 	return 0;
 }
 
-static int dump_maj_macc(const uint8_t* bits, int row, int major)
+static int dump_maj_macc(FILE* f, const uint8_t* bits, int row, int major)
 {
 	int minor, i;
 
 	for (minor = 0; minor < get_major_minors(XC6SLX9, major); minor++)
-		printf_clock(&bits[minor*FRAME_SIZE], row, major, minor);
+		printf_clock(f, &bits[minor*FRAME_SIZE], row, major, minor);
 
 	// 0:19 routing minor pairs
 	for (i = 0; i < 10; i++)
-		printf_routing_2minors(&bits[i*2*FRAME_SIZE], row, major, i*2);
+		printf_routing_2minors(f, &bits[i*2*FRAME_SIZE], row, major, i*2);
 
 	// mi20 as 64-char 0/1 string
-	printf_v64_mi20(&bits[20*FRAME_SIZE], row, major);
+	printf_v64_mi20(f, &bits[20*FRAME_SIZE], row, major);
 
 	for (minor = 21; minor < get_major_minors(XC6SLX9, major); minor++)
-		printf_frames(&bits[minor*FRAME_SIZE], /*max_frames*/ 1,
+		printf_frames(f, &bits[minor*FRAME_SIZE], /*max_frames*/ 1,
 			row, major, minor, /*print_empty*/ 0, /*no_clock*/ 1);
 	return 0;
 }
 
-static int dump_bits(struct fpga_config* cfg)
+static int dump_bits(FILE* f, struct fpga_config* cfg)
 {
 	int idcode, num_rows, row, major, off, rc;
 	const struct xc_die* die_info;
@@ -778,29 +778,29 @@ static int dump_bits(struct fpga_config* cfg)
 			off = (row*get_frames_per_row(idcode) + get_major_framestart(idcode, major)) * FRAME_SIZE;
 			switch (get_major_type(idcode, major)) {
 				case MAJ_ZERO:
-					rc = dump_maj_zero(&cfg->bits.d[off], row, major);
+					rc = dump_maj_zero(f, &cfg->bits.d[off], row, major);
 					if (rc) FAIL(rc);
 					break;
 				case MAJ_LEFT:
-					rc = dump_maj_left(&cfg->bits.d[off], row, major);
+					rc = dump_maj_left(f, &cfg->bits.d[off], row, major);
 					if (rc) FAIL(rc);
 					break;
 				case MAJ_RIGHT:
-					rc = dump_maj_right(&cfg->bits.d[off], row, major);
+					rc = dump_maj_right(f, &cfg->bits.d[off], row, major);
 					if (rc) FAIL(rc);
 					break;
 				case MAJ_LOGIC_XM:
 				case MAJ_LOGIC_XL:
 				case MAJ_CENTER:
-					rc = dump_maj_logic(&cfg->bits.d[off], row, major);
+					rc = dump_maj_logic(f, &cfg->bits.d[off], row, major);
 					if (rc) FAIL(rc);
 					break;
 				case MAJ_BRAM:
-					rc = dump_maj_bram(&cfg->bits.d[off], row, major);
+					rc = dump_maj_bram(f, &cfg->bits.d[off], row, major);
 					if (rc) FAIL(rc);
 					break;
 				case MAJ_MACC:
-					rc = dump_maj_macc(&cfg->bits.d[off], row, major);
+					rc = dump_maj_macc(f, &cfg->bits.d[off], row, major);
 					if (rc) FAIL(rc);
 					break;
 				default: HERE(); break;
@@ -812,13 +812,13 @@ fail:
 	return rc;
 }
 
-static int dump_bram(struct fpga_config *cfg)
+static int dump_bram(FILE* f, struct fpga_config *cfg)
 {
 	int row, i;
 
 	for (row = 3; row >= 0; row--) {
 		for (i = XC6_BRAM16_DEVS_PER_ROW-1; i >= 0; i--) {
-			printf_ramb_data(&cfg->bits.d[BRAM_DATA_START
+			printf_ramb_data(f, &cfg->bits.d[BRAM_DATA_START
 				+ (row*XC6_BRAM16_DEVS_PER_ROW+i)
 				  *XC6_BRAM_DATA_FRAMES_PER_DEV*FRAME_SIZE],
 				row, i);
@@ -827,28 +827,28 @@ static int dump_bram(struct fpga_config *cfg)
 	return 0;
 }
 
-int dump_config(struct fpga_config* cfg, int flags)
+int dump_config(FILE* f, struct fpga_config* cfg, int flags)
 {
 	int rc;
 
 	if (flags & DUMP_HEADER_STR)
-		dump_header(cfg);
+		dump_header(f, cfg);
 	if (flags & DUMP_REGS) {
-		rc = dump_regs(cfg, /*start*/ 0, cfg->num_regs_before_bits, flags & DUMP_CRC);
+		rc = dump_regs(f, cfg, /*start*/ 0, cfg->num_regs_before_bits, flags & DUMP_CRC);
 		if (rc) FAIL(rc);
 	}
 	if (flags & DUMP_BITS) {
-		rc = dump_bits(cfg);
+		rc = dump_bits(f, cfg);
 		if (rc) FAIL(rc);
-		rc = dump_bram(cfg);
+		rc = dump_bram(f, cfg);
 		if (rc) FAIL(rc);
-		printf_type2(cfg->bits.d, cfg->bits.len,
+		printf_type2(f, cfg->bits.d, cfg->bits.len,
 			BRAM_DATA_START + BRAM_DATA_LEN, IOB_WORDS*2/8);
 		if (flags & DUMP_CRC)
-			printf("auto-crc 0x%X\n", cfg->auto_crc);
+			fprintf(f, "auto-crc 0x%X\n", cfg->auto_crc);
 	}
 	if (flags & DUMP_REGS) {
-		rc = dump_regs(cfg, cfg->num_regs_before_bits, cfg->num_regs, flags & DUMP_CRC);
+		rc = dump_regs(f, cfg, cfg->num_regs_before_bits, cfg->num_regs, flags & DUMP_CRC);
 		if (rc) FAIL(rc);
 	}
 	return 0;
@@ -1122,16 +1122,16 @@ static int read_bits(struct fpga_config* cfg, uint8_t* d, int len,
 						printf("dest all-0\n");
 					else {
 						printf("dest {\n");
-						dump_data(1, &cfg->bits.d[offset_in_bits + (i-padding_frames)*FRAME_SIZE],
+						dump_data(stdout, 1, &cfg->bits.d[offset_in_bits + (i-padding_frames)*FRAME_SIZE],
 							FRAME_SIZE, 16);
 						printf("}\n");
 					}
 					printf("src {\n");
-					dump_data(1, &d[src_off + i*FRAME_SIZE], FRAME_SIZE, 16);
+					dump_data(stdout, 1, &d[src_off + i*FRAME_SIZE], FRAME_SIZE, 16);
 					printf("}\n");
 				}
 				if (offset_in_bits)
-					printf_minor_diff(FAR_row, FAR_major, FAR_minor,
+					printf_minor_diff(stdout, FAR_row, FAR_major, FAR_minor,
 						&cfg->bits.d[offset_in_bits + (i-padding_frames)*FRAME_SIZE],
 						&d[src_off + i*FRAME_SIZE]);
 				memcpy(&cfg->bits.d[offset_in_bits
@@ -20,23 +20,13 @@ int fpga_find_iob(struct fpga_model *model, const char *sitename,
 	int i, j;
 
 	RC_CHECK(model);
-	for (i = 0; i < model->pkg->num_pins; i++) {
-		if (!strcmp(model->pkg->pin[i].name, sitename))
-			break;
-	}
-	if (i >= model->pkg->num_pins) {
+	i = find_pkg_pin(model, sitename, /*by_desc*/ 0);
+	if (i == -1) {
 		HERE();
 		return -1;
 	}
-	for (j = 0; j < model->die->num_t2_ios; j++) {
-		if (!model->die->t2_io[j].pair)
-			continue;
-		if (model->die->t2_io[j].pair == model->pkg->pin[i].pair
-		    && model->die->t2_io[j].pos_side == model->pkg->pin[i].pos_side
-		    && model->die->t2_io[j].bank == model->pkg->pin[i].bank)
-			break;
-	}
-	if (j >= model->die->num_t2_ios) {
+	j = model->pin_t2_io[i];
+	if (j == -1) {
 		fprintf(stderr, "#E %s:%i fpga_find_iob() cannot find %s\n",
 			__FILE__, __LINE__, sitename);
 		return -1;
@@ -50,31 +40,31 @@ int fpga_find_iob(struct fpga_model *model, const char *sitename,
 const char *fpga_iob_sitename(struct fpga_model *model,
 	int y, int x, dev_type_idx_t type_idx)
 {
-	int i, j;
+	int i;
 
-	for (i = 0; i < model->die->num_t2_ios; i++) {
-		if (!model->die->t2_io[i].pair)
-			continue;
-		if (model->die->t2_io[i].y == y
-		    && model->die->t2_io[i].x == x
-		    && model->die->t2_io[i].type_idx == type_idx)
-			break;
-	}
-	if (i >= model->die->num_t2_ios) {
+	i = find_t2_io(model, y, x, type_idx);
+	if (i == -1) {
 		HERE();
 		return 0;
 	}
-	for (j = 0; j < model->pkg->num_pins; j++) {
-		if (model->pkg->pin[j].bank == model->die->t2_io[i].bank
-		    && model->pkg->pin[j].pair == model->die->t2_io[i].pair
-		    && model->pkg->pin[j].pos_side == model->die->t2_io[i].pos_side)
-			break;
+	if (model->t2_io_pin[i] == -1) {
+		HERE();
+		return 0;
 	}
-	if (j >= model->pkg->num_pins) {
+	return model->pkg->pin[model->t2_io_pin[i]].name;
+}
+
+const char *fpga_find_pkg_pin(struct fpga_model *model,
+	const char *description)
+{
+	int i;
+
+	i = find_pkg_pin(model, description, /*by_desc*/ 1);
+	if (i == -1) {
 		HERE();
 		return 0;
 	}
-	return model->pkg->pin[j].name;
+	return model->pkg->pin[i].name;
 }
 
 static void enum_x(struct fpga_model *model, enum fpgadev_type type,
@@ -209,6 +199,13 @@ dev_idx_t fpga_dev_idx(struct fpga_model* model,
 
 	// function must work even if model->rc is set
 	tile = YX_TILE(model, y, x);
+	if (tile->dev_index) {
+		if (type <= DEV_NONE || type >= DEV_TYPE_COUNT || type_idx < 0
+		    || type_idx >= tile->dev_index[type+1]-tile->dev_index[type])
+			return NO_DEV;
+		return tile->dev_index[DEV_TYPE_COUNT+1
+			+ tile->dev_index[type] + type_idx];
+	}
 	type_count = 0;
 	for (i = 0; i < tile->num_devs; i++) {
 		if (tile->devs[i].type == type) {
@@ -228,6 +225,12 @@ dev_type_idx_t fdev_typeidx(struct fpga_model* model, int y, int x,
 
 	// function must work even if model->rc is set
 	tile = YX_TILE(model, y, x);
+	if (tile->dev_index) {
+		const uint8_t* by_type = &tile->dev_index[DEV_TYPE_COUNT+1];
+		for (i = tile->dev_index[tile->devs[dev_idx].type];
+		     by_type[i] != dev_idx; i++);
+		return i - tile->dev_index[tile->devs[dev_idx].type];
+	}
 	type_count = 0;
 	for (i = 0; i < dev_idx; i++) {
 		if (tile->devs[i].type == tile->devs[dev_idx].type)
@@ -288,8 +291,8 @@ const char* fdev_pinw_idx2str(int devtype, pinw_idx_t idx)
 const char* fdev_logic_pinstr(pinw_idx_t idx, int ld1_type)
 {
  	enum { NUM_BUFS = 16, BUF_SIZE = 16 };
-	static char buf[NUM_BUFS][BUF_SIZE];
-	static int last_buf = 0;
+	static __thread char buf[NUM_BUFS][BUF_SIZE];
+	static __thread int last_buf = 0;
 
 	last_buf = (last_buf+1)%NUM_BUFS;
 	if (ld1_type == LOGIC_M)
@@ -318,15 +321,29 @@ str16_t fdev_logic_pinstr_i(struct fpga_model* model, pinw_idx_t idx, int ld1_ty
 	return str_i;
 }
 
-static int reset_required_pins(struct fpga_device* dev)
+union fpgadev_cfg* fdev_cfg(struct fpga_model* model,
+	struct fpga_device* dev)
+{
+	union fpgadev_cfg* cfg;
+
+	if (dev->u != &fdev_no_cfg)
+		return dev->u;
+	fpga_journal_dev(model, dev);
+	// the required pins list is kept in the same allocation
+	cfg = calloc(1, sizeof(*cfg)
+		+ dev->num_pinw_total*sizeof(*dev->pinw_req_for_cfg));
+	if (!cfg) { HERE(); return 0; }
+	dev->u = cfg;
+	dev->pinw_req_for_cfg = (pinw_idx_t*) (cfg+1);
+	return cfg;
+}
+
+static int reset_required_pins(struct fpga_model* model,
+	struct fpga_device* dev)
 {
 	int rc;
 
-	if (!dev->pinw_req_for_cfg) {
-		dev->pinw_req_for_cfg = malloc(dev->num_pinw_total
-			* sizeof(*dev->pinw_req_for_cfg));
-		if (!dev->pinw_req_for_cfg) FAIL(ENOMEM);
-	}
+	if (!fdev_cfg(model, dev)) FAIL(ENOMEM);
 	dev->pinw_req_total = 0;
 	dev->pinw_req_in = 0;
 	return 0;
@@ -413,8 +430,9 @@ int fdev_logic_setconf(struct fpga_model *model, int y, int x,
 	fdev_delete(model, y, x, DEV_LOGIC, type_idx);
 	dev = fdev_p(model, y, x, DEV_LOGIC, type_idx);
 	RC_ASSERT(model, dev);
+	if (!fdev_cfg(model, dev)) RC_FAIL(model, ENOMEM);
 
-	dev->u.logic = *logic_cfg;
+	dev->u->logic = *logic_cfg;
 	dev->instantiated = 1;
 
 	fdev_set_required_pins(model, y, x, DEV_LOGIC, type_idx);
@@ -429,13 +447,13 @@ int fdev_logic_a2d_out_used(struct fpga_model* model, int y, int x,
 
 	dev = fdev_p(model, y, x, DEV_LOGIC, type_idx);
 	RC_ASSERT(model, dev);
-	rc = reset_required_pins(dev);
+	rc = reset_required_pins(model, dev);
 	if (rc) RC_FAIL(model, rc);
 
 	if (used)
-		dev->u.logic.a2d[lut_a2d].flags |= OUT_USED;
+		dev->u->logic.a2d[lut_a2d].flags |= OUT_USED;
 	else
-		dev->u.logic.a2d[lut_a2d].flags &= ~OUT_USED;
+		dev->u->logic.a2d[lut_a2d].flags &= ~OUT_USED;
 	dev->instantiated = 1;
 	RC_RETURN(model);
 }
@@ -449,12 +467,12 @@ int fdev_logic_a2d_ff(struct fpga_model* model, int y, int x, int type_idx,
 	RC_CHECK(model);
 	dev = fdev_p(model, y, x, DEV_LOGIC, type_idx);
 	if (!dev) FAIL(EINVAL);
-	rc = reset_required_pins(dev);
+	rc = reset_required_pins(model, dev);
 	if (rc) FAIL(rc);
 
-	dev->u.logic.a2d[lut_a2d].ff = FF_FF;
-	dev->u.logic.a2d[lut_a2d].ff_mux = ff_mux;
-	dev->u.logic.a2d[lut_a2d].ff_srinit = srinit;
+	dev->u->logic.a2d[lut_a2d].ff = FF_FF;
+	dev->u->logic.a2d[lut_a2d].ff_mux = ff_mux;
+	dev->u->logic.a2d[lut_a2d].ff_srinit = srinit;
 	// A flip-flop also needs a clock (and sync attribute) to operate.
 	dev->instantiated = 1;
 	return 0;
@@ -471,10 +489,10 @@ int fdev_logic_a2d_ff5_srinit(struct fpga_model* model, int y, int x,
 	RC_CHECK(model);
 	dev = fdev_p(model, y, x, DEV_LOGIC, type_idx);
 	if (!dev) FAIL(EINVAL);
-	rc = reset_required_pins(dev);
+	rc = reset_required_pins(model, dev);
 	if (rc) FAIL(rc);
 
-	dev->u.logic.a2d[lut_a2d].ff5_srinit = srinit;
+	dev->u->logic.a2d[lut_a2d].ff5_srinit = srinit;
 	dev->instantiated = 1;
 	return 0;
 fail:
@@ -490,10 +508,10 @@ int fdev_logic_a2d_out_mux(struct fpga_model* model, int y, int x,
 	RC_CHECK(model);
 	dev = fdev_p(model, y, x, DEV_LOGIC, type_idx);
 	if (!dev) FAIL(EINVAL);
-	rc = reset_required_pins(dev);
+	rc = reset_required_pins(model, dev);
 	if (rc) FAIL(rc);
 
-	dev->u.logic.a2d[lut_a2d].out_mux = out_mux;
+	dev->u->logic.a2d[lut_a2d].out_mux = out_mux;
 	dev->instantiated = 1;
 	return 0;
 fail:
@@ -509,10 +527,10 @@ int fdev_logic_a2d_cy0(struct fpga_model* model, int y, int x,
 	RC_CHECK(model);
 	dev = fdev_p(model, y, x, DEV_LOGIC, type_idx);
 	if (!dev) FAIL(EINVAL);
-	rc = reset_required_pins(dev);
+	rc = reset_required_pins(model, dev);
 	if (rc) FAIL(rc);
 
-	dev->u.logic.a2d[lut_a2d].cy0 = cy0;
+	dev->u->logic.a2d[lut_a2d].cy0 = cy0;
 	dev->instantiated = 1;
 	return 0;
 fail:
@@ -528,10 +546,10 @@ int fdev_logic_clk(struct fpga_model* model, int y, int x, int type_idx,
 	RC_CHECK(model);
 	dev = fdev_p(model, y, x, DEV_LOGIC, type_idx);
 	if (!dev) FAIL(EINVAL);
-	rc = reset_required_pins(dev);
+	rc = reset_required_pins(model, dev);
 	if (rc) FAIL(rc);
 
-	dev->u.logic.clk_inv = clk;
+	dev->u->logic.clk_inv = clk;
 	dev->instantiated = 1;
 	return 0;
 fail:
@@ -547,10 +565,10 @@ int fdev_logic_sync(struct fpga_model* model, int y, int x, int type_idx,
 	RC_CHECK(model);
 	dev = fdev_p(model, y, x, DEV_LOGIC, type_idx);
 	if (!dev) FAIL(EINVAL);
-	rc = reset_required_pins(dev);
+	rc = reset_required_pins(model, dev);
 	if (rc) FAIL(rc);
 
-	dev->u.logic.sync_attr = sync_attr;
+	dev->u->logic.sync_attr = sync_attr;
 	dev->instantiated = 1;
 	return 0;
 fail:
@@ -565,10 +583,10 @@ int fdev_logic_ce_used(struct fpga_model* model, int y, int x, int type_idx)
 	RC_CHECK(model);
 	dev = fdev_p(model, y, x, DEV_LOGIC, type_idx);
 	if (!dev) FAIL(EINVAL);
-	rc = reset_required_pins(dev);
+	rc = reset_required_pins(model, dev);
 	if (rc) FAIL(rc);
 
-	dev->u.logic.ce_used = 1;
+	dev->u->logic.ce_used = 1;
 	dev->instantiated = 1;
 	return 0;
 fail:
@@ -583,10 +601,10 @@ int fdev_logic_sr_used(struct fpga_model* model, int y, int x, int type_idx)
 	RC_CHECK(model);
 	dev = fdev_p(model, y, x, DEV_LOGIC, type_idx);
 	if (!dev) FAIL(EINVAL);
-	rc = reset_required_pins(dev);
+	rc = reset_required_pins(model, dev);
 	if (rc) FAIL(rc);
 
-	dev->u.logic.sr_used = 1;
+	dev->u->logic.sr_used = 1;
 	dev->instantiated = 1;
 	return 0;
 fail:
@@ -602,10 +620,10 @@ int fdev_logic_we_mux(struct fpga_model* model, int y, int x,
 	RC_CHECK(model);
 	dev = fdev_p(model, y, x, DEV_LOGIC, type_idx);
 	if (!dev) FAIL(EINVAL);
-	rc = reset_required_pins(dev);
+	rc = reset_required_pins(model, dev);
 	if (rc) FAIL(rc);
 
-	dev->u.logic.we_mux = we_mux;
+	dev->u->logic.we_mux = we_mux;
 	dev->instantiated = 1;
 	return 0;
 fail:
@@ -621,10 +639,10 @@ int fdev_logic_cout_used(struct fpga_model* model, int y, int x,
 	RC_CHECK(model);
 	dev = fdev_p(model, y, x, DEV_LOGIC, type_idx);
 	if (!dev) FAIL(EINVAL);
-	rc = reset_required_pins(dev);
+	rc = reset_required_pins(model, dev);
 	if (rc) FAIL(rc);
 
-	dev->u.logic.cout_used = (used != 0);
+	dev->u->logic.cout_used = (used != 0);
 	dev->instantiated = 1;
 	return 0;
 fail:
@@ -640,10 +658,10 @@ int fdev_logic_precyinit(struct fpga_model* model, int y, int x,
 	RC_CHECK(model);
 	dev = fdev_p(model, y, x, DEV_LOGIC, type_idx);
 	if (!dev) FAIL(EINVAL);
-	rc = reset_required_pins(dev);
+	rc = reset_required_pins(model, dev);
 	if (rc) FAIL(rc);
 
-	dev->u.logic.precyinit = precyinit;
+	dev->u->logic.precyinit = precyinit;
 	dev->instantiated = 1;
 	return 0;
 fail:
@@ -657,12 +675,12 @@ int fdev_logic_o5_used(struct fpga_model *model, int y, int x, int type_idx,
 	if (!dev) { HERE(); return 0; }
 
 	return (type_idx == DEV_LOG_X
-		&& dev->u.logic.a2d[lut_a2d].out_mux)
+		&& dev->u->logic.a2d[lut_a2d].out_mux)
 	       || (type_idx == DEV_LOG_M_OR_L
-		   && (dev->u.logic.a2d[lut_a2d].ff_mux == MUX_O5
-		       || dev->u.logic.a2d[lut_a2d].out_mux == MUX_5Q
-		       || dev->u.logic.a2d[lut_a2d].out_mux == MUX_O5
-		       || dev->u.logic.a2d[lut_a2d].cy0 == CY0_O5));
+		   && (dev->u->logic.a2d[lut_a2d].ff_mux == MUX_O5
+		       || dev->u->logic.a2d[lut_a2d].out_mux == MUX_5Q
+		       || dev->u->logic.a2d[lut_a2d].out_mux == MUX_O5
+		       || dev->u->logic.a2d[lut_a2d].cy0 == CY0_O5));
 }
 
 int fdev_logic_lut_dieval(struct fpga_model *model, int y, int x, int type_idx,
@@ -673,15 +691,15 @@ int fdev_logic_lut_dieval(struct fpga_model *model, int y, int x, int type_idx,
 	*die_val = 0;
 	dev = fdev_p(model, y, x, DEV_LOGIC, type_idx);
 	RC_ASSERT(model, dev);
-	if (dev->u.logic.a2d[lut_a2d].flags & LUT5VAL_SET) {
-		*die_val = dev->u.logic.a2d[lut_a2d].lut5_val;
-		if (dev->u.logic.a2d[lut_a2d].flags & LUT6VAL_SET) {
-			if (ULL_HIGH32(dev->u.logic.a2d[lut_a2d].lut6_val))
+	if (dev->u->logic.a2d[lut_a2d].flags & LUT5VAL_SET) {
+		*die_val = dev->u->logic.a2d[lut_a2d].lut5_val;
+		if (dev->u->logic.a2d[lut_a2d].flags & LUT6VAL_SET) {
+			if (ULL_HIGH32(dev->u->logic.a2d[lut_a2d].lut6_val))
 				HERE();
-			*die_val |= ULL_LOW32(dev->u.logic.a2d[lut_a2d].lut6_val << 32);
+			*die_val |= ULL_LOW32(dev->u->logic.a2d[lut_a2d].lut6_val << 32);
 		}
-	} else if (dev->u.logic.a2d[lut_a2d].flags & LUT6VAL_SET)
-		*die_val = dev->u.logic.a2d[lut_a2d].lut6_val;
+	} else if (dev->u->logic.a2d[lut_a2d].flags & LUT6VAL_SET)
+		*die_val = dev->u->logic.a2d[lut_a2d].lut6_val;
 	RC_RETURN(model);
 }
 
@@ -698,12 +716,12 @@ int fdev_iob_input(struct fpga_model* model, int y, int x, int type_idx,
 	RC_CHECK(model);
 	dev = fdev_p(model, y, x, DEV_IOB, type_idx);
 	if (!dev) FAIL(EINVAL);
-	rc = reset_required_pins(dev);
+	rc = reset_required_pins(model, dev);
 	if (rc) FAIL(rc);
 
-	strcpy(dev->u.iob.istandard, io_std);
-	dev->u.iob.bypass_mux = BYPASS_MUX_I;
-	dev->u.iob.I_mux = IMUX_I;
+	strcpy(dev->u->iob.istandard, io_std);
+	dev->u->iob.bypass_mux = BYPASS_MUX_I;
+	dev->u->iob.I_mux = IMUX_I;
 	dev->instantiated = 1;
 	return 0;
 fail:
@@ -719,23 +737,23 @@ int fdev_iob_output(struct fpga_model* model, int y, int x, int type_idx,
 	RC_CHECK(model);
 	dev = fdev_p(model, y, x, DEV_IOB, type_idx);
 	if (!dev) FAIL(EINVAL);
-	rc = reset_required_pins(dev);
+	rc = reset_required_pins(model, dev);
 	if (rc) FAIL(rc);
 
-	strcpy(dev->u.iob.ostandard, io_std);
-	dev->u.iob.O_used = 1;
-	dev->u.iob.suspend = SUSP_3STATE;
+	strcpy(dev->u->iob.ostandard, io_std);
+	dev->u->iob.O_used = 1;
+	dev->u->iob.suspend = SUSP_3STATE;
 	if (strcmp(io_std, IO_SSTL2_I)) {
 		// also see ug381 page 31
 		if (!strcmp(io_std, IO_LVCMOS33)
 		    || !strcmp(io_std, IO_LVCMOS25))
-			dev->u.iob.drive_strength = 12;
+			dev->u->iob.drive_strength = 12;
 		else if (!strcmp(io_std, IO_LVCMOS12)
 			 || !strcmp(io_std, IO_LVCMOS12_JEDEC))
-			dev->u.iob.drive_strength = 6;
+			dev->u->iob.drive_strength = 6;
 		else
-			dev->u.iob.drive_strength = 8;
-		dev->u.iob.slew = SLEW_SLOW;
+			dev->u->iob.drive_strength = 8;
+		dev->u->iob.slew = SLEW_SLOW;
 	}
 	dev->instantiated = 1;
 	return 0;
@@ -752,10 +770,10 @@ int fdev_iob_IMUX(struct fpga_model* model, int y, int x,
 	RC_CHECK(model);
 	dev = fdev_p(model, y, x, DEV_IOB, type_idx);
 	if (!dev) FAIL(EINVAL);
-	rc = reset_required_pins(dev);
+	rc = reset_required_pins(model, dev);
 	if (rc) FAIL(rc);
 
-	dev->u.iob.I_mux = mux;
+	dev->u->iob.I_mux = mux;
 	dev->instantiated = 1;
 	return 0;
 fail:
@@ -771,10 +789,10 @@ int fdev_iob_slew(struct fpga_model* model, int y, int x,
 	RC_CHECK(model);
 	dev = fdev_p(model, y, x, DEV_IOB, type_idx);
 	if (!dev) FAIL(EINVAL);
-	rc = reset_required_pins(dev);
+	rc = reset_required_pins(model, dev);
 	if (rc) FAIL(rc);
 
-	dev->u.iob.slew = slew;
+	dev->u->iob.slew = slew;
 	dev->instantiated = 1;
 	return 0;
 fail:
@@ -790,10 +808,10 @@ int fdev_iob_drive(struct fpga_model* model, int y, int x,
 	RC_CHECK(model);
 	dev = fdev_p(model, y, x, DEV_IOB, type_idx);
 	if (!dev) FAIL(EINVAL);
-	rc = reset_required_pins(dev);
+	rc = reset_required_pins(model, dev);
 	if (rc) FAIL(rc);
 
-	dev->u.iob.drive_strength = drive_strength;
+	dev->u->iob.drive_strength = drive_strength;
 	dev->instantiated = 1;
 	return 0;
 fail:
@@ -809,12 +827,12 @@ int fdev_bufgmux(struct fpga_model *model, int y, int x,
 	RC_CHECK(model);
 	dev = fdev_p(model, y, x, DEV_BUFGMUX, type_idx);
 	RC_ASSERT(model, dev);
-	rc = reset_required_pins(dev);
+	rc = reset_required_pins(model, dev);
 	if (rc) RC_FAIL(model, rc);
 
-	dev->u.bufgmux.clk = clk;
-	dev->u.bufgmux.disable_attr = disable_attr;
-	dev->u.bufgmux.s_inv = s_inv;
+	dev->u->bufgmux.clk = clk;
+	dev->u->bufgmux.disable_attr = disable_attr;
+	dev->u->bufgmux.s_inv = s_inv;
 	dev->instantiated = 1;
 	RC_RETURN(model);
 }
@@ -827,9 +845,10 @@ int fdev_bscan(struct fpga_model *model, int y, int x, int type_idx,
 	RC_CHECK(model);
 	dev = fdev_p(model, y, x, DEV_BSCAN, type_idx);
 	RC_ASSERT(model, dev);
+	if (!fdev_cfg(model, dev)) RC_FAIL(model, ENOMEM);
 
-	dev->u.bscan.jtag_chain = jtag_chain;
-	dev->u.bscan.jtag_test = jtag_test;
+	dev->u->bscan.jtag_chain = jtag_chain;
+	dev->u->bscan.jtag_test = jtag_test;
 	dev->instantiated = 1;
 	RC_RETURN(model);
 }
@@ -843,86 +862,86 @@ int fdev_set_required_pins(struct fpga_model* model, int y, int x, int type,
 	RC_CHECK(model);
 	dev = fdev_p(model, y, x, type, type_idx);
 	if (!dev) FAIL(EINVAL);
-	rc = reset_required_pins(dev);
+	rc = reset_required_pins(model, dev);
 	if (rc) FAIL(rc);
 	if (type == DEV_LOGIC) {
-		if (dev->u.logic.clk_inv)
+		if (dev->u->logic.clk_inv)
 			add_req_inpin(dev, LI_CLK);
-		if (dev->u.logic.ce_used)
+		if (dev->u->logic.ce_used)
 			add_req_inpin(dev, LI_CE);
-		if (dev->u.logic.sr_used)
+		if (dev->u->logic.sr_used)
 			add_req_inpin(dev, LI_SR);
-		if (dev->u.logic.cout_used)
+		if (dev->u->logic.cout_used)
 			add_req_outpin(dev, LO_COUT);
-		if (dev->u.logic.precyinit == PRECYINIT_AX)
+		if (dev->u->logic.precyinit == PRECYINIT_AX)
 			add_req_inpin(dev, LI_AX);
-		if (dev->u.logic.a2d[LUT_A].out_mux == MUX_F7
-		    || dev->u.logic.a2d[LUT_A].ff_mux == MUX_F7)
+		if (dev->u->logic.a2d[LUT_A].out_mux == MUX_F7
+		    || dev->u->logic.a2d[LUT_A].ff_mux == MUX_F7)
 			add_req_inpin(dev, LI_AX);
-		if (dev->u.logic.a2d[LUT_C].out_mux == MUX_F7
-		    || dev->u.logic.a2d[LUT_C].ff_mux == MUX_F7)
+		if (dev->u->logic.a2d[LUT_C].out_mux == MUX_F7
+		    || dev->u->logic.a2d[LUT_C].ff_mux == MUX_F7)
 			add_req_inpin(dev, LI_CX);
-		if (dev->u.logic.a2d[LUT_B].out_mux == MUX_F8
-		    || dev->u.logic.a2d[LUT_B].ff_mux == MUX_F8) {
+		if (dev->u->logic.a2d[LUT_B].out_mux == MUX_F8
+		    || dev->u->logic.a2d[LUT_B].ff_mux == MUX_F8) {
 			add_req_inpin(dev, LI_AX);
 			add_req_inpin(dev, LI_BX);
 			add_req_inpin(dev, LI_CX);
 		}
-		if (dev->u.logic.we_mux == WEMUX_WE)
+		if (dev->u->logic.we_mux == WEMUX_WE)
 			add_req_inpin(dev, LI_WE);
-		else if (dev->u.logic.we_mux == WEMUX_CE)
+		else if (dev->u->logic.we_mux == WEMUX_CE)
 			add_req_inpin(dev, LI_CE);
-		if (dev->u.logic.wa7_used)
+		if (dev->u->logic.wa7_used)
 			add_req_inpin(dev, LI_CX);
-		if (dev->u.logic.wa8_used)
+		if (dev->u->logic.wa8_used)
 			add_req_inpin(dev, LI_BX);
 		for (i = LUT_A; i <= LUT_D; i++) {
-			if (dev->u.logic.a2d[i].flags & OUT_USED) {
+			if (dev->u->logic.a2d[i].flags & OUT_USED) {
 				// LO_A..LO_D are in sequence
 				add_req_outpin(dev, LO_A+i);
 			}
-			if (dev->u.logic.a2d[i].out_mux) {
+			if (dev->u->logic.a2d[i].out_mux) {
 				// LO_AMUX..LO_DMUX are in sequence
 				add_req_outpin(dev, LO_AMUX+i);
 			}
-			if (dev->u.logic.a2d[i].ff) {
+			if (dev->u->logic.a2d[i].ff) {
 				// LO_AQ..LO_DQ are in sequence
 				add_req_outpin(dev, LO_AQ+i);
 			}
-			if (dev->u.logic.a2d[i].ff_mux == MUX_X
-			    || dev->u.logic.a2d[i].cy0 == CY0_X
-			    || dev->u.logic.a2d[i].di_mux == DIMUX_X) {
+			if (dev->u->logic.a2d[i].ff_mux == MUX_X
+			    || dev->u->logic.a2d[i].cy0 == CY0_X
+			    || dev->u->logic.a2d[i].di_mux == DIMUX_X) {
 				// LI_AX..LI_DX are in sequence
 				add_req_inpin(dev, LI_AX+i);
 			}
 
 			req_inpins = 0;
-			if (dev->u.logic.a2d[i].flags & LUT5VAL_SET) {
+			if (dev->u->logic.a2d[i].flags & LUT5VAL_SET) {
 				// A6 must be high/vcc if lut5 is used
 				req_inpins |= 1<<5;
-				req_inpins |= bool_req_pins(dev->u.logic.a2d[i].lut5_val, 32);
+				req_inpins |= bool_req_pins(dev->u->logic.a2d[i].lut5_val, 32);
 			}
-			if (dev->u.logic.a2d[i].flags & LUT6VAL_SET) {
-				req_inpins |= bool_req_pins(dev->u.logic.a2d[i].lut6_val,
-					(dev->u.logic.a2d[i].flags & LUT5VAL_SET) ? 32 : 64);
+			if (dev->u->logic.a2d[i].flags & LUT6VAL_SET) {
+				req_inpins |= bool_req_pins(dev->u->logic.a2d[i].lut6_val,
+					(dev->u->logic.a2d[i].flags & LUT5VAL_SET) ? 32 : 64);
 			}
 			for (j = 0; j < 6; j++) {
 				if (req_inpins & (1<<j))
 					add_req_inpin(dev, LI_A1+i*6+j);
 			}
-			if ((dev->u.logic.a2d[i].ff_mux == MUX_XOR
-			     || dev->u.logic.a2d[i].out_mux == MUX_XOR)
-			    && !dev->u.logic.precyinit)
+			if ((dev->u->logic.a2d[i].ff_mux == MUX_XOR
+			     || dev->u->logic.a2d[i].out_mux == MUX_XOR)
+			    && !dev->u->logic.precyinit)
 				add_req_inpin(dev, LI_CIN);
-			if (dev->u.logic.a2d[i].ram_mode)
+			if (dev->u->logic.a2d[i].ram_mode)
 				add_req_inpin(dev, LI_CLK);
 		}
 		return 0;
 	}
 	if (type == DEV_IOB) {
-		if (dev->u.iob.I_mux)
+		if (dev->u->iob.I_mux)
 			add_req_outpin(dev, IOB_OUT_I);
-		if (dev->u.iob.O_used)
+		if (dev->u->iob.O_used)
 			add_req_inpin(dev, IOB_IN_O);
 	}
 	return 0;
@@ -936,13 +955,14 @@ void fdev_delete(struct fpga_model* model, int y, int x, int type, int type_idx)
 
 	dev = fdev_p(model, y, x, type, type_idx);
 	if (!dev) { HERE(); return; }
-	if (!dev->instantiated) return;
-	free(dev->pinw_req_for_cfg);
+	if (dev->u != &fdev_no_cfg) {
+		free(dev->u);
+		dev->u = (union fpgadev_cfg*) &fdev_no_cfg;
+	}
 	dev->pinw_req_for_cfg = 0;
 	dev->pinw_req_total = 0;
 	dev->pinw_req_in = 0;
 	dev->instantiated = 0;
-	memset(&dev->u, 0, sizeof(dev->u));
 }
 
 int fpga_connpt_find(struct fpga_model* model, int y, int x,
@@ -952,6 +972,9 @@ int fpga_connpt_find(struct fpga_model* model, int y, int x,
 	int i;
 
 	RC_CHECK(model);
+	STAT_INC(model->stats.connpt_finds);
+	if (fpga_materialize_tile(model, y, x))
+		return NO_CONN;
 	tile = YX_TILE(model, y, x);
 	for (i = 0; i < tile->num_conn_point_names; i++) {
 		if (tile->conn_point_names[i*2+1] == name_i)
@@ -999,6 +1022,8 @@ int fpga_find_conn(struct fpga_model* model, int search_y, int search_x,
 	struct fpga_tile* tile;
 	int i, j, dests_end;
 
+	RC_CHECK(model);
+	fpga_materialize_tile(model, search_y, search_x);
 	RC_CHECK(model);
 	tile = YX_TILE(model, search_y, search_x);
 	for (i = 0; i < tile->num_conn_point_names; i++) {
@@ -1026,8 +1051,11 @@ swidx_t fpga_switch_first(struct fpga_model* model, int y, int x,
 	int i, connpt_o;
 
 	RC_CHECK(model);
+	STAT_INC(model->stats.switch_firsts);
 	// Finds the first switch either from or to the name given.
 	if (name_i == STRIDX_NO_ENTRY) { HERE(); return NO_SWITCH; }
+	if (fpga_materialize_tile(model, y, x))
+		return NO_SWITCH;
 	tile = YX_TILE(model, y, x);
 	for (i = 0; i < tile->num_switches; i++) {
 		connpt_o = SW_I(tile->switches[i], from_to);
@@ -1064,6 +1092,7 @@ static swidx_t fpga_switch_search(struct fpga_model* model, int y, int x,
 swidx_t fpga_switch_next(struct fpga_model* model, int y, int x,
 	swidx_t last, int from_to)
 {
+	STAT_INC(model->stats.switch_nexts);
 	return fpga_switch_search(model, y, x, last,
 		(last & FIRST_SW) ? 0 : last+1, from_to);
 }
@@ -1256,8 +1285,8 @@ static const char* connpt_str(struct fpga_model* model, int y, int x, int connpt
 	// We have a little local ringbuffer to make passing
 	// around pointers with unknown lifetime and possible
 	// overlap with writing functions more stable.
-	static char switch_get_buf[NUM_CONNPT_BUFS][CONNPT_BUF_SIZE];
-	static int last_buf = 0;
+	static __thread char switch_get_buf[NUM_CONNPT_BUFS][CONNPT_BUF_SIZE];
+	static __thread int last_buf = 0;
 
 	const char* hash_str;
 	int str_i;
@@ -1296,8 +1325,8 @@ const char* fpga_switch_print(struct fpga_model* model, int y, int x,
 	swidx_t swidx)
 {
  	enum { NUM_BUFS = 16, BUF_SIZE = 128 };
-	static char buf[NUM_BUFS][BUF_SIZE];
-	static int last_buf = 0;
+	static __thread char buf[NUM_BUFS][BUF_SIZE];
+	static __thread int last_buf = 0;
 	uint32_t sw;
 
 	sw = YX_TILE(model, y, x)->switches[swidx];
@@ -1314,8 +1343,8 @@ const char* fpga_switch_print_json(struct fpga_model* model, int y, int x,
 	swidx_t swidx)
 {
  	enum { NUM_BUFS = 16, BUF_SIZE = 128 };
-	static char buf[NUM_BUFS][BUF_SIZE];
-	static int last_buf = 0;
+	static __thread char buf[NUM_BUFS][BUF_SIZE];
+	static __thread int last_buf = 0;
 	uint32_t sw;
 
 	sw = YX_TILE(model, y, x)->switches[swidx];
@@ -1337,13 +1366,14 @@ int fpga_switch_is_bidir(struct fpga_model* model, int y, int x,
 int fpga_switch_is_used(struct fpga_model* model, int y, int x,
 	swidx_t swidx)
 {
-	return (YX_TILE(model, y, x)->switches[swidx] & SWITCH_USED) != 0;
+	return SWITCH_IS_USED(YX_TILE(model, y, x), swidx);
 }
 
 void fpga_switch_enable(struct fpga_model* model, int y, int x,
 	swidx_t swidx)
 {
-	YX_TILE(model, y, x)->switches[swidx] |= SWITCH_USED;
+	fpga_journal_tile(model, y, x);
+	YX_TILE(model, y, x)->switches_used[swidx/32] |= 1u << (swidx%32);
 }
 
 int fpga_switch_set_enable(struct fpga_model* model, int y, int x,
@@ -1358,7 +1388,7 @@ int fpga_switch_set_enable(struct fpga_model* model, int y, int x,
 void fpga_switch_disable(struct fpga_model* model, int y, int x,
 	swidx_t swidx)
 {
-	YX_TILE(model, y, x)->switches[swidx] &= ~SWITCH_USED;
+	YX_TILE(model, y, x)->switches_used[swidx/32] &= ~(1u << (swidx%32));
 }
 
 #define SW_BUF_SIZE	256
@@ -1367,8 +1397,8 @@ void fpga_switch_disable(struct fpga_model* model, int y, int x,
 static const char* fmt_swset_el(struct fpga_model* model, int y, int x,
 	swidx_t sw, int from_to)
 {
-	static char sw_buf[NUM_SW_BUFS][SW_BUF_SIZE];
-	static int last_buf = 0;
+	static __thread char sw_buf[NUM_SW_BUFS][SW_BUF_SIZE];
+	static __thread int last_buf = 0;
 	char midstr[64];
 
 	last_buf = (last_buf+1)%NUM_SW_BUFS;
@@ -1396,8 +1426,8 @@ static const char* fmt_swset_el(struct fpga_model* model, int y, int x,
 const char* fmt_swset(struct fpga_model* model, int y, int x,
 	struct sw_set* set, int from_to)
 {
-	static char buf[FMT_SWSET_NUM_BUFS][FMT_SWSET_BUF_SIZE];
-	static int last_buf = 0;
+	static __thread char buf[FMT_SWSET_NUM_BUFS][FMT_SWSET_BUF_SIZE];
+	static __thread int last_buf = 0;
 	int i, o;
 
 	last_buf = (last_buf+1)%FMT_SWSET_NUM_BUFS;
@@ -1506,6 +1536,7 @@ int fpga_switch_chain(struct sw_chain* ch)
 	struct fpga_tile* tile;
 	int child_from_to, level_down, i;
 
+	STAT_INC(ch->model->stats.chain_steps);
 	if (!ch->set.len)
 		{ HERE(); goto internal_error; }
 	if (ch->first_round) {
@@ -2067,6 +2098,7 @@ int fnet_new(struct fpga_model* model, net_idx_t* new_idx)
 	int rc;
 
 	RC_CHECK(model);
+	STAT_INC(model->stats.net_allocs);
 	// highest_used_net is initialized to NO_NET which becomes 1
 	rc = fnet_useidx(model, model->highest_used_net+1);
 	if (rc) return rc;
@@ -2136,6 +2168,7 @@ int fpga_swset_in_other_net(struct fpga_model *model, int y, int x,
 	struct fpga_net* net_p;
 	int i, j;
 
+	STAT_INC(model->stats.other_net_checks);
 	net_p = fnet_get(model, our_net);
 	if (!net_p) {
 		fprintf(stderr ,"#E %s:%i cannot find our_net %i\n",
@@ -2763,6 +2796,8 @@ static int fnet_route_logic_carry(struct fpga_model *model, net_idx_t net_i, int
 		&& (net_p->el[in_i].y == regular_row_up(net_p->el[out_i].y, model)));
 
 	xm_col = has_device_type(model, net_p->el[out_i].y, net_p->el[out_i].x, DEV_LOGIC, LOGIC_M);
+	fpga_materialize_tile(model, net_p->el[out_i].y, net_p->el[out_i].x);
+	RC_CHECK(model);
 	if (xm_col) {
 		from_str_i = strarray_find(&model->str, "M_COUT");
 		to_str_i = strarray_find(&model->str, "M_COUT_N");
@@ -2899,6 +2934,9 @@ int fnet_vcc_gnd(struct fpga_model *model, net_idx_t net_i, int is_vcc)
 	net_p = fnet_get(model, net_i);
 	RC_ASSERT(model, net_p);
 
+	// make sure the wire names are known in a lazily built model
+	fpga_materialize_tile(model, net_p->el[in_i].y, net_p->el[in_i].x);
+	RC_CHECK(model);
 	from_i = strarray_find(&model->str, is_vcc ? "VCC_WIRE" : "GND_WIRE");
 	RC_ASSERT(model, !OUT_OF_U16(from_i));
 	in_enum = 0;
@@ -14,6 +14,11 @@ int fpga_find_iob(struct fpga_model* model, const char* sitename,
 const char *fpga_iob_sitename(struct fpga_model *model,
 	int y, int x, dev_type_idx_t type_idx);
 
+// Same as xc6_find_pkg_pin(), but hashed in the model.
+// Returns 0 if description not found.
+const char *fpga_find_pkg_pin(struct fpga_model *model,
+	const char *description);
+
 //
 // When dealing with devices, there are two indices:
 // 1. The index of the device in the device array for that tile.
@@ -115,6 +120,11 @@ void fdev_print_required_pins(struct fpga_model* model, int y, int x,
 	int type, int type_idx);
 void fdev_delete(struct fpga_model* model, int y, int x, int type,
 	int type_idx);
+// Returns the device's own config for writing, allocated on first
+// use and journaled for fpga_reset_model(). Returns 0 if out of
+// memory.
+union fpgadev_cfg* fdev_cfg(struct fpga_model* model,
+	struct fpga_device* dev);
 
 // Returns the connpt index or NO_CONN if the name was not
 // found. connpt_dests_o and num_dests are optional and may
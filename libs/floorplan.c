@@ -19,31 +19,157 @@ void printf_version(FILE* f)
 	fprintf(f, "  \"fpga_floorplan_version\" : 1");
 }
 
+// Clips range to the model, a null range means the whole model.
+static void clip_range(struct fpga_model* model, const struct fp_range* range,
+	struct fp_range* clipped)
+{
+	clipped->y_beg = 0;
+	clipped->y_end = model->y_height-1;
+	clipped->x_beg = 0;
+	clipped->x_end = model->x_width-1;
+	if (!range)
+		return;
+	if (range->y_beg > clipped->y_beg)
+		clipped->y_beg = range->y_beg;
+	if (range->y_end != -1 && range->y_end < clipped->y_end)
+		clipped->y_end = range->y_end;
+	if (range->x_beg > clipped->x_beg)
+		clipped->x_beg = range->x_beg;
+	if (range->x_end != -1 && range->x_end < clipped->x_end)
+		clipped->x_end = range->x_end;
+}
+
+#define OUT_BUF_SIZE	(1024*1024)
+// no single line is longer than this
+#define OUT_LINE_MAX	1024
+
+// Full-chip ports, conns and switches dumps are millions of lines.
+// They are formatted straight into a large buffer that is written
+// out with fwrite() when full, instead of one fprintf() per line.
+struct out_buf
+{
+	FILE* f;
+	char* buf;
+	int len;
+	int rc;
+};
+
+static int ob_init(struct out_buf* ob, FILE* f)
+{
+	ob->f = f;
+	ob->len = 0;
+	ob->rc = 0;
+	ob->buf = malloc(OUT_BUF_SIZE);
+	if (!ob->buf) {
+		HERE();
+		return ENOMEM;
+	}
+	return 0;
+}
+
+static void ob_flush(struct out_buf* ob)
+{
+	if (ob->len && fwrite(ob->buf, ob->len, 1, ob->f) != 1
+	    && !ob->rc)
+		ob->rc = errno ? errno : EIO;
+	ob->len = 0;
+}
+
+// Makes room for a whole line, so that no flush happens in the middle
+// of it and line lengths can be measured in the buffer.
+static void ob_line(struct out_buf* ob)
+{
+	if (ob->len + OUT_LINE_MAX > OUT_BUF_SIZE)
+		ob_flush(ob);
+}
+
+static void ob_str(struct out_buf* ob, const char* s)
+{
+	int len = strlen(s);
+
+	if (ob->len + len > OUT_BUF_SIZE) {
+		ob_flush(ob);
+		if (len > OUT_BUF_SIZE) {
+			if (fwrite(s, len, 1, ob->f) != 1 && !ob->rc)
+				ob->rc = errno ? errno : EIO;
+			return;
+		}
+	}
+	memcpy(&ob->buf[ob->len], s, len);
+	ob->len += len;
+}
+
+static void ob_int(struct out_buf* ob, int i)
+{
+	char digits[16];
+	int num_digits = 0;
+	unsigned int u;
+
+	if (ob->len + (int) sizeof(digits) > OUT_BUF_SIZE)
+		ob_flush(ob);
+	if (i < 0) {
+		ob->buf[ob->len++] = '-';
+		u = -(unsigned int) i;
+	} else
+		u = i;
+	do {
+		digits[num_digits++] = '0' + u%10;
+		u /= 10;
+	} while (u);
+	while (num_digits)
+		ob->buf[ob->len++] = digits[--num_digits];
+}
+
+static void ob_pad(struct out_buf* ob, int line_start, int width)
+{
+	while (ob->len - line_start < width)
+		ob->buf[ob->len++] = ' ';
+}
+
+static int ob_free(struct out_buf* ob)
+{
+	ob_flush(ob);
+	free(ob->buf);
+	ob->buf = 0;
+	return ob->rc;
+}
+
 int printf_tiles(FILE* f, struct fpga_model* model)
+{
+	return printf_tiles_range(f, model, /*range*/ 0);
+}
+
+int printf_tiles_range(FILE* f, struct fpga_model* model,
+	const struct fp_range* range)
 {
 	struct fpga_tile* tile;
-	int x, y, first_line;
+	struct fp_range r;
+	int x, y, first_line, first_tile;
 
 	RC_CHECK(model);
+	clip_range(model, range, &r);
 	fprintf(f, "  \"tiles\" : [\n");
-	for (x = 0; x < model->x_width; x++) {
-		if (x) fprintf(f, ",\n\n");
+	first_tile = 1;
+	for (x = r.x_beg; x <= r.x_end; x++) {
 		first_line = 1;
-		for (y = 0; y < model->y_height; y++) {
+		for (y = r.y_beg; y <= r.y_end; y++) {
 			tile = &model->tiles[y*model->x_width + x];
 
 			if (tile->type != NA) {
 				fprintf(f, "%s    { \"y\" : %i, \"x\" : %i, \"name\" : \"%s\" }",
-					first_line ? "" : ",\n", y, x,
-					fpga_tiletype_str(tile->type));
+					!first_line ? ",\n" : first_tile ? "" : ",\n\n",
+					y, x, fpga_tiletype_str(tile->type));
 				first_line = 0;
+				first_tile = 0;
 			}
 			if (tile->flags) {
 				int tf = tile->flags, first_flag = 1;
 				
 				fprintf(f, "%s    { \"y\" : %i, \"x\" : %i, \"flags\" : [ ",
-					first_line ? "" : ",\n", y, x);
+					!first_line ? ",\n" : first_tile ? "" : ",\n\n",
+					y, x);
 				first_line = 0;
+				first_tile = 0;
 
 				PRINT_FLAG(f, TF_FABRIC_ROUTING_COL, first_flag);
 				PRINT_FLAG(f, TF_FABRIC_LOGIC_XM_COL, first_flag);
@@ -92,17 +218,17 @@ int printf_IOB(FILE *f, struct fpga_model *model,
 			tile->devs[dev_i].subtype == IOBM ? "M" : "S");
 		first_line = 0;
 	}
-	if (tile->devs[dev_i].u.iob.istandard[0]) {
+	if (tile->devs[dev_i].u->iob.istandard[0]) {
 		fprintf(f, "%s%s\"istd\" : \"%s\" }", first_line ? "" : ",\n", pref,
-			tile->devs[dev_i].u.iob.istandard);
+			tile->devs[dev_i].u->iob.istandard);
 		first_line = 0;
 	}
-	if (tile->devs[dev_i].u.iob.ostandard[0]) {
+	if (tile->devs[dev_i].u->iob.ostandard[0]) {
 		fprintf(f, "%s%s\"ostd\" : \"%s\" }", first_line ? "" : ",\n", pref,
-			tile->devs[dev_i].u.iob.ostandard);
+			tile->devs[dev_i].u->iob.ostandard);
 		first_line = 0;
 	}
-	switch (tile->devs[dev_i].u.iob.bypass_mux) {
+	switch (tile->devs[dev_i].u->iob.bypass_mux) {
 		case BYPASS_MUX_I:
 			fprintf(f, "%s%s\"bypass_mux\" : \"I\" }", first_line ? "" : ",\n", pref);
 			first_line = 0;
@@ -117,7 +243,7 @@ int printf_IOB(FILE *f, struct fpga_model *model,
 			break;
 		case 0: break; default: RC_FAIL(model, EINVAL);
 	}
-	switch (tile->devs[dev_i].u.iob.I_mux) {
+	switch (tile->devs[dev_i].u->iob.I_mux) {
 		case IMUX_I_B:
 			fprintf(f, "%s%s\"imux\" : \"I_B\" }", first_line ? "" : ",\n", pref);
 			first_line = 0;
@@ -128,12 +254,12 @@ int printf_IOB(FILE *f, struct fpga_model *model,
 			break;
 		case 0: break; default: RC_FAIL(model, EINVAL);
 	}
-	if (tile->devs[dev_i].u.iob.drive_strength) {
+	if (tile->devs[dev_i].u->iob.drive_strength) {
 		fprintf(f, "%s%s\"strength\" : %i }", first_line ? "" : ",\n", pref,
-			tile->devs[dev_i].u.iob.drive_strength);
+			tile->devs[dev_i].u->iob.drive_strength);
 		first_line = 0;
 	}
-	switch (tile->devs[dev_i].u.iob.slew) {
+	switch (tile->devs[dev_i].u->iob.slew) {
 		case SLEW_SLOW:
 			fprintf(f, "%s%s\"slew\" : \"SLOW\" }", first_line ? "" : ",\n", pref);
 			first_line = 0;
@@ -148,11 +274,11 @@ int printf_IOB(FILE *f, struct fpga_model *model,
 			break;
 		case 0: break; default: RC_FAIL(model, EINVAL);
 	}
-	if (tile->devs[dev_i].u.iob.O_used) {
+	if (tile->devs[dev_i].u->iob.O_used) {
 		fprintf(f, "%s%s\"O_used\" : true }", first_line ? "" : ",\n", pref);
 		first_line = 0;
 	}
-	switch (tile->devs[dev_i].u.iob.suspend) {
+	switch (tile->devs[dev_i].u->iob.suspend) {
 		case SUSP_LAST_VAL:
 			fprintf(f, "%s%s\"suspend\" : \"DRIVE_LAST_VALUE\" }", first_line ? "" : ",\n", pref);
 			first_line = 0;
@@ -179,7 +305,7 @@ int printf_IOB(FILE *f, struct fpga_model *model,
 			break;
 		case 0: break; default: RC_FAIL(model, EINVAL);
 	}
-	switch (tile->devs[dev_i].u.iob.in_term) {
+	switch (tile->devs[dev_i].u->iob.in_term) {
 		case ITERM_NONE: 
 			fprintf(f, "%s%s\"in_term\" : \"NONE\" }", first_line ? "" : ",\n", pref);
 			first_line = 0;
@@ -198,7 +324,7 @@ int printf_IOB(FILE *f, struct fpga_model *model,
 			break;
 		case 0: break; default: RC_FAIL(model, EINVAL);
 	}
-	switch (tile->devs[dev_i].u.iob.out_term) {
+	switch (tile->devs[dev_i].u->iob.out_term) {
 		case OTERM_NONE: 
 			fprintf(f, "%s%s\"out_term\" : \"NONE\" }", first_line ? "" : ",\n", pref);
 			first_line = 0;
@@ -223,9 +349,11 @@ int printf_IOB(FILE *f, struct fpga_model *model,
 static int read_IOB_attr(struct fpga_model *model, struct fpga_device *dev,
 	const char *w1, int w1_len, const char *w2, int w2_len)
 {
+	if (!fdev_cfg(model, dev)) { HERE(); return 0; }
+
 	// First the one-word attributes.
 	if (!str_cmp(w1, w1_len, "O_used", ZTERM)) {
-		dev->u.iob.O_used = 1;
+		dev->u->iob.O_used = 1;
 		goto inst_1;
 	}
 	// The remaining attributes all require 2 words.
@@ -233,84 +361,84 @@ static int read_IOB_attr(struct fpga_model *model, struct fpga_device *dev,
 	if (!str_cmp(w1, w1_len, "type", ZTERM))
 		return 2; // no reason for instantiation
 	if (!str_cmp(w1, w1_len, "istd", ZTERM)) {
-		memcpy(dev->u.iob.istandard, w2, w2_len);
-		dev->u.iob.istandard[w2_len] = 0;
+		memcpy(dev->u->iob.istandard, w2, w2_len);
+		dev->u->iob.istandard[w2_len] = 0;
 		goto inst_2;
 	}
 	if (!str_cmp(w1, w1_len, "ostd", ZTERM)) {
-		memcpy(dev->u.iob.ostandard, w2, w2_len);
-		dev->u.iob.ostandard[w2_len] = 0;
+		memcpy(dev->u->iob.ostandard, w2, w2_len);
+		dev->u->iob.ostandard[w2_len] = 0;
 		goto inst_2;
 	}
 	if (!str_cmp(w1, w1_len, "bypass_mux", ZTERM)) {
 		if (!str_cmp(w2, w2_len, "I", ZTERM))
-			dev->u.iob.bypass_mux = BYPASS_MUX_I;
+			dev->u->iob.bypass_mux = BYPASS_MUX_I;
 		else if (!str_cmp(w2, w2_len, "O", ZTERM))
-			dev->u.iob.bypass_mux = BYPASS_MUX_O;
+			dev->u->iob.bypass_mux = BYPASS_MUX_O;
 		else if (!str_cmp(w2, w2_len, "T", ZTERM))
-			dev->u.iob.bypass_mux = BYPASS_MUX_T;
+			dev->u->iob.bypass_mux = BYPASS_MUX_T;
 		else return 0;
 		goto inst_2;
 	}
 	if (!str_cmp(w1, w1_len, "imux", ZTERM)) {
 		if (!str_cmp(w2, w2_len, "I_B", ZTERM))
-			dev->u.iob.I_mux = IMUX_I_B;
+			dev->u->iob.I_mux = IMUX_I_B;
 		else if (!str_cmp(w2, w2_len, "I", ZTERM))
-			dev->u.iob.I_mux = IMUX_I;
+			dev->u->iob.I_mux = IMUX_I;
 		else return 0;
 		goto inst_2;
 	}
 	if (!str_cmp(w1, w1_len, "strength", ZTERM)) {
-		dev->u.iob.drive_strength = to_i(w2, w2_len);
+		dev->u->iob.drive_strength = to_i(w2, w2_len);
 		goto inst_2;
 	}
 	if (!str_cmp(w1, w1_len, "slew", ZTERM)) {
 		if (!str_cmp(w2, w2_len, "SLOW", ZTERM))
-			dev->u.iob.slew = SLEW_SLOW;
+			dev->u->iob.slew = SLEW_SLOW;
 		else if (!str_cmp(w2, w2_len, "FAST", ZTERM))
-			dev->u.iob.slew = SLEW_FAST;
+			dev->u->iob.slew = SLEW_FAST;
 		else if (!str_cmp(w2, w2_len, "QUIETIO", ZTERM))
-			dev->u.iob.slew = SLEW_QUIETIO;
+			dev->u->iob.slew = SLEW_QUIETIO;
 		else return 0;
 		goto inst_2;
 	}
 	if (!str_cmp(w1, w1_len, "suspend", 7)) {
 		if (!str_cmp(w2, w2_len, "DRIVE_LAST_VALUE", ZTERM))
-			dev->u.iob.suspend = SUSP_LAST_VAL;
+			dev->u->iob.suspend = SUSP_LAST_VAL;
 		else if (!str_cmp(w2, w2_len, "3STATE", ZTERM))
-			dev->u.iob.suspend = SUSP_3STATE;
+			dev->u->iob.suspend = SUSP_3STATE;
 		else if (!str_cmp(w2, w2_len, "3STATE_PULLUP", ZTERM))
-			dev->u.iob.suspend = SUSP_3STATE_PULLUP;
+			dev->u->iob.suspend = SUSP_3STATE_PULLUP;
 		else if (!str_cmp(w2, w2_len, "3STATE_PULLDOWN", ZTERM))
-			dev->u.iob.suspend = SUSP_3STATE_PULLDOWN;
+			dev->u->iob.suspend = SUSP_3STATE_PULLDOWN;
 		else if (!str_cmp(w2, w2_len, "3STATE_KEEPER", ZTERM))
-			dev->u.iob.suspend = SUSP_3STATE_KEEPER;
+			dev->u->iob.suspend = SUSP_3STATE_KEEPER;
 		else if (!str_cmp(w2, w2_len, "3STATE_OCT_ON", ZTERM))
-			dev->u.iob.suspend = SUSP_3STATE_OCT_ON;
+			dev->u->iob.suspend = SUSP_3STATE_OCT_ON;
 		else return 0;
 		goto inst_2;
 	}
 	if (!str_cmp(w1, w1_len, "in_term", ZTERM)) {
 		if (!str_cmp(w2, w2_len, "NONE", ZTERM))
-			dev->u.iob.in_term = ITERM_NONE;
+			dev->u->iob.in_term = ITERM_NONE;
 		else if (!str_cmp(w2, w2_len, "UNTUNED_SPLIT_25", ZTERM))
-			dev->u.iob.in_term = ITERM_UNTUNED_25;
+			dev->u->iob.in_term = ITERM_UNTUNED_25;
 		else if (!str_cmp(w2, w2_len, "UNTUNED_SPLIT_50", ZTERM))
-			dev->u.iob.in_term = ITERM_UNTUNED_50;
+			dev->u->iob.in_term = ITERM_UNTUNED_50;
 		else if (!str_cmp(w2, w2_len, "UNTUNED_SPLIT_75", ZTERM))
-			dev->u.iob.in_term = ITERM_UNTUNED_75;
+			dev->u->iob.in_term = ITERM_UNTUNED_75;
 		else return 0;
 		goto inst_2;
 	}
 	if (!str_cmp(w1, w1_len, "out_term", ZTERM)) {
 		if (!str_cmp(w2, w2_len, "NONE", ZTERM))
-			dev->u.iob.out_term = OTERM_NONE;
+			dev->u->iob.out_term = OTERM_NONE;
 		else if (!str_cmp(w2, w2_len, "UNTUNED_25", ZTERM))
-			dev->u.iob.out_term = OTERM_UNTUNED_25;
+			dev->u->iob.out_term = OTERM_UNTUNED_25;
 		else if (!str_cmp(w2, w2_len, "UNTUNED_50", ZTERM))
-			dev->u.iob.out_term = OTERM_UNTUNED_50;
+			dev->u->iob.out_term = OTERM_UNTUNED_50;
 		else if (!str_cmp(w2, w2_len, "UNTUNED_75", ZTERM))
-			dev->u.iob.out_term = OTERM_UNTUNED_75;
+			dev->u->iob.out_term = OTERM_UNTUNED_75;
 		else return 0;
 		goto inst_2;
 	}
@@ -358,7 +486,7 @@ int printf_LOGIC(FILE* f, struct fpga_model* model,
 		}
 	}
 
-	cfg = &tile->devs[dev_i].u.logic;
+	cfg = &tile->devs[dev_i].u->logic;
 	for (j = LUT_D; j >= LUT_A; j--) {
 		int print_hex_vals =
 			cfg->a2d[j].ram_mode || cfg->a2d[j].flags & LUTMODE_ROM;
@@ -655,34 +783,34 @@ static int read_LOGIC_attr(struct fpga_model* model, int y, int x, int type_idx,
 	int i, j, rc;
 
 	dev = fdev_p(model, y, x, DEV_LOGIC, type_idx);
-	if (!dev) { HERE(); return 0; }
+	if (!dev || !fdev_cfg(model, dev)) { HERE(); return 0; }
 
 	// First the one-word attributes.
 	for (i = LUT_A; i <= LUT_D; i++) {
 		snprintf(cmp_str, sizeof(cmp_str), "%c_used", 'A'+i);
 		if (!str_cmp(w1, w1_len, cmp_str, ZTERM)) {
-			dev->u.logic.a2d[i].flags |= OUT_USED;
+			dev->u->logic.a2d[i].flags |= OUT_USED;
 			goto inst_1;
 		}
 	}
 	if (!str_cmp(w1, w1_len, "ce_used", ZTERM)) {
-		dev->u.logic.ce_used = 1;
+		dev->u->logic.ce_used = 1;
 		goto inst_1;
 	}
 	if (!str_cmp(w1, w1_len, "sr_used", ZTERM)) {
-		dev->u.logic.sr_used = 1;
+		dev->u->logic.sr_used = 1;
 		goto inst_1;
 	}
 	if (!str_cmp(w1, w1_len, "cout_used", ZTERM)) {
-		dev->u.logic.cout_used = 1;
+		dev->u->logic.cout_used = 1;
 		goto inst_1;
 	}
 	if (!str_cmp(w1, w1_len, "wa7_used", ZTERM)) {
-		dev->u.logic.wa7_used = 1;
+		dev->u->logic.wa7_used = 1;
 		goto inst_1;
 	}
 	if (!str_cmp(w1, w1_len, "wa8_used", ZTERM)) {
-		dev->u.logic.wa8_used = 1;
+		dev->u->logic.wa8_used = 1;
 		goto inst_1;
 	}
 
@@ -697,16 +825,16 @@ static int read_LOGIC_attr(struct fpga_model* model, int y, int x, int type_idx,
 		if (!str_cmp(w1, w1_len, cmp_str, ZTERM)) {
 			rc = bool_str2bits(w2, w2_len, &val, 64);
 			if (rc) { HERE(); return 0; }
-			dev->u.logic.a2d[i].lut6_val = val;
-			dev->u.logic.a2d[i].flags |= LUT6VAL_SET;
+			dev->u->logic.a2d[i].lut6_val = val;
+			dev->u->logic.a2d[i].flags |= LUT6VAL_SET;
 			goto inst_2;
 		}
 		snprintf(cmp_str, sizeof(cmp_str), "%c5_lut_str", 'A'+i);
 		if (!str_cmp(w1, w1_len, cmp_str, ZTERM)) {
 			rc = bool_str2bits(w2, w2_len, &val, 32);
 			if (rc) { HERE(); return 0; }
-			dev->u.logic.a2d[i].lut5_val = val;
-			dev->u.logic.a2d[i].flags |= LUT5VAL_SET;
+			dev->u->logic.a2d[i].lut5_val = val;
+			dev->u->logic.a2d[i].flags |= LUT5VAL_SET;
 			goto inst_2;
 		}
 		snprintf(cmp_str, sizeof(cmp_str), "%c6_lut_val", 'A'+i);
@@ -725,10 +853,10 @@ static int read_LOGIC_attr(struct fpga_model* model, int y, int x, int type_idx,
 					__FILE__, __LINE__, errno, endptr);
 				return 0;
 			}
-			dev->u.logic.a2d[i].lut6_val = val;
-			dev->u.logic.a2d[i].flags |= LUT6VAL_SET;
-			if (!dev->u.logic.a2d[i].ram_mode)
-				dev->u.logic.a2d[i].flags |= LUTMODE_ROM;
+			dev->u->logic.a2d[i].lut6_val = val;
+			dev->u->logic.a2d[i].flags |= LUT6VAL_SET;
+			if (!dev->u->logic.a2d[i].ram_mode)
+				dev->u->logic.a2d[i].flags |= LUTMODE_ROM;
 			goto inst_2;
 		}
 		snprintf(cmp_str, sizeof(cmp_str), "%c5_lut_val", 'A'+i);
@@ -747,158 +875,158 @@ static int read_LOGIC_attr(struct fpga_model* model, int y, int x, int type_idx,
 					__FILE__, __LINE__, errno, endptr);
 				return 0;
 			}
-			dev->u.logic.a2d[i].lut5_val = val;
-			dev->u.logic.a2d[i].flags |= LUT5VAL_SET;
-			if (!dev->u.logic.a2d[i].ram_mode)
-				dev->u.logic.a2d[i].flags |= LUTMODE_ROM;
+			dev->u->logic.a2d[i].lut5_val = val;
+			dev->u->logic.a2d[i].flags |= LUT5VAL_SET;
+			if (!dev->u->logic.a2d[i].ram_mode)
+				dev->u->logic.a2d[i].flags |= LUTMODE_ROM;
 			goto inst_2;
 		}
 		snprintf(cmp_str, sizeof(cmp_str), "%c_ffmux", 'A'+i);
 		if (!str_cmp(w1, w1_len, cmp_str, ZTERM)) {
 			if (!str_cmp(w2, w2_len, "O6", ZTERM))
-				dev->u.logic.a2d[i].ff_mux = MUX_O6;
+				dev->u->logic.a2d[i].ff_mux = MUX_O6;
 			else if (!str_cmp(w2, w2_len, "O5", ZTERM))
-				dev->u.logic.a2d[i].ff_mux = MUX_O5;
+				dev->u->logic.a2d[i].ff_mux = MUX_O5;
 			else if (!str_cmp(w2, w2_len, "X", ZTERM))
-				dev->u.logic.a2d[i].ff_mux = MUX_X;
+				dev->u->logic.a2d[i].ff_mux = MUX_X;
 			else if (!str_cmp(w2, w2_len, "CY", ZTERM))
-				dev->u.logic.a2d[i].ff_mux = MUX_CY;
+				dev->u->logic.a2d[i].ff_mux = MUX_CY;
 			else if (!str_cmp(w2, w2_len, "XOR", ZTERM))
-				dev->u.logic.a2d[i].ff_mux = MUX_XOR;
+				dev->u->logic.a2d[i].ff_mux = MUX_XOR;
 			else if (!str_cmp(w2, w2_len, "F7", ZTERM))
-				dev->u.logic.a2d[i].ff_mux = MUX_F7;
+				dev->u->logic.a2d[i].ff_mux = MUX_F7;
 			else if (!str_cmp(w2, w2_len, "F8", ZTERM))
-				dev->u.logic.a2d[i].ff_mux = MUX_F8;
+				dev->u->logic.a2d[i].ff_mux = MUX_F8;
 			else if (!str_cmp(w2, w2_len, "MC31", ZTERM))
-				dev->u.logic.a2d[i].ff_mux = MUX_MC31;
+				dev->u->logic.a2d[i].ff_mux = MUX_MC31;
 			else return 0;
 			goto inst_2;
 		}
 		snprintf(cmp_str, sizeof(cmp_str), "%c_ffsrinit", 'A'+i);
 		if (!str_cmp(w1, w1_len, cmp_str, ZTERM)) {
 			if (!str_cmp(w2, w2_len, "0", ZTERM))
-				dev->u.logic.a2d[i].ff_srinit = FF_SRINIT0;
+				dev->u->logic.a2d[i].ff_srinit = FF_SRINIT0;
 			else if (!str_cmp(w2, w2_len, "1", ZTERM))
-				dev->u.logic.a2d[i].ff_srinit = FF_SRINIT1;
+				dev->u->logic.a2d[i].ff_srinit = FF_SRINIT1;
 			else return 0;
 			goto inst_2;
 		}
 		snprintf(cmp_str, sizeof(cmp_str), "%c5_ffsrinit", 'A'+i);
 		if (!str_cmp(w1, w1_len, cmp_str, ZTERM)) {
 			if (!str_cmp(w2, w2_len, "0", ZTERM))
-				dev->u.logic.a2d[i].ff5_srinit = FF_SRINIT0;
+				dev->u->logic.a2d[i].ff5_srinit = FF_SRINIT0;
 			else if (!str_cmp(w2, w2_len, "1", ZTERM))
-				dev->u.logic.a2d[i].ff5_srinit = FF_SRINIT1;
+				dev->u->logic.a2d[i].ff5_srinit = FF_SRINIT1;
 			else return 0;
 			goto inst_2;
 		}
 		snprintf(cmp_str, sizeof(cmp_str), "%c_outmux", 'A'+i);
 		if (!str_cmp(w1, w1_len, cmp_str, ZTERM)) {
 			if (!str_cmp(w2, w2_len, "O6", ZTERM))
-				dev->u.logic.a2d[i].out_mux = MUX_O6;
+				dev->u->logic.a2d[i].out_mux = MUX_O6;
 			else if (!str_cmp(w2, w2_len, "O5", ZTERM))
-				dev->u.logic.a2d[i].out_mux = MUX_O5;
+				dev->u->logic.a2d[i].out_mux = MUX_O5;
 			else if (!str_cmp(w2, w2_len, "5Q", ZTERM))
-				dev->u.logic.a2d[i].out_mux = MUX_5Q;
+				dev->u->logic.a2d[i].out_mux = MUX_5Q;
 			else if (!str_cmp(w2, w2_len, "CY", ZTERM))
-				dev->u.logic.a2d[i].out_mux = MUX_CY;
+				dev->u->logic.a2d[i].out_mux = MUX_CY;
 			else if (!str_cmp(w2, w2_len, "XOR", ZTERM))
-				dev->u.logic.a2d[i].out_mux = MUX_XOR;
+				dev->u->logic.a2d[i].out_mux = MUX_XOR;
 			else if (!str_cmp(w2, w2_len, "F7", ZTERM))
-				dev->u.logic.a2d[i].out_mux = MUX_F7;
+				dev->u->logic.a2d[i].out_mux = MUX_F7;
 			else if (!str_cmp(w2, w2_len, "F8", ZTERM))
-				dev->u.logic.a2d[i].out_mux = MUX_F8;
+				dev->u->logic.a2d[i].out_mux = MUX_F8;
 			else if (!str_cmp(w2, w2_len, "MC31", ZTERM))
-				dev->u.logic.a2d[i].out_mux = MUX_MC31;
+				dev->u->logic.a2d[i].out_mux = MUX_MC31;
 			else return 0;
 			goto inst_2;
 		}
 		snprintf(cmp_str, sizeof(cmp_str), "%c_ff", 'A'+i);
 		if (!str_cmp(w1, w1_len, cmp_str, ZTERM)) {
 			if (!str_cmp(w2, w2_len, "OR2L", ZTERM))
-				dev->u.logic.a2d[i].ff = FF_OR2L;
+				dev->u->logic.a2d[i].ff = FF_OR2L;
 			else if (!str_cmp(w2, w2_len, "AND2L", ZTERM))
-				dev->u.logic.a2d[i].ff = FF_AND2L;
+				dev->u->logic.a2d[i].ff = FF_AND2L;
 			else if (!str_cmp(w2, w2_len, "LATCH", ZTERM))
-				dev->u.logic.a2d[i].ff = FF_LATCH;
+				dev->u->logic.a2d[i].ff = FF_LATCH;
 			else if (!str_cmp(w2, w2_len, "FF", ZTERM))
-				dev->u.logic.a2d[i].ff = FF_FF;
+				dev->u->logic.a2d[i].ff = FF_FF;
 			else return 0;
 			goto inst_2;
 		}
 		snprintf(cmp_str, sizeof(cmp_str), "%c_cy0", 'A'+i);
 		if (!str_cmp(w1, w1_len, cmp_str, ZTERM)) {
 			if (!str_cmp(w2, w2_len, "X", ZTERM))
-				dev->u.logic.a2d[i].cy0 = CY0_X;
+				dev->u->logic.a2d[i].cy0 = CY0_X;
 			else if (!str_cmp(w2, w2_len, "O5", ZTERM))
-				dev->u.logic.a2d[i].cy0 = CY0_O5;
+				dev->u->logic.a2d[i].cy0 = CY0_O5;
 			else return 0;
 			goto inst_2;
 		}
 		snprintf(cmp_str, sizeof(cmp_str), "%c_ram_mode", 'A'+i);
 		if (!str_cmp(w1, w1_len, cmp_str, ZTERM)) {
 			if (!str_cmp(w2, w2_len, "DPRAM64", ZTERM))
-				dev->u.logic.a2d[i].ram_mode = DPRAM64;
+				dev->u->logic.a2d[i].ram_mode = DPRAM64;
 			else if (!str_cmp(w2, w2_len, "DPRAM32", ZTERM))
-				dev->u.logic.a2d[i].ram_mode = DPRAM32;
+				dev->u->logic.a2d[i].ram_mode = DPRAM32;
 			else if (!str_cmp(w2, w2_len, "SPRAM64", ZTERM))
-				dev->u.logic.a2d[i].ram_mode = SPRAM64;
+				dev->u->logic.a2d[i].ram_mode = SPRAM64;
 			else if (!str_cmp(w2, w2_len, "SPRAM32", ZTERM))
-				dev->u.logic.a2d[i].ram_mode = SPRAM32;
+				dev->u->logic.a2d[i].ram_mode = SPRAM32;
 			else if (!str_cmp(w2, w2_len, "SRL32", ZTERM))
-				dev->u.logic.a2d[i].ram_mode = SRL32;
+				dev->u->logic.a2d[i].ram_mode = SRL32;
 			else if (!str_cmp(w2, w2_len, "SRL16", ZTERM))
-				dev->u.logic.a2d[i].ram_mode = SRL16;
+				dev->u->logic.a2d[i].ram_mode = SRL16;
 			else return 0;
-			if (dev->u.logic.a2d[i].flags & LUTMODE_ROM)
-				dev->u.logic.a2d[i].flags &= ~LUTMODE_ROM;
+			if (dev->u->logic.a2d[i].flags & LUTMODE_ROM)
+				dev->u->logic.a2d[i].flags &= ~LUTMODE_ROM;
 			goto inst_2;
 		}
 		snprintf(cmp_str, sizeof(cmp_str), "%c_di_mux", 'A'+i);
 		if (!str_cmp(w1, w1_len, cmp_str, ZTERM)) {
 			if (!str_cmp(w2, w2_len, "MC31", ZTERM))
-				dev->u.logic.a2d[i].di_mux = DIMUX_MC31;
+				dev->u->logic.a2d[i].di_mux = DIMUX_MC31;
 			else if (!str_cmp(w2, w2_len, "X", ZTERM))
-				dev->u.logic.a2d[i].di_mux = DIMUX_X;
+				dev->u->logic.a2d[i].di_mux = DIMUX_X;
 			else if (!str_cmp(w2, w2_len, "DX", ZTERM))
-				dev->u.logic.a2d[i].di_mux = DIMUX_DX;
+				dev->u->logic.a2d[i].di_mux = DIMUX_DX;
 			else if (!str_cmp(w2, w2_len, "BDI1", ZTERM))
-				dev->u.logic.a2d[i].di_mux = DIMUX_BDI1;
+				dev->u->logic.a2d[i].di_mux = DIMUX_BDI1;
 			else return 0;
 			goto inst_2;
 		}
 	}
 	if (!str_cmp(w1, w1_len, "clk", ZTERM)) {
 		if (!str_cmp(w2, w2_len, "CLK_B", ZTERM))
-			dev->u.logic.clk_inv = CLKINV_B;
+			dev->u->logic.clk_inv = CLKINV_B;
 		else if (!str_cmp(w2, w2_len, "CLK", ZTERM))
-			dev->u.logic.clk_inv = CLKINV_CLK;
+			dev->u->logic.clk_inv = CLKINV_CLK;
 		else return 0;
 		goto inst_2;
 	}
 	if (!str_cmp(w1, w1_len, "sync", ZTERM)) {
 		if (!str_cmp(w2, w2_len, "SYNC", ZTERM))
-			dev->u.logic.sync_attr = SYNCATTR_SYNC;
+			dev->u->logic.sync_attr = SYNCATTR_SYNC;
 		else if (!str_cmp(w2, w2_len, "ASYNC", ZTERM))
-			dev->u.logic.sync_attr = SYNCATTR_ASYNC;
+			dev->u->logic.sync_attr = SYNCATTR_ASYNC;
 		else return 0;
 		goto inst_2;
 	}
 	if (!str_cmp(w1, w1_len, "wemux", ZTERM)) {
 		if (!str_cmp(w2, w2_len, "WE", ZTERM))
-			dev->u.logic.we_mux = WEMUX_WE;
+			dev->u->logic.we_mux = WEMUX_WE;
 		else if (!str_cmp(w2, w2_len, "CE", ZTERM))
-			dev->u.logic.we_mux = WEMUX_CE;
+			dev->u->logic.we_mux = WEMUX_CE;
 		else return 0;
 		goto inst_2;
 	}
 	if (!str_cmp(w1, w1_len, "precyinit", ZTERM)) {
 		if (!str_cmp(w2, w2_len, "0", ZTERM))
-			dev->u.logic.precyinit = PRECYINIT_0;
+			dev->u->logic.precyinit = PRECYINIT_0;
 		else if (!str_cmp(w2, w2_len, "1", ZTERM))
-			dev->u.logic.precyinit = PRECYINIT_1;
+			dev->u->logic.precyinit = PRECYINIT_1;
 		else if (!str_cmp(w2, w2_len, "AX", ZTERM))
-			dev->u.logic.precyinit = PRECYINIT_AX;
+			dev->u->logic.precyinit = PRECYINIT_AX;
 		else return 0;
 		goto inst_2;
 	}
@@ -931,7 +1059,7 @@ int printf_BUFGMUX(FILE *f, struct fpga_model *model,
 		fprintf(f, "%s }", pref);
 		first_line = 0;
 	}
-	cfg = &tile->devs[dev_i].u.bufgmux;
+	cfg = &tile->devs[dev_i].u->bufgmux;
 	switch (cfg->clk) {
 		case BUFG_CLK_ASYNC:
 			fprintf(f, "%s%s, \"clk\" : \"ASYNC\" }", first_line ? "" : ",\n", pref);
@@ -973,27 +1101,28 @@ static int read_BUFGMUX_attr(struct fpga_model *model, struct fpga_device *dev,
 {
 	// BUFGMUX only has 2-word attributes
 	if (w2_len < 1) return 0;
+	if (!fdev_cfg(model, dev)) { HERE(); return 0; }
 	if (!str_cmp(w1, w1_len, "clk", ZTERM)) {
 		if (!str_cmp(w2, w2_len, "ASYNC", ZTERM))
-			dev->u.bufgmux.clk = BUFG_CLK_ASYNC;
+			dev->u->bufgmux.clk = BUFG_CLK_ASYNC;
 		else if (!str_cmp(w2, w2_len, "SYNC", ZTERM))
-			dev->u.bufgmux.clk = BUFG_CLK_SYNC;
+			dev->u->bufgmux.clk = BUFG_CLK_SYNC;
 		else return 0;
 		goto inst;
 	}
 	if (!str_cmp(w1, w1_len, "disable_attr", ZTERM)) {
 		if (!str_cmp(w2, w2_len, "LOW", ZTERM))
-			dev->u.bufgmux.disable_attr = BUFG_DISATTR_LOW;
+			dev->u->bufgmux.disable_attr = BUFG_DISATTR_LOW;
 		else if (!str_cmp(w2, w2_len, "HIGH", ZTERM))
-			dev->u.bufgmux.disable_attr = BUFG_DISATTR_HIGH;
+			dev->u->bufgmux.disable_attr = BUFG_DISATTR_HIGH;
 		else return 0;
 		goto inst;
 	}
 	if (!str_cmp(w1, w1_len, "s_inv", ZTERM)) {
 		if (!str_cmp(w2, w2_len, "NO", ZTERM))
-			dev->u.bufgmux.s_inv = BUFG_SINV_N;
+			dev->u->bufgmux.s_inv = BUFG_SINV_N;
 		else if (!str_cmp(w2, w2_len, "YES", ZTERM))
-			dev->u.bufgmux.s_inv = BUFG_SINV_Y;
+			dev->u->bufgmux.s_inv = BUFG_SINV_Y;
 		else return 0;
 		goto inst;
 	}
@@ -1023,7 +1152,7 @@ int printf_BUFIO(FILE *f, struct fpga_model *model,
 		fprintf(f, "%s }", pref);
 		first_line = 0;
 	}
-	cfg = &tile->devs[dev_i].u.bufio;
+	cfg = &tile->devs[dev_i].u->bufio;
 	if (cfg->divide) {
 		fprintf(f, "%s%s, \"divide\" : %i\n", first_line ? "" : ",\n", pref, cfg->divide);
 		first_line = 0;
@@ -1058,23 +1187,24 @@ static int read_BUFIO_attr(struct fpga_model *model, struct fpga_device *dev,
 {
 	// BUFIO only has 2-word attributes
 	if (w2_len < 1) return 0;
+	if (!fdev_cfg(model, dev)) { HERE(); return 0; }
 	if (!str_cmp(w1, w1_len, "divide", ZTERM)) {
-		dev->u.bufio.divide = to_i(w2, w2_len);
+		dev->u->bufio.divide = to_i(w2, w2_len);
 		goto inst;
 	}
 	if (!str_cmp(w1, w1_len, "divide_bypass", ZTERM)) {
 		if (!str_cmp(w2, w2_len, "NO", ZTERM))
-			dev->u.bufio.divide_bypass = BUFIO_DIVIDEBP_N;
+			dev->u->bufio.divide_bypass = BUFIO_DIVIDEBP_N;
 		else if (!str_cmp(w2, w2_len, "YES", ZTERM))
-			dev->u.bufio.divide_bypass = BUFIO_DIVIDEBP_Y;
+			dev->u->bufio.divide_bypass = BUFIO_DIVIDEBP_Y;
 		else return 0;
 		goto inst;
 	}
 	if (!str_cmp(w1, w1_len, "i_inv", ZTERM)) {
 		if (!str_cmp(w2, w2_len, "NO", ZTERM))
-			dev->u.bufio.i_inv = BUFIO_IINV_N;
+			dev->u->bufio.i_inv = BUFIO_IINV_N;
 		else if (!str_cmp(w2, w2_len, "YES", ZTERM))
-			dev->u.bufio.i_inv = BUFIO_IINV_Y;
+			dev->u->bufio.i_inv = BUFIO_IINV_Y;
 		else return 0;
 		goto inst;
 	}
@@ -1104,7 +1234,7 @@ int printf_BSCAN(FILE *f, struct fpga_model *model,
 		fprintf(f, "%s }", pref);
 		first_line = 0;
 	}
-	cfg = &tile->devs[dev_i].u.bscan;
+	cfg = &tile->devs[dev_i].u->bscan;
 	if (cfg->jtag_chain) {
 		fprintf(f, "%s%s, \"jtag_chain\" : %i }", first_line ? "" : ",\n", pref, cfg->jtag_chain);
 		first_line = 0;
@@ -1128,15 +1258,16 @@ static int read_BSCAN_attr(struct fpga_model *model, struct fpga_device *dev,
 {
 	// BSCAN only has 2-word attributes
 	if (w2_len < 1) return 0;
+	if (!fdev_cfg(model, dev)) { HERE(); return 0; }
 	if (!str_cmp(w1, w1_len, "jtag_chain", ZTERM)) {
-		dev->u.bscan.jtag_chain = to_i(w2, w2_len);
+		dev->u->bscan.jtag_chain = to_i(w2, w2_len);
 		goto inst;
 	}
 	if (!str_cmp(w1, w1_len, "jtag_test", ZTERM)) {
 		if (!str_cmp(w2, w2_len, "NO", ZTERM))
-			dev->u.bscan.jtag_test = BSCAN_JTAG_TEST_N;
+			dev->u->bscan.jtag_test = BSCAN_JTAG_TEST_N;
 		else if (!str_cmp(w2, w2_len, "YES", ZTERM))
-			dev->u.bscan.jtag_test = BSCAN_JTAG_TEST_Y;
+			dev->u->bscan.jtag_test = BSCAN_JTAG_TEST_Y;
 		else return 0;
 		goto inst;
 	}
@@ -1147,15 +1278,23 @@ inst:
 }
 
 int printf_devices(FILE* f, struct fpga_model* model, int config_only, int no_json)
+{
+	return printf_devices_range(f, model, config_only, no_json, /*range*/ 0);
+}
+
+int printf_devices_range(FILE* f, struct fpga_model* model, int config_only,
+	int no_json, const struct fp_range* range)
 {
 	int x, y, i, first_dev;
 	struct fpga_tile* tile;
+	struct fp_range r;
 
 	RC_CHECK(model);
+	clip_range(model, range, &r);
 	if (!no_json) fprintf(f, "  \"devices\" : [\n");
 	first_dev = 1;
-	for (x = 0; x < model->x_width; x++) {
-		for (y = 0; y < model->y_height; y++) {
+	for (x = r.x_beg; x <= r.x_end; x++) {
+		for (y = r.y_beg; y <= r.y_end; y++) {
 			tile = YX_TILE(model, y, x);
 			for (i = 0; i < tile->num_devs; i++) {
 				if (config_only && !(tile->devs[i].instantiated))
@@ -1203,17 +1342,29 @@ int printf_devices(FILE* f, struct fpga_model* model, int config_only, int no_js
 }
 
 int printf_ports(FILE* f, struct fpga_model* model)
+{
+	return printf_ports_range(f, model, /*range*/ 0);
+}
+
+int printf_ports_range(FILE* f, struct fpga_model* model,
+	const struct fp_range* range)
 {
 	struct fpga_tile* tile;
+	struct out_buf ob;
+	struct fp_range r;
 	const char* conn_point_name_src;
 	int x, y, i, conn_point_dests_o, num_dests_for_this_conn_point;
-	int first_in_tile, first_tile;
+	int first_in_tile, first_tile, rc;
 
 	RC_CHECK(model);
-	fprintf(f, "  \"ports\" : [\n");
+	fpga_materialize_all(model);
+	RC_CHECK(model);
+	clip_range(model, range, &r);
+	if ((rc = ob_init(&ob, f))) RC_FAIL(model, rc);
+	ob_str(&ob, "  \"ports\" : [\n");
 	first_tile = 1;
-	for (x = 0; x < model->x_width; x++) {
-		for (y = 0; y < model->y_height; y++) {
+	for (x = r.x_beg; x <= r.x_end; x++) {
+		for (y = r.y_beg; y <= r.y_end; y++) {
 			tile = &model->tiles[y*model->x_width + x];
 
 			first_in_tile = 1;
@@ -1232,33 +1383,53 @@ int printf_ports(FILE* f, struct fpga_model* model)
 						tile->conn_point_names[i*2+1], x, y, i);
 					continue;
 				}
+				ob_line(&ob);
 				if (first_in_tile && !first_tile)
-					fprintf(f, ",\n\n");
-				fprintf(f, "%s    { \"y\" : %i, \"x\" : %i, \"name\" : \"%s\" }",
-					first_in_tile ? "" : ",\n", y, x, conn_point_name_src);
+					ob_str(&ob, ",\n\n");
+				else if (!first_in_tile)
+					ob_str(&ob, ",\n");
+				ob_str(&ob, "    { \"y\" : ");
+				ob_int(&ob, y);
+				ob_str(&ob, ", \"x\" : ");
+				ob_int(&ob, x);
+				ob_str(&ob, ", \"name\" : \"");
+				ob_str(&ob, conn_point_name_src);
+				ob_str(&ob, "\" }");
 				first_in_tile = 0;
 				first_tile = 0;
 			}
 		}
 	}
-	fprintf(f, "\n  ]");
+	ob_str(&ob, "\n  ]");
+	if ((rc = ob_free(&ob))) RC_FAIL(model, rc);
 	RC_RETURN(model);
 }
 
 int printf_conns(FILE* f, struct fpga_model* model)
+{
+	return printf_conns_range(f, model, /*range*/ 0);
+}
+
+int printf_conns_range(FILE* f, struct fpga_model* model,
+	const struct fp_range* range)
 {
 	struct fpga_tile* tile;
-	char tmp_line[512];
+	struct out_buf ob;
+	struct fp_range r;
 	const char* conn_point_name_src, *other_tile_connpt_str;
 	uint16_t other_tile_connpt_str_i;
-	int x, y, i, j, k, conn_point_dests_o, num_dests_for_this_conn_point;
-	int other_tile_x, other_tile_y, first_tile, first_in_tile;
+	int x, y, i, j, conn_point_dests_o, num_dests_for_this_conn_point;
+	int other_tile_x, other_tile_y, first_tile, first_in_tile, line_start, rc;
 
 	RC_CHECK(model);
-	fprintf(f, "  \"connections\" : [\n");
+	fpga_materialize_all(model);
+	RC_CHECK(model);
+	clip_range(model, range, &r);
+	if ((rc = ob_init(&ob, f))) RC_FAIL(model, rc);
+	ob_str(&ob, "  \"connections\" : [\n");
 	first_tile = 1;
-	for (x = 0; x < model->x_width; x++) {
-		for (y = 0; y < model->y_height; y++) {
+	for (x = r.x_beg; x <= r.x_end; x++) {
+		for (y = r.y_beg; y <= r.y_end; y++) {
 			tile = &model->tiles[y*model->x_width + x];
 
 			first_in_tile = 1;
@@ -1288,51 +1459,96 @@ int printf_conns(FILE* f, struct fpga_model* model)
 						continue;
 					}
 
+					ob_line(&ob);
 					if (first_in_tile && !first_tile)
-						fprintf(f, ",\n\n");
-					sprintf(tmp_line, "\"y1\" : %i, \"x1\" : %i, \"name1\" : \"%s\", ",
-						y, x, conn_point_name_src);
-					k = strlen(tmp_line);
-					while (k < 60)
-						tmp_line[k++] = ' ';
-					sprintf(&tmp_line[k], "\"y2\" : %i, \"x2\" : %i, \"name2\" : \"%s\"",
-						other_tile_y, other_tile_x, other_tile_connpt_str);
-					fprintf(f, "%s    { %s }",
-						first_in_tile ? "" : ",\n", tmp_line);
+						ob_str(&ob, ",\n\n");
+					else if (!first_in_tile)
+						ob_str(&ob, ",\n");
+					ob_str(&ob, "    { ");
+					// the second half starts at column 60
+					line_start = ob.len;
+					ob_str(&ob, "\"y1\" : ");
+					ob_int(&ob, y);
+					ob_str(&ob, ", \"x1\" : ");
+					ob_int(&ob, x);
+					ob_str(&ob, ", \"name1\" : \"");
+					ob_str(&ob, conn_point_name_src);
+					ob_str(&ob, "\", ");
+					ob_pad(&ob, line_start, 60);
+					ob_str(&ob, "\"y2\" : ");
+					ob_int(&ob, other_tile_y);
+					ob_str(&ob, ", \"x2\" : ");
+					ob_int(&ob, other_tile_x);
+					ob_str(&ob, ", \"name2\" : \"");
+					ob_str(&ob, other_tile_connpt_str);
+					ob_str(&ob, "\" }");
 					first_in_tile = 0;
 					first_tile = 0;
 				}
 			}
 		}
 	}
-	fprintf(f, "\n  ]");
+	ob_str(&ob, "\n  ]");
+	if ((rc = ob_free(&ob))) RC_FAIL(model, rc);
 	RC_RETURN(model);
 }
 
 int printf_switches(FILE *f, struct fpga_model *model)
+{
+	return printf_switches_range(f, model, /*range*/ 0);
+}
+
+int printf_switches_range(FILE *f, struct fpga_model *model,
+	const struct fp_range *range)
 {
 	struct fpga_tile *tile;
-	int x, y, i, first_in_tile, first_tile;
+	struct out_buf ob;
+	struct fp_range r;
+	const char *from_str, *to_str;
+	int x, y, i, first_in_tile, first_tile, rc;
 
 	RC_CHECK(model);
-	fprintf(f, "  \"switches\" : [\n");
+	fpga_materialize_all(model);
+	RC_CHECK(model);
+	clip_range(model, range, &r);
+	if ((rc = ob_init(&ob, f))) RC_FAIL(model, rc);
+	ob_str(&ob, "  \"switches\" : [\n");
 	first_tile = 1;
-	for (x = 0; x < model->x_width; x++) {
-		for (y = 0; y < model->y_height; y++) {
+	for (x = r.x_beg; x <= r.x_end; x++) {
+		for (y = r.y_beg; y <= r.y_end; y++) {
 			tile = YX_TILE(model, y, x);
 			first_in_tile = 1;
 			for (i = 0; i < tile->num_switches; i++) {
+				from_str = strarray_lookup(&model->str,
+					fpga_switch_str_i(model, y, x, i, SW_FROM));
+				to_str = strarray_lookup(&model->str,
+					fpga_switch_str_i(model, y, x, i, SW_TO));
+				if (!from_str || !to_str) {
+					HERE();
+					continue;
+				}
+				ob_line(&ob);
 				if (first_in_tile && !first_tile)
-					fprintf(f, ",\n\n");
-				fprintf(f, "%s    { \"y\" : %i, \"x\" : %i%s }",
-					first_in_tile ? "" : ",\n", y, x,
-					fpga_switch_print_json(model, y, x, i));
+					ob_str(&ob, ",\n\n");
+				else if (!first_in_tile)
+					ob_str(&ob, ",\n");
+				ob_str(&ob, "    { \"y\" : ");
+				ob_int(&ob, y);
+				ob_str(&ob, ", \"x\" : ");
+				ob_int(&ob, x);
+				ob_str(&ob, ", \"from\" : \"");
+				ob_str(&ob, from_str);
+				ob_str(&ob, "\", \"to\" : \"");
+				ob_str(&ob, to_str);
+				ob_str(&ob, fpga_switch_is_bidir(model, y, x, i)
+					? "\", \"bidir\" : true }" : "\" }");
 				first_in_tile = 0;
 				first_tile = 0;
 			}
 		}
 	}
-	fprintf(f, "\n  ]");
+	ob_str(&ob, "\n  ]");
+	if ((rc = ob_free(&ob))) RC_FAIL(model, rc);
 	RC_RETURN(model);
 }
 
@@ -1414,6 +1630,8 @@ static void read_net_line(struct fpga_model* model, const char* line, int start)
 
 		if (coord(line, el_type_end, &coord_end, &y_coord, &x_coord))
 			return;
+		if (fpga_materialize_tile(model, y_coord, x_coord))
+			{ HERE(); return; }
 
 		next_word(line, coord_end, &from_beg, &from_end);
 		next_word(line, from_end, &direction_beg, &direction_end);
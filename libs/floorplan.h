@@ -18,6 +18,25 @@ int printf_conns(FILE *f, struct fpga_model *model);
 int printf_switches(FILE *f, struct fpga_model *model);
 int printf_nets(FILE *f, struct fpga_model *model, int no_json);
 
+// Tile range for the _range variants of the printf functions,
+// inclusive. -1 as y_end or x_end means up to the last row or column.
+// A null range prints all tiles, same as the functions above.
+struct fp_range
+{
+	int y_beg, y_end, x_beg, x_end;
+};
+
+int printf_tiles_range(FILE *f, struct fpga_model *model,
+	const struct fp_range *range);
+int printf_devices_range(FILE *f, struct fpga_model *model, int config_only,
+	int no_json, const struct fp_range *range);
+int printf_ports_range(FILE *f, struct fpga_model *model,
+	const struct fp_range *range);
+int printf_conns_range(FILE *f, struct fpga_model *model,
+	const struct fp_range *range);
+int printf_switches_range(FILE *f, struct fpga_model *model,
+	const struct fp_range *range);
+
 int printf_IOB(FILE* f, struct fpga_model* model,
 	int y, int x, int type_idx, int config_only);
 int printf_LOGIC(FILE* f, struct fpga_model* model,
@@ -28,3 +47,59 @@ int printf_BUFIO(FILE* f, struct fpga_model* model,
 	int y, int x, int type_idx, int config_only);
 int printf_BSCAN(FILE* f, struct fpga_model* model,
 	int y, int x, int type_idx, int config_only);
+
+//
+// Routing graph export, a binary CSR (compressed sparse row) file that
+// can be mapped and used without building a model. Nodes are the
+// connection points of all tiles, edges are the connections between
+// tiles and the switches inside a tile. See graph.c for the layout.
+//
+
+#define GRAPH_MAGIC	"FPGAGRPH"
+#define GRAPH_VERSION	1
+
+enum { GRAPH_EDGE_CONN = 0, GRAPH_EDGE_SW, GRAPH_EDGE_SW_BIDIR };
+
+struct graph_header
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t y_height, x_width;
+	uint32_t num_nodes, num_edges;
+	uint32_t num_strings, str_bytes;
+	uint32_t reserved;
+	uint64_t off_tile_nodes, off_nodes, off_edge_start, off_edge_dest;
+	uint64_t off_edge_type, off_str_offsets, off_str_data, file_size;
+};
+
+struct graph_node
+{
+	uint16_t y, x;
+	uint16_t name; // index into the string table
+	// enum extra_wires for the routing wires that init_wire_tables()
+	// decodes, NO_WIRE for all other names
+	uint16_t wire;
+};
+
+struct fpga_graph
+{
+	void* map;
+	size_t map_len;
+	const struct graph_header* hdr;
+	const uint32_t* tile_nodes; // y*x_width+x, one more than tiles
+	const struct graph_node* nodes;
+	// edges of node n are edge_start[n] to edge_start[n+1]-1
+	const uint32_t* edge_start;
+	const uint32_t* edge_dest;
+	const uint8_t* edge_type;
+	const uint32_t* str_offsets;
+	const char* str_data;
+};
+
+int write_graph(FILE* f, struct fpga_model* model);
+int map_graph(struct fpga_graph* graph, const char* path);
+void unmap_graph(struct fpga_graph* graph);
+const char* graph_str(const struct fpga_graph* graph, int str_i);
+// returns -1 if not found
+int graph_find_node(const struct fpga_graph* graph, int y, int x,
+	const char* name);
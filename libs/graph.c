@@ -0,0 +1,378 @@
+//
+// This is free and unencumbered software released into the public domain.
+// For details see the UNLICENSE file at the root of the source tree.
+//
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "model.h"
+#include "control.h"
+#include "floorplan.h"
+
+//
+// The routing graph file is a header followed by flat arrays, each
+// aligned to 8 bytes, in host byte order:
+//
+//   tile_nodes  uint32_t[y_height*x_width+1]   first node of each tile
+//   nodes       struct graph_node[num_nodes]   y, x, name, wire
+//   edge_start  uint32_t[num_nodes+1]          CSR row pointers
+//   edge_dest   uint32_t[num_edges]            destination node
+//   edge_type   uint8_t[num_edges]             GRAPH_EDGE_*
+//   str_offsets uint32_t[num_strings]          offset into str_data
+//   str_data    char[str_bytes]                0-terminated strings
+//
+// The nodes of a tile are its connection points in model order, so a
+// switch from/to index is a node offset from tile_nodes[].
+//
+
+#define GRAPH_ALIGN(n)	(((n) + 7) & ~(uint64_t) 7)
+
+static int write_array(FILE* f, const void* data, uint64_t len, uint64_t* pos)
+{
+	static const char zeros[8];
+
+	if (len && fwrite(data, len, 1, f) != 1)
+		return errno ? errno : EIO;
+	*pos += len;
+	if (GRAPH_ALIGN(*pos) != *pos) {
+		if (fwrite(zeros, GRAPH_ALIGN(*pos) - *pos, 1, f) != 1)
+			return errno ? errno : EIO;
+		*pos = GRAPH_ALIGN(*pos);
+	}
+	return 0;
+}
+
+// Per tile, the nodes sorted by name, so that the destination node of
+// a connection can be found with a binary search.
+struct node_key
+{
+	uint16_t name;
+	uint32_t node;
+};
+
+static int node_key_cmp(const void* a, const void* b)
+{
+	const struct node_key* key_a = a, *key_b = b;
+
+	if (key_a->name != key_b->name)
+		return (int) key_a->name - (int) key_b->name;
+	return (key_a->node > key_b->node) - (key_a->node < key_b->node);
+}
+
+static int find_node(const uint32_t* tile_nodes, const struct node_key* keys,
+	int tile_i, uint16_t name)
+{
+	int lo, hi, mid;
+
+	lo = tile_nodes[tile_i];
+	hi = tile_nodes[tile_i+1] - 1;
+	while (lo <= hi) {
+		mid = (lo + hi) / 2;
+		if (keys[mid].name == name)
+			return keys[mid].node;
+		if (keys[mid].name < name)
+			lo = mid + 1;
+		else
+			hi = mid - 1;
+	}
+	return -1;
+}
+
+int write_graph(FILE* f, struct fpga_model* model)
+{
+	struct graph_header hdr;
+	struct fpga_tile* tile;
+	uint32_t* tile_nodes = 0, *edge_start = 0, *edge_dest = 0;
+	uint32_t* str_offsets = 0, *fill = 0;
+	struct graph_node* nodes = 0;
+	struct node_key* keys = 0;
+	uint8_t* edge_type = 0;
+	char* str_data = 0;
+	const char* s;
+	uint64_t pos;
+	int num_tiles, tile_i, y, x, i, j, node, from, to, dest, type, rc;
+
+	RC_CHECK(model);
+	rc = fpga_materialize_all(model);
+	if (rc) FAIL(rc);
+
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, GRAPH_MAGIC, sizeof(hdr.magic));
+	hdr.version = GRAPH_VERSION;
+	hdr.y_height = model->y_height;
+	hdr.x_width = model->x_width;
+	num_tiles = model->y_height * model->x_width;
+
+	// nodes
+	tile_nodes = malloc((num_tiles+1) * sizeof(*tile_nodes));
+	if (!tile_nodes) FAIL(ENOMEM);
+	hdr.num_nodes = 0;
+	for (tile_i = 0; tile_i < num_tiles; tile_i++) {
+		tile_nodes[tile_i] = hdr.num_nodes;
+		hdr.num_nodes += model->tiles[tile_i].num_conn_point_names;
+	}
+	tile_nodes[num_tiles] = hdr.num_nodes;
+	nodes = malloc((hdr.num_nodes ? hdr.num_nodes : 1) * sizeof(*nodes));
+	keys = malloc((hdr.num_nodes ? hdr.num_nodes : 1) * sizeof(*keys));
+	if (!nodes || !keys) FAIL(ENOMEM);
+	for (y = 0; y < model->y_height; y++) {
+		for (x = 0; x < model->x_width; x++) {
+			tile_i = y*model->x_width + x;
+			tile = &model->tiles[tile_i];
+			for (i = 0; i < tile->num_conn_point_names; i++) {
+				node = tile_nodes[tile_i] + i;
+				nodes[node].y = y;
+				nodes[node].x = x;
+				nodes[node].name = tile->conn_point_names[i*2+1];
+				// only the wires the model already decoded,
+				// parsing all other names is slow and noisy
+				nodes[node].wire = (model->str_wire
+				    && model->str_wire[nodes[node].name]
+						!= STR_WIRE_UNKNOWN)
+					? model->str_wire[nodes[node].name] : NO_WIRE;
+				keys[node].name = nodes[node].name;
+				keys[node].node = node;
+			}
+			qsort(&keys[tile_nodes[tile_i]],
+				tile->num_conn_point_names,
+				sizeof(*keys), node_key_cmp);
+		}
+	}
+
+	// Edges are counted per node first, then filled in. Connections
+	// come first, then switches. Bidirectional switches are stored
+	// in both directions.
+	edge_start = calloc(hdr.num_nodes+1, sizeof(*edge_start));
+	fill = calloc(hdr.num_nodes+1, sizeof(*fill));
+	if (!edge_start || !fill) FAIL(ENOMEM);
+	for (type = GRAPH_EDGE_CONN; type <= GRAPH_EDGE_SW; type++) {
+		for (tile_i = 0; tile_i < num_tiles; tile_i++) {
+			tile = &model->tiles[tile_i];
+			if (type == GRAPH_EDGE_CONN) {
+				for (i = 0; i < tile->num_conn_point_names; i++) {
+					node = tile_nodes[tile_i] + i;
+					edge_start[node+1] += ((i < tile->num_conn_point_names-1)
+						? tile->conn_point_names[(i+1)*2]
+						: tile->num_conn_point_dests)
+						- tile->conn_point_names[i*2];
+				}
+				continue;
+			}
+			for (i = 0; i < tile->num_switches; i++) {
+				edge_start[tile_nodes[tile_i]
+					+ SW_FROM_I(tile->switches[i]) + 1]++;
+				if (tile->switches[i] & SWITCH_BIDIRECTIONAL)
+					edge_start[tile_nodes[tile_i]
+						+ SW_TO_I(tile->switches[i]) + 1]++;
+			}
+		}
+	}
+	for (node = 0; node < hdr.num_nodes; node++) {
+		edge_start[node+1] += edge_start[node];
+		fill[node] = edge_start[node];
+	}
+	hdr.num_edges = edge_start[hdr.num_nodes];
+	edge_dest = malloc((hdr.num_edges ? hdr.num_edges : 1) * sizeof(*edge_dest));
+	edge_type = malloc(hdr.num_edges ? hdr.num_edges : 1);
+	if (!edge_dest || !edge_type) FAIL(ENOMEM);
+	for (type = GRAPH_EDGE_CONN; type <= GRAPH_EDGE_SW; type++) {
+		for (tile_i = 0; tile_i < num_tiles; tile_i++) {
+			tile = &model->tiles[tile_i];
+			if (type == GRAPH_EDGE_CONN) {
+				for (i = 0; i < tile->num_conn_point_names; i++) {
+					node = tile_nodes[tile_i] + i;
+					for (j = tile->conn_point_names[i*2];
+					     j < ((i < tile->num_conn_point_names-1)
+						? tile->conn_point_names[(i+1)*2]
+						: tile->num_conn_point_dests); j++) {
+						// dests are x-y-name
+						dest = find_node(tile_nodes, keys,
+							tile->conn_point_dests[j*3+1]*model->x_width
+							 + tile->conn_point_dests[j*3],
+							tile->conn_point_dests[j*3+2]);
+						if (dest == -1) FAIL(EINVAL);
+						edge_dest[fill[node]] = dest;
+						edge_type[fill[node]++] = GRAPH_EDGE_CONN;
+					}
+				}
+				continue;
+			}
+			for (i = 0; i < tile->num_switches; i++) {
+				from = tile_nodes[tile_i] + SW_FROM_I(tile->switches[i]);
+				to = tile_nodes[tile_i] + SW_TO_I(tile->switches[i]);
+				if (!(tile->switches[i] & SWITCH_BIDIRECTIONAL)) {
+					edge_dest[fill[from]] = to;
+					edge_type[fill[from]++] = GRAPH_EDGE_SW;
+					continue;
+				}
+				edge_dest[fill[from]] = to;
+				edge_type[fill[from]++] = GRAPH_EDGE_SW_BIDIR;
+				edge_dest[fill[to]] = from;
+				edge_type[fill[to]++] = GRAPH_EDGE_SW_BIDIR;
+			}
+		}
+	}
+
+	// String table, indexed by the model's string index. Unused
+	// indices point to the empty string at offset 0.
+	hdr.num_strings = model->str.highest_index+1;
+	str_offsets = calloc(hdr.num_strings, sizeof(*str_offsets));
+	if (!str_offsets) FAIL(ENOMEM);
+	hdr.str_bytes = 1;
+	for (i = 1; i < hdr.num_strings; i++) {
+		if ((s = strarray_lookup(&model->str, i)))
+			hdr.str_bytes += strlen(s)+1;
+	}
+	str_data = malloc(hdr.str_bytes);
+	if (!str_data) FAIL(ENOMEM);
+	str_data[0] = 0;
+	hdr.str_bytes = 1;
+	for (i = 1; i < hdr.num_strings; i++) {
+		if (!(s = strarray_lookup(&model->str, i)))
+			continue;
+		str_offsets[i] = hdr.str_bytes;
+		strcpy(&str_data[hdr.str_bytes], s);
+		hdr.str_bytes += strlen(s)+1;
+	}
+
+	pos = GRAPH_ALIGN(sizeof(hdr));
+	hdr.off_tile_nodes = pos;
+	pos = GRAPH_ALIGN(pos + (num_tiles+1) * sizeof(*tile_nodes));
+	hdr.off_nodes = pos;
+	pos = GRAPH_ALIGN(pos + (uint64_t) hdr.num_nodes * sizeof(*nodes));
+	hdr.off_edge_start = pos;
+	pos = GRAPH_ALIGN(pos + (uint64_t) (hdr.num_nodes+1) * sizeof(*edge_start));
+	hdr.off_edge_dest = pos;
+	pos = GRAPH_ALIGN(pos + (uint64_t) hdr.num_edges * sizeof(*edge_dest));
+	hdr.off_edge_type = pos;
+	pos = GRAPH_ALIGN(pos + hdr.num_edges);
+	hdr.off_str_offsets = pos;
+	pos = GRAPH_ALIGN(pos + (uint64_t) hdr.num_strings * sizeof(*str_offsets));
+	hdr.off_str_data = pos;
+	hdr.file_size = GRAPH_ALIGN(pos + hdr.str_bytes);
+
+	pos = 0;
+	if ((rc = write_array(f, &hdr, sizeof(hdr), &pos))
+	    || (rc = write_array(f, tile_nodes, (num_tiles+1) * sizeof(*tile_nodes), &pos))
+	    || (rc = write_array(f, nodes, (uint64_t) hdr.num_nodes * sizeof(*nodes), &pos))
+	    || (rc = write_array(f, edge_start, (uint64_t) (hdr.num_nodes+1) * sizeof(*edge_start), &pos))
+	    || (rc = write_array(f, edge_dest, (uint64_t) hdr.num_edges * sizeof(*edge_dest), &pos))
+	    || (rc = write_array(f, edge_type, hdr.num_edges, &pos))
+	    || (rc = write_array(f, str_offsets, (uint64_t) hdr.num_strings * sizeof(*str_offsets), &pos))
+	    || (rc = write_array(f, str_data, hdr.str_bytes, &pos)))
+		FAIL(rc);
+	if (pos != hdr.file_size) FAIL(EINVAL);
+	rc = 0;
+fail:
+	free(str_data);
+	free(str_offsets);
+	free(edge_type);
+	free(edge_dest);
+	free(fill);
+	free(edge_start);
+	free(keys);
+	free(nodes);
+	free(tile_nodes);
+	return rc;
+}
+
+// Whether num elements of size bytes at off are aligned and within
+// the mapping.
+static int array_in_map(const struct fpga_graph* graph, uint64_t off,
+	uint64_t num, uint64_t size)
+{
+	return GRAPH_ALIGN(off) == off && off <= graph->map_len
+		&& num * size <= graph->map_len - off;
+}
+
+int map_graph(struct fpga_graph* graph, const char* path)
+{
+	const struct graph_header* hdr;
+	struct stat st;
+	int fd, rc;
+
+	memset(graph, 0, sizeof(*graph));
+	fd = open(path, O_RDONLY);
+	if (fd == -1) {
+		fprintf(stderr, "#E %s:%i cannot open %s\n",
+			__FILE__, __LINE__, path);
+		return errno;
+	}
+	if (fstat(fd, &st)) FAIL(errno);
+	if (st.st_size < sizeof(*hdr)) FAIL(EINVAL);
+	graph->map_len = st.st_size;
+	graph->map = mmap(0, graph->map_len, PROT_READ, MAP_SHARED, fd, 0);
+	if (graph->map == MAP_FAILED) {
+		graph->map = 0;
+		FAIL(errno);
+	}
+	close(fd);
+	fd = -1;
+
+	hdr = graph->map;
+	if (memcmp(hdr->magic, GRAPH_MAGIC, sizeof(hdr->magic))
+	    || hdr->version != GRAPH_VERSION
+	    || hdr->file_size != graph->map_len
+	    || !array_in_map(graph, hdr->off_tile_nodes,
+		(uint64_t) hdr->y_height*hdr->x_width + 1, sizeof(uint32_t))
+	    || !array_in_map(graph, hdr->off_nodes, hdr->num_nodes,
+		sizeof(struct graph_node))
+	    || !array_in_map(graph, hdr->off_edge_start,
+		(uint64_t) hdr->num_nodes + 1, sizeof(uint32_t))
+	    || !array_in_map(graph, hdr->off_edge_dest, hdr->num_edges,
+		sizeof(uint32_t))
+	    || !array_in_map(graph, hdr->off_edge_type, hdr->num_edges, 1)
+	    || !array_in_map(graph, hdr->off_str_offsets, hdr->num_strings,
+		sizeof(uint32_t))
+	    || !array_in_map(graph, hdr->off_str_data, hdr->str_bytes, 1)) {
+		fprintf(stderr, "#E %s:%i %s is not a version %i graph\n",
+			__FILE__, __LINE__, path, GRAPH_VERSION);
+		FAIL(EINVAL);
+	}
+	graph->hdr = hdr;
+	graph->tile_nodes = (const uint32_t*) ((const char*) graph->map + hdr->off_tile_nodes);
+	graph->nodes = (const struct graph_node*) ((const char*) graph->map + hdr->off_nodes);
+	graph->edge_start = (const uint32_t*) ((const char*) graph->map + hdr->off_edge_start);
+	graph->edge_dest = (const uint32_t*) ((const char*) graph->map + hdr->off_edge_dest);
+	graph->edge_type = (const uint8_t*) graph->map + hdr->off_edge_type;
+	graph->str_offsets = (const uint32_t*) ((const char*) graph->map + hdr->off_str_offsets);
+	graph->str_data = (const char*) graph->map + hdr->off_str_data;
+	return 0;
+fail:
+	if (fd != -1) close(fd);
+	unmap_graph(graph);
+	return rc;
+}
+
+void unmap_graph(struct fpga_graph* graph)
+{
+	if (graph->map)
+		munmap(graph->map, graph->map_len);
+	memset(graph, 0, sizeof(*graph));
+}
+
+const char* graph_str(const struct fpga_graph* graph, int str_i)
+{
+	if (str_i < 0 || str_i >= graph->hdr->num_strings)
+		return "";
+	return &graph->str_data[graph->str_offsets[str_i]];
+}
+
+int graph_find_node(const struct fpga_graph* graph, int y, int x,
+	const char* name)
+{
+	int tile_i, node;
+
+	if (y < 0 || y >= graph->hdr->y_height
+	    || x < 0 || x >= graph->hdr->x_width)
+		return -1;
+	tile_i = y*graph->hdr->x_width + x;
+	for (node = graph->tile_nodes[tile_i];
+	     node < graph->tile_nodes[tile_i+1]; node++) {
+		if (!strcmp(graph_str(graph, graph->nodes[node].name), name))
+			return node;
+	}
+	return -1;
+}
@@ -7,6 +7,7 @@
 
 #include <stdarg.h>
 #include <errno.h>
+#include <sys/mman.h>
 #include "model.h"
 
 void printf_stdout(const char* fmt, ...)
@@ -27,7 +28,7 @@ void printf_stderr(const char* fmt, ...)
 
 const char *bitstr(uint32_t value, int digits)
 {
-        static char str[2 /* "0b" */ + 32 + 1 /* '\0' */];
+        static __thread char str[2 /* "0b" */ + 32 + 1 /* '\0' */];
         int i;
 
         str[0] = '0';
@@ -38,7 +39,7 @@ const char *bitstr(uint32_t value, int digits)
         return str;
 }
 
-void dump_data(int indent, const uint8_t *data, int len, int base)
+void dump_data(FILE* f, int indent, const uint8_t *data, int len, int base)
 {
 	int i, j, k;
 	char fmt_str[16] = "%s@%05x";
@@ -59,21 +60,21 @@ void dump_data(int indent, const uint8_t *data, int len, int base)
 		fmt_str[5] = '6';
 
 	while (i < len) {
-		printf(fmt_str, indent_str, i);
+		fprintf(f, fmt_str, indent_str, i);
 		for (j = 0; (j < 8) && (i + j < len); j++) {
 			if (i + j >= len) break;
 			if (base == 16)
-				printf(" %02x", data[i+j]);
+				fprintf(f, " %02x", data[i+j]);
 			else if (base == 2) {
-				printf(" ");
+				fprintf(f, " ");
 				for (k = 0; k < 8; k++)
-					printf(data[i+j] & (1<<(7-k)) ? "1" : "0");
+					fprintf(f, data[i+j] & (1<<(7-k)) ? "1" : "0");
 			} else {
-				printf(" #E");
+				fprintf(f, " #E");
 				break;
 			}
 		}
-		printf("\n");
+		fprintf(f, "\n");
 		i += 8;
 	}
 }
@@ -163,15 +164,36 @@ static int bool_nextlen(const char *expr, int len)
 	return -1;
 }
 
+// Truth tables of the six lut inputs: bit i is the value of
+// the input in minterm i, so all 64 minterms of an expression
+// can be evaluated at once with 64-bit operations.
+static const uint64_t s_lut_pin_mask[6] = {
+	0xAAAAAAAAAAAAAAAA, /*A1*/
+	0xCCCCCCCCCCCCCCCC, /*A2*/
+	0xF0F0F0F0F0F0F0F0, /*A3*/
+	0xFF00FF00FF00FF00, /*A4*/
+	0xFFFF0000FFFF0000, /*A5*/
+	0xFFFFFFFF00000000  /*A6*/ };
+
 // + or, * and, @ xor, ~ not
-// var must point to array of A1..A6 variables
-static int bool_eval(const char *expr, int len, const int *var)
+// All operators have the same precedence and bind to the
+// right, so A1*A2+A3 evaluates as A1*(A2+A3).
+// Returns 0 and the truth table of all 64 minterms in *res,
+// or -1 if the expression cannot be parsed.
+static int bool_eval(const char *expr, int len, uint64_t *res)
 {
-	int i, negate, result, oplen;
+	uint64_t result, right_side, gate;
+	int i, negate, oplen;
 
 	if (len == 1) {
-		if (*expr == '1') return 1;
-		if (*expr == '0') return 0;
+		if (*expr == '1') {
+			*res = 0xFFFFFFFFFFFFFFFFULL;
+			return 0;
+		}
+		if (*expr == '0') {
+			*res = 0;
+			return 0;
+		}
 	}
 	oplen = bool_nextlen(expr, len);
 	if (oplen < 1) goto fail;
@@ -183,42 +205,74 @@ static int bool_eval(const char *expr, int len, const int *var)
 	}
 	if (expr[i] == '(') {
 		if (i+2 >= oplen) goto fail;
-		result = bool_eval(&expr[i+1], oplen-i-2, var);
-		if (result == -1) goto fail;
+		if (bool_eval(&expr[i+1], oplen-i-2, &result)) goto fail;
 	} else if (expr[i] == 'A') {
 		if (i+1 >= oplen) goto fail;
 		if (expr[i+1] < '1' || expr[i+1] > '6')
 			goto fail;
-		result = var[expr[i+1]-'1'];
+		result = s_lut_pin_mask[expr[i+1]-'1'];
 		if (oplen != i+2) goto fail;
 	} else goto fail;
-	if (negate) result = !result;
+	if (negate) result = ~result;
+
+	// gate is the product of all factors left of result,
+	// it applies to everything that follows.
+	gate = 0xFFFFFFFFFFFFFFFFULL;
 	i = oplen;
 	while (i < len) {
-		if (expr[i] == '+') {
-			if (result) return 1;
-			return bool_eval(&expr[i+1], len-i-1, var);
-		}
-		if (expr[i] == '@') {
-			int right_side = bool_eval(&expr[i+1], len-i-1, var);
-			if (right_side == -1) goto fail;
-			return (result && !right_side) || (!result && right_side);
+		if (expr[i] == '+' || expr[i] == '@') {
+			if (bool_eval(&expr[i+1], len-i-1, &right_side))
+				goto fail;
+			if (expr[i] == '+')
+				result |= right_side;
+			else
+				result ^= right_side;
+			break;
 		}
 		if (expr[i] != '*') goto fail;
-		if (!result) break;
 		if (++i >= len) goto fail;
 
 		oplen = bool_nextlen(&expr[i], len-i);
 		if (oplen < 1) goto fail;
-		result = bool_eval(&expr[i], oplen, var);
-		if (result == -1) goto fail;
+		gate &= result;
+		if (bool_eval(&expr[i], oplen, &result)) goto fail;
 		i += oplen;
 	}
-	return result;
+	*res = gate & result;
+	return 0;
 fail:
 	return -1;
 }
 
+// The same lut equations are parsed over and over again when
+// reading floorplans and in the autotest, so the truth tables
+// of short expressions are kept in a small direct-mapped cache.
+// The cache is per thread so that models can be worked on
+// concurrently without locking.
+#define BOOL_CACHE_SIZE		256
+#define BOOL_CACHE_MAX_STRLEN	127
+
+struct bool_cache_entry
+{
+	char str[BOOL_CACHE_MAX_STRLEN+1]; // empty string means unused
+	uint64_t u64;
+};
+
+static __thread struct bool_cache_entry s_bool_cache[BOOL_CACHE_SIZE];
+
+static struct bool_cache_entry *bool_cache_slot(const char *str, int str_len)
+{
+	uint32_t hash;
+	int i;
+
+	if (str_len > BOOL_CACHE_MAX_STRLEN)
+		return 0;
+	hash = 5381;
+	for (i = 0; i < str_len; i++)
+		hash = ((hash << 5) + hash) + (unsigned char) str[i];
+	return &s_bool_cache[hash % BOOL_CACHE_SIZE];
+}
+
 uint64_t map_bits(uint64_t u64, int num_bits, int *src_pos)
 {
 	uint64_t result;
@@ -260,163 +314,287 @@ int bool_str2lut_pair(const char *str6, const char *str5, uint64_t *lut6_val, ui
 
 int bool_str2bits(const char *str, int str_len, uint64_t *u64, int num_bits)
 {
-	int i, j, bool_res, rc, vars[6];
+	struct bool_cache_entry *cache;
+	uint64_t truth_table;
+	int rc;
 
-	if (num_bits == 64)
-		*u64 = 0;
-	else if (num_bits == 32)
-		*u64 &= 0xFFFFFFFF00000000;
-	else FAIL(EINVAL);
+	if (num_bits != 64 && num_bits != 32) FAIL(EINVAL);
 
 	if (str_len == ZTERM)
 		str_len = strlen(str);
-	for (i = 0; i < num_bits; i++) {
-		for (j = 0; j < sizeof(vars)/sizeof(*vars); j++)
-			vars[j] = (i & (1<<j)) != 0;
-		bool_res = bool_eval(str, str_len, vars);
-		if (bool_res == -1) {
+	cache = bool_cache_slot(str, str_len);
+	if (cache && cache->str[0] && !strncmp(cache->str, str, str_len)
+	    && !cache->str[str_len])
+		truth_table = cache->u64;
+	else {
+		if (bool_eval(str, str_len, &truth_table)) {
 			fprintf(stderr, "#E %s:%i cannot evaluate '%.*s'\n",
 				__FILE__, __LINE__, str_len, str);
 			FAIL(EINVAL);
 		}
-		if (bool_res) *u64 |= 1ULL<<i;
+		if (cache && str_len) {
+			memcpy(cache->str, str, str_len);
+			cache->str[str_len] = 0;
+			cache->u64 = truth_table;
+		}
 	}
+	// Minterms 0..31 are the ones with A6 low, so the
+	// 32-bit result is the lower half of the truth table.
+	if (num_bits == 64)
+		*u64 = truth_table;
+	else
+		*u64 = (*u64 & 0xFFFFFFFF00000000ULL) | ULL_LOW32(truth_table);
 	return 0;
 fail:
 	return rc;
 }
 
-typedef struct _minterm_entry
+static int bool_popcount64(uint64_t v)
 {
-	char a[6]; // 0=A1, 5=A6. value can be 0, 1 or 2 for 'removed'
-	int merged;
-} minterm_entry;
+	v = v - ((v >> 1) & 0x5555555555555555ULL);
+	v = (v & 0x3333333333333333ULL) + ((v >> 2) & 0x3333333333333333ULL);
+	v = (v + (v >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+	return (v * 0x0101010101010101ULL) >> 56;
+}
 
-const char* bool_bits2str(uint64_t u64, int num_bits)
+// A cube is a product term: the inputs in care are fixed
+// to their bit in val, all other inputs are don't care.
+struct bool_cube
 {
-	// round 0 needs 64 entries
-	// round 1 (size2): 192
-	// round 2 (size4): 240
-	// round 3 (size8): 160
-	// round 4 (size16): 60
-	// round 5 (size32): 12
-	// round 6 (size64): 1
-	minterm_entry mt[7][256];
-	int mt_size[7];
-	int i, j, k, round, only_diff_bit;
-	int str_end, first_op, bit_width;
-	static char str[2048];
-
-	if (num_bits == 64) {
-		if (!u64) return "0";
-		if (u64 == 0xFFFFFFFFFFFFFFFFULL) return "1";
-		bit_width = 6;
-	} else if (num_bits == 32) {
-		if (!ULL_LOW32(u64)) return "0";
-		if (ULL_LOW32(u64) == 0xFFFFFFFF) return "1";
-		bit_width = 5;
-	} else {
-		HERE();
-		return "0";
-	}
+	uint64_t tt; // truth table over all minterms
+	int care;
+	int val;
+};
 
-	memset(mt, 0, sizeof(mt));
-	memset(mt_size, 0, sizeof(mt_size));
+// Maximum number of cubes over 6 inputs is 3^6.
+#define BOOL_MAX_CUBES	729
 
-	// set starting minterms
-	for (i = 0; i < num_bits; i++) {
-		if (u64 & (1ULL<<i)) {
-			for (j = 0; j < bit_width; j++) {
-				if (i&(1<<j))
-					mt[0][mt_size[0]].a[j] = 1;
+// Swaps the minterms with input i low and high.
+static uint64_t bool_flip_input(uint64_t v, int i)
+{
+	return ((v & s_lut_pin_mask[i]) >> (1<<i))
+		| ((v << (1<<i)) & s_lut_pin_mask[i]);
+}
+
+// Finds all prime implicants of the 6-input function f. A cube is a
+// prime implicant if it lies within f and none of its literals can
+// be removed without leaving f. Products with more literals come
+// first, the same order in which the former Quine-McCluskey rounds
+// produced them.
+static int bool_primes(uint64_t f, struct bool_cube *primes)
+{
+	uint64_t implicants[64], prime_mask, tt;
+	int dc, care, val, i, num_primes;
+
+	// Bit m of implicants[care] is set if the cube that fixes
+	// the inputs in care to their value in minterm m lies within
+	// f. Dropping input i from care adds the minterms with input
+	// i flipped to each cube.
+	implicants[63] = f;
+	for (care = 62; care >= 0; care--) {
+		for (i = 0; care & (1<<i); i++);
+		implicants[care] = implicants[care|(1<<i)]
+			& bool_flip_input(implicants[care|(1<<i)], i);
+	}
+
+	num_primes = 0;
+	for (dc = 0; dc <= 6; dc++) {
+		for (care = 0; care < 64; care++) {
+			if (bool_popcount64(care) != 6-dc)
+				continue;
+			// A cube is prime if no literal can be dropped.
+			// Each cube is represented by its minterm with all
+			// don't care inputs low.
+			prime_mask = implicants[care];
+			for (i = 0; i < 6; i++) {
+				if (care & (1<<i))
+					prime_mask &= ~implicants[care & ~(1<<i)];
+				else
+					prime_mask &= ~s_lut_pin_mask[i];
+			}
+			while (prime_mask) {
+				val = bool_popcount64((prime_mask & -prime_mask) - 1);
+				prime_mask &= prime_mask - 1;
+				tt = 0xFFFFFFFFFFFFFFFFULL;
+				for (i = 0; i < 6; i++) {
+					if (!(care & (1<<i))) continue;
+					tt &= (val & (1<<i)) ? s_lut_pin_mask[i]
+						: ~s_lut_pin_mask[i];
+				}
+				primes[num_primes].tt = tt;
+				primes[num_primes].care = care;
+				primes[num_primes].val = val;
+				num_primes++;
 			}
-			mt_size[0]++;
 		}
 	}
+	return num_primes;
+}
 
-	// go through five rounds of merging
-	for (round = 1; round < 7; round++) {
-		for (i = 0; i < mt_size[round-1]; i++) {
-			for (j = i+1; j < mt_size[round-1]; j++) {
-				only_diff_bit = -1;
-				for (k = 0; k < bit_width; k++) {
-					if (mt[round-1][i].a[k] != mt[round-1][j].a[k]) {
-						if (only_diff_bit != -1) {
-							only_diff_bit = -1;
-							break;
-						}
-						only_diff_bit = k;
-					}
-				}
-				if (only_diff_bit != -1) {
-					char new_term[6];
-	
-					for (k = 0; k < bit_width; k++)
-						new_term[k] =
-						  (k == only_diff_bit) ? 2 
-						    : mt[round-1][i].a[k];
-					for (k = 0; k < mt_size[round]; k++) {
-						if (new_term[0] == mt[round][k].a[0]
-						    && new_term[1] == mt[round][k].a[1]
-						    && new_term[2] == mt[round][k].a[2]
-						    && new_term[3] == mt[round][k].a[3]
-						    && new_term[4] == mt[round][k].a[4]
-						    && new_term[5] == mt[round][k].a[5])
-							break;
-					}
-					if (k >= mt_size[round]) {
-						mt[round][mt_size[round]].a[0] = new_term[0];
-						mt[round][mt_size[round]].a[1] = new_term[1];
-						mt[round][mt_size[round]].a[2] = new_term[2];
-						mt[round][mt_size[round]].a[3] = new_term[3];
-						mt[round][mt_size[round]].a[4] = new_term[4];
-						mt[round][mt_size[round]].a[5] = new_term[5];
-						mt_size[round]++;
-					}
-					mt[round-1][i].merged = 1;
-					mt[round-1][j].merged = 1;
-				}
+// Selects a small set of primes covering f: first all essential
+// primes, then greedily the prime covering most of the remaining
+// minterms, finally each prime that is covered by the others is
+// dropped again.
+static void bool_cover(uint64_t f, const struct bool_cube *primes,
+	int num_primes, int *selected)
+{
+	uint64_t uncovered, others, covered_once, covered_more;
+	int i, j, best, best_count, count;
+
+	// minterms covered by exactly one prime make it essential
+	covered_once = 0;
+	covered_more = 0;
+	for (i = 0; i < num_primes; i++) {
+		covered_more |= covered_once & primes[i].tt;
+		covered_once = (covered_once | primes[i].tt) & ~covered_more;
+	}
+	uncovered = f;
+	for (i = 0; i < num_primes; i++) {
+		selected[i] = (primes[i].tt & covered_once) != 0;
+		if (selected[i])
+			uncovered &= ~primes[i].tt;
+	}
+	while (uncovered) {
+		best = -1;
+		best_count = 0;
+		for (i = 0; i < num_primes; i++) {
+			if (selected[i]) continue;
+			count = bool_popcount64(primes[i].tt & uncovered);
+			// on equal coverage, prefer fewer literals
+			if (count > best_count
+			    || (count && count == best_count
+				&& bool_popcount64(primes[i].care)
+				   < bool_popcount64(primes[best].care))) {
+				best = i;
+				best_count = count;
 			}
 		}
+		if (best == -1) {
+			HERE();
+			break;
+		}
+		selected[best] = 1;
+		uncovered &= ~primes[best].tt;
+	}
+	for (i = 0; i < num_primes; i++) {
+		if (!selected[i]) continue;
+		others = 0;
+		for (j = 0; j < num_primes; j++) {
+			if (j != i && selected[j])
+				others |= primes[j].tt;
+		}
+		if (!(f & ~others))
+			selected[i] = 0;
 	}
+}
+
+int bool_bits2str_r(uint64_t u64, int num_bits, char *str, int str_size)
+{
+	struct bool_cube primes[BOOL_MAX_CUBES];
+	int selected[BOOL_MAX_CUBES];
+	int i, j, num_primes, num_products, str_end, first_op;
+	int product_len, need_parens, rc;
 
+	if (num_bits == 32) {
+		// A 5-input function is a 6-input function that
+		// does not depend on A6, so no product will contain A6.
+		u64 = ULL_LOW32(u64) | ((uint64_t) ULL_LOW32(u64) << 32);
+	} else if (num_bits != 64)
+		FAIL(EINVAL);
+	if (str_size < 2) FAIL(EINVAL);
+
+	if (!u64 || u64 == 0xFFFFFFFFFFFFFFFFULL) {
+		strcpy(str, u64 ? "1" : "0");
+		return 0;
+	}
+	num_primes = bool_primes(u64, primes);
+	bool_cover(u64, primes, num_primes, selected);
+
+	num_products = 0;
+	for (i = 0; i < num_primes; i++) {
+		if (selected[i])
+			num_products++;
+	}
+	// Operators have equal precedence and bind to the right
+	// in bool_str2bits(), so products need parentheses in
+	// a sum to read back correctly.
+	need_parens = num_products > 1;
 	str_end = 0;
-	for (round = 0; round < 7; round++) {
-		for (i = 0; i < mt_size[round]; i++) {
-			if (!mt[round][i].merged) {
-				if (str_end)
-					str[str_end++] = '+';
-				first_op = 1;
-				for (j = 0; j < bit_width; j++) {
-					if (mt[round][i].a[j] != 2) {
-						if (!first_op)
-							str[str_end++] = '*';
-						if (!mt[round][i].a[j])
-							str[str_end++] = '~';
-						str[str_end++] = 'A';
-						str[str_end++] = '1' + j;
-						first_op = 0;
-					}
-				}
-			}
+	for (i = 0; i < num_primes; i++) {
+		if (!selected[i]) continue;
+		// each literal takes up to 4 characters: '*', '~', 'A', digit
+		product_len = bool_popcount64(primes[i].care)*4 + 3;
+		if (str_end + product_len >= str_size) FAIL(ERANGE);
+		if (str_end)
+			str[str_end++] = '+';
+		if (need_parens && primes[i].care & (primes[i].care-1))
+			str[str_end++] = '(';
+		first_op = 1;
+		for (j = 0; j < 6; j++) {
+			if (!(primes[i].care & (1<<j))) continue;
+			if (!first_op)
+				str[str_end++] = '*';
+			if (!(primes[i].val & (1<<j)))
+				str[str_end++] = '~';
+			str[str_end++] = 'A';
+			str[str_end++] = '1' + j;
+			first_op = 0;
 		}
+		if (need_parens && primes[i].care & (primes[i].care-1))
+			str[str_end++] = ')';
 	}
 	str[str_end] = 0;
+	return 0;
+fail:
+	return rc;
+}
+
+// Floorplans repeat the same lut values many times, so
+// the strings are memoized per value and width. Entries are
+// stored inline and per thread, longer strings are not cached.
+#define BITS2STR_CACHE_SIZE	1024
+#define BITS2STR_CACHE_MAX_STRLEN	115
+
+struct bits2str_cache_entry
+{
+	uint64_t u64;
+	int num_bits; // 0 means unused
+	char str[BITS2STR_CACHE_MAX_STRLEN+1];
+};
+
+static __thread struct bits2str_cache_entry s_bits2str_cache[BITS2STR_CACHE_SIZE];
 
-	// TODO: This could be further simplified, see Petrick's method.
-	// XOR don't simplify well, try A2@A3
-	return str;
+const char* bool_bits2str(uint64_t u64, int num_bits)
+{
+	static __thread char str[BOOL_STR_MAXLEN];
+	struct bits2str_cache_entry *cache;
+	uint64_t hash;
+
+	if (num_bits == 32)
+		u64 &= 0x00000000FFFFFFFFULL;
+	else if (num_bits != 64) {
+		HERE();
+		return "0";
+	}
+	hash = (u64 ^ (u64 >> 29) ^ num_bits) * 0x9E3779B97F4A7C15ULL;
+	cache = &s_bits2str_cache[(hash >> 32) % BITS2STR_CACHE_SIZE];
+	if (cache->num_bits == num_bits && cache->u64 == u64)
+		return cache->str;
+
+	if (bool_bits2str_r(u64, num_bits, str, sizeof(str))) {
+		HERE();
+		return "0";
+	}
+	if (strlen(str) > BITS2STR_CACHE_MAX_STRLEN)
+		return str;
+	cache->u64 = u64;
+	cache->num_bits = num_bits;
+	strcpy(cache->str, str);
+	return cache->str;
 }
 
 int bool_req_pins(uint64_t u64, int num_bits)
 {
-	static const uint64_t pin_mask[6] = {
-		0xAAAAAAAAAAAAAAAA, /*A1*/
-		0xCCCCCCCCCCCCCCCC, /*A2*/
-		0xF0F0F0F0F0F0F0F0, /*A3*/
-		0xFF00FF00FF00FF00, /*A4*/
-		0xFFFF0000FFFF0000, /*A5*/
-		0xFFFFFFFF00000000  /*A6*/ };
 	uint64_t bit_mask;
 	int req_pins, num_pins, i;
 
@@ -433,13 +611,13 @@ int bool_req_pins(uint64_t u64, int num_bits)
 	// are the same.
 	req_pins = 0;
 	for (i = 0; i < num_pins; i++) {
-		if ((u64 & pin_mask[i] & bit_mask) >> (1<<i) != (u64 & ~pin_mask[i] & bit_mask))
+		if ((u64 & s_lut_pin_mask[i] & bit_mask) >> (1<<i) != (u64 & ~s_lut_pin_mask[i] & bit_mask))
 			req_pins |= 1<<i;
 	}
 	return req_pins;
 }
 
-void printf_type2(uint8_t *d, int len, int inpos, int num_entries)
+void printf_type2(FILE* f, uint8_t *d, int len, int inpos, int num_entries)
 {
 	uint64_t u64;
 	uint16_t u16;
@@ -448,11 +626,11 @@ void printf_type2(uint8_t *d, int len, int inpos, int num_entries)
 	for (i = 0; i < num_entries; i++) {
 		u64 = frame_get_u64(&d[inpos+i*8]);
 		if (!u64) continue;
-		printf("type2 8*%i 0x%016lX\n", i, u64);
+		fprintf(f, "type2 8*%i 0x%016lX\n", i, u64);
 		for (j = 0; j < 4; j++) {
 			u16 = frame_get_u16(&d[inpos+i*8+j*2]);
 			if (u16)
-				printf("type2 2*%i 8*%i+%i 0x%04X\n", i*4+j, i, j, u16);
+				fprintf(f, "type2 2*%i 8*%i+%i 0x%04X\n", i*4+j, i, j, u16);
 		}
 	}
 }
@@ -484,7 +662,7 @@ static void ramb_words_split_data_parity(const int (*ramb_words)[1024],
 	}
 }
 
-void printf_ramb_data(const uint8_t *bits, int row, int bram_idx)
+void printf_ramb_data(FILE* f, const uint8_t *bits, int row, int bram_idx)
 {
 	int nonzero_head, nonzero_tail, ramb_words[1024];
 	int init_data[64][16], init_parity[8][16];
@@ -508,16 +686,16 @@ void printf_ramb_data(const uint8_t *bits, int row, int bram_idx)
 	if (nonzero_head || nonzero_tail) {
 		PHERE();
 		if (nonzero_head) {
-			printf(" head");
+			fprintf(f, " head");
 			for (i = 0; i < XC6_BRAM_DATA_PREFIX_LEN; i++)
-				printf(" %02X", bits[i]);
-			printf("\n");
+				fprintf(f, " %02X", bits[i]);
+			fprintf(f, "\n");
 		}
 		if (nonzero_tail) {
-			printf(" tail");
+			fprintf(f, " tail");
 			for (i = 0; i < XC6_BRAM_DATA_SUFFIX_LEN; i++)
-				printf(" %02X", bits[XC6_BRAM_DATA_FRAMES_PER_DEV*FRAME_SIZE-XC6_BRAM_DATA_SUFFIX_LEN + i]);
-			printf("\n");
+				fprintf(f, " %02X", bits[XC6_BRAM_DATA_FRAMES_PER_DEV*FRAME_SIZE-XC6_BRAM_DATA_SUFFIX_LEN + i]);
+			fprintf(f, "\n");
 		}
 	}
 
@@ -532,14 +710,14 @@ void printf_ramb_data(const uint8_t *bits, int row, int bram_idx)
 			if (!init_parity[i][j]) continue;
 			if (!header_printed) {
 				header_printed = 1;
-				printf("br%i maj_i %i dev_i %i/16\n{\n", row,
+				fprintf(f, "br%i maj_i %i dev_i %i/16\n{\n", row,
 					bram_idx/XC6_BRAM16_DEVS_PER_MAJOR,
 					bram_idx%XC6_BRAM16_DEVS_PER_MAJOR);
 			}
-			printf(" parity 0x%02X \"", i);
+			fprintf(f, " parity 0x%02X \"", i);
 			for (j = 0; j < 16; j++)
-				printf("%04X", init_parity[i][15-j]);
-			printf("\"\n");
+				fprintf(f, "%04X", init_parity[i][15-j]);
+			fprintf(f, "\"\n");
 		}
 	}
 	for (i = 0; i < 64; i++) {
@@ -547,18 +725,18 @@ void printf_ramb_data(const uint8_t *bits, int row, int bram_idx)
 			if (!init_data[i][j]) continue;
 			if (!header_printed) {
 				header_printed = 1;
-				printf("br%i maj_i %i dev_i %i/16\n{\n", row,
+				fprintf(f, "br%i maj_i %i dev_i %i/16\n{\n", row,
 					bram_idx/XC6_BRAM16_DEVS_PER_MAJOR,
 					bram_idx%XC6_BRAM16_DEVS_PER_MAJOR);
 			}
-			printf(" init 0x%02X \"", i);
+			fprintf(f, " init 0x%02X \"", i);
 			for (j = 0; j < 16; j++)
-				printf("%04X", init_data[i][15-j]);
-			printf("\"\n");
+				fprintf(f, "%04X", init_data[i][15-j]);
+			fprintf(f, "\"\n");
 		}
 	}
 	if (header_printed)
-		printf("}\n");
+		fprintf(f, "}\n");
 
 	// ramb8,0
 	header_printed = 0;
@@ -567,14 +745,14 @@ void printf_ramb_data(const uint8_t *bits, int row, int bram_idx)
 			if (!init_parity[i][j]) continue;
 			if (!header_printed) {
 				header_printed = 1;
-				printf("br%i maj_i %i dev_i %i,0/8\n{\n", row,
+				fprintf(f, "br%i maj_i %i dev_i %i,0/8\n{\n", row,
 					bram_idx/XC6_BRAM16_DEVS_PER_MAJOR,
 					bram_idx%XC6_BRAM16_DEVS_PER_MAJOR);
 			}
-			printf(" parity 0x%02X \"", i);
+			fprintf(f, " parity 0x%02X \"", i);
 			for (j = 0; j < 16; j++)
-				printf("%04X", init_parity[i][15-j]);
-			printf("\"\n");
+				fprintf(f, "%04X", init_parity[i][15-j]);
+			fprintf(f, "\"\n");
 		}
 	}
 	for (i = 0; i < 32; i++) {
@@ -582,18 +760,18 @@ void printf_ramb_data(const uint8_t *bits, int row, int bram_idx)
 			if (!init_data[i][j]) continue;
 			if (!header_printed) {
 				header_printed = 1;
-				printf("br%i maj_i %i dev_i %i,0/8\n{\n", row,
+				fprintf(f, "br%i maj_i %i dev_i %i,0/8\n{\n", row,
 					bram_idx/XC6_BRAM16_DEVS_PER_MAJOR,
 					bram_idx%XC6_BRAM16_DEVS_PER_MAJOR);
 			}
-			printf(" init 0x%02X \"", i);
+			fprintf(f, " init 0x%02X \"", i);
 			for (j = 0; j < 16; j++)
-				printf("%04X", init_data[i][15-j]);
-			printf("\"\n");
+				fprintf(f, "%04X", init_data[i][15-j]);
+			fprintf(f, "\"\n");
 		}
 	}
 	if (header_printed)
-		printf("}\n");
+		fprintf(f, "}\n");
 
 	// ramb8,1
 	header_printed = 0;
@@ -602,14 +780,14 @@ void printf_ramb_data(const uint8_t *bits, int row, int bram_idx)
 			if (!init_parity[i][j]) continue;
 			if (!header_printed) {
 				header_printed = 1;
-				printf("br%i maj_i %i dev_i %i,1/8\n{\n", row,
+				fprintf(f, "br%i maj_i %i dev_i %i,1/8\n{\n", row,
 					bram_idx/XC6_BRAM16_DEVS_PER_MAJOR,
 					bram_idx%XC6_BRAM16_DEVS_PER_MAJOR);
 			}
-			printf(" parity 0x%02X \"", i-4);
+			fprintf(f, " parity 0x%02X \"", i-4);
 			for (j = 0; j < 16; j++)
-				printf("%04X", init_parity[i][15-j]);
-			printf("\"\n");
+				fprintf(f, "%04X", init_parity[i][15-j]);
+			fprintf(f, "\"\n");
 		}
 	}
 	for (i = 32; i < 64; i++) {
@@ -617,18 +795,18 @@ void printf_ramb_data(const uint8_t *bits, int row, int bram_idx)
 			if (!init_data[i][j]) continue;
 			if (!header_printed) {
 				header_printed = 1;
-				printf("br%i maj_i %i dev_i %i,1/8\n{\n", row,
+				fprintf(f, "br%i maj_i %i dev_i %i,1/8\n{\n", row,
 					bram_idx/XC6_BRAM16_DEVS_PER_MAJOR,
 					bram_idx%XC6_BRAM16_DEVS_PER_MAJOR);
 			}
-			printf(" init 0x%02X \"", i-32);
+			fprintf(f, " init 0x%02X \"", i-32);
 			for (j = 0; j < 16; j++)
-				printf("%04X", init_data[i][15-j]);
-			printf("\"\n");
+				fprintf(f, "%04X", init_data[i][15-j]);
+			fprintf(f, "\"\n");
 		}
 	}
 	if (header_printed)
-		printf("}\n");
+		fprintf(f, "}\n");
 }
 
 void bram_extract_init(bram_init_t *init, const uint8_t *bits)
@@ -816,7 +994,7 @@ static int xc6_bit2pin(int bit)
 	return 7-pin;
 }
 
-int printf_frames(const uint8_t* bits, int max_frames,
+int printf_frames(FILE* f, const uint8_t* bits, int max_frames,
 	int row, int major, int minor, int print_empty, int no_clock)
 {
 	int i, i_without_clk;
@@ -834,9 +1012,9 @@ int printf_frames(const uint8_t* bits, int max_frames,
 		}
 		if (print_empty) {
 			if (i > 1)
-				printf("%s- *%i\n", prefix, i);
+				fprintf(f, "%s- *%i\n", prefix, i);
 			else
-				printf("%s-\n", prefix);
+				fprintf(f, "%s-\n", prefix);
 		}
 		return i;
 	}
@@ -847,7 +1025,7 @@ int printf_frames(const uint8_t* bits, int max_frames,
 			if (!frame_get_bit(bits, i)) continue;
 			if (i >= 512 && i < 528) { // hclk
 				if (!no_clock)
-					printf("%sbit %i\n", prefix, i);
+					fprintf(f, "%sbit %i\n", prefix, i);
 				continue;
 			}
 			i_without_clk = i;
@@ -857,23 +1035,23 @@ int printf_frames(const uint8_t* bits, int max_frames,
 				i_without_clk/64, i_without_clk%64,
 				i_without_clk/256, i_without_clk%256,
 				xc6_bit2pin(i_without_clk));
-			printf("%sbit %i %s\n", prefix, i, suffix);
+			fprintf(f, "%sbit %i %s\n", prefix, i, suffix);
 		}
 		return 1;
 	}
-	printf("%shex\n", prefix);
-	printf("{\n");
-	dump_data(1, bits, /*len*/ FRAME_SIZE, /*base*/ 16);
-	printf("}\n");
+	fprintf(f, "%shex\n", prefix);
+	fprintf(f, "{\n");
+	dump_data(f, 1, bits, /*len*/ FRAME_SIZE, /*base*/ 16);
+	fprintf(f, "}\n");
 	return 1;
 }
 
-void printf_clock(const uint8_t* frame, int row, int major, int minor)
+void printf_clock(FILE* f, const uint8_t* frame, int row, int major, int minor)
 {
 	int i;
 	for (i = 0; i < 16; i++) {
 		if (frame_get_bit(frame, 512 + i))
-			printf("r%i ma%i mi%i clock %i pin %i\n",
+			fprintf(f, "r%i ma%i mi%i clock %i pin %i\n",
 				row, major, minor, i, xc6_bit2pin(i));
 	}
 }
@@ -894,7 +1072,7 @@ int clb_empty(uint8_t* maj_bits, int idx)
 	return 1;
 }
 
-void printf_extrabits(const uint8_t* maj_bits, int start_minor, int num_minors,
+void printf_extrabits(FILE* f, const uint8_t* maj_bits, int start_minor, int num_minors,
 	int start_bit, int num_bits, int row, int major)
 {
 	int minor, bit, bit_no_clk;
@@ -905,7 +1083,7 @@ void printf_extrabits(const uint8_t* maj_bits, int start_minor, int num_minors,
 				bit_no_clk = bit;
 				if (bit_no_clk >= 528)
 					bit_no_clk -= XC6_HCLK_BITS;
-				printf("r%i ma%i mi%i bit %i 64*%i+%i 256*%i+%i\n",
+				fprintf(f, "r%i ma%i mi%i bit %i 64*%i+%i 256*%i+%i\n",
 					row, major, minor, bit,
 					bit_no_clk/64, bit_no_clk%64,
 					bit_no_clk/256, bit_no_clk%256);
@@ -930,7 +1108,7 @@ void write_lut64(uint8_t* two_minors, int off_in_frame, uint64_t u64)
 	}
 }
 
-void printf_routing_2minors(const uint8_t* bits, int row, int major,
+void printf_routing_2minors(FILE* f, const uint8_t* bits, int row, int major,
 	int even_minor)
 {
 	int y, i, hclk;
@@ -952,13 +1130,13 @@ void printf_routing_2minors(const uint8_t* bits, int row, int major,
 					bit_str[i*2+1] = '1';
 			}
 			// todo: might be nice to add the tile y and x here
-			printf("r%i ma%i v64_%i mip%i %s\n",
+			fprintf(f, "r%i ma%i v64_%i mip%i %s\n",
 				row, major, y, even_minor, bit_str);
 		}
 	}
 }
 
-void printf_v64_mi20(const uint8_t* bits, int row, int major)
+void printf_v64_mi20(FILE* f, const uint8_t* bits, int row, int major)
 {
 	int y, i, num_bits_on, hclk;
 	uint64_t u64;
@@ -971,7 +1149,7 @@ void printf_v64_mi20(const uint8_t* bits, int row, int major)
 		if (u64) {
 			for (i = 0; i < 64; i++)
 				bit_str[i] = (u64 & (1ULL << i)) ? '1' : '0';
-			printf("r%i ma%i v64_%i mi20 %s\n",
+			fprintf(f, "r%i ma%i v64_%i mi20 %s\n",
 				row, major, y, bit_str);
 			num_bits_on = 0;
 			for (i = 0; i < 64; i++) {
@@ -984,7 +1162,7 @@ void printf_v64_mi20(const uint8_t* bits, int row, int major)
 				for (i = 0; i < 64; i++) {
 					if (!(u64 & (1ULL << i)))
 						continue;
-					printf("r%i ma%i v64_%i mi20 b%i\n",
+					fprintf(f, "r%i ma%i v64_%i mi20 b%i\n",
 						row, major, y, i);
 				}
 			}
@@ -995,8 +1173,8 @@ void printf_v64_mi20(const uint8_t* bits, int row, int major)
 const char *fmt_word(int word)
 {
 	enum { NUM_BUFS = 16, BUF_SIZE = 64 };
-	static char buf[NUM_BUFS][BUF_SIZE];
-	static int last_buf = 0;
+	static __thread char buf[NUM_BUFS][BUF_SIZE];
+	static __thread int last_buf = 0;
 	char bit_str[XC6_WORD_BITS];
 	int i;
 
@@ -1016,7 +1194,7 @@ const char *fmt_word(int word)
 	return buf[last_buf];
 }
 
-void printf_lut_words(const uint8_t *major_bits, int row, int major, int minor, int v16_i)
+void printf_lut_words(FILE* f, const uint8_t *major_bits, int row, int major, int minor, int v16_i)
 {
 	int off_in_frame, w;
 
@@ -1026,22 +1204,22 @@ void printf_lut_words(const uint8_t *major_bits, int row, int major, int minor,
 
 	w = frame_get_pinword(&major_bits[minor*FRAME_SIZE + off_in_frame]);
 	if (w)
-		printf("r%i ma%i v%i_%i mi%i pin %s", row, major, XC6_WORD_BITS,
+		fprintf(f, "r%i ma%i v%i_%i mi%i pin %s", row, major, XC6_WORD_BITS,
 			v16_i, minor, fmt_word(w));
 
 	w = frame_get_pinword(&major_bits[minor*FRAME_SIZE + off_in_frame + XC6_WORD_BYTES]);
 	if (w)
-		printf("r%i ma%i v%i_%i mi%i pin %s", row, major, XC6_WORD_BITS,
+		fprintf(f, "r%i ma%i v%i_%i mi%i pin %s", row, major, XC6_WORD_BITS,
 			v16_i+1, minor, fmt_word(w));
 
 	w = frame_get_pinword(&major_bits[(minor+1)*FRAME_SIZE + off_in_frame]);
 	if (w)
-		printf("r%i ma%i v%i_%i mi%i pin %s", row, major, XC6_WORD_BITS,
+		fprintf(f, "r%i ma%i v%i_%i mi%i pin %s", row, major, XC6_WORD_BITS,
 			v16_i, minor+1, fmt_word(w));
 
 	w = frame_get_pinword(&major_bits[(minor+1)*FRAME_SIZE + off_in_frame + XC6_WORD_BYTES]);
 	if (w)
-		printf("r%i ma%i v%i_%i mi%i pin %s", row, major, XC6_WORD_BITS,
+		fprintf(f, "r%i ma%i v%i_%i mi%i pin %s", row, major, XC6_WORD_BITS,
 			v16_i+1, minor+1, fmt_word(w));
 }
 	
@@ -1198,6 +1376,192 @@ uint32_t hash_djb2(const unsigned char* str)
         return hash;
 }
 
+struct diff_line
+{
+	const char* s;
+	int len; // including the newline
+	uint32_t hash;
+};
+
+static int split_lines(const char* txt, size_t len, struct diff_line** lines)
+{
+	int num_lines, i, end;
+	size_t pos;
+
+	num_lines = 0;
+	for (pos = 0; pos < len; pos++) {
+		if (txt[pos] == '\n')
+			num_lines++;
+	}
+	if (len && txt[len-1] != '\n')
+		num_lines++;
+	*lines = malloc((num_lines+1)*sizeof(**lines));
+	if (!*lines) return -1;
+	pos = 0;
+	for (i = 0; i < num_lines; i++) {
+		(*lines)[i].s = &txt[pos];
+		(*lines)[i].hash = 5381;
+		for (end = pos; end < len && txt[end] != '\n'; end++)
+			(*lines)[i].hash = (*lines)[i].hash*33 + txt[end];
+		if (end < len) end++;
+		(*lines)[i].len = end - pos;
+		pos = end;
+	}
+	return num_lines;
+}
+
+static int lines_equal(const struct diff_line* a, const struct diff_line* b)
+{
+	return a->hash == b->hash && a->len == b->len
+		&& !memcmp(a->s, b->s, a->len);
+}
+
+static void print_diff_line(FILE* f, char prefix, const struct diff_line* l)
+{
+	fputc(prefix, f);
+	fwrite(l->s, 1, l->len, f);
+	if (!l->len || l->s[l->len-1] != '\n')
+		fputc('\n', f);
+}
+
+// Above this many changed lines, the region is printed
+// as removing all of a and adding all of b.
+#define DIFF_MAX_EDITS	2048
+
+// ops for each line: 0 unchanged, 'd' deleted from a, 'i' inserted from b
+static int myers_diff(const struct diff_line* a, int n,
+	const struct diff_line* b, int m, char* ops, int* num_ops)
+{
+	int *v, **trace, max, off, d, k, x, y, prev_k, prev_x, prev_y, i, rc;
+
+	max = n+m;
+	off = max+1; // v[off+k] is the furthest x on diagonal k
+	*num_ops = 0;
+	v = malloc((2*max+3)*sizeof(*v));
+	trace = calloc(DIFF_MAX_EDITS+1, sizeof(*trace));
+	if (!v || !trace) { rc = ENOMEM; goto out; }
+	v[off+1] = 0;
+	for (d = 0; d <= max; d++) {
+		if (d > DIFF_MAX_EDITS) { rc = E2BIG; goto out; }
+		// the state before step d, i.e. after d-1 edits
+		trace[d] = malloc((2*d+3)*sizeof(*trace[d]));
+		if (!trace[d]) { rc = ENOMEM; goto out; }
+		memcpy(trace[d], &v[off-d-1], (2*d+3)*sizeof(*v));
+		for (k = -d; k <= d; k += 2) {
+			if (k == -d || (k != d && v[off+k-1] < v[off+k+1]))
+				x = v[off+k+1];
+			else
+				x = v[off+k-1]+1;
+			y = x-k;
+			while (x < n && y < m && lines_equal(&a[x], &b[y])) {
+				x++;
+				y++;
+			}
+			v[off+k] = x;
+			if (x >= n && y >= m)
+				goto found;
+		}
+	}
+	rc = EINVAL;
+	goto out;
+found:
+	// walk back, ops are collected in reverse order
+	x = n;
+	y = m;
+	for (; d > 0; d--) {
+		// trace[d][0] is k = -d-1
+		k = x-y;
+		if (k == -d || (k != d && trace[d][k-1+d+1] < trace[d][k+1+d+1]))
+			prev_k = k+1;
+		else
+			prev_k = k-1;
+		prev_x = trace[d][prev_k+d+1];
+		prev_y = prev_x-prev_k;
+		while (x > prev_x && y > prev_y) {
+			ops[(*num_ops)++] = 0;
+			x--;
+			y--;
+		}
+		ops[(*num_ops)++] = (x == prev_x) ? 'i' : 'd';
+		x = prev_x;
+		y = prev_y;
+	}
+	while (x > 0) {
+		ops[(*num_ops)++] = 0;
+		x--;
+	}
+	for (i = 0; i < *num_ops/2; i++) {
+		char tmp = ops[i];
+		ops[i] = ops[*num_ops-1-i];
+		ops[*num_ops-1-i] = tmp;
+	}
+	rc = 0;
+out:
+	if (trace) {
+		for (i = 0; i <= DIFF_MAX_EDITS && trace[i]; i++)
+			free(trace[i]);
+		free(trace);
+	}
+	free(v);
+	return rc;
+}
+
+int printf_line_diff(FILE* f, const char* a, size_t a_len,
+	const char* b, size_t b_len)
+{
+	struct diff_line *a_lines = 0, *b_lines = 0;
+	int n, m, pre, post, num_ops, ai, bi, i, j, rc;
+	char* ops = 0;
+
+	n = split_lines(a, a_len, &a_lines);
+	m = split_lines(b, b_len, &b_lines);
+	if (n < 0 || m < 0) { rc = ENOMEM; goto out; }
+
+	// the common head and tail are not part of the diff
+	for (pre = 0; pre < n && pre < m
+		&& lines_equal(&a_lines[pre], &b_lines[pre]); pre++);
+	for (post = 0; post < n-pre && post < m-pre
+		&& lines_equal(&a_lines[n-1-post], &b_lines[m-1-post]); post++);
+	n -= pre+post;
+	m -= pre+post;
+
+	ops = malloc(n+m+1);
+	if (!ops) { rc = ENOMEM; goto out; }
+	rc = myers_diff(&a_lines[pre], n, &b_lines[pre], m, ops, &num_ops);
+	if (rc == E2BIG) {
+		memset(ops, 'd', n);
+		memset(&ops[n], 'i', m);
+		num_ops = n+m;
+	} else if (rc)
+		goto out;
+
+	ai = pre;
+	bi = pre;
+	for (i = 0; i < num_ops; i = j) {
+		if (!ops[i]) {
+			ai++;
+			bi++;
+			j = i+1;
+			continue;
+		}
+		// a changed region, first removed then added lines
+		for (j = i; j < num_ops && ops[j]; j++) {
+			if (ops[j] == 'd')
+				print_diff_line(f, '-', &a_lines[ai++]);
+		}
+		for (j = i; j < num_ops && ops[j]; j++) {
+			if (ops[j] == 'i')
+				print_diff_line(f, '+', &b_lines[bi++]);
+		}
+	}
+	rc = 0;
+out:
+	free(ops);
+	free(a_lines);
+	free(b_lines);
+	return rc;
+}
+
 //
 // The format of each entry in a bin is.
 //   uint32_t idx
@@ -1242,6 +1606,7 @@ int strarray_find(struct hashed_strarray* array, const char* str)
 	int bin, search_off, i;
 	uint32_t hash;
 
+	STAT_INC(array->num_finds);
 	hash = hash_djb2((const unsigned char*) str);
 	bin = hash % array->num_bins;
 	// iterate over strings in bin to find match
@@ -1262,6 +1627,13 @@ int strarray_find(struct hashed_strarray* array, const char* str)
 	return STRIDX_NO_ENTRY;
 }
 
+static __thread struct alloc_counters s_alloc_counters;
+
+void get_alloc_counters(struct alloc_counters* counters)
+{
+	*counters = s_alloc_counters;
+}
+
 int s_stash_at_bin(struct hashed_strarray* array, const char* str, int idx, int bin);
 
 int strarray_add(struct hashed_strarray* array, const char* str, int* idx)
@@ -1269,6 +1641,8 @@ int strarray_add(struct hashed_strarray* array, const char* str, int* idx)
 	int bin, i, free_index, rc, start_index;
 	unsigned long hash;
 
+	s_alloc_counters.str_adds++;
+	STAT_INC(array->num_adds);
 	*idx = strarray_find(array, str);
 	if (*idx != STRIDX_NO_ENTRY) return 0;
 
@@ -1307,6 +1681,8 @@ int s_stash_at_bin(struct hashed_strarray* array, const char* str, int idx, int
 		new_alloclen = ((array->bin_len[bin]
 				+ BIN_STR_HEADER+str_len+1)/BIN_INCREMENT + 1)
 			  * BIN_INCREMENT;
+		s_alloc_counters.reallocs++;
+		s_alloc_counters.realloc_bytes += new_alloclen;
 		new_ptr = realloc(array->bin_strings[bin], new_alloclen);
 		if (!new_ptr) {
 			fprintf(stderr, "Out of memory.\n");
@@ -1371,8 +1747,7 @@ int strarray_init(struct hashed_strarray* array, int highest_index)
 void strarray_free(struct hashed_strarray* array)
 {
 	int i;
-	for (i = 0; i < sizeof(array->bin_strings)/
-		sizeof(array->bin_strings[0]); i++) {
+	for (i = 0; array->bin_strings && i < array->num_bins; i++) {
 		free(array->bin_strings[i]);
 		array->bin_strings[i] = 0;
 	}
@@ -1386,6 +1761,200 @@ void strarray_free(struct hashed_strarray* array)
 	array->index_to_bin = 0;
 }
 
+// Every allocation is preceded by its size, which lets
+// arena_realloc() grow the most recent allocation in place
+// and arena_release() sort chunks into free lists. Chunks up
+// to ARENA_EXACT_MAX bytes are only reused for the same size,
+// larger ones by power-of-two class.
+struct arena_chunk
+{
+	size_t size;
+	void* next_free; // only valid while the chunk is released
+};
+
+#define ARENA_ALIGN		sizeof(size_t)
+#define ARENA_HDR		sizeof(size_t)
+#define ARENA_MIN_CHUNK		(2*sizeof(void*))
+#define ARENA_EXACT_MAX		(64*1024)
+#define ARENA_NUM_LISTS		(ARENA_EXACT_MAX/ARENA_ALIGN + 64)
+
+struct arena_block
+{
+	struct arena_block* next;
+	size_t size, used;
+	size_t data[];
+};
+
+static int floor_log2(size_t v)
+{
+	int i;
+	for (i = -1; v; i++)
+		v >>= 1;
+	return i;
+}
+
+static int ceil_log2(size_t v)
+{
+	int i = floor_log2(v);
+	return ((size_t) 1 << i) == v ? i : i+1;
+}
+
+// alloc_list() finds the list to allocate size from, free_list()
+// the list that takes a released chunk of size.
+static int alloc_list(size_t size)
+{
+	if (size <= ARENA_EXACT_MAX)
+		return size/ARENA_ALIGN;
+	return ARENA_EXACT_MAX/ARENA_ALIGN + ceil_log2(size);
+}
+
+static int free_list(size_t size)
+{
+	if (size <= ARENA_EXACT_MAX)
+		return size/ARENA_ALIGN;
+	return ARENA_EXACT_MAX/ARENA_ALIGN + floor_log2(size);
+}
+
+static struct arena_chunk* arena_chunk(const void* ptr)
+{
+	return (struct arena_chunk*) ((char*) ptr - ARENA_HDR);
+}
+
+int arena_init(struct arena* arena, size_t block_size)
+{
+	memset(arena, 0, sizeof(*arena));
+	arena->block_size = block_size ? block_size : ARENA_DEFAULT_BLOCK;
+	return 0;
+}
+
+void arena_free(struct arena* arena)
+{
+	struct arena_block* block, *next;
+
+	for (block = arena->blocks; block; block = next) {
+		next = block->next;
+		munmap(block, sizeof(*block) + block->size);
+	}
+	free(arena->free_lists);
+	memset(arena, 0, sizeof(*arena));
+}
+
+static struct arena_block* arena_new_block(struct arena* arena, size_t min_size)
+{
+	struct arena_block* block;
+	size_t size;
+
+	size = arena->block_size;
+	if (min_size > size/4)
+		size = min_size;
+	// Blocks are mapped directly so that arena_free() returns
+	// the memory to the system right away.
+	block = mmap(0, sizeof(*block) + size, PROT_READ|PROT_WRITE,
+		MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+	if (block == MAP_FAILED) return 0;
+	block->size = size;
+	block->used = 0;
+	arena->total_size += size;
+	if (size == min_size && arena->blocks) {
+		// dedicated block, keep bump allocating from the current one
+		block->next = arena->blocks->next;
+		arena->blocks->next = block;
+	} else {
+		block->next = arena->blocks;
+		arena->blocks = block;
+	}
+	return block;
+}
+
+void* arena_alloc(struct arena* arena, size_t size)
+{
+	struct arena_block* block;
+	struct arena_chunk* chunk;
+	size_t chunk_size;
+	int list;
+
+	if (size < ARENA_MIN_CHUNK)
+		size = ARENA_MIN_CHUNK;
+	size = (size + ARENA_ALIGN-1) & ~(ARENA_ALIGN-1);
+	s_alloc_counters.alloc_bytes += size;
+	if (arena->free_lists) {
+		list = alloc_list(size);
+		chunk = arena->free_lists[list];
+		if (chunk) {
+			arena->free_lists[list] = chunk->next_free;
+			memset((char*) chunk + ARENA_HDR, 0, chunk->size);
+			return (char*) chunk + ARENA_HDR;
+		}
+	}
+	chunk_size = ARENA_HDR + size;
+	block = arena->blocks;
+	if (!block || block->size - block->used < chunk_size) {
+		block = arena_new_block(arena, chunk_size);
+		if (!block) return 0;
+	}
+	chunk = (struct arena_chunk*) ((char*) block->data + block->used);
+	block->used += chunk_size;
+	chunk->size = size;
+	// fresh block memory is already zero
+	if (block == arena->blocks)
+		arena->last = (char*) chunk + ARENA_HDR;
+	return (char*) chunk + ARENA_HDR;
+}
+
+void* arena_realloc(struct arena* arena, void* ptr, size_t size)
+{
+	struct arena_chunk* chunk;
+	struct arena_block* block;
+	size_t old_size;
+	void* new_ptr;
+
+	if (!ptr)
+		return arena_alloc(arena, size);
+	chunk = arena_chunk(ptr);
+	old_size = chunk->size;
+	if (size <= old_size)
+		return ptr;
+	size = (size + ARENA_ALIGN-1) & ~(ARENA_ALIGN-1);
+	s_alloc_counters.reallocs++;
+	s_alloc_counters.realloc_bytes += size;
+	block = arena->blocks;
+	if (ptr == arena->last
+	    && block->size - block->used >= size - old_size) {
+		block->used += size - old_size;
+		chunk->size = size;
+		return ptr;
+	}
+	new_ptr = arena_alloc(arena, size);
+	if (!new_ptr) return 0;
+	memcpy(new_ptr, ptr, old_size);
+	arena_release(arena, ptr);
+	return new_ptr;
+}
+
+void arena_release(struct arena* arena, void* ptr)
+{
+	struct arena_chunk* chunk;
+	int list;
+
+	if (!ptr) return;
+	if (!arena->free_lists) {
+		arena->free_lists = calloc(ARENA_NUM_LISTS,
+			sizeof(*arena->free_lists));
+		if (!arena->free_lists) return;
+	}
+	chunk = arena_chunk(ptr);
+	list = free_list(chunk->size);
+	if (ptr == arena->last)
+		arena->last = 0;
+	chunk->next_free = arena->free_lists[list];
+	arena->free_lists[list] = chunk;
+}
+
+size_t arena_size(const void* ptr)
+{
+	return ptr ? arena_chunk(ptr)->size : 0;
+}
+
 int row_pos_to_y(int num_rows, int row, int pos)
 {
 	int y;
@@ -1447,8 +2016,8 @@ int cmdline_package(int argc, char **argv)
 const char *cmdline_strvar(int argc, char **argv, const char *var)
 {
 	enum { NUM_BUFS = 32, BUF_SIZE = 256 };
-	static char buf[NUM_BUFS][BUF_SIZE];
-	static int last_buf = 0;
+	static __thread char buf[NUM_BUFS][BUF_SIZE];
+	static __thread int last_buf = 0;
 	char scan_str[128];
 	int i, next_buf;
 
@@ -37,10 +37,18 @@
 
 #define OUT_OF_U16(val)	((val) < 0 || (val) > 0xFFFF)
 
+// Hot-path counters are only incremented if built with -DFPGA_STATS,
+// otherwise STAT_INC() compiles to nothing.
+#ifdef FPGA_STATS
+  #define STAT_INC(counter)	((counter)++)
+#else
+  #define STAT_INC(counter)	do {} while (0)
+#endif
+
 void printf_stdout(const char* fmt, ...);
 void printf_stderr(const char* fmt, ...);
 const char* bitstr(uint32_t value, int digits);
-void dump_data(int indent, const uint8_t *data, int len, int base);
+void dump_data(FILE* f, int indent, const uint8_t *data, int len, int base);
 
 uint16_t __swab16(uint16_t x);
 uint32_t __swab32(uint32_t x);
@@ -71,11 +79,15 @@ int bool_str2u64(const char *str, uint64_t *u64);
 int bool_str2u32(const char *str, uint32_t *u32);
 int bool_str2lut_pair(const char *str6, const char *str5, uint64_t *lut6_val, uint32_t *lut5_val);
 int bool_str2bits(const char* str, int str_len, uint64_t* u64, int num_bits);
+// bool_bits2str() returns a string that stays valid until the next call,
+// bool_bits2str_r() writes into a caller-provided buffer instead.
+#define BOOL_STR_MAXLEN	2048
 const char* bool_bits2str(uint64_t u64, int num_bits);
+int bool_bits2str_r(uint64_t u64, int num_bits, char *str, int str_size);
 int bool_req_pins(uint64_t u64, int num_bits);
 
-void printf_type2(uint8_t* d, int len, int inpos, int num_entries);
-void printf_ramb_data(const uint8_t *bits, int row, int bram_idx);
+void printf_type2(FILE* f, uint8_t* d, int len, int inpos, int num_entries);
+void printf_ramb_data(FILE* f, const uint8_t *bits, int row, int bram_idx);
 
 typedef struct _bram_init // only first half of array used for bram8
 {
@@ -116,18 +128,18 @@ void frame_set_lut64(uint8_t* two_minors, int v32, uint64_t v);
 
 // if row is negative, it's an absolute frame number and major and
 // minor are ignored
-int printf_frames(const uint8_t* bits, int max_frames, int row, int major,
+int printf_frames(FILE* f, const uint8_t* bits, int max_frames, int row, int major,
 	int minor, int print_empty, int no_clock);
-void printf_clock(const uint8_t* frame, int row, int major, int minor);
+void printf_clock(FILE* f, const uint8_t* frame, int row, int major, int minor);
 int clb_empty(uint8_t* maj_bits, int idx);
-void printf_extrabits(const uint8_t* maj_bits, int start_minor, int num_minors,
+void printf_extrabits(FILE* f, const uint8_t* maj_bits, int start_minor, int num_minors,
 	int start_bit, int num_bits, int row, int major);
 void write_lut64(uint8_t* two_minors, int off_in_frame, uint64_t u64);
-void printf_routing_2minors(const uint8_t* bits, int row, int major,
+void printf_routing_2minors(FILE* f, const uint8_t* bits, int row, int major,
 	int even_minor);
-void printf_v64_mi20(const uint8_t* bits, int row, int major);
+void printf_v64_mi20(FILE* f, const uint8_t* bits, int row, int major);
 const char *fmt_word(int word);
-void printf_lut_words(const uint8_t *major_bits, int row, int major,
+void printf_lut_words(FILE* f, const uint8_t *major_bits, int row, int major,
 	int minor, int v16_i);
 
 int get_vm_mb(void);
@@ -149,6 +161,13 @@ void printf_wrap(FILE* f, char* line, int prefix_len,
 
 uint32_t hash_djb2(const unsigned char* str);
 
+// Prints the lines that differ between the texts a and b like
+// diff -U 0, without the file and hunk headers: for every changed
+// region the removed lines of a with '-', then the added lines
+// of b with '+'. Returns 0 or an errno.
+int printf_line_diff(FILE* f, const char* a, size_t a_len,
+	const char* b, size_t b_len);
+
 // Strings are distributed among bins. Each bin is
 // one continuous stream of zero-terminated strings
 // prefixed with a 32+16=48-bit header. The allocation
@@ -161,6 +180,10 @@ struct hashed_strarray
 	char** bin_strings;
 	int* bin_len;
 	int num_bins;
+
+	// strarray_find() and strarray_add() calls, see STAT_INC()
+	long num_finds;
+	long num_adds;
 };
 
 #define STRIDX_64K	0xFFFF
@@ -182,6 +205,42 @@ int strarray_add(struct hashed_strarray* array, const char* str, int* idx);
 int strarray_stash(struct hashed_strarray* array, const char* str, int idx);
 int strarray_used_slots(struct hashed_strarray* array);
 
+// An arena hands out many small allocations from large blocks,
+// and frees all of them at once in arena_free(). Memory returned
+// by arena_alloc() and arena_realloc() is zeroed. Released chunks
+// are reused by later allocations that fit into them.
+#define ARENA_DEFAULT_BLOCK	(1024*1024)
+
+struct arena_block;
+struct arena
+{
+	struct arena_block* blocks;
+	size_t block_size;
+	size_t total_size; // bytes of all blocks
+	void* last; // most recent allocation, can grow in place
+	void** free_lists; // allocated on first release
+};
+
+// block_size 0 means ARENA_DEFAULT_BLOCK
+int arena_init(struct arena* arena, size_t block_size);
+void arena_free(struct arena* arena);
+void* arena_alloc(struct arena* arena, size_t size);
+void* arena_realloc(struct arena* arena, void* ptr, size_t size);
+void arena_release(struct arena* arena, void* ptr);
+// usable size of an allocation, 0 for a null pointer
+size_t arena_size(const void* ptr);
+
+// Running per-thread totals of string array and arena activity,
+// sampled by the model build profiler.
+struct alloc_counters
+{
+	long str_adds; // strarray_add() calls
+	long reallocs; // growing arena_realloc() and string bin reallocs
+	long realloc_bytes; // new size of those reallocs
+	long alloc_bytes; // arena_alloc() bytes
+};
+void get_alloc_counters(struct alloc_counters* counters);
+
 int row_pos_to_y(int num_rows, int row, int pos);
 
 int cmdline_help(int argc, char **argv);
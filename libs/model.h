@@ -18,6 +18,22 @@
 
 #define LEFT_SIDE_MAJOR 1
 
+// Call counts of the hot-path primitives over the life of a model,
+// see fpga_print_stats(). The strarray_find() and strarray_add()
+// counts are kept in model->str.
+struct fpga_stats
+{
+	long connpt_finds; // fpga_connpt_find()
+	long switch_firsts; // fpga_switch_first()
+	long switch_nexts; // fpga_switch_next()
+	long chain_steps; // fpga_switch_chain()
+	long other_net_checks; // fpga_swset_in_other_net()
+	long bit_gets; // get_bit() in extract_model()
+	long bit_sets; // set_bit() and clear_bit() in extract_model()
+		       // and write_model()
+	long net_allocs; // fnet_new()
+};
+
 struct fpga_model
 {
 	int rc; // if rc != 0, all function calls will immediately return
@@ -44,11 +60,80 @@ struct fpga_model
 
 	struct fpga_tile* tiles;
 	struct hashed_strarray str;
+	// The per-tile arrays of devices, connection points and
+	// switches are allocated from the arena and freed together
+	// in fpga_free_model().
+	struct arena arena;
+	// Tile classification for is_atx(), is_aty(), is_atyx() and
+	// is_in_row(), filled in by init_tile_masks() once tiles and
+	// devices are final. Until then the predicates compute their
+	// result directly.
+	uint32_t* x_mask; // X_ bits for every x
+	uint32_t* y_mask; // Y_ bits for every y
+	uint32_t* yx_mask; // YX_ bits for every tile
+	int* row_num, *row_pos; // for every y, -1 if not in a row
+
+	// Conversions between enum extra_wires and str16_t, filled
+	// in by init_wire_tables() for the wires of sw_bitpos and
+	// completed on demand by the lookup functions.
+	// wire_str is 0 (STRIDX_NO_ENTRY) if not known yet,
+	// str_wire is STR_WIRE_UNKNOWN if not decoded yet.
+	str16_t* wire_str; // for every wire up to MW_LAST
+	str16_t gclk_brk_str[16]; // GCLK0_BRK to GCLK15_BRK
+	uint16_t* str_wire; // for every str16_t
+
+	// Package pin and type-2 IO lookups, built by init_iob_index().
+	// The hash tables have iob_hash_size slots, each holding an
+	// index into pkg->pin or die->t2_io plus 1, or 0 if empty.
+	int iob_hash_size; // power of two
+	int* pin_name_hash;
+	int* pin_desc_hash;
+	int* t2_io_yx_hash; // by y, x and type_idx
+	int* pin_t2_io; // t2_io index for every pin, -1 if none
+	int* t2_io_pin; // pin index for every t2_io, -1 if none
+
+	// Distinct device pinwire arrays, shared by all devices
+	// with the same pinwires (see fpga_device.pinw).
+	int num_pinw_tables;
+	const str16_t** pinw_tables;
+
+	// During the sizing pass of fpga_build_model_exact(),
+	// connection destinations are only counted, not stored.
+	int sizing_pass;
+
+	// A model built with fpga_build_model_lazy() defers ports,
+	// connections and switches per region until a tile in that
+	// region is first accessed. Regions are the clock rows of
+	// the die, y_region maps every y to its region. While a
+	// region is built, only tiles in building_region are
+	// changed. lazy is cleared once all regions are built.
+	int lazy;
+	int num_regions;
+	int* y_region;
+	uint8_t* region_built;
+	int building_region;
+
+	// Only allocated if build profiling is on, see
+	// fpga_build_profile().
+	struct fpga_prof* prof;
+
+	// Only counted if built with FPGA_STATS, see STAT_INC().
+	struct fpga_stats stats;
 
 	int nets_array_size;
 	int highest_used_net; // 1-based net_idx_t
 	struct fpga_net* nets;
 
+	// Tiles with enabled switches and devices that received their
+	// own config since the model was built or last reset. Only
+	// those are visited by fpga_reset_model().
+	int num_journal_tiles, journal_tiles_size;
+	int* journal_tiles; // y*x_width+x
+	// one byte per tile, set while the tile is in journal_tiles
+	uint8_t* journal_tile_marks;
+	int num_journal_devs, journal_devs_size;
+	struct fpga_device** journal_devs;
+
 	// tmp_str will be allocated to hold max(x_width, y_height)
 	// pointers, useful for string seeding when running wires.
 	const char** tmp_str;
@@ -299,6 +384,19 @@ int is_atx(int check, struct fpga_model* model, int x);
 
 int is_atyx(int check, struct fpga_model* model, int y, int x);
 
+// init_iob_index() builds the pin and IOB site tables used by
+// fpga_find_iob(), fpga_find_pkg_pin() and fpga_iob_sitename().
+int init_iob_index(struct fpga_model* model);
+// find_pkg_pin() returns the index of the package pin with the
+// given name or description, find_t2_io() the index of the type-2
+// IO at y/x/type_idx. Both return -1 if there is none.
+int find_pkg_pin(struct fpga_model* model, const char* str, int by_desc);
+int find_t2_io(struct fpga_model* model, int y, int x, int type_idx);
+
+// init_tile_masks() precomputes the tables behind is_atx(),
+// is_aty(), is_atyx() and is_in_row().
+int init_tile_masks(struct fpga_model* model);
+
 // if not in row, both return values (if given) will
 // be set to -1. the row_pos is 0..7 for the upper half,
 // 8 for the hclk, and 9..16 for the lower half.
@@ -326,6 +424,7 @@ enum fpgadev_type
 	DEV_POST_CRC_INTERNAL, DEV_STARTUP, DEV_SLAVE_SPI,
 	DEV_SUSPEND_SYNC, DEV_OCT_CALIBRATE, DEV_SPI_ACCESS,
 	DEV_DNA, DEV_PMV, DEV_PCILOGIC_SE, DEV_MCB };
+#define DEV_TYPE_COUNT (DEV_MCB+1)
 #define FPGA_DEV_STR \
 	{ 0, \
 	  "LOGIC", "TIEOFF", "MACC", "IOB", \
@@ -767,6 +866,20 @@ typedef int pinw_idx_t; // index into pinw array
 // combined), macc about 350, mcb about 1200.
 #define MAX_NUM_PINW	2048
 
+// Per-instance configuration, allocated only for configured devices.
+union fpgadev_cfg
+{
+	struct fpgadev_logic logic;
+	struct fpgadev_iob iob;
+	struct fpgadev_bufgmux bufgmux;
+	struct fpgadev_bufio bufio;
+	struct fpgadev_bscan bscan;
+	struct fpgadev_bram bram;
+};
+
+// All unconfigured devices point u to this read-only zero config.
+extern const union fpgadev_cfg fdev_no_cfg;
+
 struct fpga_device
 {
 	enum fpgadev_type type;
@@ -777,29 +890,26 @@ struct fpga_device
 	// BRAM:  BRAM16, BRAM8
 	int subtype;
 	int instantiated;
+	// set while the device is in model->journal_devs
+	int journaled;
 
 	int num_pinw_total, num_pinw_in;
 	// The array holds first the input wires, then the output wires.
 	// Unused members are set to STRIDX_NO_ENTRY.
-	str16_t* pinw;
+	// Devices with identical pinwires share one array.
+	const str16_t* pinw;
 
 	// required pinwires depend on the given config and will
 	// be deleted/invalidated on any config change.
 	int pinw_req_total, pinw_req_in;
 	pinw_idx_t* pinw_req_for_cfg;
-	
-	// the rest will be memset to 0 on any device removal/uninstantiation
-	union {
-		struct fpgadev_logic logic;
-		struct fpgadev_iob iob;
-		struct fpgadev_bufgmux bufgmux;
-		struct fpgadev_bufio bufio;
-		struct fpgadev_bscan bscan;
-		struct fpgadev_bram bram;
-	} u;
+
+	// u is &fdev_no_cfg until fdev_cfg() gives the device its
+	// own config, which also holds pinw_req_for_cfg. It is
+	// released and reset on any device removal/uninstantiation.
+	union fpgadev_cfg* u;
 };
 
-#define SWITCH_USED		0x80000000
 #define SWITCH_BIDIRECTIONAL	0x40000000
 #define SWITCH_MAX_CONNPT_O	0x7FFF // 15 bits
 #define SW_FROM_I(u32)		(((u32) >> 15) & SWITCH_MAX_CONNPT_O)
@@ -820,6 +930,24 @@ struct fpga_device
 typedef int connpt_t; // index into conn_point_names (not yet *2)
 #define CONNPT_STR16(tile, connpt)	((tile)->conn_point_names[(connpt)*2+1])
 
+// The switches of most routing tiles are identical, they share
+// one read-only template and only keep their own used bits.
+// refcount is the number of tiles using the template. The
+// connection point names of the template tile are copied when
+// the template is made, so that more tiles can be replicated
+// after the template tile received its connections.
+struct fpga_sw_template
+{
+	int refcount;
+	int num_switches;
+	uint32_t* switches;
+	int num_conn_point_names;
+	uint16_t* conn_point_names;
+};
+
+#define SWITCH_IS_USED(tile, sw_idx) \
+	(((tile)->switches_used[(sw_idx)/32] >> ((sw_idx)%32)) & 1)
+
 struct fpga_tile
 {
 	enum fpga_tile_type type;
@@ -828,6 +956,14 @@ struct fpga_tile
 	// expect up to 64 devices per tile
 	int num_devs;
 	struct fpga_device* devs;
+	// dev_index is built by init_devices() and maps
+	// (type, type_idx) to dev_idx without scanning devs:
+	//   dev_index[0..DEV_TYPE_COUNT] - start of each type in
+	//     the list below, dev_index[type+1]-dev_index[type]
+	//     is the number of devices of that type
+	//   dev_index[DEV_TYPE_COUNT+1..] - num_devs dev_idx values,
+	//     grouped by type and in type_idx order
+	uint8_t* dev_index;
 
 	// expect up to 5k connection point names per tile
 	// 2*16 bit per entry
@@ -846,17 +982,103 @@ struct fpga_tile
 	uint16_t* conn_point_dests; // num_conn_point_dests*3 16-bit words: 16(x)-16(y)-16(conn_name)
 
 	// expect up to 4k switches per tile
-	// 32bit: 31    off: no connection   on: connected
+	// 32bit: 31    unused
 	//        30    off: unidirectional  on: bidirectional
 	//        29:15 from, index into conn_point_names (not yet *2)
 	//        14:0  to, index into conn_point_names (not yet *2)
+	// If sw_template is set, switches points into the shared
+	// template and must not be written to.
 	int num_switches;
 	uint32_t* switches;
+	struct fpga_sw_template* sw_template;
+	// one bit per switch: off: no connection  on: connected
+	uint32_t* switches_used;
 };
 
 int fpga_build_model(struct fpga_model* model, int idcode, enum xc6_pkg pkg);
+// fpga_build_model_exact() first runs a sizing pass that counts
+// the final size of all per-tile arrays, then builds the model
+// again into one exactly sized arena block. This takes longer,
+// but peak and final memory use are lower.
+int fpga_build_model_exact(struct fpga_model* model, int idcode,
+	enum xc6_pkg pkg);
+// fpga_build_model_lazy() only builds tiles and devices. Ports,
+// connections and switches of a region are built the first time
+// a tile in it is accessed through the connection point, switch
+// or wire lookup functions. Code that walks the arrays of all
+// tiles directly must call fpga_materialize_all() first.
+int fpga_build_model_lazy(struct fpga_model* model, int idcode,
+	enum xc6_pkg pkg);
+// Both return model->rc and are no-ops for a fully built model.
+int fpga_materialize_tile(struct fpga_model* model, int y, int x);
+int fpga_materialize_all(struct fpga_model* model);
+// Nonzero if ports, connections and switches for tile y/x are
+// deferred and must not be added now.
+int routing_deferred(struct fpga_model* model, int y, int x);
 // returns model->rc (model itself will be memset to 0)
 int fpga_free_model(struct fpga_model* model);
+// fpga_reset_model() returns a built model to the state right after
+// fpga_build_model(): all devices are uninstantiated, all nets are
+// freed and all switches are disabled. The time taken depends on
+// the number of journaled tiles and devices, not the model size.
+// Returns model->rc, a model with an error must be rebuilt.
+int fpga_reset_model(struct fpga_model* model);
+// Called by fpga_switch_enable() and fdev_cfg() to add a tile or
+// device to the journal.
+void fpga_journal_tile(struct fpga_model* model, int y, int x);
+void fpga_journal_dev(struct fpga_model* model, struct fpga_device* dev);
+
+//
+// Build profiling records wall time, strarray_add() calls, reallocs
+// and arena bytes for every phase of the model build. Phases with
+// the same name are summed up. Setting FPGA_PROFILE=1 (table) or
+// FPGA_PROFILE=json in the environment prints the profile to stderr
+// when the model is built, or for lazy models when it is freed.
+//
+
+enum { FPGA_PROF_OFF = 0, FPGA_PROF_TABLE, FPGA_PROF_JSON };
+
+#define PROF_MAX_PHASES	128
+
+struct fpga_prof_phase
+{
+	const char* name; // up to the first '('
+	int parent; // -1 for top-level phases
+	int calls;
+	double seconds;
+	struct alloc_counters counters;
+};
+
+struct fpga_prof
+{
+	int lazy; // print when the model is freed
+	int cur_phase; // -1 outside of all phases
+	int num_phases;
+	struct fpga_prof_phase phases[PROF_MAX_PHASES];
+};
+
+// Turns profiling on or off for models built afterwards. Not to be
+// called while other threads build models.
+void fpga_build_profile(int on);
+// format is FPGA_PROF_TABLE or FPGA_PROF_JSON
+void fpga_print_profile(FILE* f, struct fpga_model* model, int format);
+
+int prof_begin(struct fpga_model* model, const char* name);
+void prof_end(struct fpga_model* model, int phase_i);
+
+// Runs call as a profiled phase named after the called function.
+#define PROF(model, call) do { \
+	int prof_phase_i = (model)->prof ? prof_begin(model, #call) : -1; \
+	call; \
+	if (prof_phase_i != -1) prof_end(model, prof_phase_i); \
+} while (0)
+
+// Nonzero if the library was built with FPGA_STATS (make STATS=1).
+int fpga_stats_enabled(void);
+// Prints model->stats and the string array counts, one counter per
+// line. Without FPGA_STATS all counters are 0 and only a note is
+// printed.
+void fpga_print_stats(FILE* f, struct fpga_model* model);
 
 const char* fpga_tiletype_str(enum fpga_tile_type type);
 
@@ -918,9 +1140,10 @@ int add_switch(struct fpga_model* model, int y, int x, const char* from,
 int add_switch_set(struct fpga_model* model, int y, int x, const char* prefix,
 	const char** pairs, int suffix_inc);
 
-// This will replicate the entire conn_point_names and switches arrays
-// from one tile to another, assuming that all of conn_point_names,
-// switches and conn_point_dests in the destination tile are empty.
+// This will replicate the entire conn_point_names array from one tile
+// to another, and let the destination tile share the switches of the
+// source tile. Assumes that all of conn_point_names, switches and
+// conn_point_dests in the destination tile are empty.
 int replicate_switches_and_names(struct fpga_model* model,
 	int y_from, int x_from, int y_to, int x_to);
 
@@ -1169,6 +1392,14 @@ str16_t fpga_iologic_wire2str_yx(struct fpga_model *model,
 const char* fpga_wire2str(enum extra_wires wire);
 str16_t fpga_wire2str_i(struct fpga_model* model, enum extra_wires wire);
 enum extra_wires fpga_str2wire(const char* str);
+// fpga_str2wire_i() decodes a string index with the table in
+// the model, each string is only parsed the first time.
+enum extra_wires fpga_str2wire_i(struct fpga_model* model, str16_t str_i);
+
+#define STR_WIRE_UNKNOWN	0xFFFF
+// init_wire_tables() can be called again after more strings
+// were added, it only fills in entries that are still unknown.
+int init_wire_tables(struct fpga_model* model);
 int fdev_logic_inbit(pinw_idx_t idx);
 int fdev_logic_outbit(pinw_idx_t idx);
 
@@ -39,43 +39,43 @@ int init_conns(struct fpga_model *model)
 {
 	RC_CHECK(model);
 
-	bufpll(model);
-	reg_ioclk(model);
-	reg_lock(model);
-	reg_pll_dcm(model);
-	gtp(model);
-	macc(model);
-	clkc(model);
-	mui(model);
-	cfb_dfb_clkpin_dqsn_dqsp(model);
-	pci(model);
-	pcice(model);
-	term_topbot(model);
-	term_leftright(model);
-
-	term_to_io(model, IOCE);
-	term_to_io(model, IOCLK);
-	term_to_io(model, PLLCE);
-	term_to_io(model, PLLCLK);
-
-	clkpll(model);
-	ckpin(model);
-	clkindirect_feedback(model, CLK_INDIRECT);
-	clkindirect_feedback(model, CLK_FEEDBACK);
-
-	run_gclk(model);
-	run_gclk_horiz_regs(model);
-	run_gclk_vert_regs(model);
-
-	connect_logic_carry(model);
-	connect_clk_sr(model, "CLK");
-	connect_clk_sr(model, "SR");
-	run_gfan(model);
-	run_io_wires(model);
-	run_logic_inout(model);
+	PROF(model, bufpll(model));
+	PROF(model, reg_ioclk(model));
+	PROF(model, reg_lock(model));
+	PROF(model, reg_pll_dcm(model));
+	PROF(model, gtp(model));
+	PROF(model, macc(model));
+	PROF(model, clkc(model));
+	PROF(model, mui(model));
+	PROF(model, cfb_dfb_clkpin_dqsn_dqsp(model));
+	PROF(model, pci(model));
+	PROF(model, pcice(model));
+	PROF(model, term_topbot(model));
+	PROF(model, term_leftright(model));
+
+	PROF(model, term_to_io(model, IOCE));
+	PROF(model, term_to_io(model, IOCLK));
+	PROF(model, term_to_io(model, PLLCE));
+	PROF(model, term_to_io(model, PLLCLK));
+
+	PROF(model, clkpll(model));
+	PROF(model, ckpin(model));
+	PROF(model, clkindirect_feedback(model, CLK_INDIRECT));
+	PROF(model, clkindirect_feedback(model, CLK_FEEDBACK));
+
+	PROF(model, run_gclk(model));
+	PROF(model, run_gclk_horiz_regs(model));
+	PROF(model, run_gclk_vert_regs(model));
+
+	PROF(model, connect_logic_carry(model));
+	PROF(model, connect_clk_sr(model, "CLK"));
+	PROF(model, connect_clk_sr(model, "SR"));
+	PROF(model, run_gfan(model));
+	PROF(model, run_io_wires(model));
+	PROF(model, run_logic_inout(model));
 
 	// it's a little faster to do the dirwires last
-	run_dirwires(model);
+	PROF(model, run_dirwires(model));
 
 	RC_RETURN(model);
 }
@@ -13,6 +13,11 @@ static int add_dev(struct fpga_model* model,
 	int y, int x, int type, int subtype);
 static int init_iob(struct fpga_model* model, int y, int x, int idx);
 static int init_logic(struct fpga_model* model, int y, int x, int idx);
+static int index_devices(struct fpga_model* model);
+static int share_pinw(struct fpga_model* model, struct fpga_device* dev,
+	const str16_t* pinw);
+
+const union fpgadev_cfg fdev_no_cfg;
 
 int init_devices(struct fpga_model* model)
 {
@@ -322,11 +327,42 @@ int init_devices(struct fpga_model* model)
 			}
 		}
 	}
-	return 0;
+	return index_devices(model);
 fail:
 	return rc;
 }
 
+static int index_devices(struct fpga_model* model)
+{
+	struct fpga_tile* tile;
+	int x, y, i, type, pos[DEV_TYPE_COUNT];
+
+	RC_CHECK(model);
+	for (y = 0; y < model->y_height; y++) {
+		for (x = 0; x < model->x_width; x++) {
+			tile = YX_TILE(model, y, x);
+			if (!tile->num_devs)
+				continue;
+			RC_ASSERT(model, tile->num_devs <= UINT8_MAX);
+			tile->dev_index = arena_alloc(&model->arena,
+				DEV_TYPE_COUNT+1+tile->num_devs);
+			if (!tile->dev_index) RC_FAIL(model, ENOMEM);
+
+			// count, then turn the counts into start offsets
+			for (i = 0; i < tile->num_devs; i++)
+				tile->dev_index[tile->devs[i].type+1]++;
+			for (type = 0; type < DEV_TYPE_COUNT; type++) {
+				tile->dev_index[type+1] += tile->dev_index[type];
+				pos[type] = tile->dev_index[type];
+			}
+			for (i = 0; i < tile->num_devs; i++)
+				tile->dev_index[DEV_TYPE_COUNT+1
+					+ pos[tile->devs[i].type]++] = i;
+		}
+	}
+	RC_RETURN(model);
+}
+
 void free_devices(struct fpga_model* model)
 {
 	struct fpga_tile* tile;
@@ -346,14 +382,15 @@ void free_devices(struct fpga_model* model)
 				fdev_delete(model, y, x, tile->devs[i].type,
 					fdev_typeidx(model, y, x, i));
 			}
-			free(tile->devs);
 			tile->devs = 0;
 			tile->num_devs = 0;
+			tile->dev_index = 0;
 		}
 	}
 }
 
 #define DEV_INCREMENT 4
+#define PINW_TABLES_INCREMENT 16
 
 static int add_dev(struct fpga_model* model,
 	int y, int x, int type, int subtype)
@@ -364,12 +401,10 @@ static int add_dev(struct fpga_model* model,
 
 	RC_CHECK(model);
 	tile = YX_TILE(model, y, x);
-	if (!(tile->num_devs % DEV_INCREMENT)) {
-		void* new_ptr = realloc(tile->devs,
+	if ((tile->num_devs+1)*sizeof(*tile->devs) > arena_size(tile->devs)) {
+		void* new_ptr = arena_realloc(&model->arena, tile->devs,
 			(tile->num_devs+DEV_INCREMENT)*sizeof(*tile->devs));
 		EXIT(!new_ptr);
-		memset(new_ptr + tile->num_devs * sizeof(*tile->devs),
-			0, DEV_INCREMENT*sizeof(*tile->devs));
 		tile->devs = new_ptr;
 	}
 	new_dev_i = tile->num_devs;
@@ -378,6 +413,7 @@ static int add_dev(struct fpga_model* model,
 	// init new device
 	tile->devs[new_dev_i].type = type;
 	tile->devs[new_dev_i].subtype = subtype;
+	tile->devs[new_dev_i].u = (union fpgadev_cfg*) &fdev_no_cfg;
 	if (type == DEV_IOB) {
 		rc = init_iob(model, y, x, new_dev_i);
 		if (rc) FAIL(rc);
@@ -396,6 +432,7 @@ static int init_iob(struct fpga_model* model, int y, int x, int idx)
 	const char* prefix;
 	int type_idx, rc;
 	char tmp_str[128];
+	str16_t pinw[IOB_LAST_OUTPUT_PINW+1];
 
 	RC_CHECK(model);
 	tile = YX_TILE(model, y, x);
@@ -411,40 +448,38 @@ static int init_iob(struct fpga_model* model, int y, int x, int idx)
 	else
 		FAIL(EINVAL);
 
-	tile->devs[idx].pinw = calloc((IOB_LAST_OUTPUT_PINW+1)
-		*sizeof(tile->devs[idx].pinw[0]), /*elsize*/ 1);
-	if (!tile->devs[idx].pinw) FAIL(ENOMEM);
+	memset(pinw, 0, sizeof(pinw));
 	tile->devs[idx].num_pinw_total = IOB_LAST_OUTPUT_PINW+1;
 	tile->devs[idx].num_pinw_in = IOB_LAST_INPUT_PINW+1;
 
 	snprintf(tmp_str, sizeof(tmp_str), "%s_O%i_PINW", prefix, type_idx);
 	rc = add_connpt_name(model, y, x, tmp_str, /*dup_warn*/ 1,
-		&tile->devs[idx].pinw[IOB_IN_O], 0);
+		&pinw[IOB_IN_O], 0);
 	if (rc) FAIL(rc);
 	snprintf(tmp_str, sizeof(tmp_str), "%s_T%i_PINW", prefix, type_idx);
 	rc = add_connpt_name(model, y, x, tmp_str, /*dup_warn*/ 1,
-		&tile->devs[idx].pinw[IOB_IN_T], 0);
+		&pinw[IOB_IN_T], 0);
 	if (rc) FAIL(rc);
 	snprintf(tmp_str, sizeof(tmp_str), "%s_DIFFI_IN%i", prefix, type_idx);
 	rc = add_connpt_name(model, y, x, tmp_str, /*dup_warn*/ 1,
-		&tile->devs[idx].pinw[IOB_IN_DIFFI_IN], 0);
+		&pinw[IOB_IN_DIFFI_IN], 0);
 	if (rc) FAIL(rc);
 	snprintf(tmp_str, sizeof(tmp_str), "%s_DIFFO_IN%i", prefix, type_idx);
 	rc = add_connpt_name(model, y, x, tmp_str, /*dup_warn*/ 1,
-		&tile->devs[idx].pinw[IOB_IN_DIFFO_IN], 0);
+		&pinw[IOB_IN_DIFFO_IN], 0);
 	if (rc) FAIL(rc);
 
 	snprintf(tmp_str, sizeof(tmp_str), "%s_IBUF%i_PINW", prefix, type_idx);
 	rc = add_connpt_name(model, y, x, tmp_str, /*dup_warn*/ 1,
-		&tile->devs[idx].pinw[IOB_OUT_I], 0);
+		&pinw[IOB_OUT_I], 0);
 	if (rc) FAIL(rc);
 	snprintf(tmp_str, sizeof(tmp_str), "%s_PADOUT%i", prefix, type_idx);
 	rc = add_connpt_name(model, y, x, tmp_str, /*dup_warn*/ 1,
-		&tile->devs[idx].pinw[IOB_OUT_PADOUT], 0);
+		&pinw[IOB_OUT_PADOUT], 0);
 	if (rc) FAIL(rc);
 	snprintf(tmp_str, sizeof(tmp_str), "%s_DIFFO_OUT%i", prefix, type_idx);
 	rc = add_connpt_name(model, y, x, tmp_str, /*dup_warn*/ 1,
-		&tile->devs[idx].pinw[IOB_OUT_DIFFO_OUT], 0);
+		&pinw[IOB_OUT_DIFFO_OUT], 0);
 	if (rc) FAIL(rc);
 
 	if (!x && y == model->center_y - CENTER_TOP_IOB_O && type_idx == 1)
@@ -460,9 +495,9 @@ static int init_iob(struct fpga_model* model, int y, int x, int idx)
 			"%s_PCI_RDY%i", prefix, type_idx);
 	}
 	rc = add_connpt_name(model, y, x, tmp_str, /*dup_warn*/ 1,
-		&tile->devs[idx].pinw[IOB_OUT_PCI_RDY], 0);
+		&pinw[IOB_OUT_PCI_RDY], 0);
 	if (rc) FAIL(rc);
-	return 0;
+	return share_pinw(model, &tile->devs[idx], pinw);
 fail:
 	return rc;
 }
@@ -472,6 +507,7 @@ static int init_logic(struct fpga_model* model, int y, int x, int idx)
 	struct fpga_tile* tile;
 	const char* pre;
 	int i, j, rc;
+	str16_t pinw[LO_LAST+1];
 
 	RC_CHECK(model);
 	tile = YX_TILE(model, y, x);
@@ -484,9 +520,7 @@ static int init_logic(struct fpga_model* model, int y, int x, int idx)
 			? "XX_" : "X_";
 	} else FAIL(EINVAL);
 
-	tile->devs[idx].pinw = calloc((LO_LAST+1)
-		*sizeof(tile->devs[idx].pinw[0]), /*elsize*/ 1);
-	if (!tile->devs[idx].pinw) FAIL(ENOMEM);
+	memset(pinw, 0, sizeof(pinw));
 	tile->devs[idx].num_pinw_total = LO_LAST+1;
 	tile->devs[idx].num_pinw_in = LI_LAST+1;
 
@@ -494,52 +528,52 @@ static int init_logic(struct fpga_model* model, int y, int x, int idx)
 		for (j = 0; j < 6; j++) {
 			rc = add_connpt_name(model, y, x, pf("%s%c%i", pre, 'A'+i, j+1),
 				/*dup_warn*/ 1,
-				&tile->devs[idx].pinw[LI_A1+i*6+j], 0);
+				&pinw[LI_A1+i*6+j], 0);
 			if (rc) FAIL(rc);
 		}
 		rc = add_connpt_name(model, y, x, pf("%s%cX", pre, 'A'+i),
 			/*dup_warn*/ 1,
-			&tile->devs[idx].pinw[LI_AX+i], 0);
+			&pinw[LI_AX+i], 0);
 		if (rc) FAIL(rc);
 		if (tile->devs[idx].subtype == LOGIC_M) {
 			rc = add_connpt_name(model, y, x, pf("%s%cI", pre, 'A'+i),
 				/*dup_warn*/ 1,
-				&tile->devs[idx].pinw[LI_AI+i], 0);
+				&pinw[LI_AI+i], 0);
 			if (rc) FAIL(rc);
 		} else
-			tile->devs[idx].pinw[LI_AI+i] = STRIDX_NO_ENTRY;
+			pinw[LI_AI+i] = STRIDX_NO_ENTRY;
 		rc = add_connpt_name(model, y, x, pf("%s%c", pre, 'A'+i),
 			/*dup_warn*/ 1,
-			&tile->devs[idx].pinw[LO_A+i], 0);
+			&pinw[LO_A+i], 0);
 		if (rc) FAIL(rc);
 		rc = add_connpt_name(model, y, x, pf("%s%cMUX", pre, 'A'+i),
 			/*dup_warn*/ 1,
-			&tile->devs[idx].pinw[LO_AMUX+i], 0);
+			&pinw[LO_AMUX+i], 0);
 		if (rc) FAIL(rc);
 		rc = add_connpt_name(model, y, x, pf("%s%cQ", pre, 'A'+i),
 			/*dup_warn*/ 1,
-			&tile->devs[idx].pinw[LO_AQ+i], 0);
+			&pinw[LO_AQ+i], 0);
 		if (rc) FAIL(rc);
 	}
 	rc = add_connpt_name(model, y, x, pf("%sCLK", pre),
 		/*dup_warn*/ 1,
-		&tile->devs[idx].pinw[LI_CLK], 0);
+		&pinw[LI_CLK], 0);
 	if (rc) FAIL(rc);
 	rc = add_connpt_name(model, y, x, pf("%sCE", pre),
 		/*dup_warn*/ 1,
-		&tile->devs[idx].pinw[LI_CE], 0);
+		&pinw[LI_CE], 0);
 	if (rc) FAIL(rc);
 	rc = add_connpt_name(model, y, x, pf("%sSR", pre),
 		/*dup_warn*/ 1,
-		&tile->devs[idx].pinw[LI_SR], 0);
+		&pinw[LI_SR], 0);
 	if (rc) FAIL(rc);
 	if (tile->devs[idx].subtype == LOGIC_M) {
 		rc = add_connpt_name(model, y, x, pf("%sWE", pre),
 			/*dup_warn*/ 1,
-			&tile->devs[idx].pinw[LI_WE], 0);
+			&pinw[LI_WE], 0);
 		if (rc) FAIL(rc);
 	} else
-		tile->devs[idx].pinw[LI_WE] = STRIDX_NO_ENTRY;
+		pinw[LI_WE] = STRIDX_NO_ENTRY;
 	if (tile->devs[idx].subtype != LOGIC_X) {
 		// Wire connections will go to some CIN later
 		// (and must not warn about duplicates), but we
@@ -547,24 +581,58 @@ static int init_logic(struct fpga_model* model, int y, int x, int idx)
 		// that pinw[LI_CIN] is initialized.
 		rc = add_connpt_name(model, y, x, pf("%sCIN", pre),
 			/*dup_warn*/ 1,
-			&tile->devs[idx].pinw[LI_CIN], 0);
+			&pinw[LI_CIN], 0);
 		if (rc) FAIL(rc);
 	} else
-		tile->devs[idx].pinw[LI_CIN] = STRIDX_NO_ENTRY;
+		pinw[LI_CIN] = STRIDX_NO_ENTRY;
 	if (tile->devs[idx].subtype == LOGIC_M) {
 		rc = add_connpt_name(model, y, x, "M_COUT",
 			/*dup_warn*/ 1,
-			&tile->devs[idx].pinw[LO_COUT], 0);
+			&pinw[LO_COUT], 0);
 		if (rc) FAIL(rc);
 	} else if (tile->devs[idx].subtype == LOGIC_L) {
 		rc = add_connpt_name(model, y, x, "XL_COUT",
 			/*dup_warn*/ 1,
-			&tile->devs[idx].pinw[LO_COUT], 0);
+			&pinw[LO_COUT], 0);
 		if (rc) FAIL(rc);
 	} else 
-		tile->devs[idx].pinw[LO_COUT] = STRIDX_NO_ENTRY;
+		pinw[LO_COUT] = STRIDX_NO_ENTRY;
 
-	return 0;
+	return share_pinw(model, &tile->devs[idx], pinw);
 fail:
 	return rc;
 }
+
+// All devices of one type and name prefix have the same pinwires,
+// so only distinct arrays are stored in the model.
+static int share_pinw(struct fpga_model* model, struct fpga_device* dev,
+	const str16_t* pinw)
+{
+	size_t size;
+	str16_t* new_pinw;
+	int i;
+
+	RC_CHECK(model);
+	size = dev->num_pinw_total*sizeof(*pinw);
+	for (i = 0; i < model->num_pinw_tables; i++) {
+		if (arena_size(model->pinw_tables[i]) >= size
+		    && !memcmp(model->pinw_tables[i], pinw, size)) {
+			dev->pinw = model->pinw_tables[i];
+			RC_RETURN(model);
+		}
+	}
+	if ((model->num_pinw_tables+1)*sizeof(*model->pinw_tables)
+	    > arena_size(model->pinw_tables)) {
+		void* new_ptr = arena_realloc(&model->arena,
+			model->pinw_tables, (model->num_pinw_tables
+			+ PINW_TABLES_INCREMENT)*sizeof(*model->pinw_tables));
+		if (!new_ptr) RC_FAIL(model, ENOMEM);
+		model->pinw_tables = new_ptr;
+	}
+	new_pinw = arena_alloc(&model->arena, size);
+	if (!new_pinw) RC_FAIL(model, ENOMEM);
+	memcpy(new_pinw, pinw, size);
+	model->pinw_tables[model->num_pinw_tables++] = new_pinw;
+	dev->pinw = new_pinw;
+	RC_RETURN(model);
+}
@@ -14,8 +14,8 @@ const char* pf(const char* fmt, ...)
 {
 	// safe to call it NUM_PF_BUFStimes in 1 expression,
 	// such as function params or a net structure
-	static char pf_buf[NUM_PF_BUFS][128];
-	static int last_buf = 0;
+	static __thread char pf_buf[NUM_PF_BUFS][128];
+	static __thread int last_buf = 0;
 	va_list list;
 	last_buf = (last_buf+1)%NUM_PF_BUFS;
 	pf_buf[last_buf][0] = 0;
@@ -27,8 +27,8 @@ const char* pf(const char* fmt, ...)
 
 const char* wpref(struct fpga_model* model, int y, int x, const char* wire_name)
 {
-	static char buf[8][128];
-	static int last_buf = 0;
+	static __thread char buf[8][128];
+	static __thread int last_buf = 0;
 	const char *prefix;
 	int i;
 
@@ -99,6 +99,8 @@ int has_connpt(struct fpga_model* model, int y, int x,
 	uint16_t name_i;
 	int i;
 
+	if (fpga_materialize_tile(model, y, x))
+		return 0;
 	i = strarray_find(&model->str, name);
 	if (i == STRIDX_NO_ENTRY)
 		return 0;
@@ -112,18 +114,36 @@ int has_connpt(struct fpga_model* model, int y, int x,
 	return 0;
 }
 
+// Grows a per-tile array in the model arena so that it holds at
+// least num elements of el_size bytes. The capacity in bytes is a
+// power of two and at least inc elements, so that arrays released
+// while growing can be reused by other arrays of any type.
+static void* tile_array_reserve(struct fpga_model* model, void* ptr,
+	int num, int el_size, int inc)
+{
+	size_t size;
+
+	if ((size_t) num*el_size <= arena_size(ptr))
+		return ptr;
+	for (size = 64; size < (size_t) inc*el_size
+		|| size < (size_t) num*el_size; size *= 2);
+	return arena_realloc(&model->arena, ptr, size);
+}
+
 #define CONN_NAMES_INCREMENT	128
 
 // add_switch() assumes that the new element is appended
 // at the end of the array.
-static void connpt_names_array_append(struct fpga_tile* tile, int name_i)
+static void connpt_names_array_append(struct fpga_model* model,
+	struct fpga_tile* tile, int name_i)
 {
-	if (!(tile->num_conn_point_names % CONN_NAMES_INCREMENT)) {
-		uint16_t* new_ptr = realloc(tile->conn_point_names,
-			(tile->num_conn_point_names+CONN_NAMES_INCREMENT)*2*sizeof(uint16_t));
-		if (!new_ptr) EXIT(ENOMEM);
-		tile->conn_point_names = new_ptr;
-	}
+	uint16_t* new_ptr;
+
+	new_ptr = tile_array_reserve(model, tile->conn_point_names,
+		tile->num_conn_point_names+1, 2*sizeof(uint16_t),
+		CONN_NAMES_INCREMENT);
+	if (!new_ptr) EXIT(ENOMEM);
+	tile->conn_point_names = new_ptr;
 	tile->conn_point_names[tile->num_conn_point_names*2] = tile->num_conn_point_dests;
 	tile->conn_point_names[tile->num_conn_point_names*2+1] = name_i;
 	tile->num_conn_point_names++;
@@ -153,7 +173,7 @@ static int add_connpt_name_i(struct fpga_model *model, int y, int x,
 				strarray_lookup(&model->str, name_i));
 	} else
 		// This is the first connection under name, add name.
-		connpt_names_array_append(tile, name_i);
+		connpt_names_array_append(model, tile, name_i);
 	RC_RETURN(model);
 }
 
@@ -164,6 +184,8 @@ int add_connpt_name(struct fpga_model* model, int y, int x,
 	int rc, i;
 
 	RC_CHECK(model);
+	if (routing_deferred(model, y, x))
+		return 0;
 
 	rc = strarray_add(&model->str, connpt_name, &i);
 	if (rc) RC_FAIL(model, rc);
@@ -179,6 +201,9 @@ int has_device(struct fpga_model* model, int y, int x, int dev)
 	struct fpga_tile* tile = YX_TILE(model, y, x);
 	int i, type_count;
 
+	if (tile->dev_index)
+		return (dev > DEV_NONE && dev < DEV_TYPE_COUNT)
+			? tile->dev_index[dev+1]-tile->dev_index[dev] : 0;
 	type_count = 0;
 	for (i = 0; i < tile->num_devs; i++) {
 		if (tile->devs[i].type == dev)
@@ -193,6 +218,16 @@ int has_device_type(struct fpga_model* model, int y, int x, int dev, int subtype
 	int i, type_subtype_count;
 
 	type_subtype_count = 0;
+	if (tile->dev_index) {
+		if (dev <= DEV_NONE || dev >= DEV_TYPE_COUNT)
+			return 0;
+		for (i = tile->dev_index[dev]; i < tile->dev_index[dev+1]; i++) {
+			if (tile->devs[tile->dev_index[DEV_TYPE_COUNT+1+i]].subtype
+			    == subtype)
+				type_subtype_count++;
+		}
+		return type_subtype_count;
+	}
 	for (i = 0; i < tile->num_devs; i++) {
 		if (tile->devs[i].type == dev
 		    && tile->devs[i].subtype == subtype)
@@ -238,6 +273,8 @@ static int add_conn_uni_i(struct fpga_model *model,
 		strarray_lookup(&model->str, from_name), *from_connpt_o,
 		to_y, to_x, strarray_lookup(&model->str, to_name));
 #endif
+	if (routing_deferred(model, from_y, from_x))
+		RC_RETURN(model);
 	// this optimization saved about 30% of model creation time
 	if (*from_connpt_o == -1) {
 		add_connpt_name_i(model, from_y, from_x, from_name,
@@ -246,6 +283,10 @@ static int add_conn_uni_i(struct fpga_model *model,
 	}
 
 	tile = YX_TILE(model, from_y, from_x);
+	if (model->sizing_pass) {
+		tile->num_conn_point_dests++;
+		RC_RETURN(model);
+	}
 	conn_start = tile->conn_point_names[(*from_connpt_o)*2];
 	if ((*from_connpt_o)+1 >= tile->num_conn_point_names)
 		num_conn_point_dests_for_this_wire = tile->num_conn_point_dests - conn_start;
@@ -271,12 +312,11 @@ static int add_conn_uni_i(struct fpga_model *model,
 		}
 	}
 
-	if (!(tile->num_conn_point_dests % CONNS_INCREMENT)) {
-		new_ptr = realloc(tile->conn_point_dests,
-			(tile->num_conn_point_dests+CONNS_INCREMENT)*3*sizeof(uint16_t));
-		if (!new_ptr) RC_FAIL(model, ENOMEM);
-		tile->conn_point_dests = new_ptr;
-	}
+	new_ptr = tile_array_reserve(model, tile->conn_point_dests,
+		tile->num_conn_point_dests+1, 3*sizeof(uint16_t),
+		CONNS_INCREMENT);
+	if (!new_ptr) RC_FAIL(model, ENOMEM);
+	tile->conn_point_dests = new_ptr;
 	if (tile->num_conn_point_dests > j)
 		memmove(&tile->conn_point_dests[(j+1)*3],
 			&tile->conn_point_dests[j*3],
@@ -308,6 +348,8 @@ static int add_conn_uni(struct fpga_model *model,
 	int j, from_connpt_o, rc;
 
 	RC_CHECK(model);
+	if (routing_deferred(model, y1, x1))
+		return 0;
 
 	rc = strarray_add(&model->str, name1, &j);
 	if (rc) RC_FAIL(model, rc);
@@ -365,6 +407,14 @@ int add_conn_net(struct fpga_model* model, int add_pref, const struct w_net *net
 
 	RC_CHECK(model);
 	if (net->num_pts < 2) RC_FAIL(model, EINVAL);
+	if (model->lazy) {
+		for (i = 0; i < net->num_pts; i++) {
+			if (!routing_deferred(model, net->pt[i].y, net->pt[i].x))
+				break;
+		}
+		if (i >= net->num_pts)
+			RC_RETURN(model);
+	}
 	if (!net->last_inc) {
 		str16_t net_name_i[MAX_NET_POINTS];
 		int str_i, net_connpt_o[MAX_NET_POINTS];
@@ -429,14 +479,36 @@ int add_conn_net(struct fpga_model* model, int add_pref, const struct w_net *net
 // model a lot.
 #undef CHECK_DUPLICATES
 
+// Gives the tile a private copy of its shared switches, so
+// that more switches can be appended. The template stays in
+// the model arena even if no tile uses it anymore.
+static int unshare_switches(struct fpga_model* model, struct fpga_tile* tile)
+{
+	uint32_t* new_ptr;
+
+	new_ptr = arena_alloc(&model->arena,
+		tile->num_switches*sizeof(*tile->switches));
+	if (!new_ptr) {
+		fprintf(stderr, "Out of memory %s:%i\n", __FILE__, __LINE__);
+		return -1;
+	}
+	memcpy(new_ptr, tile->switches, tile->num_switches*sizeof(*tile->switches));
+	tile->switches = new_ptr;
+	tile->sw_template->refcount--;
+	tile->sw_template = 0;
+	return 0;
+}
+
 int add_switch(struct fpga_model* model, int y, int x, const char* from,
 	const char* to, int is_bidirectional)
 {
 	struct fpga_tile* tile = YX_TILE(model, y, x);
 	int rc, i, from_idx, to_idx, from_connpt_o, to_connpt_o;
-	uint32_t new_switch;
+	uint32_t new_switch, *new_ptr;
 
 	RC_CHECK(model);
+	if (routing_deferred(model, y, x))
+		return 0;
 // later this can be strarray_find() and not strarray_add(), but
 // then we need all wires and ports to be present first...
 #ifdef DBG_ALLOW_ADDPOINTS
@@ -474,11 +546,11 @@ int add_switch(struct fpga_model* model, int y, int x, const char* from,
 #ifdef DBG_ALLOW_ADDPOINTS
 	if (from_connpt_o == -1) {
 		from_connpt_o = tile->num_conn_point_names;
-		connpt_names_array_append(tile, from_idx);
+		connpt_names_array_append(model, tile, from_idx);
 	}
 	if (to_connpt_o == -1) {
 		to_connpt_o = tile->num_conn_point_names;
-		connpt_names_array_append(tile, to_idx);
+		connpt_names_array_append(model, tile, to_idx);
 	}
 #endif
 	if (from_connpt_o == -1 || to_connpt_o == -1) {
@@ -505,15 +577,26 @@ int add_switch(struct fpga_model* model, int y, int x, const char* from,
 		}
 	}
 #endif
-	if (!(tile->num_switches % SWITCH_ALLOC_INCREMENT)) {
-		uint32_t* new_ptr = realloc(tile->switches,
-			(tile->num_switches+SWITCH_ALLOC_INCREMENT)*sizeof(*tile->switches));
-		if (!new_ptr) {
-			fprintf(stderr, "Out of memory %s:%i\n", __FILE__, __LINE__);
-			return -1;
-		}
-		tile->switches = new_ptr;
+	if (tile->sw_template) {
+		rc = unshare_switches(model, tile);
+		if (rc) goto xout;
+	}
+	new_ptr = tile_array_reserve(model, tile->switches,
+		tile->num_switches+1, sizeof(*tile->switches),
+		SWITCH_ALLOC_INCREMENT);
+	if (!new_ptr) {
+		fprintf(stderr, "Out of memory %s:%i\n", __FILE__, __LINE__);
+		return -1;
+	}
+	tile->switches = new_ptr;
+	new_ptr = tile_array_reserve(model, tile->switches_used,
+		tile->num_switches/32+1, sizeof(*tile->switches_used),
+		SWITCH_ALLOC_INCREMENT/32);
+	if (!new_ptr) {
+		fprintf(stderr, "Out of memory %s:%i\n", __FILE__, __LINE__);
+		return -1;
 	}
+	tile->switches_used = new_ptr;
 	tile->switches[tile->num_switches++] = new_switch;
 	return 0;
 xout:
@@ -556,27 +639,53 @@ int replicate_switches_and_names(struct fpga_model* model,
 	int y_from, int x_from, int y_to, int x_to)
 {
 	struct fpga_tile* from_tile, *to_tile;
+	struct fpga_sw_template* template;
 	int rc;
 
 	RC_CHECK(model);
+	if (routing_deferred(model, y_to, x_to))
+		return 0;
 	from_tile = YX_TILE(model, y_from, x_from);
 	to_tile = YX_TILE(model, y_to, x_to);
 	if (to_tile->num_conn_point_names
 	    || to_tile->num_conn_point_dests
-	    || to_tile->num_switches
-	    || from_tile->num_conn_point_dests
-	    || !from_tile->num_conn_point_names
-	    || !from_tile->num_switches) FAIL(EINVAL);
+	    || to_tile->num_switches) FAIL(EINVAL);
+
+	if (!from_tile->sw_template) {
+		if (from_tile->num_conn_point_dests
+		    || !from_tile->num_conn_point_names
+		    || !from_tile->num_switches) FAIL(EINVAL);
+		template = arena_alloc(&model->arena, sizeof(*template));
+		if (!template) EXIT(ENOMEM);
+		template->refcount = 1;
+		template->num_switches = from_tile->num_switches;
+		template->switches = from_tile->switches;
+		template->num_conn_point_names = from_tile->num_conn_point_names;
+		template->conn_point_names = arena_alloc(&model->arena,
+			template->num_conn_point_names*2*sizeof(uint16_t));
+		if (!template->conn_point_names) EXIT(ENOMEM);
+		memcpy(template->conn_point_names, from_tile->conn_point_names,
+			template->num_conn_point_names*2*sizeof(uint16_t));
+		from_tile->sw_template = template;
+	} else
+		template = from_tile->sw_template;
 
-	to_tile->conn_point_names = malloc(((from_tile->num_conn_point_names/CONN_NAMES_INCREMENT)+1)*CONN_NAMES_INCREMENT*2*sizeof(uint16_t));
+	to_tile->conn_point_names = tile_array_reserve(model,
+		to_tile->conn_point_names, template->num_conn_point_names,
+		2*sizeof(uint16_t), CONN_NAMES_INCREMENT);
 	if (!to_tile->conn_point_names) EXIT(ENOMEM);
-	memcpy(to_tile->conn_point_names, from_tile->conn_point_names, from_tile->num_conn_point_names*2*sizeof(uint16_t));
-	to_tile->num_conn_point_names = from_tile->num_conn_point_names;
-
-	to_tile->switches = malloc(((from_tile->num_switches/SWITCH_ALLOC_INCREMENT)+1)*SWITCH_ALLOC_INCREMENT*sizeof(*from_tile->switches));
-	if (!to_tile->switches) EXIT(ENOMEM);
-	memcpy(to_tile->switches, from_tile->switches, from_tile->num_switches*sizeof(*from_tile->switches));
-	to_tile->num_switches = from_tile->num_switches;
+	memcpy(to_tile->conn_point_names, template->conn_point_names,
+		template->num_conn_point_names*2*sizeof(uint16_t));
+	to_tile->num_conn_point_names = template->num_conn_point_names;
+
+	to_tile->switches_used = tile_array_reserve(model,
+		to_tile->switches_used, (template->num_switches+31)/32,
+		sizeof(*to_tile->switches_used), SWITCH_ALLOC_INCREMENT/32);
+	if (!to_tile->switches_used) EXIT(ENOMEM);
+	to_tile->sw_template = template;
+	template->refcount++;
+	to_tile->switches = template->switches;
+	to_tile->num_switches = template->num_switches;
 	return 0;
 fail:
 	return rc;
@@ -622,7 +731,7 @@ char last_major(const char* str, int cur_o)
 	return 0;
 }
 
-int is_aty(int check, struct fpga_model* model, int y)
+static int calc_aty(int check, struct fpga_model* model, int y)
 {
 	if (y < 0) return 0;
 	if (check & Y_OUTER_TOP && y == TOP_OUTER_ROW) return 1;
@@ -649,7 +758,7 @@ int is_aty(int check, struct fpga_model* model, int y)
 	return 0;
 }
 
-int is_atx(int check, struct fpga_model* model, int x)
+static int calc_atx(int check, struct fpga_model* model, int x)
 {
 	if (x < 0) return 0;
 	if (check & X_OUTER_LEFT && !x) return 1;
@@ -696,7 +805,7 @@ int is_atx(int check, struct fpga_model* model, int x)
 	return 0;
 }
 
-int is_atyx(int check, struct fpga_model* model, int y, int x)
+static int calc_atyx(int check, struct fpga_model* model, int y, int x)
 {
 	struct fpga_tile* tile;
 
@@ -742,7 +851,7 @@ int is_atyx(int check, struct fpga_model* model, int y, int x)
 	return 0;
 }
 
-void is_in_row(const struct fpga_model* model, int y,
+static void calc_in_row(const struct fpga_model* model, int y,
 	int* row_num, int* row_pos)
 {
 	int dist_to_center;
@@ -766,6 +875,217 @@ void is_in_row(const struct fpga_model* model, int y,
 	if (row_pos) *row_pos = y%(8+1+8);
 }
 
+void is_in_row(const struct fpga_model* model, int y,
+	int* row_num, int* row_pos)
+{
+	if (model->row_pos && y >= 0 && y < model->y_height) {
+		if (row_num) *row_num = model->row_num[y];
+		if (row_pos) *row_pos = model->row_pos[y];
+		return;
+	}
+	calc_in_row(model, y, row_num, row_pos);
+}
+
+int is_aty(int check, struct fpga_model* model, int y)
+{
+	if (model->y_mask && y >= 0 && y < model->y_height)
+		return (model->y_mask[y] & check) != 0;
+	return calc_aty(check, model, y);
+}
+
+int is_atx(int check, struct fpga_model* model, int x)
+{
+	if (model->x_mask && x >= 0 && x < model->x_width)
+		return (model->x_mask[x] & check) != 0;
+	return calc_atx(check, model, x);
+}
+
+int is_atyx(int check, struct fpga_model* model, int y, int x)
+{
+	if (model->yx_mask && y >= 0 && y < model->y_height
+	    && x >= 0 && x < model->x_width)
+		return (model->yx_mask[y*model->x_width+x] & check) != 0;
+	return calc_atyx(check, model, y, x);
+}
+
+// The type-2 IOs are hashed by their coordinates, the package
+// pins by name and description. Each pin is linked to the
+// type-2 IO with the same bank, pair and pos_side.
+
+static uint32_t iob_yx_hash(int y, int x, int type_idx)
+{
+	return ((uint32_t) y << 20 ^ (uint32_t) x << 8 ^ type_idx)
+		* 0x9E3779B1;
+}
+
+static uint32_t iob_bank_pair_hash(int bank, int pair, int pos_side)
+{
+	return ((uint32_t) bank << 20 ^ (uint32_t) pair << 1 ^ pos_side)
+		* 0x9E3779B1;
+}
+
+static void iob_hash_insert(int* table, int mask, uint32_t hash, int idx)
+{
+	int slot;
+
+	for (slot = (hash >> 8) & mask; table[slot];
+		slot = (slot+1) & mask);
+	table[slot] = idx+1;
+}
+
+int find_pkg_pin(struct fpga_model* model, const char* str, int by_desc)
+{
+	const struct xc6_pin_info* pin;
+	const int* table;
+	int mask, slot;
+
+	table = by_desc ? model->pin_desc_hash : model->pin_name_hash;
+	mask = model->iob_hash_size-1;
+	for (slot = (hash_djb2((const unsigned char*) str) >> 8) & mask;
+	     table[slot]; slot = (slot+1) & mask) {
+		pin = &model->pkg->pin[table[slot]-1];
+		if (!strcmp(by_desc ? pin->description : pin->name, str))
+			return table[slot]-1;
+	}
+	return -1;
+}
+
+int find_t2_io(struct fpga_model* model, int y, int x, int type_idx)
+{
+	const struct xc_t2_io_info* t2_io;
+	int mask, slot, i;
+
+	mask = model->iob_hash_size-1;
+	for (slot = (iob_yx_hash(y, x, type_idx) >> 8) & mask;
+	     (i = model->t2_io_yx_hash[slot]); slot = (slot+1) & mask) {
+		t2_io = &model->die->t2_io[i-1];
+		if (t2_io->y == y && t2_io->x == x
+		    && t2_io->type_idx == type_idx)
+			return i-1;
+	}
+	return -1;
+}
+
+int init_iob_index(struct fpga_model* model)
+{
+	const struct xc6_pin_info* pin;
+	const struct xc_t2_io_info* t2_io;
+	int* bank_pair_hash;
+	int mask, slot, i, j;
+
+	RC_CHECK(model);
+	for (model->iob_hash_size = 64;
+	     model->iob_hash_size < 2*model->pkg->num_pins
+	     || model->iob_hash_size < 2*model->die->num_t2_ios;
+	     model->iob_hash_size *= 2);
+	mask = model->iob_hash_size-1;
+	model->pin_name_hash = arena_alloc(&model->arena,
+		model->iob_hash_size*sizeof(int));
+	model->pin_desc_hash = arena_alloc(&model->arena,
+		model->iob_hash_size*sizeof(int));
+	model->t2_io_yx_hash = arena_alloc(&model->arena,
+		model->iob_hash_size*sizeof(int));
+	model->pin_t2_io = arena_alloc(&model->arena,
+		model->pkg->num_pins*sizeof(int));
+	model->t2_io_pin = arena_alloc(&model->arena,
+		model->die->num_t2_ios*sizeof(int));
+	bank_pair_hash = calloc(model->iob_hash_size, sizeof(int));
+	if (!model->pin_name_hash || !model->pin_desc_hash
+	    || !model->t2_io_yx_hash || !model->pin_t2_io
+	    || !model->t2_io_pin || !bank_pair_hash) {
+		free(bank_pair_hash);
+		RC_FAIL(model, ENOMEM);
+	}
+
+	for (i = 0; i < model->die->num_t2_ios; i++) {
+		model->t2_io_pin[i] = -1;
+		t2_io = &model->die->t2_io[i];
+		if (!t2_io->pair)
+			continue;
+		iob_hash_insert(model->t2_io_yx_hash, mask,
+			iob_yx_hash(t2_io->y, t2_io->x, t2_io->type_idx), i);
+		iob_hash_insert(bank_pair_hash, mask, iob_bank_pair_hash(
+			t2_io->bank, t2_io->pair, t2_io->pos_side), i);
+	}
+	// On collisions the first entry wins, as it did with the
+	// linear searches before.
+	for (i = 0; i < model->pkg->num_pins; i++) {
+		pin = &model->pkg->pin[i];
+		model->pin_t2_io[i] = -1;
+		// num_pins includes unbonded pins not in the table
+		if (!pin->name || !pin->description)
+			continue;
+		if (find_pkg_pin(model, pin->name, /*by_desc*/ 0) == -1)
+			iob_hash_insert(model->pin_name_hash, mask,
+				hash_djb2((const unsigned char*) pin->name), i);
+		if (find_pkg_pin(model, pin->description, /*by_desc*/ 1) == -1)
+			iob_hash_insert(model->pin_desc_hash, mask,
+				hash_djb2((const unsigned char*) pin->description), i);
+
+		for (slot = (iob_bank_pair_hash(pin->bank, pin->pair, pin->pos_side) >> 8) & mask;
+		     (j = bank_pair_hash[slot]); slot = (slot+1) & mask) {
+			t2_io = &model->die->t2_io[j-1];
+			if (t2_io->bank != pin->bank || t2_io->pair != pin->pair
+			    || t2_io->pos_side != pin->pos_side)
+				continue;
+			if (model->pin_t2_io[i] == -1)
+				model->pin_t2_io[i] = j-1;
+			if (model->t2_io_pin[j-1] == -1)
+				model->t2_io_pin[j-1] = i;
+		}
+	}
+	free(bank_pair_hash);
+	RC_RETURN(model);
+}
+
+int init_tile_masks(struct fpga_model* model)
+{
+	int* row_num, *row_pos;
+	uint32_t* x_mask, *y_mask, *yx_mask;
+	int x, y, bit;
+
+	RC_CHECK(model);
+	row_num = arena_alloc(&model->arena, model->y_height*sizeof(*row_num));
+	row_pos = arena_alloc(&model->arena, model->y_height*sizeof(*row_pos));
+	x_mask = arena_alloc(&model->arena, model->x_width*sizeof(*x_mask));
+	y_mask = arena_alloc(&model->arena, model->y_height*sizeof(*y_mask));
+	yx_mask = arena_alloc(&model->arena,
+		model->x_width*model->y_height*sizeof(*yx_mask));
+	if (!row_num || !row_pos || !x_mask || !y_mask || !yx_mask)
+		RC_FAIL(model, ENOMEM);
+
+	// Each table is only published once it is complete, so
+	// the calc_ functions never see a partial table.
+	for (y = 0; y < model->y_height; y++)
+		calc_in_row(model, y, &row_num[y], &row_pos[y]);
+	model->row_num = row_num;
+	model->row_pos = row_pos;
+	for (x = 0; x < model->x_width; x++) {
+		for (bit = 0; bit < 32; bit++) {
+			if (calc_atx(1u << bit, model, x))
+				x_mask[x] |= 1u << bit;
+		}
+	}
+	model->x_mask = x_mask;
+	for (y = 0; y < model->y_height; y++) {
+		for (bit = 0; bit < 32; bit++) {
+			if (calc_aty(1u << bit, model, y))
+				y_mask[y] |= 1u << bit;
+		}
+	}
+	model->y_mask = y_mask;
+	for (y = 0; y < model->y_height; y++) {
+		for (x = 0; x < model->x_width; x++) {
+			for (bit = 0; bit < 32; bit++) {
+				if (calc_atyx(1u << bit, model, y, x))
+					yx_mask[y*model->x_width+x] |= 1u << bit;
+			}
+		}
+	}
+	model->yx_mask = yx_mask;
+	RC_RETURN(model);
+}
+
 int which_row(int y, struct fpga_model* model)
 {
 	int result;
@@ -933,8 +1253,8 @@ const char *fpga_connpt_str(struct fpga_model *model, enum extra_wires wire,
 	int y, int x, int dest_y, int dest_x)
 {
  	enum { NUM_BUFS = 8, BUF_SIZE = MAX_WIRENAME_LEN };
-	static char buf[NUM_BUFS][BUF_SIZE];
-	static int last_buf = 0;
+	static __thread char buf[NUM_BUFS][BUF_SIZE];
+	static __thread int last_buf = 0;
 	const char *wstr;
 	int i, wnum, wchar;
 
@@ -1593,6 +1913,8 @@ str16_t fpga_wire2str_yx(struct fpga_model *model, enum extra_wires wire,
 	char buf[MAX_WIRENAME_LEN];
 	int str_i, row_num, row_pos;
 
+	if (fpga_materialize_tile(model, y, x))
+		return STRIDX_NO_ENTRY;
 	if (wire >= GCLK0 && wire <= GCLK15) {
 		is_in_row(model, y, &row_num, &row_pos);
 		if (row_pos != LAST_POS_IN_ROW
@@ -1600,6 +1922,8 @@ str16_t fpga_wire2str_yx(struct fpga_model *model, enum extra_wires wire,
 		    || (row_num == model->die->num_rows/2 && is_atx(X_LEFT_IO_ROUTING_COL|X_RIGHT_IO_ROUTING_COL, model, x)))
 			return fpga_wire2str_i(model, wire);
 
+		if (model->gclk_brk_str[wire-GCLK0] != STRIDX_NO_ENTRY)
+			return model->gclk_brk_str[wire-GCLK0];
 		snprintf(buf, sizeof(buf), "%s_BRK", fpga_wire2str(wire));
 	} else
 		return fpga_wire2str_i(model, wire);
@@ -1608,12 +1932,16 @@ str16_t fpga_wire2str_yx(struct fpga_model *model, enum extra_wires wire,
 		HERE();
 		str_i = STRIDX_NO_ENTRY;
 	}
+	if (model->wire_str)
+		model->gclk_brk_str[wire-GCLK0] = str_i;
 	return str_i;
 }
 
 str16_t fpga_iologic_wire2str_yx(struct fpga_model *model,
 	enum iologic_wire wire, int y, int x)
 {
+	if (fpga_materialize_tile(model, y, x))
+		return STRIDX_NO_ENTRY;
 	switch (wire) {
 		case D_ILOGIC_SITE:
 			return strarray_find(&model->str, "D_ILOGIC_SITE");
@@ -1717,8 +2045,8 @@ str16_t fpga_iologic_wire2str_yx(struct fpga_model *model,
 const char *fpga_wire2str(enum extra_wires wire)
 {
  	enum { NUM_BUFS = 8, BUF_SIZE = MAX_WIRENAME_LEN };
-	static char buf[NUM_BUFS][BUF_SIZE];
-	static int last_buf = 0;
+	static __thread char buf[NUM_BUFS][BUF_SIZE];
+	static __thread int last_buf = 0;
 	int flags;
 
 	switch (wire) {
@@ -1916,7 +2244,86 @@ const char *fpga_wire2str(enum extra_wires wire)
 
 str16_t fpga_wire2str_i(struct fpga_model* model, enum extra_wires wire)
 {
-	return strarray_find(&model->str, fpga_wire2str(wire));
+	str16_t str_i;
+
+	if (model->wire_str && wire >= 0 && wire <= MW_LAST
+	    && model->wire_str[wire] != STRIDX_NO_ENTRY)
+		return model->wire_str[wire];
+	str_i = strarray_find(&model->str, fpga_wire2str(wire));
+	// Unknown strings are not remembered, they may be
+	// added later in a lazily built model.
+	if (model->wire_str && wire >= 0 && wire <= MW_LAST)
+		model->wire_str[wire] = str_i;
+	return str_i;
+}
+
+enum extra_wires fpga_str2wire_i(struct fpga_model* model, str16_t str_i)
+{
+	enum extra_wires wire;
+
+	if (str_i == STRIDX_NO_ENTRY) {
+		HERE();
+		return NO_WIRE;
+	}
+	if (model->str_wire && model->str_wire[str_i] != STR_WIRE_UNKNOWN)
+		return model->str_wire[str_i];
+	wire = fpga_str2wire(strarray_lookup(&model->str, str_i));
+	if (model->str_wire)
+		model->str_wire[str_i] = wire;
+	return wire;
+}
+
+static void decode_str_wire(struct fpga_model* model, const char* str)
+{
+	int str_i;
+
+	str_i = strarray_find(&model->str, str);
+	if (str_i != STRIDX_NO_ENTRY && !OUT_OF_U16(str_i))
+		fpga_str2wire_i(model, str_i);
+}
+
+int init_wire_tables(struct fpga_model* model)
+{
+	enum extra_wires wire;
+	int i, j;
+
+	RC_CHECK(model);
+	if (!model->wire_str) {
+		model->wire_str = arena_alloc(&model->arena,
+			(MW_LAST+1)*sizeof(*model->wire_str));
+		model->str_wire = arena_alloc(&model->arena,
+			STRIDX_64K*sizeof(*model->str_wire));
+		if (!model->wire_str || !model->str_wire)
+			RC_FAIL(model, ENOMEM);
+		memset(model->str_wire, 0xFF,
+			STRIDX_64K*sizeof(*model->str_wire));
+	}
+	// The routing switch wires are the ones converted over
+	// and over again when writing and extracting bits, in
+	// the plain, the _BRK and the INT_IOI_ variants.
+	for (i = 0; i < model->num_bitpos; i++) {
+		for (j = 0; j < 2; j++) {
+			wire = j ? model->sw_bitpos[i].to
+				: model->sw_bitpos[i].from;
+			if (wire < 0 || wire > MW_LAST
+			    || model->wire_str[wire] != STRIDX_NO_ENTRY)
+				continue;
+			if (fpga_wire2str_i(model, wire) == STRIDX_NO_ENTRY)
+				continue;
+			fpga_str2wire_i(model, model->wire_str[wire]);
+			decode_str_wire(model, pf("INT_IOI_%s", fpga_wire2str(wire)));
+		}
+	}
+	for (i = 0; i < 16; i++) {
+		if (model->gclk_brk_str[i] != STRIDX_NO_ENTRY)
+			continue;
+		j = strarray_find(&model->str, pf("%s_BRK", fpga_wire2str(GCLK0+i)));
+		if (j == STRIDX_NO_ENTRY || OUT_OF_U16(j))
+			continue;
+		model->gclk_brk_str[i] = j;
+		fpga_str2wire_i(model, j);
+	}
+	RC_RETURN(model);
 }
 
 enum extra_wires fpga_str2wire(const char* str)
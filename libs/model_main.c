@@ -6,15 +6,154 @@
 //
 
 #include <stdarg.h>
+#include <time.h>
 #include "model.h"
+#include "control.h"
 
 static int s_high_speed_replicate = 1;
 
-int fpga_build_model(struct fpga_model* model, int idcode, enum xc6_pkg pkg)
+// Set from FPGA_PROFILE when the library is loaded, before any
+// thread can build a model. Afterwards only fpga_build_profile()
+// writes s_prof_on.
+static int s_prof_on = 0;
+static int s_prof_print = FPGA_PROF_OFF;
+
+// Final size of the per-tile arrays, recorded by the sizing
+// pass of fpga_build_model_exact().
+struct tile_size
+{
+	int num_devs;
+	int num_conn_point_names;
+	int num_conn_point_dests;
+	int num_switches;
+	int shared_switches;
+};
+
+// Generous per-allocation overhead for header and alignment.
+#define ARENA_CHUNK_SLACK	32
+
+static size_t chunk_bytes(size_t size)
+{
+	return size ? size + ARENA_CHUNK_SLACK : 0;
+}
+
+// Allocates every per-tile array with its final size, all in
+// one arena block. The builder then never has to grow them.
+static int presize_tiles(struct fpga_model* model,
+	const struct tile_size* sizes)
+{
+	const struct tile_size* sz;
+	struct fpga_tile* tile;
+	size_t total;
+	int i;
+
+	RC_CHECK(model);
+	total = 0;
+	for (i = 0; i < model->x_width * model->y_height; i++) {
+		sz = &sizes[i];
+		total += chunk_bytes(sz->num_devs*sizeof(struct fpga_device))
+			+ chunk_bytes(sz->num_conn_point_names*2*sizeof(uint16_t))
+			+ chunk_bytes(sz->num_conn_point_dests*3*sizeof(uint16_t))
+			+ chunk_bytes((sz->num_switches+31)/32*sizeof(uint32_t));
+		if (!sz->shared_switches)
+			total += chunk_bytes(sz->num_switches*sizeof(uint32_t));
+	}
+	if (!total) RC_RETURN(model);
+	model->arena.block_size = total;
+	for (i = 0; i < model->x_width * model->y_height; i++) {
+		sz = &sizes[i];
+		tile = &model->tiles[i];
+		if (sz->num_devs) {
+			tile->devs = arena_alloc(&model->arena,
+				sz->num_devs*sizeof(*tile->devs));
+			if (!tile->devs) RC_FAIL(model, ENOMEM);
+		}
+		if (sz->num_conn_point_names) {
+			tile->conn_point_names = arena_alloc(&model->arena,
+				sz->num_conn_point_names*2*sizeof(uint16_t));
+			if (!tile->conn_point_names) RC_FAIL(model, ENOMEM);
+		}
+		if (sz->num_conn_point_dests) {
+			tile->conn_point_dests = arena_alloc(&model->arena,
+				sz->num_conn_point_dests*3*sizeof(uint16_t));
+			if (!tile->conn_point_dests) RC_FAIL(model, ENOMEM);
+		}
+		if (!sz->num_switches)
+			continue;
+		if (!sz->shared_switches) {
+			tile->switches = arena_alloc(&model->arena,
+				sz->num_switches*sizeof(*tile->switches));
+			if (!tile->switches) RC_FAIL(model, ENOMEM);
+		}
+		tile->switches_used = arena_alloc(&model->arena,
+			(sz->num_switches+31)/32*sizeof(*tile->switches_used));
+		if (!tile->switches_used) RC_FAIL(model, ENOMEM);
+	}
+	model->arena.block_size = ARENA_DEFAULT_BLOCK;
+	RC_RETURN(model);
+}
+
+// Maps every y to the clock row it belongs to. The term rows at
+// the top are part of the first row, the center regs and the
+// bottom term rows part of the row above them.
+static int init_regions(struct fpga_model* model)
+{
+	int y, row, cur_region;
+
+	RC_CHECK(model);
+	model->num_regions = model->die->num_rows;
+	model->y_region = arena_alloc(&model->arena,
+		model->y_height*sizeof(*model->y_region));
+	model->region_built = arena_alloc(&model->arena,
+		model->num_regions*sizeof(*model->region_built));
+	if (!model->y_region || !model->region_built)
+		RC_FAIL(model, ENOMEM);
+	cur_region = -1;
+	for (y = 0; y < model->y_height; y++) {
+		row = which_row(y, model);
+		if (row != -1)
+			cur_region = row;
+		else if (cur_region == -1) {
+			for (row = y+1; (cur_region = which_row(row, model)) == -1; row++)
+				RC_ASSERT(model, row < model->y_height);
+		}
+		RC_ASSERT(model, cur_region < model->num_regions);
+		model->y_region[y] = cur_region;
+	}
+	model->building_region = -1;
+	RC_RETURN(model);
+}
+
+// Adds ports, connections and switches to all tiles, or in a
+// lazily built model only to the tiles in building_region.
+static int build_routing(struct fpga_model* model)
+{
+	RC_CHECK(model);
+	if (s_high_speed_replicate)
+		PROF(model, replicate_routing_switches(model));
+	// todo: compare.ports only works if other switches and conns
+	//       are disabled, as long as not all connections are supported
+	PROF(model, init_ports(model, /*dup_warn*/ !s_high_speed_replicate));
+	PROF(model, init_conns(model));
+	PROF(model, init_switches(model, /*routing_sw*/ !s_high_speed_replicate));
+	PROF(model, init_wire_tables(model));
+	RC_RETURN(model);
+}
+
+static int build_model(struct fpga_model* model, int idcode,
+	enum xc6_pkg pkg, const struct tile_size* sizes, int sizing_pass,
+	int lazy)
 {
 	int rc;
 
 	memset(model, 0, sizeof(*model));
+	arena_init(&model->arena, ARENA_DEFAULT_BLOCK);
+	model->sizing_pass = sizing_pass;
+	if (s_prof_on) {
+		model->prof = calloc(1, sizeof(*model->prof));
+		if (!model->prof) RC_FAIL(model, ENOMEM);
+		model->prof->cur_phase = -1;
+	}
 	model->die = xc_die_info(idcode);
 	model->pkg = xc6_pkg_info(pkg);
 	if (!model->die || !model->pkg) RC_FAIL(model, EINVAL);
@@ -26,26 +165,127 @@ int fpga_build_model(struct fpga_model* model, int idcode, enum xc6_pkg pkg)
 	// connections and finally switches is important so
 	// that the codes can build upon each other.
 
-	init_tiles(model);
-	init_devices(model);
-	if (s_high_speed_replicate)
-		replicate_routing_switches(model);
-	// todo: compare.ports only works if other switches and conns
-	//       are disabled, as long as not all connections are supported
-	init_ports(model, /*dup_warn*/ !s_high_speed_replicate);
-	init_conns(model);
-	init_switches(model, /*routing_sw*/ !s_high_speed_replicate);
+	init_iob_index(model);
+	PROF(model, init_tiles(model));
+	if (sizes)
+		PROF(model, presize_tiles(model, sizes));
+	PROF(model, init_devices(model));
+	PROF(model, init_tile_masks(model));
+	if (lazy) {
+		init_regions(model);
+		model->lazy = 1;
+	} else
+		build_routing(model);
+	if (model->prof) {
+		model->prof->lazy = lazy;
+		if (s_prof_print && !lazy)
+			fpga_print_profile(stderr, model, s_prof_print);
+	}
+	model->sizing_pass = 0;
+	RC_RETURN(model);
+}
+
+int fpga_build_model(struct fpga_model* model, int idcode, enum xc6_pkg pkg)
+{
+	return build_model(model, idcode, pkg, /*sizes*/ 0,
+		/*sizing_pass*/ 0, /*lazy*/ 0);
+}
+
+int fpga_build_model_exact(struct fpga_model* model, int idcode,
+	enum xc6_pkg pkg)
+{
+	struct tile_size* sizes;
+	struct fpga_tile* tile;
+	int num_tiles, i, rc;
 
+	rc = build_model(model, idcode, pkg, /*sizes*/ 0,
+		/*sizing_pass*/ 1, /*lazy*/ 0);
+	if (rc) return rc;
+	num_tiles = model->x_width * model->y_height;
+	sizes = malloc(num_tiles*sizeof(*sizes));
+	if (!sizes) RC_FAIL(model, ENOMEM);
+	for (i = 0; i < num_tiles; i++) {
+		tile = &model->tiles[i];
+		sizes[i].num_devs = tile->num_devs;
+		sizes[i].num_conn_point_names = tile->num_conn_point_names;
+		sizes[i].num_conn_point_dests = tile->num_conn_point_dests;
+		sizes[i].num_switches = tile->num_switches;
+		sizes[i].shared_switches = tile->sw_template != 0;
+	}
+	fpga_free_model(model);
+	rc = build_model(model, idcode, pkg, sizes, /*sizing_pass*/ 0,
+		/*lazy*/ 0);
+	free(sizes);
+	return rc;
+}
+
+int fpga_build_model_lazy(struct fpga_model* model, int idcode,
+	enum xc6_pkg pkg)
+{
+	return build_model(model, idcode, pkg, /*sizes*/ 0,
+		/*sizing_pass*/ 0, /*lazy*/ 1);
+}
+
+int fpga_materialize_tile(struct fpga_model* model, int y, int x)
+{
+	int region, i;
+
+	RC_CHECK(model);
+	// The lookup functions are also used while a region
+	// is built, that must not recurse.
+	if (!model->lazy || model->building_region != -1)
+		return 0;
+	if (y < 0 || y >= model->y_height) RC_FAIL(model, EINVAL);
+	region = model->y_region[y];
+	if (model->region_built[region])
+		return 0;
+
+	model->building_region = region;
+	build_routing(model);
+	model->building_region = -1;
+	model->region_built[region] = 1;
+
+	for (i = 0; i < model->num_regions; i++) {
+		if (!model->region_built[i])
+			RC_RETURN(model);
+	}
+	model->lazy = 0;
 	RC_RETURN(model);
 }
 
+int fpga_materialize_all(struct fpga_model* model)
+{
+	int y;
+
+	RC_CHECK(model);
+	for (y = 0; model->lazy && y < model->y_height; y++) {
+		fpga_materialize_tile(model, y, /*x*/ 0);
+		RC_CHECK(model);
+	}
+	RC_RETURN(model);
+}
+
+int routing_deferred(struct fpga_model* model, int y, int x)
+{
+	return model->lazy && model->y_region[y] != model->building_region;
+}
+
 int fpga_free_model(struct fpga_model* model)
 {
 	int rc;
 
 	if (!model) return 0;
 	rc = model->rc;
+	if (model->prof) {
+		if (s_prof_print && model->prof->lazy)
+			fpga_print_profile(stderr, model, s_prof_print);
+		free(model->prof);
+	}
 	free_devices(model);
+	free(model->journal_tiles);
+	free(model->journal_tile_marks);
+	free(model->journal_devs);
+	arena_free(&model->arena);
 	free(model->tmp_str);
 	strarray_free(&model->str);
 	free(model->tiles);
@@ -54,6 +294,257 @@ int fpga_free_model(struct fpga_model* model)
 	return rc;
 }
 
+#define JOURNAL_INCREMENT 256
+
+void fpga_journal_tile(struct fpga_model* model, int y, int x)
+{
+	void* new_ptr;
+	int tile_i;
+
+	if (!model->journal_tile_marks) {
+		model->journal_tile_marks = calloc(model->y_height
+			*model->x_width, sizeof(*model->journal_tile_marks));
+		if (!model->journal_tile_marks)
+			{ RC_SET(model, ENOMEM); return; }
+	}
+	tile_i = y*model->x_width + x;
+	if (model->journal_tile_marks[tile_i])
+		return;
+	if (model->num_journal_tiles >= model->journal_tiles_size) {
+		new_ptr = realloc(model->journal_tiles,
+			(model->journal_tiles_size+JOURNAL_INCREMENT)
+			*sizeof(*model->journal_tiles));
+		if (!new_ptr) { RC_SET(model, ENOMEM); return; }
+		model->journal_tiles = new_ptr;
+		model->journal_tiles_size += JOURNAL_INCREMENT;
+	}
+	model->journal_tiles[model->num_journal_tiles++] = tile_i;
+	model->journal_tile_marks[tile_i] = 1;
+}
+
+void fpga_journal_dev(struct fpga_model* model, struct fpga_device* dev)
+{
+	void* new_ptr;
+
+	if (dev->journaled)
+		return;
+	if (model->num_journal_devs >= model->journal_devs_size) {
+		new_ptr = realloc(model->journal_devs,
+			(model->journal_devs_size+JOURNAL_INCREMENT)
+			*sizeof(*model->journal_devs));
+		if (!new_ptr) { RC_SET(model, ENOMEM); return; }
+		model->journal_devs = new_ptr;
+		model->journal_devs_size += JOURNAL_INCREMENT;
+	}
+	model->journal_devs[model->num_journal_devs++] = dev;
+	dev->journaled = 1;
+}
+
+int fpga_reset_model(struct fpga_model* model)
+{
+	struct fpga_device* dev;
+	struct fpga_tile* tile;
+	int i;
+
+	RC_CHECK(model);
+	// same as fdev_delete()
+	for (i = 0; i < model->num_journal_devs; i++) {
+		dev = model->journal_devs[i];
+		if (dev->u != &fdev_no_cfg) {
+			free(dev->u);
+			dev->u = (union fpgadev_cfg*) &fdev_no_cfg;
+		}
+		dev->pinw_req_for_cfg = 0;
+		dev->pinw_req_total = 0;
+		dev->pinw_req_in = 0;
+		dev->instantiated = 0;
+		dev->journaled = 0;
+	}
+	model->num_journal_devs = 0;
+
+	for (i = 0; i < model->num_journal_tiles; i++) {
+		tile = &model->tiles[model->journal_tiles[i]];
+		memset(tile->switches_used, 0, (tile->num_switches+31)/32
+			*sizeof(*tile->switches_used));
+		model->journal_tile_marks[model->journal_tiles[i]] = 0;
+	}
+	model->num_journal_tiles = 0;
+
+	fnet_free_all(model);
+	RC_RETURN(model);
+}
+
+void fpga_build_profile(int on)
+{
+	s_prof_on = on;
+}
+
+__attribute__((constructor)) static void prof_from_env(void)
+{
+	const char* env;
+
+	env = getenv("FPGA_PROFILE");
+	if (!env || !*env || !strcmp(env, "0"))
+		s_prof_print = FPGA_PROF_OFF;
+	else if (!strcmp(env, "json"))
+		s_prof_print = FPGA_PROF_JSON;
+	else
+		s_prof_print = FPGA_PROF_TABLE;
+	s_prof_on = s_prof_print != FPGA_PROF_OFF;
+}
+
+static double prof_seconds(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec/1e9;
+}
+
+static void prof_add_counters(struct alloc_counters* sum,
+	const struct alloc_counters* add, int sign)
+{
+	sum->str_adds += sign*add->str_adds;
+	sum->reallocs += sign*add->reallocs;
+	sum->realloc_bytes += sign*add->realloc_bytes;
+	sum->alloc_bytes += sign*add->alloc_bytes;
+}
+
+int prof_begin(struct fpga_model* model, const char* name)
+{
+	struct fpga_prof* prof = model->prof;
+	struct fpga_prof_phase* phase;
+	struct alloc_counters now;
+	int name_len, i;
+
+	if (!prof) return -1;
+	name_len = strcspn(name, "(");
+	for (i = 0; i < prof->num_phases; i++) {
+		phase = &prof->phases[i];
+		if (phase->parent == prof->cur_phase
+		    && !strncmp(phase->name, name, name_len)
+		    && (!phase->name[name_len] || phase->name[name_len] == '('))
+			break;
+	}
+	if (i >= prof->num_phases) {
+		if (prof->num_phases >= PROF_MAX_PHASES)
+			return -1;
+		phase = &prof->phases[prof->num_phases++];
+		phase->name = name;
+		phase->parent = prof->cur_phase;
+	}
+	phase->calls++;
+	// the start values are subtracted here, prof_end() adds
+	// the end values
+	phase->seconds -= prof_seconds();
+	get_alloc_counters(&now);
+	prof_add_counters(&phase->counters, &now, -1);
+	prof->cur_phase = i;
+	return i;
+}
+
+void prof_end(struct fpga_model* model, int phase_i)
+{
+	struct fpga_prof_phase* phase;
+	struct alloc_counters now;
+
+	if (!model->prof || phase_i < 0) return;
+	phase = &model->prof->phases[phase_i];
+	get_alloc_counters(&now);
+	prof_add_counters(&phase->counters, &now, +1);
+	phase->seconds += prof_seconds();
+	model->prof->cur_phase = phase->parent;
+}
+
+static void print_phases(FILE* f, struct fpga_prof* prof, int parent,
+	int depth, int format)
+{
+	struct fpga_prof_phase* phase;
+	int name_len, first, i;
+
+	first = 1;
+	for (i = 0; i < prof->num_phases; i++) {
+		phase = &prof->phases[i];
+		if (phase->parent != parent)
+			continue;
+		name_len = strcspn(phase->name, "(");
+		if (format == FPGA_PROF_JSON) {
+			fprintf(f, "%s\n%*s{ \"name\" : \"%.*s\", \"calls\" : %i,"
+				" \"ms\" : %.3f, \"str_adds\" : %li,"
+				" \"reallocs\" : %li, \"realloc_bytes\" : %li,"
+				" \"alloc_bytes\" : %li",
+				first ? "" : ",", 2*depth+2, "",
+				name_len, phase->name, phase->calls,
+				phase->seconds*1000, phase->counters.str_adds,
+				phase->counters.reallocs,
+				phase->counters.realloc_bytes,
+				phase->counters.alloc_bytes);
+			fprintf(f, ", \"phases\" : [");
+			print_phases(f, prof, i, depth+1, format);
+			fprintf(f, "] }");
+		} else {
+			fprintf(f, "%*s%-*.*s %6i %10.3f %9li %9li %11li %11li\n",
+				2*depth, "", 32-2*depth, name_len, phase->name,
+				phase->calls, phase->seconds*1000,
+				phase->counters.str_adds,
+				phase->counters.reallocs,
+				phase->counters.realloc_bytes,
+				phase->counters.alloc_bytes);
+			print_phases(f, prof, i, depth+1, format);
+		}
+		first = 0;
+	}
+}
+
+void fpga_print_profile(FILE* f, struct fpga_model* model, int format)
+{
+	if (!model->prof) return;
+	if (format == FPGA_PROF_JSON) {
+		fprintf(f, "{ \"sizing_pass\" : %s, \"lazy\" : %s,"
+			" \"phases\" : [",
+			model->sizing_pass ? "true" : "false",
+			model->prof->lazy ? "true" : "false");
+		print_phases(f, model->prof, /*parent*/ -1, /*depth*/ 0, format);
+		fprintf(f, " ] }\n");
+		return;
+	}
+	if (model->sizing_pass)
+		fprintf(f, "sizing pass\n");
+	fprintf(f, "%-32s %6s %10s %9s %9s %11s %11s\n", "phase", "calls",
+		"ms", "str_adds", "reallocs", "realloc_b", "alloc_b");
+	print_phases(f, model->prof, /*parent*/ -1, /*depth*/ 0, format);
+}
+
+int fpga_stats_enabled(void)
+{
+#ifdef FPGA_STATS
+	return 1;
+#else
+	return 0;
+#endif
+}
+
+void fpga_print_stats(FILE* f, struct fpga_model* model)
+{
+	const struct fpga_stats* stats = &model->stats;
+
+	if (!fpga_stats_enabled()) {
+		fprintf(f, "#W Counters not compiled in, rebuild with make STATS=1\n");
+		return;
+	}
+	fprintf(f, "%-20s %12li\n", "strarray_finds", model->str.num_finds);
+	fprintf(f, "%-20s %12li\n", "strarray_adds", model->str.num_adds);
+	fprintf(f, "%-20s %12li\n", "connpt_finds", stats->connpt_finds);
+	fprintf(f, "%-20s %12li\n", "switch_firsts", stats->switch_firsts);
+	fprintf(f, "%-20s %12li\n", "switch_nexts", stats->switch_nexts);
+	fprintf(f, "%-20s %12li\n", "chain_steps", stats->chain_steps);
+	fprintf(f, "%-20s %12li\n", "other_net_checks",
+		stats->other_net_checks);
+	fprintf(f, "%-20s %12li\n", "bit_gets", stats->bit_gets);
+	fprintf(f, "%-20s %12li\n", "bit_sets", stats->bit_sets);
+	fprintf(f, "%-20s %12li\n", "net_allocs", stats->net_allocs);
+}
+
 static const char* fpga_ttstr[] = // tile type strings
 {
 	[NA] = "NA",
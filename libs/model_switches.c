@@ -48,54 +48,54 @@ int init_switches(struct fpga_model *model, int routing_sw)
 {
 	RC_CHECK(model);
 
-	centx_gtp(model);
-	centy_pci_rdy(model);
-
-	dev_oct_calibrate(model, TOP_FIRST_REGULAR, LEFT_IO_DEVS, /*idx*/ 0);
-	dev_oct_calibrate(model, TOP_FIRST_REGULAR, LEFT_IO_DEVS, /*idx*/ 1);
-	dev_oct_calibrate(model, model->y_height - BOT_LAST_REGULAR_O, LEFT_IO_DEVS, /*idx*/ 0);
-	dev_oct_calibrate(model, model->y_height - BOT_LAST_REGULAR_O, LEFT_IO_DEVS, /*idx*/ 1);
-	dev_oct_calibrate(model, TOP_FIRST_REGULAR+1, model->x_width-RIGHT_IO_DEVS_O, /*idx*/ 0);
-	dev_oct_calibrate(model, model->y_height - BOT_LAST_REGULAR_O, model->x_width-RIGHT_IO_DEVS_O, /*idx*/ 0);
-
-	dev_dna(model);
-	dev_pmv(model);
-	dev_icap(model);
-	dev_spi_access(model);
-	dev_post_crc(model);
-	dev_startup(model);
-	dev_slave_spi(model);
-	dev_suspend_sync(model);
-	centy_bram_ckpin(model);
-	pcice_sw(model);
-	term_to_io_sw(model, IOCE);
-	term_to_io_sw(model, IOCLK);
-	term_to_io_sw(model, PLLCE);
-	term_to_io_sw(model, PLLCLK);
+	PROF(model, centx_gtp(model));
+	PROF(model, centy_pci_rdy(model));
+
+	PROF(model, dev_oct_calibrate(model, TOP_FIRST_REGULAR, LEFT_IO_DEVS, /*idx*/ 0));
+	PROF(model, dev_oct_calibrate(model, TOP_FIRST_REGULAR, LEFT_IO_DEVS, /*idx*/ 1));
+	PROF(model, dev_oct_calibrate(model, model->y_height - BOT_LAST_REGULAR_O, LEFT_IO_DEVS, /*idx*/ 0));
+	PROF(model, dev_oct_calibrate(model, model->y_height - BOT_LAST_REGULAR_O, LEFT_IO_DEVS, /*idx*/ 1));
+	PROF(model, dev_oct_calibrate(model, TOP_FIRST_REGULAR+1, model->x_width-RIGHT_IO_DEVS_O, /*idx*/ 0));
+	PROF(model, dev_oct_calibrate(model, model->y_height - BOT_LAST_REGULAR_O, model->x_width-RIGHT_IO_DEVS_O, /*idx*/ 0));
+
+	PROF(model, dev_dna(model));
+	PROF(model, dev_pmv(model));
+	PROF(model, dev_icap(model));
+	PROF(model, dev_spi_access(model));
+	PROF(model, dev_post_crc(model));
+	PROF(model, dev_startup(model));
+	PROF(model, dev_slave_spi(model));
+	PROF(model, dev_suspend_sync(model));
+	PROF(model, centy_bram_ckpin(model));
+	PROF(model, pcice_sw(model));
+	PROF(model, term_to_io_sw(model, IOCE));
+	PROF(model, term_to_io_sw(model, IOCLK));
+	PROF(model, term_to_io_sw(model, PLLCE));
+	PROF(model, term_to_io_sw(model, PLLCLK));
 
 	if (routing_sw)
-		init_routing(model);
-
-	init_logic(model);
-   	init_iologic(model);
-   	init_north_south_dirwire_term(model);
-   	init_east_west_dirwire_term(model);
-   	init_ce_clk(model);
-	init_io(model);
-	init_center(model);
-	init_hclk(model);
-	init_logicout_fw(model);
-	init_bram(model);
-	init_macc(model);
-	init_topbot_tterm_gclk(model);
-	init_bufio(model);
-	init_bscan(model);
-	init_dcm(model);
-	init_pll(model);
-	init_center_hclk(model);
-	init_center_midbuf(model);
-	init_center_reg_tblr(model);
-	init_center_topbot_cfb_dfb(model);
+		PROF(model, init_routing(model));
+
+	PROF(model, init_logic(model));
+   	PROF(model, init_iologic(model));
+   	PROF(model, init_north_south_dirwire_term(model));
+   	PROF(model, init_east_west_dirwire_term(model));
+   	PROF(model, init_ce_clk(model));
+	PROF(model, init_io(model));
+	PROF(model, init_center(model));
+	PROF(model, init_hclk(model));
+	PROF(model, init_logicout_fw(model));
+	PROF(model, init_bram(model));
+	PROF(model, init_macc(model));
+	PROF(model, init_topbot_tterm_gclk(model));
+	PROF(model, init_bufio(model));
+	PROF(model, init_bscan(model));
+	PROF(model, init_dcm(model));
+	PROF(model, init_pll(model));
+	PROF(model, init_center_hclk(model));
+	PROF(model, init_center_midbuf(model));
+	PROF(model, init_center_reg_tblr(model));
+	PROF(model, init_center_topbot_cfb_dfb(model));
 
 	RC_RETURN(model);
 }
@@ -1477,7 +1477,7 @@ static int init_routing(struct fpga_model *model)
 int replicate_routing_switches(struct fpga_model *model)
 {
 	struct fpga_tile* tile;
-	int x, y, first_y, first_x, rc;
+	int x, y, first_y, first_x, building_region, rc;
 
 	RC_CHECK(model);
 	first_y = -1;
@@ -1493,6 +1493,8 @@ int replicate_routing_switches(struct fpga_model *model)
 			// them in the high-speed replication scheme.
 			if (tile->type == IO_ROUTING || tile->type == ROUTING_IO_L
 			    || tile->type == ROUTING_BRK || tile->type == BRAM_ROUTING_BRK) {
+				if (routing_deferred(model, y, x))
+					continue;
 				rc = init_routing_tile(model, y, x);
 				if (rc) RC_FAIL(model, rc);
 				continue;
@@ -1500,7 +1502,16 @@ int replicate_routing_switches(struct fpga_model *model)
 			if (first_y == -1) {
 				first_y = y;
 				first_x = x;
+				// In a lazily built model, the template tile
+				// is built with the first region that needs
+				// it, even if it is in another region.
+				if (tile->num_switches)
+					continue;
+				building_region = model->building_region;
+				if (model->lazy)
+					model->building_region = model->y_region[y];
 				rc = init_routing_tile(model, y, x);
+				model->building_region = building_region;
 				if (rc) RC_FAIL(model, rc);
 				continue;
 			}
@@ -9,197 +9,465 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdint.h>
-#include <assert.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 
 #include "helper.h"
 
-#define ALLOC_INCREMENT 16
+#define READ_CHUNK	(1024*1024)
+#define NO_NAME		0xFFFFFFFF
 
-static int add_entry(uint32_t** net, uint32_t new_idx)
+// All names point into the input buffer, which stays mapped
+// until the program exits, so nothing needs to be copied.
+struct name_table
 {
-	if (!*net) {
-		*net = malloc(ALLOC_INCREMENT*sizeof(**net));
-		if (!(*net)) {
-			fprintf(stderr, "Out of memory in %s:%i\n",
-				__FILE__, __LINE__);
+	const char* input;
+	uint32_t num_names;
+	uint32_t names_alloc;
+	uint64_t* name_off;
+	uint32_t* name_len;
+	uint32_t* name_hash;
+	// Open addressing with linear probing, NO_NAME
+	// means free. num_slots is always a power of 2.
+	uint32_t* slots;
+	uint32_t num_slots;
+};
+
+// Union-find with path halving and union by rank.
+struct net_sets
+{
+	uint32_t* parent;
+	uint8_t* rank;
+};
+
+// Connection points grouped by net: members[net_start[i]] to
+// members[net_start[i+1]-1] belong to net i.
+struct nets
+{
+	uint32_t num_nets;
+	uint32_t* net_start;
+	uint32_t* members;
+};
+
+static const struct name_table* s_sort_names;
+
+static uint32_t hash_word(const char* s, int len)
+{
+	uint32_t hash = 5381;
+	int i;
+
+	for (i = 0; i < len; i++)
+		hash = ((hash << 5) + hash) + (unsigned char) s[i];
+	return hash;
+}
+
+static int grow_slots(struct name_table* names)
+{
+	uint32_t new_num_slots, i, slot;
+	uint32_t* new_slots;
+
+	new_num_slots = names->num_slots ? names->num_slots*2 : 1<<16;
+	new_slots = malloc(new_num_slots*sizeof(*new_slots));
+	if (!new_slots) {
+		fprintf(stderr, "Out of memory in %s:%i\n", __FILE__, __LINE__);
+		return -1;
+	}
+	memset(new_slots, 0xFF, new_num_slots*sizeof(*new_slots));
+	for (i = 0; i < names->num_names; i++) {
+		slot = names->name_hash[i] & (new_num_slots-1);
+		while (new_slots[slot] != NO_NAME)
+			slot = (slot+1) & (new_num_slots-1);
+		new_slots[slot] = i;
+	}
+	free(names->slots);
+	names->slots = new_slots;
+	names->num_slots = new_num_slots;
+	return 0;
+}
+
+static int grow_names(struct name_table* names, struct net_sets* sets)
+{
+	uint32_t new_alloc;
+	void* new_ptr;
+
+	new_alloc = names->names_alloc ? names->names_alloc*2 : 1<<15;
+	if (new_alloc >= NO_NAME) goto out_of_mem;
+	if (!(new_ptr = realloc(names->name_off, new_alloc*sizeof(*names->name_off))))
+		goto out_of_mem;
+	names->name_off = new_ptr;
+	if (!(new_ptr = realloc(names->name_len, new_alloc*sizeof(*names->name_len))))
+		goto out_of_mem;
+	names->name_len = new_ptr;
+	if (!(new_ptr = realloc(names->name_hash, new_alloc*sizeof(*names->name_hash))))
+		goto out_of_mem;
+	names->name_hash = new_ptr;
+	if (!(new_ptr = realloc(sets->parent, new_alloc*sizeof(*sets->parent))))
+		goto out_of_mem;
+	sets->parent = new_ptr;
+	if (!(new_ptr = realloc(sets->rank, new_alloc*sizeof(*sets->rank))))
+		goto out_of_mem;
+	sets->rank = new_ptr;
+	names->names_alloc = new_alloc;
+	return 0;
+out_of_mem:
+	fprintf(stderr, "Out of memory in %s:%i\n", __FILE__, __LINE__);
+	return -1;
+}
+
+// Returns the index of the name, adding it and a new
+// single-member set if it has not been seen before.
+static int intern_name(struct name_table* names, struct net_sets* sets,
+	uint64_t off, int len, uint32_t* idx)
+{
+	uint32_t hash, slot, i;
+
+	hash = hash_word(&names->input[off], len);
+	slot = hash & (names->num_slots-1);
+	while ((i = names->slots[slot]) != NO_NAME) {
+		if (names->name_hash[i] == hash && names->name_len[i] == len
+		    && !memcmp(&names->input[names->name_off[i]],
+				&names->input[off], len)) {
+			*idx = i;
+			return 0;
+		}
+		slot = (slot+1) & (names->num_slots-1);
+	}
+	if (names->num_names >= names->names_alloc
+	    && grow_names(names, sets))
+		return -1;
+	i = names->num_names++;
+	names->name_off[i] = off;
+	names->name_len[i] = len;
+	names->name_hash[i] = hash;
+	names->slots[slot] = i;
+	sets->parent[i] = i;
+	sets->rank[i] = 0;
+	// keep the table at most half full
+	if (names->num_names*2 > names->num_slots && grow_slots(names))
+		return -1;
+	*idx = i;
+	return 0;
+}
+
+static uint32_t find_set(struct net_sets* sets, uint32_t i)
+{
+	while (sets->parent[i] != i) {
+		sets->parent[i] = sets->parent[sets->parent[i]];
+		i = sets->parent[i];
+	}
+	return i;
+}
+
+static void union_sets(struct net_sets* sets, uint32_t a, uint32_t b)
+{
+	a = find_set(sets, a);
+	b = find_set(sets, b);
+	if (a == b) return;
+	if (sets->rank[a] < sets->rank[b])
+		sets->parent[a] = b;
+	else if (sets->rank[a] > sets->rank[b])
+		sets->parent[b] = a;
+	else {
+		sets->parent[b] = a;
+		sets->rank[a]++;
+	}
+}
+
+// Maps the whole file, or reads stdin in large chunks if
+// the input cannot be mapped.
+static int read_input(const char* path, const char** data, uint64_t* len)
+{
+	struct stat st;
+	FILE* fp;
+	char* buf, *new_buf;
+	uint64_t buf_len, buf_alloc;
+	size_t read_len;
+	void* map;
+
+	if (strcmp(path, "-")) {
+		fp = fopen(path, "r");
+		if (!fp) {
+			fprintf(stderr, "Error opening %s.\n", path);
 			return -1;
 		}
-		**net = 1;
-	} else {
-		uint32_t num_entries = **net;
-		if (!(num_entries % ALLOC_INCREMENT)) {
-			void* new_ptr = realloc(*net,
-				(num_entries + ALLOC_INCREMENT)*sizeof(**net));
-			if (!new_ptr) {
+		if (!fstat(fileno(fp), &st) && S_ISREG(st.st_mode)) {
+			if (!st.st_size) {
+				fclose(fp);
+				*data = "";
+				*len = 0;
+				return 0;
+			}
+			map = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE,
+				fileno(fp), 0);
+			if (map != MAP_FAILED) {
+				madvise(map, st.st_size, MADV_SEQUENTIAL);
+				fclose(fp);
+				*data = map;
+				*len = st.st_size;
+				return 0;
+			}
+		}
+	} else
+		fp = stdin;
+
+	buf = 0;
+	buf_len = 0;
+	buf_alloc = 0;
+	do {
+		if (buf_len + READ_CHUNK > buf_alloc) {
+			buf_alloc = buf_alloc ? buf_alloc*2 : 16*READ_CHUNK;
+			new_buf = realloc(buf, buf_alloc);
+			if (!new_buf) {
 				fprintf(stderr, "Out of memory in %s:%i\n",
 					__FILE__, __LINE__);
+				free(buf);
+				if (fp != stdin) fclose(fp);
 				return -1;
 			}
-			*net = new_ptr;
+			buf = new_buf;
 		}
-	}
-	(*net)[**net] = new_idx;
-	(**net)++;
+		read_len = fread(&buf[buf_len], 1, READ_CHUNK, fp);
+		buf_len += read_len;
+	} while (read_len == READ_CHUNK);
+	if (fp != stdin) fclose(fp);
+	*data = buf;
+	*len = buf_len;
 	return 0;
 }
 
-static int print_nets(uint32_t** nets, struct hashed_strarray* connpt_names)
-{
-	int i, j, num_connpoints, num_nets, largest_net, total_net_connpoints;
-	const char* str;
-
-	num_connpoints = 0;
-	num_nets = 0;
-	largest_net = 0;
-	total_net_connpoints = 0;
-
-	for (i = 0; i < STRIDX_1M; i++) {
-		if (nets[i]) {
-			num_connpoints++;
-			if (!((uint64_t)nets[i] & 1)) {
-				num_nets++;
-				if (!(*nets[i]))
-					fprintf(stderr, "Internal error - 0 entries in net %i\n", i);
-				total_net_connpoints += *nets[i] - 1;
-				if (*nets[i] - 1 > largest_net)
-					largest_net = *nets[i] - 1;
-				for (j = 1; j < *nets[i]; j++) {
-					str = strarray_lookup(connpt_names, nets[i][j]);
-					if (!str) {
-						fprintf(stderr, "Internal error - cannot find str %i\n", nets[i][j]);
-						continue;
-					}
-					if (j > 1) fputc(' ', stdout);
-					fputs(str, stdout);
-				}
-				fputc('\n', stdout);
+static int is_space(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+// Joins the nets of the first two words of every line.
+static int read_pairs(const char* data, uint64_t len,
+	struct name_table* names, struct net_sets* sets)
+{
+	uint64_t pos, word_start[2], word_len[2];
+	uint32_t idx[2];
+	int num_words;
+
+	pos = 0;
+	while (pos < len) {
+		num_words = 0;
+		while (pos < len && data[pos] != '\n') {
+			if (is_space(data[pos])) {
+				pos++;
+				continue;
 			}
+			word_start[num_words] = pos;
+			while (pos < len && data[pos] != '\n'
+			       && !is_space(data[pos]))
+				pos++;
+			word_len[num_words] = pos - word_start[num_words];
+			if (++num_words >= 2) break;
 		}
+		while (pos < len && data[pos] != '\n')
+			pos++;
+		pos++;
+		if (num_words < 2) continue;
+
+		if (intern_name(names, sets, word_start[0], word_len[0], &idx[0])
+		    || intern_name(names, sets, word_start[1], word_len[1], &idx[1]))
+			return -1;
+		union_sets(sets, idx[0], idx[1]);
 	}
 	return 0;
 }
 
-struct hashed_strarray* g_sort_connpt_names;
+// Groups all names by set. Nets are numbered in the order in
+// which their first member appeared in the input, members keep
+// input order until they are sorted. Earlier versions printed the
+// nets in the order of their hashed string array slots, which had
+// no meaning either, so callers that compare output sort it (see
+// the %.cnets rule).
+static int build_nets(struct name_table* names, struct net_sets* sets,
+	struct nets* nets)
+{
+	uint32_t i, root, num_names, *net_of_root, *fill;
+
+	num_names = names->num_names;
+	nets->num_nets = 0;
+	nets->net_start = 0;
+	nets->members = malloc((num_names+1)*sizeof(*nets->members));
+	net_of_root = malloc((num_names+1)*sizeof(*net_of_root));
+	if (!nets->members || !net_of_root) goto out_of_mem;
+
+	// reuse rank as 'root has a net number' flag
+	memset(sets->rank, 0, num_names*sizeof(*sets->rank));
+	for (i = 0; i < num_names; i++) {
+		root = find_set(sets, i);
+		if (!sets->rank[root]) {
+			sets->rank[root] = 1;
+			net_of_root[root] = nets->num_nets++;
+		}
+	}
+	nets->net_start = calloc(nets->num_nets+1, sizeof(*nets->net_start));
+	if (!nets->net_start) goto out_of_mem;
+	for (i = 0; i < num_names; i++)
+		nets->net_start[net_of_root[find_set(sets, i)]+1]++;
+	for (i = 0; i < nets->num_nets; i++)
+		nets->net_start[i+1] += nets->net_start[i];
+
+	fill = malloc((nets->num_nets+1)*sizeof(*fill));
+	if (!fill) goto out_of_mem;
+	memcpy(fill, nets->net_start, (nets->num_nets+1)*sizeof(*fill));
+	for (i = 0; i < num_names; i++)
+		nets->members[fill[net_of_root[find_set(sets, i)]]++] = i;
+	free(fill);
+	free(net_of_root);
+	return 0;
+out_of_mem:
+	fprintf(stderr, "Out of memory in %s:%i\n", __FILE__, __LINE__);
+	free(net_of_root);
+	return -1;
+}
 
 static int sort_net(const void* a, const void* b)
 {
-	const uint32_t* _a, *_b;
-	const char* a_str, *b_str;
-
-	_a = a;
-	_b = b;
-	a_str = strarray_lookup(g_sort_connpt_names, *_a);
-	b_str = strarray_lookup(g_sort_connpt_names, *_b);
-	if (!a_str || !b_str) {
-		fprintf(stderr, "Internal error in %s:%i - cannot find str %i or %i\n",
-			__FILE__, __LINE__, *_a, *_b);
-		return 0;
+	uint32_t a_idx, b_idx, a_len, b_len;
+	int result;
+
+	a_idx = *(const uint32_t*) a;
+	b_idx = *(const uint32_t*) b;
+	a_len = s_sort_names->name_len[a_idx];
+	b_len = s_sort_names->name_len[b_idx];
+	result = memcmp(&s_sort_names->input[s_sort_names->name_off[a_idx]],
+		&s_sort_names->input[s_sort_names->name_off[b_idx]],
+		a_len < b_len ? a_len : b_len);
+	if (result) return result;
+	return (a_len > b_len) - (a_len < b_len);
+}
+
+struct sort_work
+{
+	pthread_mutex_t lock;
+	uint32_t next_net;
+	struct nets* nets;
+};
+
+#define SORT_BATCH	256
+
+static void* sort_thread(void* arg)
+{
+	struct sort_work* work = arg;
+	struct nets* nets = work->nets;
+	uint32_t first, last, i;
+
+	while (1) {
+		pthread_mutex_lock(&work->lock);
+		first = work->next_net;
+		work->next_net = first + SORT_BATCH < nets->num_nets
+			? first + SORT_BATCH : nets->num_nets;
+		last = work->next_net;
+		pthread_mutex_unlock(&work->lock);
+		if (first >= last) break;
+
+		for (i = first; i < last; i++)
+			qsort(&nets->members[nets->net_start[i]],
+				nets->net_start[i+1] - nets->net_start[i],
+				sizeof(*nets->members), sort_net);
 	}
-	return strcmp(a_str, b_str);
+	return 0;
 }
 
-static int sort_nets(uint32_t** nets, struct hashed_strarray* connpt_names)
+static int sort_nets(struct nets* nets, const struct name_table* names)
 {
-	int i;
+	struct sort_work work;
+	pthread_t threads[64];
+	long num_threads;
+	int i, rc;
+
+	s_sort_names = names;
+	work.next_net = 0;
+	work.nets = nets;
+	pthread_mutex_init(&work.lock, 0);
 
-	g_sort_connpt_names = connpt_names;
-	for (i = 0; i < STRIDX_1M; i++) {
-		if (nets[i] && !((uint64_t)nets[i] & 1)) {
-			qsort(&nets[i][1], *nets[i]-1, sizeof(nets[i][1]), sort_net);
+	num_threads = sysconf(_SC_NPROCESSORS_ONLN);
+	if (num_threads < 1) num_threads = 1;
+	if (num_threads > sizeof(threads)/sizeof(*threads))
+		num_threads = sizeof(threads)/sizeof(*threads);
+	// the main thread sorts too
+	for (i = 0; i < num_threads-1; i++) {
+		rc = pthread_create(&threads[i], 0, sort_thread, &work);
+		if (rc) {
+			fprintf(stderr, "Cannot create thread: %s\n", strerror(rc));
+			break;
 		}
 	}
+	sort_thread(&work);
+	while (--i >= 0)
+		pthread_join(threads[i], 0);
+	pthread_mutex_destroy(&work.lock);
+	return 0;
+}
+
+static int print_nets(const struct nets* nets, const struct name_table* names)
+{
+	static char out_buf[READ_CHUNK];
+	uint32_t i, j, idx;
+
+	setvbuf(stdout, out_buf, _IOFBF, sizeof(out_buf));
+	for (i = 0; i < nets->num_nets; i++) {
+		// a name that was only ever paired with itself
+		// is not connected to anything
+		if (nets->net_start[i+1] - nets->net_start[i] < 2)
+			continue;
+		for (j = nets->net_start[i]; j < nets->net_start[i+1]; j++) {
+			idx = nets->members[j];
+			if (j > nets->net_start[i]) fputc(' ', stdout);
+			fwrite(&names->input[names->name_off[idx]], 1,
+				names->name_len[idx], stdout);
+		}
+		fputc('\n', stdout);
+	}
+	if (fflush(stdout)) {
+		fprintf(stderr, "Error writing output: %s\n", strerror(errno));
+		return -1;
+	}
 	return 0;
 }
 
 int main(int argc, char** argv)
 {
-	char line[1024], point_a[1024], point_b[1024];
-	struct hashed_strarray connpt_names;
-	FILE* fp = 0;
-	int i, rc, point_a_idx, point_b_idx, existing_net_idx, new_net_idx;
-	int net_data_idx;
-	uint32_t** nets;
+	struct name_table names;
+	struct net_sets sets;
+	struct nets nets;
+	const char* data;
+	uint64_t data_len;
 
 	if (argc < 2) {
 		fprintf(stderr,
 			"\n"
 			"pair2net - finds all pairs connected to the same net\n"
-			"Usage: %s <data_file> | '-' for stdin\n", argv[0]);
+			"Usage: %s <data_file> | '-' for stdin\n"
+			"Prints one net per line with its members sorted, nets\n"
+			"in the order their first member appears in the input.\n",
+			argv[0]);
 		goto xout;
 	}
-	if (strarray_init(&connpt_names, STRIDX_1M)) {
-		fprintf(stderr, "Out of memory in %s:%i\n", __FILE__, __LINE__);
+	CLEAR(names);
+	CLEAR(sets);
+	CLEAR(nets);
+
+	if (read_input(argv[1], &data, &data_len))
+		goto xout;
+	names.input = data;
+	if (grow_names(&names, &sets) || grow_slots(&names))
 		goto xout;
-	}
 
-	nets = calloc(STRIDX_1M, sizeof(*nets));
-	if (!nets) {
-		fprintf(stderr, "Out of memory in %s:%i\n", __FILE__, __LINE__);
+	if (read_pairs(data, data_len, &names, &sets))
+		goto xout;
+	if (build_nets(&names, &sets, &nets))
+		goto xout;
+	if (sort_nets(&nets, &names))
+		goto xout;
+	if (print_nets(&nets, &names))
 		goto xout;
-	}
-	if (!strcmp(argv[1], "-"))
-		fp = stdin;
-	else {
-		fp = fopen(argv[1], "r");
-		if (!fp) {
-			fprintf(stderr, "Error opening %s.\n", argv[1]);
-			goto xout;
-		}
-	}
-	while (fgets(line, sizeof(line), fp)) {
-		i = sscanf(line, "%s%s", point_a, point_b);
-		if (i != 2) continue;
-
-		i = strlen(point_b);
-		if (i && point_b[i-1] == '\n')
-			point_b[i-1] = 0;
-		rc = strarray_add(&connpt_names, point_a, &point_a_idx);
-		if (rc) {
-			fprintf(stderr, "Out of memory in %s:%i\n",
-				__FILE__, __LINE__);
-			goto xout;
-		}
-		rc = strarray_add(&connpt_names, point_b, &point_b_idx);
-		if (rc) {
-			fprintf(stderr, "Out of memory in %s:%i\n",
-				__FILE__, __LINE__);
-			goto xout;
-		}
-		if (nets[point_a_idx] && nets[point_b_idx]) {
-			continue;}
-		if (nets[point_a_idx] || nets[point_b_idx]) {
-			if (nets[point_a_idx]) {
-				existing_net_idx = point_a_idx;
-				new_net_idx = point_b_idx;
-			} else { // point_b_idx exists
-				existing_net_idx = point_b_idx;
-				new_net_idx = point_a_idx;
-			}
-			if ((uint64_t) nets[existing_net_idx] & 1)
-				net_data_idx = (uint64_t) nets[existing_net_idx] >> 32;
-			else
-				net_data_idx = existing_net_idx;
-			// add new_net_idx to net data
-			rc = add_entry(&nets[net_data_idx], new_net_idx);
-			if (rc) goto xout;
-			// point to net data from new_net_idx
-			nets[new_net_idx] = (uint32_t*) (((uint64_t) net_data_idx << 32) | 1);
-		} else {
-			rc = add_entry(&nets[point_a_idx], point_a_idx);
-			if (rc) goto xout;
-			rc = add_entry(&nets[point_a_idx], point_b_idx);
-			if (rc) goto xout;
-			nets[point_b_idx] = (uint32_t*) (((uint64_t) point_a_idx << 32) | 1);
-		}
-	}
-	rc = sort_nets(nets, &connpt_names);
-	if (rc) goto xout;
-	rc = print_nets(nets, &connpt_names);
-	if (rc) goto xout;
-	fclose(fp);
 	return EXIT_SUCCESS;
 xout:
-	if(fp) fclose(fp);
 	return EXIT_FAILURE;
 }
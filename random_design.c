@@ -0,0 +1,454 @@
+//
+// This is free and unencumbered software released into the public domain.
+// For details see the UNLICENSE file at the root of the source tree.
+//
+
+#include "model.h"
+#include "floorplan.h"
+#include "control.h"
+#include "bit.h"
+
+/*
+   random_design fills a part of the chip with seeded random logic,
+   to be used as a large input for routing, bitstream and floorplan
+   benchmarks. The same seed and parameters always produce the same
+   design.
+
+   - carry chains: counters like in blinking_led.c, going up in
+     M/L columns, with their lut outputs fed back into the slice
+   - logic: slices with random lut6 values, every used lut output
+     is fed back into a random input of another lut in the slice
+   - IOBs: bonded IOBs configured as random inputs or outputs,
+     not connected to any logic
+
+   Only nets that fnet_route() can route and carry chains that
+   extract_model() reads back are generated, so the .bit can be
+   converted back with bit2fp.
+*/
+
+static uint64_t s_rand_state;
+
+// xorshift64*, independent of the C library
+static uint64_t rand64(void)
+{
+	s_rand_state ^= s_rand_state >> 12;
+	s_rand_state ^= s_rand_state << 25;
+	s_rand_state ^= s_rand_state >> 27;
+	return s_rand_state * 2685821657736338717ULL;
+}
+
+static int rand_below(int n)
+{
+	return (rand64() >> 33) % n;
+}
+
+static int rand_pct(int pct)
+{
+	return rand_below(100) < pct;
+}
+
+struct design_state
+{
+	struct fpga_model* model;
+	int logic_pct, iob_pct, carry_pct, carry_len;
+	// one byte per tile, bit type_idx set for used logic devices
+	uint8_t* logic_used;
+	int num_carry_slices, num_logic_slices, num_iobs, num_nets;
+	int num_unroutable;
+};
+
+static int logic_used(struct design_state* ds, int y, int x, int type_idx)
+{
+	return (ds->logic_used[y*ds->model->x_width + x] >> type_idx) & 1;
+}
+
+static void set_logic_used(struct design_state* ds, int y, int x, int type_idx)
+{
+	ds->logic_used[y*ds->model->x_width + x] |= 1 << type_idx;
+}
+
+// Mirrors fnet_route_logic_to_self() without touching model->rc, so
+// that pins which cannot be connected are skipped instead of failing
+// the whole model.
+static int can_route_in_slice(struct fpga_model* model, int y, int x,
+	int type_idx, net_idx_t net, int out_pin, int in_pin)
+{
+	struct fpga_device* dev;
+	struct sw_conns out_conns, in_conns;
+	struct sw_set sw_set;
+	int routable = 0;
+
+	dev = fdev_p(model, y, x, DEV_LOGIC, type_idx);
+	if (!dev) { HERE(); return 0; }
+	construct_sw_conns(&out_conns, model, y, x, dev->pinw[out_pin],
+		SW_FROM, /*max_depth*/ 2, net);
+	construct_sw_conns(&in_conns, model, y, x, dev->pinw[in_pin],
+		SW_TO, /*max_depth*/ 2, net);
+	if (fpga_switch_conns(&out_conns) != NO_CONN
+	    && fpga_switch_conns(&in_conns) != NO_CONN
+	    && out_conns.dest_y == in_conns.dest_y
+	    && out_conns.dest_x == in_conns.dest_x) {
+		fpga_multi_switch_lookup(model, out_conns.dest_y,
+			out_conns.dest_x, out_conns.dest_str_i,
+			in_conns.dest_str_i, /*max_depth*/ 2, net, &sw_set);
+		routable = sw_set.len > 0;
+	}
+	destruct_sw_conns(&in_conns);
+	destruct_sw_conns(&out_conns);
+	return routable;
+}
+
+// Connects out_pin to the first pin in in_pins[0..num_in_pins-1] that
+// can be routed inside the slice. Returns the index of that pin in
+// *in_i, or -1 if none of them is reachable.
+static int route_in_slice(struct design_state* ds, int y, int x,
+	int type_idx, int out_pin, const int* in_pins, int num_in_pins,
+	int* in_i)
+{
+	net_idx_t net;
+	int rc;
+
+	*in_i = -1;
+	rc = fnet_new(ds->model, &net);
+	if (rc) FAIL(rc);
+	rc = fnet_add_port(ds->model, net, y, x, DEV_LOGIC, type_idx, out_pin);
+	if (rc) FAIL(rc);
+	for (*in_i = 0; *in_i < num_in_pins; (*in_i)++) {
+		if (can_route_in_slice(ds->model, y, x, type_idx, net,
+			out_pin, in_pins[*in_i]))
+			break;
+	}
+	if (*in_i >= num_in_pins) {
+		*in_i = -1;
+		fnet_delete(ds->model, net);
+		ds->num_unroutable++;
+		return 0;
+	}
+	rc = fnet_add_port(ds->model, net, y, x, DEV_LOGIC, type_idx,
+		in_pins[*in_i]);
+	if (rc) FAIL(rc);
+	rc = fnet_route(ds->model, net);
+	if (rc) FAIL(rc);
+	ds->num_nets++;
+	return 0;
+fail:
+	return rc;
+}
+
+// A counter of 4 bits per slice, the same as in blinking_led.c.
+static int add_carry_chain(struct design_state* ds, int y, int x)
+{
+	static const int out_pin[] = {LO_AQ, LO_BQ, LO_CQ, LO_DQ};
+	static const int in_pin[] = {LI_A5, LI_B5, LI_C5, LI_D5};
+	struct fpgadev_logic logic_cfg;
+	net_idx_t net;
+	int slice, next_y, i, in_i, rc;
+
+	for (slice = 0; slice < ds->carry_len; slice++) {
+		CLEAR(logic_cfg);
+		logic_cfg.clk_inv = CLKINV_CLK;
+		logic_cfg.sync_attr = SYNCATTR_ASYNC;
+		for (i = 0; i < NUM_LUTS; i++) {
+			logic_cfg.a2d[i].flags |= LUT5VAL_SET | LUT6VAL_SET;
+			if (!slice && !i) {
+				logic_cfg.precyinit = PRECYINIT_0;
+				rc = bool_str2lut_pair("(A6+~A6)*(~A5)", "1",
+					&logic_cfg.a2d[i].lut6_val,
+					&logic_cfg.a2d[i].lut5_val);
+			} else
+				rc = bool_str2lut_pair("(A6+~A6)*(A5)", "0",
+					&logic_cfg.a2d[i].lut6_val,
+					&logic_cfg.a2d[i].lut5_val);
+			if (rc) FAIL(rc);
+			logic_cfg.a2d[i].cy0 = CY0_O5;
+			logic_cfg.a2d[i].ff = FF_FF;
+			logic_cfg.a2d[i].ff_mux = MUX_XOR;
+			logic_cfg.a2d[i].ff_srinit = FF_SRINIT0;
+		}
+		next_y = regular_row_up(y, ds->model);
+		if (slice < ds->carry_len-1) {
+			logic_cfg.cout_used = 1;
+			rc = fnet_new(ds->model, &net);
+			if (rc) FAIL(rc);
+			rc = fnet_add_port(ds->model, net, y, x, DEV_LOGIC,
+				DEV_LOG_M_OR_L, LO_COUT);
+			if (rc) FAIL(rc);
+			rc = fnet_add_port(ds->model, net, next_y, x, DEV_LOGIC,
+				DEV_LOG_M_OR_L, LI_CIN);
+			if (rc) FAIL(rc);
+			rc = fnet_route(ds->model, net);
+			if (rc) FAIL(rc);
+			ds->num_nets++;
+		}
+		rc = fdev_logic_setconf(ds->model, y, x, DEV_LOG_M_OR_L,
+			&logic_cfg);
+		if (rc) FAIL(rc);
+		for (i = 0; i < NUM_LUTS; i++) {
+			rc = route_in_slice(ds, y, x, DEV_LOG_M_OR_L,
+				out_pin[i], &in_pin[i], 1, &in_i);
+			if (rc) FAIL(rc);
+			if (in_i == -1) {
+				fprintf(stderr, "#E %s:%i y%i x%i: cannot route "
+					"counter feedback\n", __FILE__, __LINE__, y, x);
+				FAIL(EINVAL);
+			}
+		}
+		set_logic_used(ds, y, x, DEV_LOG_M_OR_L);
+		ds->num_carry_slices++;
+		y = next_y;
+	}
+	return 0;
+fail:
+	return rc;
+}
+
+// Mirrors back_to_cout() in the bitstream extractor: a carry slice is
+// only extracted if its CIN leads back to the COUT of a logic tile,
+// even for the first slice of a chain.
+static int cin_from_logic(struct fpga_model* model, int y, int x)
+{
+	struct fpga_device* dev;
+	int connpt_dests_o, num_dests, i, cout_y, cout_x;
+	str16_t cout_str;
+
+	dev = fdev_p(model, y, x, DEV_LOGIC, DEV_LOG_M_OR_L);
+	if (!dev) { HERE(); return 0; }
+	if (fpga_connpt_find(model, y, x, dev->pinw[LI_CIN],
+		&connpt_dests_o, &num_dests) == NO_CONN
+	    || (num_dests != 1 && num_dests != 2))
+		return 0;
+	for (i = 0; i < num_dests; i++) {
+		fpga_conn_dest(model, y, x, connpt_dests_o+i,
+			&cout_y, &cout_x, &cout_str);
+		if (has_device(model, cout_y, cout_x, DEV_LOGIC))
+			return 1;
+	}
+	return 0;
+}
+
+// Returns 1 if carry_len M/L slices starting at y, x are free, each
+// has a regular row above it and all of them can be extracted again.
+static int carry_chain_fits(struct design_state* ds, int y, int x)
+{
+	int slice;
+
+	for (slice = 0; slice < ds->carry_len; slice++) {
+		if (y == -1
+		    || !has_device(ds->model, y, x, DEV_LOGIC)
+		    || logic_used(ds, y, x, DEV_LOG_M_OR_L)
+		    || !cin_from_logic(ds->model, y, x))
+			return 0;
+		y = regular_row_up(y, ds->model);
+	}
+	return 1;
+}
+
+static int add_carry_chains(struct design_state* ds)
+{
+	int y, x, rc;
+
+	for (x = 0; x < ds->model->x_width; x++) {
+		if (!is_atx(X_FABRIC_LOGIC_COL|X_CENTER_LOGIC_COL, ds->model, x)
+		    || !rand_pct(ds->carry_pct))
+			continue;
+		// chains start at random rows and may not overlap
+		for (y = ds->model->y_height-1; y >= 0; y--) {
+			if (!rand_pct(ds->carry_pct)
+			    || !carry_chain_fits(ds, y, x))
+				continue;
+			rc = add_carry_chain(ds, y, x);
+			if (rc) FAIL(rc);
+		}
+	}
+	return 0;
+fail:
+	return rc;
+}
+
+// Every used lut output is fed back into one lut input of the same
+// slice, picked at random among the reachable ones that are still free.
+static int add_random_slice(struct design_state* ds, int y, int x,
+	int type_idx)
+{
+	struct fpgadev_logic logic_cfg;
+	int in_pins[LI_D6-LI_A1+1];
+	int num_luts, num_in_pins, start, i, j, in_i, rc;
+
+	CLEAR(logic_cfg);
+	num_luts = 1 + rand_below(NUM_LUTS);
+	for (i = 0; i < num_luts; i++) {
+		logic_cfg.a2d[i].flags |= OUT_USED | LUT6VAL_SET;
+		logic_cfg.a2d[i].lut6_val = rand64();
+	}
+	rc = fdev_logic_setconf(ds->model, y, x, type_idx, &logic_cfg);
+	if (rc) FAIL(rc);
+
+	num_in_pins = LI_D6-LI_A1+1;
+	for (i = 0; i < num_in_pins; i++)
+		in_pins[i] = LI_A1 + i;
+	for (i = 0; i < num_luts; i++) {
+		// rotate the free pins to a random start
+		start = rand_below(num_in_pins);
+		for (j = 0; j < start; j++) {
+			in_i = in_pins[0];
+			memmove(&in_pins[0], &in_pins[1],
+				(num_in_pins-1)*sizeof(in_pins[0]));
+			in_pins[num_in_pins-1] = in_i;
+		}
+		rc = route_in_slice(ds, y, x, type_idx, LO_A + i,
+			in_pins, num_in_pins, &in_i);
+		if (rc) FAIL(rc);
+		if (in_i == -1)
+			continue;
+		memmove(&in_pins[in_i], &in_pins[in_i+1],
+			(num_in_pins-in_i-1)*sizeof(in_pins[0]));
+		num_in_pins--;
+	}
+	set_logic_used(ds, y, x, type_idx);
+	ds->num_logic_slices++;
+	return 0;
+fail:
+	return rc;
+}
+
+static int add_random_logic(struct design_state* ds)
+{
+	int y, x, type_idx, rc;
+
+	for (x = 0; x < ds->model->x_width; x++) {
+		for (y = 0; y < ds->model->y_height; y++) {
+			if (!has_device(ds->model, y, x, DEV_LOGIC))
+				continue;
+			for (type_idx = DEV_LOG_M_OR_L; type_idx <= DEV_LOG_X; type_idx++) {
+				if (logic_used(ds, y, x, type_idx)
+				    || !rand_pct(ds->logic_pct))
+					continue;
+				rc = add_random_slice(ds, y, x, type_idx);
+				if (rc) FAIL(rc);
+			}
+		}
+	}
+	return 0;
+fail:
+	return rc;
+}
+
+static int add_random_iobs(struct design_state* ds)
+{
+	static const char* io_std[] =
+		{ IO_LVCMOS33, IO_LVCMOS25, IO_LVCMOS18, IO_LVTTL };
+	const struct xc6_pin_info* pin;
+	int i, iob_y, iob_x, iob_type_idx, rc;
+
+	for (i = 0; i < ds->model->pkg->num_pins; i++) {
+		pin = &ds->model->pkg->pin[i];
+		// skip pins that are not mapped to an IOB in this model
+		if (!pin->description || strncmp(pin->description, "IO_", 3)
+		    || ds->model->pin_t2_io[i] == -1
+		    || !rand_pct(ds->iob_pct))
+			continue;
+		rc = fpga_find_iob(ds->model, pin->name, &iob_y, &iob_x,
+			&iob_type_idx);
+		if (rc) FAIL(rc);
+		if (rand_below(2))
+			rc = fdev_iob_input(ds->model, iob_y, iob_x,
+				iob_type_idx, io_std[rand_below(4)]);
+		else
+			rc = fdev_iob_output(ds->model, iob_y, iob_x,
+				iob_type_idx, io_std[rand_below(4)]);
+		if (rc) FAIL(rc);
+		ds->num_iobs++;
+	}
+	return 0;
+fail:
+	return rc;
+}
+
+// cmdline_intvar() returns 0 for missing variables, but 0 is a
+// valid density here.
+static int intvar_default(int argc, char** argv, const char* var, int def)
+{
+	return cmdline_strvar(argc, argv, var)
+		? cmdline_intvar(argc, argv, var) : def;
+}
+
+int main(int argc, char** argv)
+{
+	struct fpga_model model;
+	struct design_state ds;
+	const char* param_out;
+	char path[1024];
+	FILE* f = 0;
+	int seed, rc;
+
+	if (cmdline_help(argc, argv)) {
+		printf( "       %*s [-Dseed=<num, default 1>]\n"
+			"       %*s [-Dlogic=<percent of free logic slices, default 50>]\n"
+			"       %*s [-Diob=<percent of bonded IOBs, default 50>]\n"
+			"       %*s [-Dcarry=<percent, density of carry chains, default 25>]\n"
+			"       %*s [-Dcarry_len=<slices per carry chain, default 4>]\n"
+			"       %*s [-Dout=<name, writes name.fp and name.bit>]\n"
+			"\n"
+			"Without -Dout, the floorplan is written to stdout.\n"
+			"\n", (int) strlen(*argv), "", (int) strlen(*argv), "",
+			(int) strlen(*argv), "", (int) strlen(*argv), "",
+			(int) strlen(*argv), "", (int) strlen(*argv), "");
+		return 0;
+	}
+	memset(&ds, 0, sizeof(ds));
+	seed = intvar_default(argc, argv, "seed", 1);
+	ds.logic_pct = intvar_default(argc, argv, "logic", 50);
+	ds.iob_pct = intvar_default(argc, argv, "iob", 50);
+	ds.carry_pct = intvar_default(argc, argv, "carry", 25);
+	ds.carry_len = intvar_default(argc, argv, "carry_len", 4);
+	if (ds.carry_len < 1) {
+		fprintf(stderr, "#E carry_len must be at least 1\n");
+		return EXIT_FAILURE;
+	}
+	param_out = cmdline_strvar(argc, argv, "out");
+	// xorshift must not start at 0
+	s_rand_state = 0x9E3779B97F4A7C15ULL ^ (uint64_t) seed;
+
+	rc = fpga_build_model(&model, cmdline_part(argc, argv),
+		cmdline_package(argc, argv));
+	if (rc) FAIL(rc);
+	ds.model = &model;
+	ds.logic_used = calloc(model.x_width*model.y_height, 1);
+	if (!ds.logic_used) FAIL(ENOMEM);
+
+	rc = add_carry_chains(&ds);
+	if (rc) FAIL(rc);
+	rc = add_random_logic(&ds);
+	if (rc) FAIL(rc);
+	rc = add_random_iobs(&ds);
+	if (rc) FAIL(rc);
+	fprintf(stderr, "O seed %i: %i carry slices, %i logic slices, "
+		"%i IOBs, %i nets (%i lut outputs unroutable)\n", seed,
+		ds.num_carry_slices, ds.num_logic_slices, ds.num_iobs,
+		ds.num_nets, ds.num_unroutable);
+
+	if (!param_out) {
+		rc = write_floorplan(stdout, &model, FP_DEFAULT);
+		if (rc) FAIL(rc);
+	} else {
+		snprintf(path, sizeof(path), "%s.fp", param_out);
+		if (!(f = fopen(path, "w"))) FAIL(errno);
+		rc = write_floorplan(f, &model, FP_DEFAULT);
+		if (rc) FAIL(rc);
+		fclose(f);
+
+		snprintf(path, sizeof(path), "%s.bit", param_out);
+		if (!(f = fopen(path, "w"))) FAIL(errno);
+		rc = write_bitfile(f, &model);
+		if (rc) FAIL(rc);
+		fclose(f);
+		f = 0;
+	}
+	free(ds.logic_used);
+	return fpga_free_model(&model);
+fail:
+	if (f) fclose(f);
+	free(ds.logic_used);
+	fpga_free_model(&model);
+	return rc;
+}
@@ -8,14 +8,12 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <pthread.h>
 
 #include "helper.h"
 
 #define LINE_LENGTH	1024
 
-static int s_numlines;
-static char s_lines[1000][LINE_LENGTH];
-
 // returns 0 if no number found
 static int find_rightmost_num(const char* s, int s_len,
 	int* dig_start, int* dig_end)
@@ -183,70 +181,124 @@ static int is_known_suffix(const char* str, int str_len)
 	return 0;
 }
 
-static void next_unequal_word(
-	const char* a, int a_start, int* a_beg, int* a_end,
-	const char* b, int b_start, int* b_beg, int* b_end)
+// The sort key of a line is parsed once into the word
+// positions and the sequence number found in each word.
+struct seq_word
+{
+	int beg, end; // offsets in line
+	// num_start and num_end are relative to beg, num_end
+	// is 0 if the word has no number.
+	int num_start, num_end;
+	int num;
+	// set if the rest of the word after the number is
+	// empty or a known suffix
+	int suffix_known;
+};
+
+// A line is allocated in one block with its words
+// and the zero-terminated string (without newline).
+struct seq_line
+{
+	int len; // without the newline
+	int has_nl; // print_line() only appends a newline if read
+	int num_words;
+	struct seq_word* words;
+	char* str;
+};
+
+static int is_word_sep(char c)
 {
-	*a_beg = a_start;
-	*a_end = a_start;
-	*b_beg = b_start;
-	*b_end = b_start;
+	return c == ' ' || c == '\t' || c == '\n';
+}
 
-	// find the first non-matching word
-	while (1) {
-		next_word(a, *a_beg, a_beg, a_end);
-		next_word(b, *b_beg, b_beg, b_end);
+static struct seq_line* seq_line_new(const char* s, int len)
+{
+	struct seq_line* line;
+	struct seq_word* word;
+	int i, num_words, has_nl;
+
+	has_nl = len && s[len-1] == '\n';
+	if (has_nl)
+		len--;
+	num_words = 0;
+	for (i = 0; i < len; i++) {
+		if (!is_word_sep(s[i]) && (!i || is_word_sep(s[i-1])))
+			num_words++;
+	}
+	line = malloc(sizeof(*line) + num_words*sizeof(*line->words) + len+1);
+	if (!line) {
+		fprintf(stderr, "Out of memory in %s:%i\n", __FILE__, __LINE__);
+		return 0;
+	}
+	line->len = len;
+	line->has_nl = has_nl;
+	line->num_words = num_words;
+	line->words = (struct seq_word*) &line[1];
+	line->str = (char*) &line->words[num_words];
+	memcpy(line->str, s, len);
+	line->str[len] = 0;
+
+	i = 0;
+	for (word = line->words; word < &line->words[num_words]; word++) {
+		while (is_word_sep(s[i])) i++;
+		word->beg = i;
+		while (i < len && !is_word_sep(s[i])) i++;
+		word->end = i;
+		find_number(&s[word->beg], word->end-word->beg,
+			&word->num_start, &word->num_end);
+		word->num = to_i(&s[word->beg+word->num_start],
+			word->num_end-word->num_start);
+		word->suffix_known = word->beg+word->num_end == word->end
+			|| is_known_suffix(&s[word->beg+word->num_end],
+				word->end-word->beg-word->num_end);
+	}
+	return line;
+}
 
-		if (*a_end-*a_beg <= 0
-		    || *b_end-*b_beg <= 0)
-			return;
+// returns the index of the first word that differs in a and b,
+// starting at word start
+static int next_unequal_word(const struct seq_line* a,
+	const struct seq_line* b, int start)
+{
+	const struct seq_word* aw, *bw;
+	int i;
 
-		if (str_cmp(&a[*a_beg], *a_end-*a_beg, &b[*b_beg], *b_end-*b_beg))
-			return;
-		*a_beg = *a_end;
-		*b_beg = *b_end;
+	for (i = start; i < a->num_words && i < b->num_words; i++) {
+		aw = &a->words[i];
+		bw = &b->words[i];
+		if (str_cmp(&a->str[aw->beg], aw->end-aw->beg,
+			    &b->str[bw->beg], bw->end-bw->beg))
+			break;
 	}
+	return i;
 }
 
-static int sort_lines(const void* a, const void* b)
+static int seq_cmp(const struct seq_line* a, const struct seq_line* b)
 {
-	const char* _a, *_b;
-	int a_word_beg, a_word_end, b_word_beg, b_word_end;
-	int a_num, b_num, a_num_start, b_num_start, a_num_end, b_num_end;
-	int num_result, result, suffix_result;
-
-	_a = a;
-	_b = b;
+	const struct seq_word* aw, *bw;
+	const char* a_word, *b_word;
+	int i, num_result, result, suffix_result;
 
 	// find the first non-matching word
-	a_word_beg = 0;
-	b_word_beg = 0;
-	next_unequal_word(_a, a_word_beg, &a_word_beg, &a_word_end,
-		_b, b_word_beg, &b_word_beg, &b_word_end);
-
-	if (a_word_end-a_word_beg <= 0) {
-		if (b_word_end-b_word_beg <= 0)
+	i = next_unequal_word(a, b, 0);
+	if (i >= a->num_words) {
+		if (i >= b->num_words)
 			return 0;
 		return -1;
 	}
-	if (b_word_end-b_word_beg <= 0) {
-		if (a_word_end-a_word_beg <= 0)
-			return 0;
+	if (i >= b->num_words)
 		return 1;
-	}
-
-	// first try to find 2 numbers
-	find_number(&_a[a_word_beg], a_word_end-a_word_beg,
-		&a_num_start, &a_num_end);
-	find_number(&_b[b_word_beg], b_word_end-b_word_beg,
-		&b_num_start, &b_num_end);
+	aw = &a->words[i];
+	bw = &b->words[i];
+	a_word = &a->str[aw->beg];
+	b_word = &b->str[bw->beg];
 
 	// if we cannot find both numbers, return a regular
 	// string comparison over the entire word
-	if (a_num_end <= a_num_start
-	    || b_num_end <= b_num_start) {
-		result = str_cmp(&_a[a_word_beg], a_word_end-a_word_beg,
-			&_b[b_word_beg], b_word_end-b_word_beg);
+	if (aw->num_end <= aw->num_start
+	    || bw->num_end <= bw->num_start) {
+		result = str_cmp(a_word, aw->end-aw->beg,
+			b_word, bw->end-bw->beg);
 		if (!result) {
 			fprintf(stderr, "Internal error in %s:%i\n",
 				__FILE__, __LINE__);
@@ -255,52 +307,32 @@ static int sort_lines(const void* a, const void* b)
 		return result;
 	}
 	// A number must always be prefixed by at least one character.
-	if (!a_num_start || !b_num_start) {
+	if (!aw->num_start || !bw->num_start) {
 		fprintf(stderr, "Internal error in %s:%i\n",
 			__FILE__, __LINE__);
 		exit(0);
 	}
 	// otherwise compare the string up to the 2 numbers,
 	// if it does not match return that result
-	result = str_cmp(&_a[a_word_beg], a_num_start,
-		&_b[b_word_beg], b_num_start);
+	result = str_cmp(a_word, aw->num_start, b_word, bw->num_start);
 	if (result)
 		return result;
 
-	a_num_start += a_word_beg;
-	a_num_end += a_word_beg;
-	b_num_start += b_word_beg;
-	b_num_end += b_word_beg;
-	if (a_num_end > a_word_end
-	    || b_num_end > b_word_end) {
-		fprintf(stderr, "Internal error in %s:%i\n",
-			__FILE__, __LINE__);
-		fprintf(stderr, "sort_line_a: %s", _a);
-		fprintf(stderr, "sort_line_b: %s", _b);
-		exit(1);
-	}
-	if ((a_word_end-a_num_end == 0
-	     || is_known_suffix(&_a[a_num_end],
-		a_word_end-a_num_end))
-	    && (b_word_end-b_num_end == 0
-	     || is_known_suffix(&_b[b_num_end],
-		b_word_end-b_num_end))) {
+	if (aw->suffix_known && bw->suffix_known) {
 		// known suffix comes before number
-		suffix_result = str_cmp(&_a[a_num_end],
-			a_word_end-a_num_end,
-			&_b[b_num_end], b_word_end-b_num_end);
+		suffix_result = str_cmp(&a_word[aw->num_end],
+			aw->end-aw->beg-aw->num_end,
+			&b_word[bw->num_end], bw->end-bw->beg-bw->num_end);
 		if (suffix_result)
 			return suffix_result;
 	}
-
-	a_num = to_i(&_a[a_num_start], a_num_end-a_num_start);
-	b_num = to_i(&_b[b_num_start], b_num_end-b_num_start);
-	num_result = a_num-b_num;
+	num_result = aw->num-bw->num;
 
 	// if the non-known suffixes don't match, return numeric result
 	// if numbers are not equal, otherwise suffix result
-	suffix_result = str_cmp(&_a[a_num_end], a_word_end-a_num_end,
-		&_b[b_num_end], b_word_end-b_num_end);
+	suffix_result = str_cmp(&a_word[aw->num_end],
+		aw->end-aw->beg-aw->num_end,
+		&b_word[bw->num_end], bw->end-bw->beg-bw->num_end);
 	if (suffix_result) {
 		if (num_result) return num_result;
 		return suffix_result;
@@ -311,61 +343,43 @@ static int sort_lines(const void* a, const void* b)
 	if (!num_result) {
 		fprintf(stderr, "Internal error in %s:%i\n",
 			__FILE__, __LINE__);
-		fprintf(stderr, "sort_line_a: %s", _a);
-		fprintf(stderr, "sort_line_b: %s", _b);
+		fprintf(stderr, "sort_line_a: %s\n", a->str);
+		fprintf(stderr, "sort_line_b: %s\n", b->str);
 		exit(1);
 	}
 
 	// find second non-equal word
-	next_unequal_word(_a, a_word_end, &a_word_beg, &a_word_end,
-		_b, b_word_end, &b_word_beg, &b_word_end);
-	if (a_word_end <= a_word_beg
-	    || b_word_end <= b_word_beg)
+	i = next_unequal_word(a, b, i+1);
+	if (i >= a->num_words || i >= b->num_words)
 		return num_result;
-	
+	aw = &a->words[i];
+	bw = &b->words[i];
+	a_word = &a->str[aw->beg];
+	b_word = &b->str[bw->beg];
+
 	// if no numbers in second non-equal words, fall back
 	// to numeric result of first word
-	find_number(&_a[a_word_beg], a_word_end-a_word_beg,
-		&a_num_start, &a_num_end);
-	find_number(&_b[b_word_beg], b_word_end-b_word_beg,
-		&b_num_start, &b_num_end);
-	if (a_num_end <= a_num_start
-	    || b_num_end <= b_num_start)
+	if (aw->num_end <= aw->num_start
+	    || bw->num_end <= bw->num_start)
 		return num_result;
 	// A number must always be prefixed by at least one character.
-	if (!a_num_start || !b_num_start) {
+	if (!aw->num_start || !bw->num_start) {
 		fprintf(stderr, "Internal error in %s:%i\n",
 			__FILE__, __LINE__);
 		exit(0);
 	}
 	// If the prefix string of the second word does not
 	// match, fall back to numeric result of first word.
-	result = str_cmp(&_a[a_word_beg], a_num_start,
-		&_b[b_word_beg], b_num_start);
+	result = str_cmp(a_word, aw->num_start, b_word, bw->num_start);
 	if (result)
 		return num_result;
-	a_num_start += a_word_beg;
-	a_num_end += a_word_beg;
-	b_num_start += b_word_beg;
-	b_num_end += b_word_beg;
-	if (a_num_end > a_word_end
-	    || b_num_end > b_word_end) {
-		fprintf(stderr, "Internal error in %s:%i\n",
-			__FILE__, __LINE__);
-		exit(0);
-	}
 	// if there are known suffixes in second non-equal
 	// words, compare those first
-	if ((a_word_end-a_num_end == 0
-	     || is_known_suffix(&_a[a_num_end],
-		a_word_end-a_num_end))
-	    && (b_word_end-b_num_end == 0
-	     || is_known_suffix(&_b[b_num_end],
-		b_word_end-b_num_end))) {
+	if (aw->suffix_known && bw->suffix_known) {
 		// known suffix comes before number
-		suffix_result = str_cmp(&_a[a_num_end],
-			a_word_end-a_num_end,
-			&_b[b_num_end], b_word_end-b_num_end);
+		suffix_result = str_cmp(&a_word[aw->num_end],
+			aw->end-aw->beg-aw->num_end,
+			&b_word[bw->num_end], bw->end-bw->beg-bw->num_end);
 		if (suffix_result)
 			return suffix_result;
 	}
@@ -373,51 +387,413 @@ static int sort_lines(const void* a, const void* b)
 	return num_result;
 }
 
+static int sort_lines(const void* a, const void* b)
+{
+	return seq_cmp(*(struct seq_line* const*) a,
+		*(struct seq_line* const*) b);
+}
+
+static int print_line(FILE* f, const struct seq_line* line)
+{
+	fwrite(line->str, 1, line->len, f);
+	if (line->has_nl)
+		fputc('\n', f);
+	return ferror(f) ? -1 : 0;
+}
+
+// The default mode sorts a sliding window of 1000 lines, which
+// is enough for input that was pre-sorted with sort.
+static int sort_window(FILE* fp)
+{
+	struct seq_line* lines[1000];
+	char buf[LINE_LENGTH];
+	int i, num_lines;
+
+	num_lines = 0;
+	// read 200 lines to beginning of buffer
+	while (num_lines < 200 && fgets(buf, sizeof(buf), fp)) {
+		if (!(lines[num_lines] = seq_line_new(buf, strlen(buf))))
+			return -1;
+		num_lines++;
+	}
+	while (1) {
+		// read another 800 lines
+		while (num_lines < 1000 && fgets(buf, sizeof(buf), fp)) {
+			if (!(lines[num_lines] = seq_line_new(buf, strlen(buf))))
+				return -1;
+			num_lines++;
+		}
+		if (!num_lines) break;
+		// sort 1000 lines
+		qsort(lines, num_lines, sizeof(lines[0]), sort_lines);
+		// print first 800 lines
+		for (i = 0; i < 800; i++) {
+			if (i >= num_lines) break;
+			print_line(stdout, lines[i]);
+			free(lines[i]);
+		}
+		// move up last 200 lines to beginning of buffer
+		if (num_lines > i) {
+			memmove(&lines[0], &lines[i],
+				(num_lines-i)*sizeof(lines[0]));
+			num_lines -= i;
+		} else
+			num_lines = 0;
+	}
+	return 0;
+}
+
+//
+// External sort: the input is read in batches of up to BATCH_BYTES,
+// each batch is split into one slice per cpu and the slices are
+// sorted in parallel. If the whole input fits into one batch, the
+// slices are merged straight to stdout. Otherwise each batch is
+// merged into a temporary run file and all runs are merged at the
+// end. Run files store the parsed lines, so no line is parsed twice.
+//
+
+#define BATCH_BYTES	(256*1024*1024)
+#define MAX_THREADS	64
+
+struct seq_batch
+{
+	struct seq_line** lines;
+	int num_lines, lines_alloc;
+	long long num_bytes;
+};
+
+struct sort_slice
+{
+	struct seq_line** lines;
+	int num_lines;
+};
+
+// A merge source is either an in-memory sorted slice or a run file.
+struct merge_src
+{
+	struct seq_line** lines;
+	int num_lines, next_line;
+	FILE* run_f;
+	struct seq_line* cur;
+};
+
+static void* sort_slice_thread(void* arg)
+{
+	struct sort_slice* slice = arg;
+	qsort(slice->lines, slice->num_lines, sizeof(*slice->lines), sort_lines);
+	return 0;
+}
+
+static int num_cpus(void)
+{
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+	if (n < 1) return 1;
+	if (n > MAX_THREADS) return MAX_THREADS;
+	return n;
+}
+
+static int write_run_line(FILE* f, const struct seq_line* line)
+{
+	if (fwrite(&line->len, sizeof(line->len), 1, f) != 1
+	    || fwrite(&line->has_nl, sizeof(line->has_nl), 1, f) != 1
+	    || fwrite(&line->num_words, sizeof(line->num_words), 1, f) != 1
+	    || fwrite(line->words, sizeof(*line->words), line->num_words, f)
+		!= line->num_words
+	    || fwrite(line->str, 1, line->len, f) != line->len) {
+		fprintf(stderr, "Error writing temporary file.\n");
+		return -1;
+	}
+	return 0;
+}
+
+// returns 0 and sets *line to 0 at the end of the run
+static int read_run_line(FILE* f, struct seq_line** line)
+{
+	struct seq_line* new_line;
+	int len, has_nl, num_words;
+
+	*line = 0;
+	if (fread(&len, sizeof(len), 1, f) != 1)
+		return 0;
+	if (fread(&has_nl, sizeof(has_nl), 1, f) != 1)
+		goto fail;
+	if (fread(&num_words, sizeof(num_words), 1, f) != 1)
+		goto fail;
+	new_line = malloc(sizeof(*new_line) + num_words*sizeof(*new_line->words) + len+1);
+	if (!new_line) {
+		fprintf(stderr, "Out of memory in %s:%i\n", __FILE__, __LINE__);
+		return -1;
+	}
+	new_line->len = len;
+	new_line->has_nl = has_nl;
+	new_line->num_words = num_words;
+	new_line->words = (struct seq_word*) &new_line[1];
+	new_line->str = (char*) &new_line->words[num_words];
+	if (fread(new_line->words, sizeof(*new_line->words), num_words, f)
+		!= num_words
+	    || fread(new_line->str, 1, len, f) != len) {
+		free(new_line);
+		goto fail;
+	}
+	new_line->str[len] = 0;
+	*line = new_line;
+	return 0;
+fail:
+	fprintf(stderr, "Error reading temporary file.\n");
+	return -1;
+}
+
+static int merge_next(struct merge_src* src)
+{
+	if (src->run_f) {
+		free(src->cur);
+		return read_run_line(src->run_f, &src->cur);
+	}
+	free(src->cur);
+	src->cur = (src->next_line < src->num_lines)
+		? src->lines[src->next_line++] : 0;
+	return 0;
+}
+
+static void heap_sift_down(struct merge_src** heap, int heap_len, int i)
+{
+	struct merge_src* tmp;
+	int child;
+
+	while ((child = 2*i+1) < heap_len) {
+		if (child+1 < heap_len
+		    && seq_cmp(heap[child+1]->cur, heap[child]->cur) < 0)
+			child++;
+		if (seq_cmp(heap[i]->cur, heap[child]->cur) <= 0)
+			break;
+		tmp = heap[i];
+		heap[i] = heap[child];
+		heap[child] = tmp;
+		i = child;
+	}
+}
+
+// k-way merge of all sources into f, freeing all lines
+static int merge_sources(struct merge_src* srcs, int num_srcs, FILE* f,
+	int to_run)
+{
+	struct merge_src** heap;
+	int i, heap_len, rc;
+
+	heap = malloc(num_srcs*sizeof(*heap));
+	if (!heap) {
+		fprintf(stderr, "Out of memory in %s:%i\n", __FILE__, __LINE__);
+		return -1;
+	}
+	heap_len = 0;
+	for (i = 0; i < num_srcs; i++) {
+		srcs[i].cur = 0;
+		if (merge_next(&srcs[i])) goto fail;
+		if (srcs[i].cur)
+			heap[heap_len++] = &srcs[i];
+	}
+	for (i = heap_len/2-1; i >= 0; i--)
+		heap_sift_down(heap, heap_len, i);
+	while (heap_len) {
+		rc = to_run ? write_run_line(f, heap[0]->cur)
+			: print_line(f, heap[0]->cur);
+		if (rc) goto fail;
+		if (merge_next(heap[0])) goto fail;
+		if (!heap[0]->cur)
+			heap[0] = heap[--heap_len];
+		heap_sift_down(heap, heap_len, 0);
+	}
+	free(heap);
+	return 0;
+fail:
+	free(heap);
+	return -1;
+}
+
+// Sorts the batch in parallel slices and merges the slices into
+// a new run file, or to stdout if run_f is 0.
+static int sort_batch(struct seq_batch* batch, FILE* run_f)
+{
+	struct sort_slice slices[MAX_THREADS];
+	struct merge_src srcs[MAX_THREADS];
+	pthread_t threads[MAX_THREADS];
+	int i, num_slices, slice_len, started, rc;
+
+	num_slices = num_cpus();
+	if (num_slices > batch->num_lines)
+		num_slices = batch->num_lines ? batch->num_lines : 1;
+	slice_len = (batch->num_lines + num_slices-1) / num_slices;
+	for (i = 0; i < num_slices; i++) {
+		slices[i].lines = &batch->lines[i*slice_len];
+		slices[i].num_lines = batch->num_lines - i*slice_len;
+		if (slices[i].num_lines > slice_len)
+			slices[i].num_lines = slice_len;
+		if (slices[i].num_lines < 0)
+			slices[i].num_lines = 0;
+	}
+	// the main thread sorts the first slice
+	for (started = 1; started < num_slices; started++) {
+		rc = pthread_create(&threads[started], 0, sort_slice_thread,
+			&slices[started]);
+		if (rc) {
+			fprintf(stderr, "Cannot create thread: %s\n", strerror(rc));
+			break;
+		}
+	}
+	for (i = started; i < num_slices; i++)
+		sort_slice_thread(&slices[i]);
+	sort_slice_thread(&slices[0]);
+	for (i = 1; i < started; i++)
+		pthread_join(threads[i], 0);
+
+	memset(srcs, 0, sizeof(srcs));
+	for (i = 0; i < num_slices; i++) {
+		srcs[i].lines = slices[i].lines;
+		srcs[i].num_lines = slices[i].num_lines;
+	}
+	rc = merge_sources(srcs, num_slices, run_f ? run_f : stdout,
+		/*to_run*/ run_f != 0);
+	batch->num_lines = 0;
+	batch->num_bytes = 0;
+	return rc;
+}
+
+static int sort_external(FILE* fp)
+{
+	struct seq_batch batch;
+	struct merge_src* runs;
+	struct seq_line* line;
+	FILE** run_files;
+	char* buf;
+	size_t buf_size;
+	ssize_t len;
+	void* new_ptr;
+	int i, num_runs, rc;
+
+	CLEAR(batch);
+	buf = 0;
+	buf_size = 0;
+	run_files = 0;
+	num_runs = 0;
+	rc = -1;
+	while ((len = getline(&buf, &buf_size, fp)) > 0) {
+		if (batch.num_lines >= batch.lines_alloc) {
+			batch.lines_alloc = batch.lines_alloc
+				? batch.lines_alloc*2 : 64*1024;
+			new_ptr = realloc(batch.lines,
+				batch.lines_alloc*sizeof(*batch.lines));
+			if (!new_ptr) {
+				fprintf(stderr, "Out of memory in %s:%i\n",
+					__FILE__, __LINE__);
+				goto out;
+			}
+			batch.lines = new_ptr;
+		}
+		if (!(line = seq_line_new(buf, len)))
+			goto out;
+		batch.lines[batch.num_lines++] = line;
+		batch.num_bytes += sizeof(*line) + line->len
+			+ line->num_words*sizeof(*line->words);
+		if (batch.num_bytes < BATCH_BYTES)
+			continue;
+
+		// spill batch to a new run file
+		new_ptr = realloc(run_files, (num_runs+1)*sizeof(*run_files));
+		if (!new_ptr) {
+			fprintf(stderr, "Out of memory in %s:%i\n",
+				__FILE__, __LINE__);
+			goto out;
+		}
+		run_files = new_ptr;
+		if (!(run_files[num_runs] = tmpfile())) {
+			fprintf(stderr, "Cannot create temporary file.\n");
+			goto out;
+		}
+		num_runs++;
+		if (sort_batch(&batch, run_files[num_runs-1]))
+			goto out;
+	}
+	if (!num_runs) {
+		rc = sort_batch(&batch, /*run_f*/ 0);
+		goto out;
+	}
+	if (batch.num_lines) {
+		new_ptr = realloc(run_files, (num_runs+1)*sizeof(*run_files));
+		if (!new_ptr) {
+			fprintf(stderr, "Out of memory in %s:%i\n",
+				__FILE__, __LINE__);
+			goto out;
+		}
+		run_files = new_ptr;
+		if (!(run_files[num_runs] = tmpfile())) {
+			fprintf(stderr, "Cannot create temporary file.\n");
+			goto out;
+		}
+		num_runs++;
+		if (sort_batch(&batch, run_files[num_runs-1]))
+			goto out;
+	}
+	runs = calloc(num_runs, sizeof(*runs));
+	if (!runs) {
+		fprintf(stderr, "Out of memory in %s:%i\n", __FILE__, __LINE__);
+		goto out;
+	}
+	for (i = 0; i < num_runs; i++) {
+		rewind(run_files[i]);
+		runs[i].run_f = run_files[i];
+	}
+	rc = merge_sources(runs, num_runs, stdout, /*to_run*/ 0);
+	free(runs);
+out:
+	for (i = 0; i < num_runs; i++)
+		fclose(run_files[i]);
+	free(run_files);
+	for (i = 0; i < batch.num_lines; i++)
+		free(batch.lines[i]);
+	free(batch.lines);
+	free(buf);
+	return rc;
+}
+
 int main(int argc, char** argv)
 {
+	static char out_buf[1024*1024];
 	FILE* fp = 0;
-	int i;
+	int external, file_arg, rc;
 
-	if (argc < 2) {
+	external = 0;
+	file_arg = 1;
+	if (argc > 1 && !strcmp(argv[1], "--external")) {
+		external = 1;
+		file_arg++;
+	}
+	if (argc < file_arg+1) {
 		fprintf(stderr,
 			"sort_seq - sort by sequence\n"
-			"Usage: %s <data_file> | - for stdin\n", argv[0]);
+			"Usage: %s [--external] <data_file> | - for stdin\n"
+			"  --external  sort the entire input instead of a window\n"
+			"              of 1000 lines, using temporary files\n",
+			argv[0]);
 		goto xout;
 	}
-	if (!strcmp(argv[1], "-"))
+	if (!strcmp(argv[file_arg], "-"))
 		fp = stdin;
 	else {
-		fp = fopen(argv[1], "r");
+		fp = fopen(argv[file_arg], "r");
 		if (!fp) {
-			fprintf(stderr, "Error opening %s.\n", argv[1]);
+			fprintf(stderr, "Error opening %s.\n", argv[file_arg]);
 			goto xout;
 		}
 	}
-	s_numlines = 0;
-	// read 200 lines to beginning of buffer
-	while (s_numlines < 200
-	       && fgets(s_lines[s_numlines], sizeof(s_lines[0]), fp))
-		s_numlines++;
-	while (1) {
-		// read another 800 lines
-		while (s_numlines < 1000
-		       && fgets(s_lines[s_numlines], sizeof(s_lines[0]), fp))
-			s_numlines++;
-		if (!s_numlines) break;
-		// sort 1000 lines
-		qsort(s_lines, s_numlines, sizeof(s_lines[0]), sort_lines);
-		// print first 800 lines
-		for (i = 0; i < 800; i++) {
-			if (i >= s_numlines) break;
-			printf("%s", s_lines[i]);
-		}
-		// move up last 200 lines to beginning of buffer
-		if (s_numlines > i) {
-			memmove(s_lines[0], s_lines[i],
-				(s_numlines-i)*sizeof(s_lines[0]));
-			s_numlines -= i;
-		} else
-			s_numlines = 0;
+	setvbuf(stdout, out_buf, _IOFBF, sizeof(out_buf));
+	if (external)
+		rc = sort_external(fp);
+	else
+		rc = sort_window(fp);
+	if (rc) goto xout;
+	if (fflush(stdout)) {
+		fprintf(stderr, "Error writing output.\n");
+		goto xout;
 	}
 	fclose(fp);
 	return EXIT_SUCCESS;
@@ -0,0 +1,9 @@
+    { "y" : 67, "x" : 13, "dev" : "LOGIC", "dev_idx" : 0, "D6_lut_val" : "0x00000000000000FF" },
+    { "y" : 67, "x" : 13, "dev" : "LOGIC", "dev_idx" : 0, "D_ram_mode" : "DPRAM64" },
+    { "y" : 67, "x" : 13, "dev" : "LOGIC", "dev_idx" : 0, "clk" : "CLK" },
+    { "y" : 67, "x" : 13, "dev" : "LOGIC", "dev_idx" : 0, "wemux" : "CE" }
+net_i 5:      { "type" : "in", "y" : 67, "x" : 13, "dev" : "LOGIC", "dev_idx" : 0, "pin" : "CLK" }
+net_i 6:      { "type" : "in", "y" : 67, "x" : 13, "dev" : "LOGIC", "dev_idx" : 0, "pin" : "CE" }
+net_i 7:      { "type" : "in", "y" : 67, "x" : 13, "dev" : "LOGIC", "dev_idx" : 0, "pin" : "D4" }
+net_i 8:      { "type" : "in", "y" : 67, "x" : 13, "dev" : "LOGIC", "dev_idx" : 0, "pin" : "D5" }
+net_i 9:      { "type" : "in", "y" : 67, "x" : 13, "dev" : "LOGIC", "dev_idx" : 0, "pin" : "D6" }
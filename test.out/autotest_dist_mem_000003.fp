@@ -0,0 +1,11 @@
+    { "y" : 67, "x" : 13, "dev" : "LOGIC", "dev_idx" : 0, "D6_lut_val" : "0x00000000000000FF" },
+    { "y" : 67, "x" : 13, "dev" : "LOGIC", "dev_idx" : 0, "D_ram_mode" : "DPRAM64" },
+    { "y" : 67, "x" : 13, "dev" : "LOGIC", "dev_idx" : 0, "clk" : "CLK" },
+    { "y" : 67, "x" : 13, "dev" : "LOGIC", "dev_idx" : 0, "wemux" : "WE" },
+    { "y" : 67, "x" : 13, "dev" : "LOGIC", "dev_idx" : 0, "wa7_used" : true }
+net_i 9:      { "type" : "in", "y" : 67, "x" : 13, "dev" : "LOGIC", "dev_idx" : 0, "pin" : "CLK" }
+net_i 10:      { "type" : "in", "y" : 67, "x" : 13, "dev" : "LOGIC", "dev_idx" : 0, "pin" : "WE" }
+net_i 11:      { "type" : "in", "y" : 67, "x" : 13, "dev" : "LOGIC", "dev_idx" : 0, "pin" : "CX" }
+net_i 12:      { "type" : "in", "y" : 67, "x" : 13, "dev" : "LOGIC", "dev_idx" : 0, "pin" : "D4" }
+net_i 13:      { "type" : "in", "y" : 67, "x" : 13, "dev" : "LOGIC", "dev_idx" : 0, "pin" : "D5" }
+net_i 14:      { "type" : "in", "y" : 67, "x" : 13, "dev" : "LOGIC", "dev_idx" : 0, "pin" : "D6" }
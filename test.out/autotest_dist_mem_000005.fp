@@ -0,0 +1,14 @@
+    { "y" : 67, "x" : 13, "dev" : "LOGIC", "dev_idx" : 0, "D6_lut_val" : "0x00000000000000FF" },
+    { "y" : 67, "x" : 13, "dev" : "LOGIC", "dev_idx" : 0, "D_ram_mode" : "DPRAM64" },
+    { "y" : 67, "x" : 13, "dev" : "LOGIC", "dev_idx" : 0, "A6_lut_val" : "0x00000000000000FF" },
+    { "y" : 67, "x" : 13, "dev" : "LOGIC", "dev_idx" : 0, "A_ram_mode" : "DPRAM64" },
+    { "y" : 67, "x" : 13, "dev" : "LOGIC", "dev_idx" : 0, "clk" : "CLK" },
+    { "y" : 67, "x" : 13, "dev" : "LOGIC", "dev_idx" : 0, "wemux" : "WE" }
+net_i 20:      { "type" : "in", "y" : 67, "x" : 13, "dev" : "LOGIC", "dev_idx" : 0, "pin" : "CLK" }
+net_i 21:      { "type" : "in", "y" : 67, "x" : 13, "dev" : "LOGIC", "dev_idx" : 0, "pin" : "WE" }
+net_i 22:      { "type" : "in", "y" : 67, "x" : 13, "dev" : "LOGIC", "dev_idx" : 0, "pin" : "A4" }
+net_i 23:      { "type" : "in", "y" : 67, "x" : 13, "dev" : "LOGIC", "dev_idx" : 0, "pin" : "A5" }
+net_i 24:      { "type" : "in", "y" : 67, "x" : 13, "dev" : "LOGIC", "dev_idx" : 0, "pin" : "A6" }
+net_i 25:      { "type" : "in", "y" : 67, "x" : 13, "dev" : "LOGIC", "dev_idx" : 0, "pin" : "D4" }
+net_i 26:      { "type" : "in", "y" : 67, "x" : 13, "dev" : "LOGIC", "dev_idx" : 0, "pin" : "D5" }
+net_i 27:      { "type" : "in", "y" : 67, "x" : 13, "dev" : "LOGIC", "dev_idx" : 0, "pin" : "D6" }